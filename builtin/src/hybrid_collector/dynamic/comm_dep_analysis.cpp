@@ -13,35 +13,10 @@ using namespace std;
 #define MAX_WAIT_REQ 50
 #define MAX_NPROCS 1000
 
-#define DEBUG
-
-typedef struct CollInfoStruct {
-  string call_path;
-  string comm;
-  string count;
-  string exe_time;
-} CIS;
-
-typedef struct P2PInfoStruct {
-  char type = 0;
-  string call_path;
-  int request_count = 0;
-  int source[MAX_WAIT_REQ] = {0};
-  int dest[MAX_WAIT_REQ] = {0};
-  int tag[MAX_WAIT_REQ] = {0};
-  string count;
-  string exe_time;
-} PIS;
+// MAX_WAIT_REQ sizes the p2p records of the reader
+#include "mpi_info_reader.h"
 
-typedef struct CommDepEdge {
-  char dest_type = 0;
-  char src_type = 0;
-  string dest_callpath;
-  string src_callpath;
-  int dest_pid = 0;
-  int src_pid = 0;
-  double exe_time = 0;
-} CDE;
+#define DEBUG
 
 // unordered_map<unsigned long long, CIS*> coll_info[];
 vector<unordered_map<unsigned long long, CIS *>> coll_info;
@@ -55,95 +30,17 @@ vector<CDE *> comm_dep_edge;
 void readMPIInfo(string file_name, int pid) {
   coll_info_pointer[pid] = 0;
   p2p_info_pointer[pid] = 0;
-  ifstream inputStream(file_name, ios::in);
-  if (!inputStream.good()) {
-    cout << "Failed to open MPID file\n";
-    return;
+  vector<CIS *> coll_records;
+  vector<PIS *> p2p_records;
+  readMPIInfoRecords(file_name, coll_records, p2p_records);
+  for (CIS *one_coll_info : coll_records) {
+    coll_info[pid].insert(make_pair(coll_info_pointer[pid], one_coll_info));
+    coll_info_pointer[pid]++;
   }
-  size_t pos = 0;
-  string delimiter = "";
-  for (string line; getline(inputStream, line);) {
-    // Parse - type
-    delimiter = " ";
-    pos = line.find(delimiter);
-    string type_str = line.substr(0, pos);
-    line.erase(0, pos + delimiter.length());
-
-    // Parse - call path
-    delimiter = "|";
-    pos = line.find(delimiter);
-    string call_path_str = line.substr(0, pos);
-    line.erase(0, pos + delimiter.length());
-
-    // Parse - info
-    pos = line.find(delimiter);
-    string info_str = line.substr(0, pos);
-    line.erase(0, pos + delimiter.length());
-
-    // Parse - count
-    pos = line.find(delimiter);
-    string count_str = line.substr(0, pos);
-    line.erase(0, pos + delimiter.length());
-
-    // Parse -  time
-    delimiter = "\n";
-    pos = line.find(delimiter);
-    string exe_time_str = line.substr(0, pos);
-    line.erase(0, pos + delimiter.length());
-
-    if (!type_str.compare(string("c"))) {
-      // CIS * one_coll_info = (CIS*) malloc(sizeof(CIS));
-      CIS *one_coll_info = new CIS;
-      // delimiter = " ";
-      // while ((pos = call_path_str.find(delimiter)) != std::string::npos) {
-      //   string addr = call_path_str.substr(0, pos);
-      //   call_path_str.erase(0, pos + delimiter.length());
-      //   stringstream stristre =
-      // }
-
-      one_coll_info->call_path = call_path_str;
-      one_coll_info->comm = info_str;
-      one_coll_info->count = count_str;
-      one_coll_info->exe_time = exe_time_str;
-      coll_info[pid].insert(make_pair(coll_info_pointer[pid], one_coll_info));
-      coll_info_pointer[pid]++;
-    } else if (!type_str.compare(string("s")) ||
-               !type_str.compare(string("S")) ||
-               !type_str.compare(string("r")) ||
-               !type_str.compare(string("R")) ||
-               !type_str.compare(string("w"))) {
-      // PIS * one_p2p_info = (PIS*) malloc(sizeof(PIS));
-      PIS *one_p2p_info = new PIS;
-
-      one_p2p_info->type = type_str.c_str()[0];
-      one_p2p_info->call_path = call_path_str;
-      one_p2p_info->count = count_str;
-      one_p2p_info->exe_time = exe_time_str;
-
-      // Analyze
-      int request_count_tmp = 0;
-      delimiter = ",";
-      while ((pos = info_str.find(delimiter)) != std::string::npos) {
-        string src_dst_tag = info_str.substr(0, pos);
-        info_str.erase(0, pos + delimiter.length());
-        stringstream stristre;
-        int src = -1, dst = -1, tag = -1;
-        stristre << src_dst_tag;
-        stristre >> src >> dst >> tag;
-        one_p2p_info->source[request_count_tmp] = src;
-        one_p2p_info->dest[request_count_tmp] = dst;
-        one_p2p_info->tag[request_count_tmp] = tag;
-        request_count_tmp++;
-      }
-      one_p2p_info->request_count = request_count_tmp;
-      pair<unsigned long long, PIS *> pair_tmp(p2p_info_pointer[pid],
-                                               one_p2p_info);
-      p2p_info[pid].insert(pair_tmp);
-      // p2p_info[pid].insert(make_pair(p2p_info_pointer[pid], one_p2p_info));
-      p2p_info_pointer[pid]++;
-    }
+  for (PIS *one_p2p_info : p2p_records) {
+    p2p_info[pid].insert(make_pair(p2p_info_pointer[pid], one_p2p_info));
+    p2p_info_pointer[pid]++;
   }
-  inputStream.close();
 }
 
 void readTraceInfo(string file_name, int pid) {
@@ -165,12 +62,14 @@ void readTraceInfo(string file_name, int pid) {
   inputStream.close();
 }
 
-bool existCDE(int dest_type, int src_type, string dest_callpath,
-              string src_callpath, int dest_pid, int src_pid) {
+bool existCDE(int dest_type, int src_type,
+              const vector<unsigned long long> &dest_callpath,
+              const vector<unsigned long long> &src_callpath, int dest_pid,
+              int src_pid) {
   for (auto cde : comm_dep_edge) {
     if (cde->dest_type == dest_type && cde->src_type == src_type &&
-        !cde->dest_callpath.compare(dest_callpath) &&
-        !cde->src_callpath.compare(src_callpath) && cde->dest_pid == dest_pid &&
+        cde->dest_callpath == dest_callpath &&
+        cde->src_callpath == src_callpath && cde->dest_pid == dest_pid &&
         cde->src_pid == src_pid) {
       return true;
     }
@@ -216,11 +115,14 @@ void commOpMatch(int pid) {
                   src_dest == dest && src_tag == tag) {
                 char dest_type = p2p_info[pid][index / 2]->type;
                 // char src_type = p2p_info[src][src_index / 2]->type;
-                string dest_callpath = p2p_info[pid][index / 2]->call_path;
-                string src_callpath = p2p_info[src][src_index / 2]->call_path;
+                vector<unsigned long long> dest_callpath =
+                    p2p_info[pid][index / 2]->call_path;
+                vector<unsigned long long> src_callpath =
+                    p2p_info[src][src_index / 2]->call_path;
                 int dest_pid = pid;
                 int src_pid = src;
-                double exe_time = stod(p2p_info[pid][index / 2]->exe_time);
+                double exe_time = p2p_info[pid][index / 2]->exe_time;
+                unsigned long long bytes = p2p_info[src][src_index / 2]->bytes;
 
                 // delete it
                 trace_log[src].erase(src_iter);
@@ -238,13 +140,14 @@ void commOpMatch(int pid) {
                 one_comm_dep_edge->dest_pid = dest_pid;
                 one_comm_dep_edge->src_pid = src_pid;
                 one_comm_dep_edge->exe_time = exe_time;
+                one_comm_dep_edge->bytes = bytes;
                 comm_dep_edge.push_back(one_comm_dep_edge);
 
 #ifdef DEBUG
-                cout << dest_type << " | " << dest_callpath << " | " << dest_pid
-                     << ", ";
-                cout << src_type << " | " << src_callpath << " | " << src_pid
-                     << ", ";
+                cout << dest_type << " | " << callPathString(dest_callpath)
+                     << " | " << dest_pid << ", ";
+                cout << src_type << " | " << callPathString(src_callpath)
+                     << " | " << src_pid << ", ";
                 cout << exe_time << endl;
 
 #endif
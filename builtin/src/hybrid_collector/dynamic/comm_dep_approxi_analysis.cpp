@@ -13,35 +13,10 @@ using namespace std;
 #define MAX_WAIT_REQ 500 // increase it if we test larger process scale
 #define MAX_NPROCS 10000 // increase it if we test larger process scale
 
-//#define DEBUG
-
-typedef struct CollInfoStruct {
-  string call_path;
-  string comm;
-  string count;
-  string exe_time;
-} CIS;
-
-typedef struct P2PInfoStruct {
-  char type = 0;
-  string call_path;
-  int request_count = 0;
-  int source[MAX_WAIT_REQ] = {0};
-  int dest[MAX_WAIT_REQ] = {0};
-  int tag[MAX_WAIT_REQ] = {0};
-  string count;
-  string exe_time;
-} PIS;
+// MAX_WAIT_REQ sizes the p2p records of the reader
+#include "mpi_info_reader.h"
 
-typedef struct CommDepEdge {
-  char dest_type = 0;
-  char src_type = 0;
-  string dest_callpath;
-  string src_callpath;
-  int dest_pid = 0;
-  int src_pid = 0;
-  double exe_time = 0;
-} CDE;
+//#define DEBUG
 
 // unordered_map<unsigned long long, CIS*> coll_info[];
 vector<unordered_map<unsigned long long, CIS *>> coll_info;
@@ -55,95 +30,17 @@ vector<CDE *> comm_dep_edge;
 void readMPIInfo(string file_name, int pid) {
   coll_info_pointer[pid] = 0;
   p2p_info_pointer[pid] = 0;
-  ifstream inputStream(file_name.c_str(), ios_base::in);
-  if (!inputStream.good()) {
-    cout << "Failed to open " << file_name.c_str() << " file\n";
-    return;
+  vector<CIS *> coll_records;
+  vector<PIS *> p2p_records;
+  readMPIInfoRecords(file_name, coll_records, p2p_records);
+  for (CIS *one_coll_info : coll_records) {
+    coll_info[pid].insert(make_pair(coll_info_pointer[pid], one_coll_info));
+    coll_info_pointer[pid]++;
   }
-  size_t pos = 0;
-  string delimiter = "";
-  for (string line; getline(inputStream, line);) {
-    // Parse - type
-    delimiter = " ";
-    pos = line.find(delimiter);
-    string type_str = line.substr(0, pos);
-    line.erase(0, pos + delimiter.length());
-
-    // Parse - call path
-    delimiter = "|";
-    pos = line.find(delimiter);
-    string call_path_str = line.substr(0, pos);
-    line.erase(0, pos + delimiter.length());
-
-    // Parse - info
-    pos = line.find(delimiter);
-    string info_str = line.substr(0, pos);
-    line.erase(0, pos + delimiter.length());
-
-    // Parse - count
-    pos = line.find(delimiter);
-    string count_str = line.substr(0, pos);
-    line.erase(0, pos + delimiter.length());
-
-    // Parse -  time
-    delimiter = "\n";
-    pos = line.find(delimiter);
-    string exe_time_str = line.substr(0, pos);
-    line.erase(0, pos + delimiter.length());
-
-    if (!type_str.compare(string("c"))) {
-      // CIS * one_coll_info = (CIS*) malloc(sizeof(CIS));
-      CIS *one_coll_info = new CIS;
-      // delimiter = " ";
-      // while ((pos = call_path_str.find(delimiter)) != std::string::npos) {
-      //   string addr = call_path_str.substr(0, pos);
-      //   call_path_str.erase(0, pos + delimiter.length());
-      //   stringstream stristre =
-      // }
-
-      one_coll_info->call_path = call_path_str;
-      one_coll_info->comm = info_str;
-      one_coll_info->count = count_str;
-      one_coll_info->exe_time = exe_time_str;
-      coll_info[pid].insert(make_pair(coll_info_pointer[pid], one_coll_info));
-      coll_info_pointer[pid]++;
-    } else if (!type_str.compare(string("s")) ||
-               !type_str.compare(string("S")) ||
-               !type_str.compare(string("r")) ||
-               !type_str.compare(string("R")) ||
-               !type_str.compare(string("w"))) {
-      // PIS * one_p2p_info = (PIS*) malloc(sizeof(PIS));
-      PIS *one_p2p_info = new PIS;
-
-      one_p2p_info->type = type_str.c_str()[0];
-      one_p2p_info->call_path = call_path_str;
-      one_p2p_info->count = count_str;
-      one_p2p_info->exe_time = exe_time_str;
-
-      // Analyze
-      int request_count_tmp = 0;
-      delimiter = ",";
-      while ((pos = info_str.find(delimiter)) != std::string::npos) {
-        string src_dst_tag = info_str.substr(0, pos);
-        info_str.erase(0, pos + delimiter.length());
-        stringstream stristre;
-        int src = -1, dst = -1, tag = -1;
-        stristre << src_dst_tag;
-        stristre >> src >> dst >> tag;
-        one_p2p_info->source[request_count_tmp] = src;
-        one_p2p_info->dest[request_count_tmp] = dst;
-        one_p2p_info->tag[request_count_tmp] = tag;
-        request_count_tmp++;
-      }
-      one_p2p_info->request_count = request_count_tmp;
-      pair<unsigned long long, PIS *> pair_tmp(p2p_info_pointer[pid],
-                                               one_p2p_info);
-      p2p_info[pid].push_back(one_p2p_info);
-      // p2p_info[pid].insert(make_pair(p2p_info_pointer[pid], one_p2p_info));
-      p2p_info_pointer[pid]++;
-    }
+  for (PIS *one_p2p_info : p2p_records) {
+    p2p_info[pid].push_back(one_p2p_info);
+    p2p_info_pointer[pid]++;
   }
-  inputStream.close();
 }
 
 void readTraceInfo(string file_name, int pid) {
@@ -165,12 +62,14 @@ void readTraceInfo(string file_name, int pid) {
   inputStream.close();
 }
 
-bool existCDE(int dest_type, int src_type, string dest_callpath,
-              string src_callpath, int dest_pid, int src_pid) {
+bool existCDE(int dest_type, int src_type,
+              const vector<unsigned long long> &dest_callpath,
+              const vector<unsigned long long> &src_callpath, int dest_pid,
+              int src_pid) {
   for (auto cde : comm_dep_edge) {
     if (cde->dest_type == dest_type && cde->src_type == src_type &&
-        !cde->dest_callpath.compare(dest_callpath) &&
-        !cde->src_callpath.compare(src_callpath) && cde->dest_pid == dest_pid &&
+        cde->dest_callpath == dest_callpath &&
+        cde->src_callpath == src_callpath && cde->dest_pid == dest_pid &&
         cde->src_pid == src_pid) {
       return true;
     }
@@ -216,11 +115,14 @@ void commOpMatch(int pid) {
                   src_dest == dest && src_tag == tag) {
                 char dest_type = p2p_info[pid][index / 2]->type;
                 // char src_type = p2p_info[src][src_index / 2]->type;
-                string dest_callpath = p2p_info[pid][index / 2]->call_path;
-                string src_callpath = p2p_info[src][src_index / 2]->call_path;
+                vector<unsigned long long> dest_callpath =
+                    p2p_info[pid][index / 2]->call_path;
+                vector<unsigned long long> src_callpath =
+                    p2p_info[src][src_index / 2]->call_path;
                 int dest_pid = pid;
                 int src_pid = src;
-                double exe_time = stod(p2p_info[pid][index / 2]->exe_time);
+                double exe_time = p2p_info[pid][index / 2]->exe_time;
+                unsigned long long bytes = p2p_info[src][src_index / 2]->bytes;
 
                 // delete it
                 trace_log[src].erase(src_iter);
@@ -238,13 +140,14 @@ void commOpMatch(int pid) {
                 one_comm_dep_edge->dest_pid = dest_pid;
                 one_comm_dep_edge->src_pid = src_pid;
                 one_comm_dep_edge->exe_time = exe_time;
+                one_comm_dep_edge->bytes = bytes;
                 comm_dep_edge.push_back(one_comm_dep_edge);
 
 #ifdef DEBUG
-                cout << dest_type << " | " << dest_callpath << " | " << dest_pid
-                     << ", ";
-                cout << src_type << " | " << src_callpath << " | " << src_pid
-                     << ", ";
+                cout << dest_type << " | " << callPathString(dest_callpath)
+                     << " | " << dest_pid << ", ";
+                cout << src_type << " | " << callPathString(src_callpath)
+                     << " | " << src_pid << ", ";
                 cout << exe_time << endl;
 #endif
 
@@ -282,14 +185,13 @@ void commOpMatchWithMPIInfo(int pid) {
               src_dest == dest && src_tag == tag) {
             char dest_type = (*iter)->type;
             // char src_type = ( *src_iter ) ->type;
-            string dest_callpath = (*iter)->call_path;
-            string src_callpath = (*src_iter)->call_path;
+            vector<unsigned long long> dest_callpath = (*iter)->call_path;
+            vector<unsigned long long> src_callpath = (*src_iter)->call_path;
             int dest_pid = pid;
             int src_pid = src;
-            double exe_time = 0.0;
-            if (!(*iter)->exe_time.empty()) {
-              exe_time = stod((*iter)->exe_time);
-            }
+            double exe_time = (*iter)->exe_time;
+            double src_exe_time = (*src_iter)->exe_time;
+            unsigned long long bytes = (*src_iter)->bytes;
 
             // delete it
             p2p_info[src].erase(src_iter);
@@ -307,13 +209,10 @@ void commOpMatchWithMPIInfo(int pid) {
             one_comm_dep_edge->dest_pid = dest_pid;
             one_comm_dep_edge->src_pid = src_pid;
             one_comm_dep_edge->exe_time = exe_time;
+            one_comm_dep_edge->bytes = bytes;
             comm_dep_edge.push_back(one_comm_dep_edge);
 
             if (src_type == 's') {
-              double src_exe_time = 0.0;
-              if (!(*src_iter)->exe_time.empty()) {
-                src_exe_time = stod((*src_iter)->exe_time);
-              }
               CDE *one_reverse_comm_dep_edge = new CDE;
               one_reverse_comm_dep_edge->dest_type = src_type;
               one_reverse_comm_dep_edge->src_type = dest_type;
@@ -322,6 +221,7 @@ void commOpMatchWithMPIInfo(int pid) {
               one_reverse_comm_dep_edge->dest_pid = src_pid;
               one_reverse_comm_dep_edge->src_pid = dest_pid;
               one_reverse_comm_dep_edge->exe_time = src_exe_time;
+              one_reverse_comm_dep_edge->bytes = bytes;
               comm_dep_edge.push_back(one_reverse_comm_dep_edge);
             }
             break;
@@ -332,14 +232,89 @@ void commOpMatchWithMPIInfo(int pid) {
   }
 }
 
+// Record of rank pid matching a collective record of another rank, which is
+// of the same operation on the same ranks and root, with the same call path
+// if any
+CIS *matchCollInfo(int pid, CIS *info) {
+  if (pid < 0 || (size_t)pid >= coll_info.size()) {
+    return NULL;
+  }
+  CIS *match = NULL;
+  for (auto &kv : coll_info[pid]) {
+    CIS *other = kv.second;
+    if (other->op != info->op || other->comm != info->comm ||
+        other->root != info->root) {
+      continue;
+    }
+    if (other->call_path == info->call_path) {
+      return other;
+    }
+    if (match == NULL) {
+      match = other;
+    }
+  }
+  return match;
+}
+
+void addCollCDE(CIS *dest_info, int dest_pid, CIS *src_info, int src_pid) {
+  if (existCDE(dest_info->type, src_info->type, dest_info->call_path,
+               src_info->call_path, dest_pid, src_pid)) {
+    return;
+  }
+  CDE *one_comm_dep_edge = new CDE;
+  one_comm_dep_edge->dest_type = dest_info->type;
+  one_comm_dep_edge->src_type = src_info->type;
+  one_comm_dep_edge->dest_callpath = dest_info->call_path;
+  one_comm_dep_edge->src_callpath = src_info->call_path;
+  one_comm_dep_edge->dest_pid = dest_pid;
+  one_comm_dep_edge->src_pid = src_pid;
+  one_comm_dep_edge->exe_time = dest_info->exe_time;
+  one_comm_dep_edge->bytes = src_info->bytes;
+  comm_dep_edge.push_back(one_comm_dep_edge);
+}
+
+// Collective dependence edges: the root of a reduction or gather waits for
+// the other ranks, which wait for the root of a broadcast or scatter. Other
+// collectives are approximated as a reduction to the first rank of the
+// communicator followed by a broadcast from it.
+void commCollMatchWithMPIInfo(int pid) {
+  for (auto &kv : coll_info[pid]) {
+    CIS *info = kv.second;
+    if (info->comm.empty()) {
+      continue;
+    }
+    bool to_root = info->op != COLL_OP_BCAST &&
+                   info->op != COLL_OP_SCATTER && info->op != COLL_OP_SCATTERV;
+    bool from_root = info->op != COLL_OP_REDUCE &&
+                     info->op != COLL_OP_GATHER && info->op != COLL_OP_GATHERV;
+    int root = info->root >= 0 ? info->root : info->comm[0];
+    if (pid == root && to_root) {
+      for (int member : info->comm) {
+        CIS *src_info = member != pid ? matchCollInfo(member, info) : NULL;
+        if (src_info != NULL) {
+          addCollCDE(info, pid, src_info, member);
+        }
+      }
+    } else if (pid != root && from_root) {
+      CIS *src_info = matchCollInfo(root, info);
+      if (src_info != NULL) {
+        addCollCDE(info, pid, src_info, root);
+      }
+    }
+  }
+}
+
+// Edges are written as the edge data of a perf data text file, valued with
+// the TIME and BYTES metrics named on the header line
 void outputCommDepEdges(ofstream &fout) {
-  fout << "0" << endl;
+  fout << "0 0 TIME BYTES" << endl;
   fout << comm_dep_edge.size() << endl;
   for (auto &cdp : comm_dep_edge) {
     //#ifdef DEBUG
 
-    fout << cdp->src_callpath << " | " << cdp->dest_callpath << " | ";
-    fout << cdp->exe_time << " | ";
+    fout << callPathString(cdp->src_callpath) << " | "
+         << callPathString(cdp->dest_callpath) << " | ";
+    fout << cdp->exe_time << " " << cdp->bytes << " | ";
     fout << cdp->src_pid << " | " << cdp->dest_pid << " | ";
     fout << "0 | 0" << endl;
     // fout.flush();
@@ -366,6 +341,9 @@ int main(int argc, char *argv[]) {
   for (int pid = 0; pid < nprocs; pid++) {
     commOpMatchWithMPIInfo(pid);
   }
+  for (int pid = 0; pid < nprocs; pid++) {
+    commCollMatchWithMPIInfo(pid);
+  }
   std::string output_filename =
       string(argv[2]) + string("/dynamic_data/") + string(argv[3]);
   ofstream outputStream(output_filename.c_str(), ios_base::out);
@@ -0,0 +1,495 @@
+#include "baguatool.h"
+#include <dlfcn.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MODULE_INITED 1
+
+#define MAX_CALL_PATH_DEPTH 100
+
+// Mean bytes allocated between two samples, HEAP_SAMPLE_INTERVAL in the
+// environment overrides it
+#define HEAP_SAMPLE_INTERVAL 524288
+
+// Sampled allocations tracked until they are freed, must be a power of 2
+#define MAX_LIVE_SAMPLES 65536
+#define MAX_LIVE_SAMPLE_PROBES 64
+
+// Allocations of dlsym before the allocator is resolved
+#define BOOTSTRAP_HEAP_SIZE 65536
+
+// Metrics of heap data
+#define ALLOC_BYTES 0
+#define ALLOC_COUNT 1
+#define LIVE_BYTES 2
+#define LIFETIME 3
+#define NUM_HEAP_METRICS 4
+
+// Thread-local variables are read in every allocation, and the dynamic TLS
+// model may allocate at the first access
+#define HEAP_TLS __thread __attribute__((tls_model("initial-exec")))
+
+#define gettid() syscall(__NR_gettid)
+
+static void *(*original_malloc)(size_t size) = NULL;
+static void *(*original_calloc)(size_t nmemb, size_t size) = NULL;
+static void *(*original_realloc)(void *ptr, size_t size) = NULL;
+static void (*original_free)(void *ptr) = NULL;
+static int (*original_posix_memalign)(void **memptr, size_t alignment,
+                                      size_t size) = NULL;
+
+// Not exported, so that it can be preloaded with another collector
+static std::unique_ptr<baguatool::collector::Sampler> sampler = nullptr;
+static std::unique_ptr<baguatool::core::PerfData> perf_data = nullptr;
+
+static int module_init = 0;
+static int resolving_allocator = 0;
+static long long sample_interval = HEAP_SAMPLE_INTERVAL;
+
+static char bootstrap_heap[BOOTSTRAP_HEAP_SIZE]
+    __attribute__((aligned(16)));
+static unsigned long bootstrap_heap_used = 0;
+
+/** A sampled allocation, found by its address at free */
+struct live_sample_t {
+  void *ptr;
+  baguatool::type::perf_data_t bytes;
+  baguatool::type::perf_data_t count;
+  long long alloc_time;
+  int thread_gid;
+  int call_path_len;
+  baguatool::type::addr_t *call_path;
+};
+
+// Open addressing table with linear probing. Sampled allocations and frees
+// change it under live_sample_lock, and a removed sample is filled by
+// backward shift so that no tombstones pile up. Frees of other pointers
+// probe without the lock, and probe again if the table changed meanwhile:
+// live_sample_seq is odd while it changes.
+#define EMPTY_SLOT ((void *)0)
+static live_sample_t live_samples[MAX_LIVE_SAMPLES];
+static int num_live_samples = 0;
+static volatile int live_sample_lock = 0;
+static volatile unsigned long live_sample_seq = 0;
+
+static HEAP_TLS int in_heap_hook = 0;
+static HEAP_TLS long long bytes_until_sample = 0;
+static HEAP_TLS unsigned long long random_state = 0;
+static HEAP_TLS int thread_gid = -1;
+static int thread_global_id = 0;
+
+static inline long long GetTime() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static int GetThreadGid() {
+  if (thread_gid < 0) {
+    thread_gid = __sync_fetch_and_add(&thread_global_id, 1);
+  }
+  return thread_gid;
+}
+
+/** Draw bytes until the next sample from an exponential distribution, so
+ * that every byte is sampled with the same probability */
+static long long NextSampleDistance() {
+  if (random_state == 0) {
+    random_state = (GetTime() ^ (gettid() << 32)) | 1;
+  }
+  // xorshift64
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 7;
+  random_state ^= random_state << 17;
+  double u = ((random_state >> 11) + 1.0) / 9007199254740993.0;
+  return (long long)(-log(u) * sample_interval) + 1;
+}
+
+static void *resolve_symbol(const char *symbol_name) {
+  void *result = dlsym(RTLD_NEXT, symbol_name);
+  if (result == NULL) {
+    LOG_ERROR("Unable to resolve symbol %s\n", symbol_name);
+    exit(1);
+  }
+  return result;
+}
+
+/** Resolve the allocator at the first allocation, which can precede the
+ * constructor. Allocations of dlsym itself are served by bootstrap_heap. */
+static void resolve_allocator() {
+  if (original_free != NULL) {
+    return;
+  }
+  resolving_allocator = 1;
+  original_malloc = (decltype(original_malloc))resolve_symbol("malloc");
+  original_calloc = (decltype(original_calloc))resolve_symbol("calloc");
+  original_realloc = (decltype(original_realloc))resolve_symbol("realloc");
+  original_posix_memalign = (decltype(original_posix_memalign))resolve_symbol(
+      "posix_memalign");
+  original_free = (decltype(original_free))resolve_symbol("free");
+  resolving_allocator = 0;
+}
+
+static void *bootstrap_malloc(size_t size) {
+  unsigned long offset = __sync_fetch_and_add(&bootstrap_heap_used,
+                                              (size + 15) & ~15UL);
+  if (offset + size > BOOTSTRAP_HEAP_SIZE) {
+    return NULL;
+  }
+  return bootstrap_heap + offset;
+}
+
+static inline bool is_bootstrap_ptr(void *ptr) {
+  return (char *)ptr >= bootstrap_heap &&
+         (char *)ptr < bootstrap_heap + BOOTSTRAP_HEAP_SIZE;
+}
+
+static inline unsigned long hash_ptr(void *ptr) {
+  return (((unsigned long)ptr >> 4) * 0x9E3779B97F4A7C15UL) >> 48;
+}
+
+static void lock_live_samples() {
+  while (__sync_lock_test_and_set(&live_sample_lock, 1)) {
+    while (live_sample_lock) {
+    }
+  }
+  __sync_fetch_and_add(&live_sample_seq, 1);
+}
+
+static void unlock_live_samples() {
+  __sync_fetch_and_add(&live_sample_seq, 1);
+  __sync_lock_release(&live_sample_lock);
+}
+
+/** Slot of a sampled allocation, -1 if it is not sampled */
+static long find_live_sample(void *ptr) {
+  unsigned long h = hash_ptr(ptr);
+  for (int i = 0; i < MAX_LIVE_SAMPLE_PROBES; i++) {
+    unsigned long x = (h + i) & (MAX_LIVE_SAMPLES - 1);
+    void *key = live_samples[x].ptr;
+    if (key == EMPTY_SLOT) {
+      return -1;
+    }
+    if (key == ptr) {
+      return x;
+    }
+  }
+  return -1;
+}
+
+/** Whether an allocation is sampled, without taking the lock */
+static bool is_live_sample(void *ptr) {
+  while (true) {
+    unsigned long seq = live_sample_seq;
+    __sync_synchronize();
+    bool found = find_live_sample(ptr) >= 0;
+    __sync_synchronize();
+    if ((seq & 1) == 0 && seq == live_sample_seq) {
+      return found;
+    }
+  }
+}
+
+/** Track a sampled allocation until it is freed
+ * @return false if the table has no slot for it
+ */
+static bool insert_live_sample(const live_sample_t *sample) {
+  unsigned long h = hash_ptr(sample->ptr);
+  bool inserted = false;
+  lock_live_samples();
+  for (int i = 0; i < MAX_LIVE_SAMPLE_PROBES; i++) {
+    live_sample_t *slot = &live_samples[(h + i) & (MAX_LIVE_SAMPLES - 1)];
+    if (slot->ptr == EMPTY_SLOT) {
+      *slot = *sample;
+      num_live_samples++;
+      inserted = true;
+      break;
+    }
+  }
+  unlock_live_samples();
+  return inserted;
+}
+
+/** Remove a slot, and move later samples of its probe run back into the
+ * hole unless that would put them before their home slot */
+static void remove_live_sample(unsigned long x) {
+  unsigned long mask = MAX_LIVE_SAMPLES - 1;
+  unsigned long hole = x;
+  for (unsigned long y = (x + 1) & mask;
+       y != x && live_samples[y].ptr != EMPTY_SLOT; y = (y + 1) & mask) {
+    unsigned long home = hash_ptr(live_samples[y].ptr) & mask;
+    if (((y - home) & mask) >= ((y - hole) & mask)) {
+      live_samples[hole] = live_samples[y];
+      hole = y;
+    }
+  }
+  live_samples[hole].ptr = EMPTY_SLOT;
+  live_samples[hole].call_path = NULL;
+  num_live_samples--;
+}
+
+/** Take a sampled allocation out of the table
+ * @return false if it is not sampled
+ */
+static bool take_live_sample(void *ptr, live_sample_t *sample) {
+  if (!is_live_sample(ptr)) {
+    return false;
+  }
+  lock_live_samples();
+  long x = find_live_sample(ptr);
+  if (x >= 0) {
+    *sample = live_samples[x];
+    remove_live_sample(x);
+  }
+  unlock_live_samples();
+  return x >= 0;
+}
+
+/** Record a sampled allocation: bytes and count it stands for are added to
+ * its call path and it is tracked until it is freed */
+static void RecordAlloc(void *ptr, size_t size) {
+  long long start_time = GetTime();
+  baguatool::type::addr_t call_path[MAX_CALL_PATH_DEPTH] = {0};
+  int call_path_len = sampler->GetBacktrace(call_path, MAX_CALL_PATH_DEPTH);
+
+  // An allocation of size bytes is sampled with probability p, so it stands
+  // for 1 / p allocations
+  double p = 1.0 - exp(-(double)size / sample_interval);
+  baguatool::type::perf_data_t values[NUM_HEAP_METRICS] = {0};
+  values[ALLOC_BYTES] = size / p;
+  values[ALLOC_COUNT] = 1.0 / p;
+  values[LIVE_BYTES] = size / p;
+  perf_data->RecordVertexData(call_path, call_path_len, 0 /* process_id */,
+                              GetThreadGid(), values, NUM_HEAP_METRICS);
+
+  live_sample_t sample;
+  sample.ptr = ptr;
+  sample.bytes = values[ALLOC_BYTES];
+  sample.count = values[ALLOC_COUNT];
+  sample.alloc_time = start_time;
+  sample.thread_gid = GetThreadGid();
+  sample.call_path_len = call_path_len;
+  sample.call_path = (baguatool::type::addr_t *)original_malloc(
+      call_path_len * sizeof(baguatool::type::addr_t));
+  if (sample.call_path != NULL) {
+    memcpy(sample.call_path, call_path,
+           call_path_len * sizeof(baguatool::type::addr_t));
+  } else {
+    sample.call_path_len = 0;
+  }
+  if (!insert_live_sample(&sample)) {
+    // Its live bytes are never released
+    original_free(sample.call_path);
+    baguatool::core::AddSelfStat(baguatool::core::STAT_DROPPED_SAMPLES, 1);
+  }
+
+  baguatool::core::AddSelfStat(baguatool::core::STAT_SAMPLES, 1);
+  baguatool::core::AddSelfStat(baguatool::core::STAT_HANDLER_TIME,
+                               GetTime() - start_time);
+}
+
+/** Record the free of a sampled allocation: its bytes are no longer live at
+ * the call path of the allocation, and its lifetime goes to the edge from
+ * the allocation to the free */
+static void RecordFree(live_sample_t *sample) {
+  long long start_time = GetTime();
+  baguatool::type::addr_t call_path[MAX_CALL_PATH_DEPTH] = {0};
+  int call_path_len = sampler->GetBacktrace(call_path, MAX_CALL_PATH_DEPTH);
+
+  // Lifetime in seconds of all the allocations the sample stands for
+  baguatool::type::perf_data_t lifetime =
+      (start_time - sample->alloc_time) / 1e9 * sample->count;
+  baguatool::type::perf_data_t values[NUM_HEAP_METRICS] = {0};
+  values[LIVE_BYTES] = -sample->bytes;
+  values[LIFETIME] = lifetime;
+  perf_data->RecordVertexData(sample->call_path, sample->call_path_len,
+                              0 /* process_id */, sample->thread_gid, values,
+                              NUM_HEAP_METRICS);
+  perf_data->RecordEdgeData(sample->call_path, sample->call_path_len, call_path,
+                            call_path_len, 0, 0, sample->thread_gid,
+                            GetThreadGid(), LIFETIME, lifetime);
+  original_free(sample->call_path);
+
+  baguatool::core::AddSelfStat(baguatool::core::STAT_HANDLER_TIME,
+                               GetTime() - start_time);
+}
+
+/** Count an allocation, record it if a sample falls into its bytes */
+static inline void SampleAlloc(void *ptr, size_t size) {
+  if (ptr == NULL || module_init != MODULE_INITED) {
+    return;
+  }
+  bytes_until_sample -= size;
+  if (bytes_until_sample > 0) {
+    return;
+  }
+  in_heap_hook = 1;
+  // A new thread draws its first distance instead of sampling
+  if (random_state != 0) {
+    RecordAlloc(ptr, size);
+  }
+  bytes_until_sample = NextSampleDistance();
+  in_heap_hook = 0;
+}
+
+/** Take the sample of an allocation about to be freed, if it is sampled
+ * @return false if it is not sampled
+ */
+static inline bool TakeSample(void *ptr, live_sample_t *sample) {
+  if (ptr == NULL || module_init != MODULE_INITED || num_live_samples == 0) {
+    return false;
+  }
+  return take_live_sample(ptr, sample);
+}
+
+/** Record the free of an allocation if it is sampled */
+static inline void SampleFree(void *ptr) {
+  live_sample_t sample;
+  if (!TakeSample(ptr, &sample)) {
+    return;
+  }
+  in_heap_hook = 1;
+  RecordFree(&sample);
+  in_heap_hook = 0;
+}
+
+static void init_mock() __attribute__((constructor));
+static void fini_mock() __attribute__((destructor));
+
+// User-defined what to do at constructor
+static void init_mock() {
+  if (module_init == MODULE_INITED)
+    return;
+  resolve_allocator();
+
+  in_heap_hook = 1;
+  const char *interval_str = getenv("HEAP_SAMPLE_INTERVAL");
+  if (interval_str != nullptr && atoll(interval_str) > 0) {
+    sample_interval = atoll(interval_str);
+  }
+  LOG_INFO("Sample heap allocations every %lld bytes\n", sample_interval);
+
+  // The sampler only unwinds call paths, it does not sample cycles, so it
+  // can be preloaded next to a CPU sampler
+  sampler = std::make_unique<baguatool::collector::Sampler>();
+  perf_data = std::make_unique<baguatool::core::PerfData>();
+  std::vector<std::string> metric_names = {
+      std::string("ALLOC_BYTES"), std::string("ALLOC_COUNT"),
+      std::string("LIVE_BYTES"), std::string("LIFETIME")};
+  perf_data->SetMetricNames(metric_names);
+  in_heap_hook = 0;
+
+  module_init = MODULE_INITED;
+}
+
+// User-defined what to do at destructor
+static void fini_mock() {
+  in_heap_hook = 1;
+  module_init = 0;
+  // Sampled allocations still live keep their LIVE_BYTES
+  LOG_INFO("%d sampled allocations are live at exit\n", num_live_samples);
+  perf_data->Dump("dynamic_data/HEAP+0.TXT");
+  baguatool::core::DumpSelfStats("dynamic_data/HEAPSELF+0.TXT");
+
+  std::unique_ptr<baguatool::collector::SharedObjAnalysis> shared_obj_analysis =
+      std::make_unique<baguatool::collector::SharedObjAnalysis>();
+  shared_obj_analysis->CollectSharedObjMap();
+  std::string output_file_name_str = std::string("dynamic_data/SOMAP+0.TXT");
+  shared_obj_analysis->DumpSharedObjMap(output_file_name_str);
+}
+
+void *malloc(size_t size) {
+  if (original_malloc == NULL) {
+    if (resolving_allocator) {
+      return bootstrap_malloc(size);
+    }
+    resolve_allocator();
+  }
+  void *ptr = (*original_malloc)(size);
+  if (!in_heap_hook) {
+    SampleAlloc(ptr, size);
+  }
+  return ptr;
+}
+
+void *calloc(size_t nmemb, size_t size) {
+  if (original_calloc == NULL) {
+    if (resolving_allocator) {
+      // bootstrap_heap is zeroed and never reused
+      return bootstrap_malloc(nmemb * size);
+    }
+    resolve_allocator();
+  }
+  void *ptr = (*original_calloc)(nmemb, size);
+  if (!in_heap_hook) {
+    SampleAlloc(ptr, nmemb * size);
+  }
+  return ptr;
+}
+
+void *realloc(void *ptr, size_t size) {
+  if (original_realloc == NULL) {
+    resolve_allocator();
+  }
+  if (is_bootstrap_ptr(ptr)) {
+    void *new_ptr = malloc(size);
+    if (new_ptr != NULL) {
+      unsigned long max_size =
+          bootstrap_heap + BOOTSTRAP_HEAP_SIZE - (char *)ptr;
+      memcpy(new_ptr, ptr, size < max_size ? size : max_size);
+    }
+    return new_ptr;
+  }
+  if (in_heap_hook) {
+    return (*original_realloc)(ptr, size);
+  }
+  // A moved or resized block is a free of the old one and a new allocation.
+  // The sample is taken first, so that a new allocation at the old address
+  // can not be mistaken for it.
+  live_sample_t sample;
+  bool sampled = TakeSample(ptr, &sample);
+  void *new_ptr = (*original_realloc)(ptr, size);
+  if (new_ptr == NULL && size != 0) {
+    // The old block is still live
+    if (sampled && !insert_live_sample(&sample)) {
+      original_free(sample.call_path);
+      baguatool::core::AddSelfStat(baguatool::core::STAT_DROPPED_SAMPLES, 1);
+    }
+    return new_ptr;
+  }
+  if (sampled) {
+    in_heap_hook = 1;
+    RecordFree(&sample);
+    in_heap_hook = 0;
+  }
+  SampleAlloc(new_ptr, size);
+  return new_ptr;
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size) {
+  if (original_posix_memalign == NULL) {
+    resolve_allocator();
+  }
+  int ret = (*original_posix_memalign)(memptr, alignment, size);
+  if (ret == 0 && !in_heap_hook) {
+    SampleAlloc(*memptr, size);
+  }
+  return ret;
+}
+
+void free(void *ptr) {
+  if (ptr == NULL || is_bootstrap_ptr(ptr)) {
+    return;
+  }
+  if (original_free == NULL) {
+    resolve_allocator();
+  }
+  if (!in_heap_hook) {
+    SampleFree(ptr);
+  }
+  (*original_free)(ptr);
+}
@@ -0,0 +1,490 @@
+#include "baguatool.h"
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MODULE_INITED 1
+#define MODULE_INITING 2
+#define MODULE_FINISHED 3
+
+#define MAX_CALL_PATH_DEPTH 100
+
+// File descriptors and distinct files attributed by name, the others share
+// the last file id
+#define MAX_IO_FDS 65536
+#define MAX_IO_FILES 4096
+#define MAX_IO_FILE_NAME_LEN 256
+
+// Metrics of I/O data
+#define IO_BYTES 0
+#define IO_CALLS 1
+#define IO_TIME 2
+#define NUM_IO_METRICS 3
+
+#define gettid() syscall(__NR_gettid)
+
+// Only the POSIX calls below are wrapped. Buffered stdio (fopen, fread,
+// fwrite, fprintf, ...) reaches the kernel through libc-internal calls that
+// preloading cannot interpose, so it is not attributed, and neither are its
+// descriptors named after their files.
+static ssize_t (*original_read)(int fd, void *buf, size_t count) = NULL;
+static ssize_t (*original_write)(int fd, const void *buf, size_t count) = NULL;
+static ssize_t (*original_pread)(int fd, void *buf, size_t count,
+                                 off_t offset) = NULL;
+static ssize_t (*original_pwrite)(int fd, const void *buf, size_t count,
+                                  off_t offset) = NULL;
+static ssize_t (*original_pread64)(int fd, void *buf, size_t count,
+                                   off64_t offset) = NULL;
+static ssize_t (*original_pwrite64)(int fd, const void *buf, size_t count,
+                                    off64_t offset) = NULL;
+static int (*original_open)(const char *path, int flags, ...) = NULL;
+static int (*original_open64)(const char *path, int flags, ...) = NULL;
+static int (*original_openat)(int dirfd, const char *path, int flags,
+                              ...) = NULL;
+static int (*original_openat64)(int dirfd, const char *path, int flags,
+                                ...) = NULL;
+static int (*original_creat)(const char *path, mode_t mode) = NULL;
+static ssize_t (*original_readv)(int fd, const struct iovec *iov,
+                                 int iovcnt) = NULL;
+static ssize_t (*original_writev)(int fd, const struct iovec *iov,
+                                  int iovcnt) = NULL;
+static int (*original_close)(int fd) = NULL;
+static int (*original_fsync)(int fd) = NULL;
+static int (*original_fdatasync)(int fd) = NULL;
+
+// Not exported, so that it can be preloaded with another collector
+static std::unique_ptr<baguatool::collector::Sampler> sampler = nullptr;
+// I/O of each call path, and of each call path and file with the file id as
+// process id
+static std::unique_ptr<baguatool::core::PerfData> perf_data = nullptr;
+static std::unique_ptr<baguatool::core::PerfData> file_data = nullptr;
+
+static int module_init = 0;
+
+// File id of each file descriptor plus 1, 0 if unknown
+static int fd_to_file_id[MAX_IO_FDS] = {0};
+static char file_names[MAX_IO_FILES][MAX_IO_FILE_NAME_LEN];
+static int num_files = 0;
+static int file_names_lock = 0;
+
+static __thread int in_io_hook = 0;
+static __thread int thread_gid = -1;
+static int thread_global_id = 0;
+
+static inline long long GetTime() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static int GetThreadGid() {
+  if (thread_gid < 0) {
+    thread_gid = __sync_fetch_and_add(&thread_global_id, 1);
+  }
+  return thread_gid;
+}
+
+/** Get the id of a file by its name, a new one for a new name */
+static int GetFileId(const char *file_name) {
+  while (__sync_lock_test_and_set(&file_names_lock, 1)) {
+  }
+  int file_id = 0;
+  for (; file_id < num_files; file_id++) {
+    if (strncmp(file_names[file_id], file_name, MAX_IO_FILE_NAME_LEN - 1) ==
+        0) {
+      break;
+    }
+  }
+  if (file_id == num_files) {
+    if (num_files < MAX_IO_FILES) {
+      strncpy(file_names[file_id], file_name, MAX_IO_FILE_NAME_LEN - 1);
+      num_files++;
+    } else {
+      file_id = MAX_IO_FILES - 1;
+    }
+  }
+  __sync_lock_release(&file_names_lock);
+  return file_id;
+}
+
+/** Get the id of the file of a file descriptor. Descriptors not opened
+ * through the collector, e.g. stdout, inherited ones or sockets, are named
+ * after their number. */
+static int GetFdFileId(int fd) {
+  if (fd < 0 || fd >= MAX_IO_FDS) {
+    return GetFileId("fd:other");
+  }
+  int file_id = fd_to_file_id[fd] - 1;
+  if (file_id < 0) {
+    char file_name[32];
+    snprintf(file_name, sizeof(file_name), "fd:%d", fd);
+    file_id = GetFileId(file_name);
+    fd_to_file_id[fd] = file_id + 1;
+  }
+  return file_id;
+}
+
+static void SetFdFile(int fd, const char *path) {
+  if (fd >= 0 && fd < MAX_IO_FDS) {
+    fd_to_file_id[fd] = GetFileId(path) + 1;
+  }
+}
+
+static void UnsetFdFile(int fd) {
+  if (fd >= 0 && fd < MAX_IO_FDS) {
+    fd_to_file_id[fd] = 0;
+  }
+}
+
+/** Record an I/O call with the call path of the wrapper that made it. Not
+ * inlined, so that its frame is the one skipped. */
+static void __attribute__((noinline))
+RecordIO(int fd, long long bytes, long long start_time, long long end_time) {
+  in_io_hook = 1;
+  baguatool::type::addr_t call_path[MAX_CALL_PATH_DEPTH] = {0};
+  int call_path_len =
+      sampler->GetBacktrace(call_path, MAX_CALL_PATH_DEPTH, 3);
+
+  baguatool::type::perf_data_t values[NUM_IO_METRICS] = {0};
+  values[IO_BYTES] = bytes > 0 ? bytes : 0;
+  values[IO_CALLS] = 1;
+  values[IO_TIME] = (end_time - start_time) / 1e9;
+  perf_data->RecordVertexData(call_path, call_path_len, 0 /* process_id */,
+                              GetThreadGid(), values, NUM_IO_METRICS);
+  file_data->RecordVertexData(call_path, call_path_len,
+                              GetFdFileId(fd) /* file_id */, GetThreadGid(),
+                              values, NUM_IO_METRICS);
+
+  baguatool::core::AddSelfStat(baguatool::core::STAT_TRACED_CALLS, 1);
+  baguatool::core::AddSelfStat(baguatool::core::STAT_TRACE_TIME,
+                               GetTime() - end_time);
+  in_io_hook = 0;
+}
+
+static inline bool IsTracing() {
+  return module_init == MODULE_INITED && !in_io_hook;
+}
+
+static void *resolve_symbol(const char *symbol_name) {
+  void *result = dlsym(RTLD_NEXT, symbol_name);
+  if (result == NULL) {
+    LOG_ERROR("Unable to resolve symbol %s\n", symbol_name);
+    exit(1);
+  }
+  return result;
+}
+
+static void init_mock() __attribute__((constructor));
+static void fini_mock() __attribute__((destructor));
+
+// User-defined what to do at constructor
+static void init_mock() {
+  // I/O of the initialization itself is not traced
+  if (module_init != 0)
+    return;
+  module_init = MODULE_INITING;
+
+  original_read = (decltype(original_read))resolve_symbol("read");
+  original_write = (decltype(original_write))resolve_symbol("write");
+  original_pread = (decltype(original_pread))resolve_symbol("pread");
+  original_pwrite = (decltype(original_pwrite))resolve_symbol("pwrite");
+  original_pread64 = (decltype(original_pread64))resolve_symbol("pread64");
+  original_pwrite64 = (decltype(original_pwrite64))resolve_symbol("pwrite64");
+  original_open = (decltype(original_open))resolve_symbol("open");
+  original_open64 = (decltype(original_open64))resolve_symbol("open64");
+  original_openat = (decltype(original_openat))resolve_symbol("openat");
+  original_openat64 = (decltype(original_openat64))resolve_symbol("openat64");
+  original_creat = (decltype(original_creat))resolve_symbol("creat");
+  original_readv = (decltype(original_readv))resolve_symbol("readv");
+  original_writev = (decltype(original_writev))resolve_symbol("writev");
+  original_close = (decltype(original_close))resolve_symbol("close");
+  original_fsync = (decltype(original_fsync))resolve_symbol("fsync");
+  original_fdatasync = (decltype(original_fdatasync))resolve_symbol("fdatasync");
+
+  // The sampler only unwinds call paths, it does not sample cycles, so it
+  // can be preloaded next to a CPU sampler
+  in_io_hook = 1;
+  sampler = std::make_unique<baguatool::collector::Sampler>();
+  perf_data = std::make_unique<baguatool::core::PerfData>();
+  file_data = std::make_unique<baguatool::core::PerfData>();
+  std::vector<std::string> metric_names = {std::string("IO_BYTES"),
+                                           std::string("IO_CALLS"),
+                                           std::string("IO_TIME")};
+  perf_data->SetMetricNames(metric_names);
+  file_data->SetMetricNames(metric_names);
+  in_io_hook = 0;
+
+  module_init = MODULE_INITED;
+}
+
+// User-defined what to do at destructor
+static void fini_mock() {
+  // I/O of later destructors is not traced
+  module_init = MODULE_FINISHED;
+  perf_data->Dump("dynamic_data/IO+0.TXT");
+  file_data->Dump("dynamic_data/IOFILE+0.TXT");
+
+  // Names of file ids of IOFILE, one "id name" per line
+  FILE *fp = fopen("dynamic_data/IONAME+0.TXT", "w");
+  if (fp != nullptr) {
+    for (int i = 0; i < num_files; i++) {
+      fprintf(fp, "%d %s\n", i, file_names[i]);
+    }
+    fclose(fp);
+  } else {
+    LOG_ERROR("Failed to open %s\n", "dynamic_data/IONAME+0.TXT");
+  }
+  baguatool::core::DumpSelfStats("dynamic_data/IOSELF+0.TXT");
+
+  std::unique_ptr<baguatool::collector::SharedObjAnalysis> shared_obj_analysis =
+      std::make_unique<baguatool::collector::SharedObjAnalysis>();
+  shared_obj_analysis->CollectSharedObjMap();
+  std::string output_file_name_str = std::string("dynamic_data/SOMAP+0.TXT");
+  shared_obj_analysis->DumpSharedObjMap(output_file_name_str);
+}
+
+ssize_t read(int fd, void *buf, size_t count) {
+  /** If module are not initialized, init it at first. */
+  if (module_init == 0) {
+    init_mock();
+  }
+  if (!IsTracing()) {
+    return (*original_read)(fd, buf, count);
+  }
+  long long start_time = GetTime();
+  ssize_t ret = (*original_read)(fd, buf, count);
+  RecordIO(fd, ret, start_time, GetTime());
+  return ret;
+}
+
+ssize_t write(int fd, const void *buf, size_t count) {
+  if (module_init == 0) {
+    init_mock();
+  }
+  if (!IsTracing()) {
+    return (*original_write)(fd, buf, count);
+  }
+  long long start_time = GetTime();
+  ssize_t ret = (*original_write)(fd, buf, count);
+  RecordIO(fd, ret, start_time, GetTime());
+  return ret;
+}
+
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt) {
+  if (module_init == 0) {
+    init_mock();
+  }
+  if (!IsTracing()) {
+    return (*original_readv)(fd, iov, iovcnt);
+  }
+  long long start_time = GetTime();
+  ssize_t ret = (*original_readv)(fd, iov, iovcnt);
+  RecordIO(fd, ret, start_time, GetTime());
+  return ret;
+}
+
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt) {
+  if (module_init == 0) {
+    init_mock();
+  }
+  if (!IsTracing()) {
+    return (*original_writev)(fd, iov, iovcnt);
+  }
+  long long start_time = GetTime();
+  ssize_t ret = (*original_writev)(fd, iov, iovcnt);
+  RecordIO(fd, ret, start_time, GetTime());
+  return ret;
+}
+
+ssize_t pread(int fd, void *buf, size_t count, off_t offset) {
+  if (module_init == 0) {
+    init_mock();
+  }
+  if (!IsTracing()) {
+    return (*original_pread)(fd, buf, count, offset);
+  }
+  long long start_time = GetTime();
+  ssize_t ret = (*original_pread)(fd, buf, count, offset);
+  RecordIO(fd, ret, start_time, GetTime());
+  return ret;
+}
+
+ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset) {
+  if (module_init == 0) {
+    init_mock();
+  }
+  if (!IsTracing()) {
+    return (*original_pwrite)(fd, buf, count, offset);
+  }
+  long long start_time = GetTime();
+  ssize_t ret = (*original_pwrite)(fd, buf, count, offset);
+  RecordIO(fd, ret, start_time, GetTime());
+  return ret;
+}
+
+ssize_t pread64(int fd, void *buf, size_t count, off64_t offset) {
+  if (module_init == 0) {
+    init_mock();
+  }
+  if (!IsTracing()) {
+    return (*original_pread64)(fd, buf, count, offset);
+  }
+  long long start_time = GetTime();
+  ssize_t ret = (*original_pread64)(fd, buf, count, offset);
+  RecordIO(fd, ret, start_time, GetTime());
+  return ret;
+}
+
+ssize_t pwrite64(int fd, const void *buf, size_t count, off64_t offset) {
+  if (module_init == 0) {
+    init_mock();
+  }
+  if (!IsTracing()) {
+    return (*original_pwrite64)(fd, buf, count, offset);
+  }
+  long long start_time = GetTime();
+  ssize_t ret = (*original_pwrite64)(fd, buf, count, offset);
+  RecordIO(fd, ret, start_time, GetTime());
+  return ret;
+}
+
+/** The mode is only passed when a file may be created */
+static inline mode_t GetOpenMode(int flags, va_list args) {
+  if ((flags & O_CREAT) != 0 || (flags & O_TMPFILE) == O_TMPFILE) {
+    return va_arg(args, mode_t);
+  }
+  return 0;
+}
+
+int open(const char *path, int flags, ...) {
+  if (module_init == 0) {
+    init_mock();
+  }
+  va_list args;
+  va_start(args, flags);
+  mode_t mode = GetOpenMode(flags, args);
+  va_end(args);
+  if (!IsTracing()) {
+    return (*original_open)(path, flags, mode);
+  }
+  long long start_time = GetTime();
+  int fd = (*original_open)(path, flags, mode);
+  SetFdFile(fd, path);
+  RecordIO(fd, 0, start_time, GetTime());
+  return fd;
+}
+
+int open64(const char *path, int flags, ...) {
+  if (module_init == 0) {
+    init_mock();
+  }
+  va_list args;
+  va_start(args, flags);
+  mode_t mode = GetOpenMode(flags, args);
+  va_end(args);
+  if (!IsTracing()) {
+    return (*original_open64)(path, flags, mode);
+  }
+  long long start_time = GetTime();
+  int fd = (*original_open64)(path, flags, mode);
+  SetFdFile(fd, path);
+  RecordIO(fd, 0, start_time, GetTime());
+  return fd;
+}
+
+/** Paths relative to dirfd are named as given */
+int openat(int dirfd, const char *path, int flags, ...) {
+  if (module_init == 0) {
+    init_mock();
+  }
+  va_list args;
+  va_start(args, flags);
+  mode_t mode = GetOpenMode(flags, args);
+  va_end(args);
+  if (!IsTracing()) {
+    return (*original_openat)(dirfd, path, flags, mode);
+  }
+  long long start_time = GetTime();
+  int fd = (*original_openat)(dirfd, path, flags, mode);
+  SetFdFile(fd, path);
+  RecordIO(fd, 0, start_time, GetTime());
+  return fd;
+}
+
+int openat64(int dirfd, const char *path, int flags, ...) {
+  if (module_init == 0) {
+    init_mock();
+  }
+  va_list args;
+  va_start(args, flags);
+  mode_t mode = GetOpenMode(flags, args);
+  va_end(args);
+  if (!IsTracing()) {
+    return (*original_openat64)(dirfd, path, flags, mode);
+  }
+  long long start_time = GetTime();
+  int fd = (*original_openat64)(dirfd, path, flags, mode);
+  SetFdFile(fd, path);
+  RecordIO(fd, 0, start_time, GetTime());
+  return fd;
+}
+
+int creat(const char *path, mode_t mode) {
+  if (module_init == 0) {
+    init_mock();
+  }
+  if (!IsTracing()) {
+    return (*original_creat)(path, mode);
+  }
+  long long start_time = GetTime();
+  int fd = (*original_creat)(path, mode);
+  SetFdFile(fd, path);
+  RecordIO(fd, 0, start_time, GetTime());
+  return fd;
+}
+
+int close(int fd) {
+  if (module_init == 0) {
+    init_mock();
+  }
+  if (!IsTracing()) {
+    return (*original_close)(fd);
+  }
+  long long start_time = GetTime();
+  int ret = (*original_close)(fd);
+  RecordIO(fd, 0, start_time, GetTime());
+  UnsetFdFile(fd);
+  return ret;
+}
+
+int fsync(int fd) {
+  if (module_init == 0) {
+    init_mock();
+  }
+  if (!IsTracing()) {
+    return (*original_fsync)(fd);
+  }
+  long long start_time = GetTime();
+  int ret = (*original_fsync)(fd);
+  RecordIO(fd, 0, start_time, GetTime());
+  return ret;
+}
+
+int fdatasync(int fd) {
+  if (module_init == 0) {
+    init_mock();
+  }
+  if (!IsTracing()) {
+    return (*original_fdatasync)(fd);
+  }
+  long long start_time = GetTime();
+  int ret = (*original_fdatasync)(fd);
+  RecordIO(fd, 0, start_time, GetTime());
+  return ret;
+}
@@ -0,0 +1,65 @@
+#ifndef MPI_INFO_FORMAT_H_
+#define MPI_INFO_FORMAT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary layout of the MPI info logs (MPID files) written by mpi_tracer and
+// read by the communication dependence analyses. A file begins with a
+// MPIInfoFileHeader, then records follow until the end of the file, each one
+// a MPIInfoRecordHeader, call_path_len addresses (uint64_t) from the leaf and
+// info_len int32_t values. Text MPID files of PERF_DATA_FORMAT=text are told
+// apart by the magic. Files keep their MPID<rank>.TXT names in both formats,
+// which the analyses and scripts look for.
+
+#define MPI_INFO_MAGIC "BGMPINFO"
+#define MPI_INFO_MAGIC_LEN 8
+#define MPI_INFO_VERSION 2
+
+typedef struct MPIInfoFileHeader {
+  char magic[MPI_INFO_MAGIC_LEN];
+  uint32_t version;
+  uint32_t reserved;
+} MIFH;
+
+// Values of info are the world ranks of the ranks of the communicator for a
+// collective record ('c' blocking, 'C' non-blocking), or source, dest and tag
+// of each request for a p2p record
+typedef struct MPIInfoRecordHeader {
+  char type;
+  char reserved[3];
+  uint32_t call_path_len;
+  uint32_t info_len;
+  int32_t comm_id; // id of the communicator in the rank, collective records
+  uint64_t count;
+  double exe_time;
+  // Fields below are not in version 1 files
+  uint64_t bytes;
+  int32_t op;   // COLL_OP_* of collective records
+  int32_t root; // world rank of the root of rooted collectives, or -1
+} MIRH;
+
+// Size of a record header in files of a version
+#define MPI_INFO_RECORD_HEADER_SIZE(VERSION)                                   \
+  ((VERSION) == 1 ? offsetof(MIRH, bytes) : sizeof(MIRH))
+
+// Collective operations, whichever of blocking or non-blocking
+enum CollOp {
+  COLL_OP_BARRIER = 0,
+  COLL_OP_BCAST,
+  COLL_OP_REDUCE,
+  COLL_OP_ALLREDUCE,
+  COLL_OP_SCATTER,
+  COLL_OP_SCATTERV,
+  COLL_OP_GATHER,
+  COLL_OP_GATHERV,
+  COLL_OP_ALLGATHER,
+  COLL_OP_ALLGATHERV,
+  COLL_OP_ALLTOALL,
+  COLL_OP_ALLTOALLV,
+  COLL_OP_REDUCE_SCATTER,
+  COLL_OP_SCAN,
+  COLL_OP_EXSCAN
+};
+
+#endif // MPI_INFO_FORMAT_H_
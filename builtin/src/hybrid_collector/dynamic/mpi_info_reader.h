@@ -0,0 +1,258 @@
+#ifndef MPI_INFO_READER_H_
+#define MPI_INFO_READER_H_
+
+#include "mpi_info_format.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Records of MPID files, shared by the communication dependence analyses.
+// An analysis may define MAX_WAIT_REQ before including this file.
+
+#ifndef MAX_WAIT_REQ
+#define MAX_WAIT_REQ 50
+#endif
+
+typedef struct CollInfoStruct {
+  char type = 0;
+  int op = 0;
+  std::vector<unsigned long long> call_path;
+  int comm_id = 0;
+  std::vector<int> comm; // world ranks of the ranks of the communicator
+  int root = -1;
+  unsigned long long count = 0;
+  unsigned long long bytes = 0;
+  double exe_time = 0.0;
+} CIS;
+
+typedef struct P2PInfoStruct {
+  char type = 0;
+  std::vector<unsigned long long> call_path;
+  int request_count = 0;
+  int source[MAX_WAIT_REQ] = {0};
+  int dest[MAX_WAIT_REQ] = {0};
+  int tag[MAX_WAIT_REQ] = {0};
+  unsigned long long count = 0;
+  unsigned long long bytes = 0;
+  double exe_time = 0.0;
+} PIS;
+
+typedef struct CommDepEdge {
+  char dest_type = 0;
+  char src_type = 0;
+  std::vector<unsigned long long> dest_callpath;
+  std::vector<unsigned long long> src_callpath;
+  int dest_pid = 0;
+  int src_pid = 0;
+  double exe_time = 0;
+  unsigned long long bytes = 0; // bytes sent by the src side
+} CDE;
+
+// Addresses of a call path in text, from the leaf
+inline std::vector<unsigned long long>
+parseCallPath(const std::string &call_path_str) {
+  std::vector<unsigned long long> call_path;
+  const char *str = call_path_str.c_str();
+  char *end = NULL;
+  for (unsigned long long addr = strtoull(str, &end, 16); end != str;
+       addr = strtoull(str, &end, 16)) {
+    call_path.push_back(addr);
+    str = end;
+  }
+  return call_path;
+}
+
+inline std::string
+callPathString(const std::vector<unsigned long long> &call_path) {
+  std::stringstream call_path_str;
+  call_path_str << std::hex;
+  for (auto addr : call_path) {
+    call_path_str << addr << " ";
+  }
+  return call_path_str.str();
+}
+
+// Read the records of a binary MPID file following its header, see
+// mpi_info_format.h
+inline void readMPIInfoBinary(std::ifstream &inputStream,
+                              std::vector<CIS *> &coll_records,
+                              std::vector<PIS *> &p2p_records) {
+  MIFH header;
+  inputStream.read((char *)&header, sizeof(header));
+  if (!inputStream.good() || header.version < 1 ||
+      header.version > MPI_INFO_VERSION) {
+    std::cout << "Unsupported MPID file version\n";
+    return;
+  }
+  size_t record_header_size = MPI_INFO_RECORD_HEADER_SIZE(header.version);
+  MIRH record;
+  memset(&record, 0, sizeof(record));
+  record.root = -1;
+  while (inputStream.read((char *)&record, record_header_size)) {
+    std::vector<unsigned long long> call_path(record.call_path_len);
+    std::vector<int> info(record.info_len);
+    inputStream.read((char *)call_path.data(),
+                     call_path.size() * sizeof(unsigned long long));
+    inputStream.read((char *)info.data(), info.size() * sizeof(int));
+    if (!inputStream.good()) {
+      std::cout << "Truncated MPID file\n";
+      return;
+    }
+
+    if (record.type == 'c' || record.type == 'C') {
+      CIS *one_coll_info = new CIS;
+      one_coll_info->type = record.type;
+      one_coll_info->op = record.op;
+      one_coll_info->call_path = call_path;
+      one_coll_info->comm_id = record.comm_id;
+      one_coll_info->comm = info;
+      one_coll_info->root = record.root;
+      one_coll_info->count = record.count;
+      one_coll_info->bytes = record.bytes;
+      one_coll_info->exe_time = record.exe_time;
+      coll_records.push_back(one_coll_info);
+    } else if (record.type == 's' || record.type == 'S' ||
+               record.type == 'r' || record.type == 'R' ||
+               record.type == 'w') {
+      PIS *one_p2p_info = new PIS;
+      one_p2p_info->type = record.type;
+      one_p2p_info->call_path = call_path;
+      one_p2p_info->count = record.count;
+      one_p2p_info->bytes = record.bytes;
+      one_p2p_info->exe_time = record.exe_time;
+      int request_count = record.info_len / 3;
+      if (request_count > MAX_WAIT_REQ) {
+        request_count = MAX_WAIT_REQ;
+      }
+      for (int i = 0; i < request_count; i++) {
+        one_p2p_info->source[i] = info[i * 3];
+        one_p2p_info->dest[i] = info[i * 3 + 1];
+        one_p2p_info->tag[i] = info[i * 3 + 2];
+      }
+      one_p2p_info->request_count = request_count;
+      p2p_records.push_back(one_p2p_info);
+    }
+  }
+}
+
+// Read the records of a text MPID file, a line is
+// "type call path | info | count | time | bytes"
+inline void readMPIInfoText(std::ifstream &inputStream,
+                            std::vector<CIS *> &coll_records,
+                            std::vector<PIS *> &p2p_records) {
+  size_t pos = 0;
+  std::string delimiter = "";
+  for (std::string line; getline(inputStream, line);) {
+    // Parse - type
+    delimiter = " ";
+    pos = line.find(delimiter);
+    std::string type_str = line.substr(0, pos);
+    line.erase(0, pos + delimiter.length());
+
+    // Parse - call path
+    delimiter = "|";
+    pos = line.find(delimiter);
+    std::string call_path_str = line.substr(0, pos);
+    line.erase(0, pos + delimiter.length());
+
+    // Parse - info
+    pos = line.find(delimiter);
+    std::string info_str = line.substr(0, pos);
+    line.erase(0, pos + delimiter.length());
+
+    // Parse - count
+    pos = line.find(delimiter);
+    std::string count_str = line.substr(0, pos);
+    line.erase(0, pos + delimiter.length());
+
+    // Parse -  time
+    pos = line.find(delimiter);
+    std::string exe_time_str = line.substr(0, pos);
+    line.erase(0, pos == std::string::npos ? line.length()
+                                           : pos + delimiter.length());
+
+    // Parse - bytes, if any
+    std::string bytes_str = line;
+
+    if (!type_str.compare(std::string("c")) ||
+        !type_str.compare(std::string("C"))) {
+      CIS *one_coll_info = new CIS;
+
+      // info is "op comm_id root : world ranks"
+      one_coll_info->type = type_str.c_str()[0];
+      one_coll_info->call_path = parseCallPath(call_path_str);
+      std::stringstream stristre(info_str);
+      std::string colon;
+      stristre >> one_coll_info->op >> one_coll_info->comm_id >>
+          one_coll_info->root >> colon;
+      for (int rank; stristre >> rank;) {
+        one_coll_info->comm.push_back(rank);
+      }
+      one_coll_info->count = strtoull(count_str.c_str(), NULL, 10);
+      one_coll_info->bytes = strtoull(bytes_str.c_str(), NULL, 10);
+      one_coll_info->exe_time = strtod(exe_time_str.c_str(), NULL);
+      coll_records.push_back(one_coll_info);
+    } else if (!type_str.compare(std::string("s")) ||
+               !type_str.compare(std::string("S")) ||
+               !type_str.compare(std::string("r")) ||
+               !type_str.compare(std::string("R")) ||
+               !type_str.compare(std::string("w"))) {
+      PIS *one_p2p_info = new PIS;
+
+      one_p2p_info->type = type_str.c_str()[0];
+      one_p2p_info->call_path = parseCallPath(call_path_str);
+      one_p2p_info->count = strtoull(count_str.c_str(), NULL, 10);
+      one_p2p_info->bytes = strtoull(bytes_str.c_str(), NULL, 10);
+      one_p2p_info->exe_time = strtod(exe_time_str.c_str(), NULL);
+
+      // Analyze
+      int request_count_tmp = 0;
+      delimiter = ",";
+      while ((pos = info_str.find(delimiter)) != std::string::npos &&
+             request_count_tmp < MAX_WAIT_REQ) {
+        std::string src_dst_tag = info_str.substr(0, pos);
+        info_str.erase(0, pos + delimiter.length());
+        std::stringstream stristre;
+        int src = -1, dst = -1, tag = -1;
+        stristre << src_dst_tag;
+        stristre >> src >> dst >> tag;
+        one_p2p_info->source[request_count_tmp] = src;
+        one_p2p_info->dest[request_count_tmp] = dst;
+        one_p2p_info->tag[request_count_tmp] = tag;
+        request_count_tmp++;
+      }
+      one_p2p_info->request_count = request_count_tmp;
+      p2p_records.push_back(one_p2p_info);
+    }
+  }
+}
+
+// Read the collective and p2p records of a MPID file in either format, in
+// the order of the file
+inline void readMPIInfoRecords(const std::string &file_name,
+                               std::vector<CIS *> &coll_records,
+                               std::vector<PIS *> &p2p_records) {
+  std::ifstream inputStream(file_name.c_str(),
+                            std::ios_base::in | std::ios_base::binary);
+  if (!inputStream.good()) {
+    std::cout << "Failed to open " << file_name.c_str() << " file\n";
+    return;
+  }
+  // Peek the magic to tell a binary file from a text one
+  char magic[MPI_INFO_MAGIC_LEN] = {0};
+  inputStream.read(magic, MPI_INFO_MAGIC_LEN);
+  inputStream.clear();
+  inputStream.seekg(0);
+  if (memcmp(magic, MPI_INFO_MAGIC, MPI_INFO_MAGIC_LEN) == 0) {
+    readMPIInfoBinary(inputStream, coll_records, p2p_records);
+  } else {
+    readMPIInfoText(inputStream, coll_records, p2p_records);
+  }
+  inputStream.close();
+}
+
+#endif // MPI_INFO_READER_H_
@@ -24,8 +24,11 @@ char *addr_threshold;
 void RecordCallPath(int y) {
   baguatool::type::addr_t call_path[MAX_CALL_PATH_DEPTH] = {0};
   int call_path_len = sampler->GetBacktrace(call_path, MAX_CALL_PATH_DEPTH);
+  baguatool::type::perf_data_t values[MAX_NUM_SAMPLE_METRICS] = {0};
+  int num_values = sampler->GetSampleValues(values, MAX_NUM_SAMPLE_METRICS);
   perf_data->RecordVertexData(call_path, call_path_len,
-                              mpi_rank /* process_id */, 0 /* thread_id */, 1);
+                              mpi_rank /* process_id */, 0 /* thread_id */,
+                              values, num_values);
 }
 
 static void init_mock() __attribute__((constructor));
@@ -48,15 +51,19 @@ static void init_mock() {
   void (*RecordCallPathPointer)(int) = &(RecordCallPath);
   sampler->SetOverflow(RecordCallPathPointer);
 
+  sampler->ConfigurePerfData(perf_data.get(), true);
+
   sampler->Start();
 }
 
 // User-defined what to do at destructor
 static void fini_mock() {
-  sampler->Stop();
   std::string output_file_name =
       std::string("SAMPLE+") + std::to_string(mpi_rank) + std::string(".TXT");
-  perf_data->Dump(output_file_name.c_str());
+  std::string self_stats_file_name =
+      std::string("SELF+") + std::to_string(mpi_rank) + std::string(".TXT");
+  sampler->FinishPerfData(perf_data.get(), output_file_name.c_str(),
+                          self_stats_file_name.c_str());
   // sampler->RecordLdLib();
 
   std::unique_ptr<baguatool::collector::SharedObjAnalysis> shared_obj_analysis =
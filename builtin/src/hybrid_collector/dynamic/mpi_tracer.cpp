@@ -46,29 +46,46 @@ _EXTERN_C_ void pmpi_init__(MPI_Fint *ierr);
 
 #define UNW_LOCAL_ONLY // must define before including libunwind.h
 
+#include "baguatool.h"
 #include "dbg.h"
+#include "mpi_info_format.h"
 #include "mpi_init.h"
 #include <chrono>
+#include <errno.h>
+#include <fcntl.h>
 #include <fstream>
 #include <iostream>
 #include <libunwind.h>
 #include <map>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 #include <string>
+#include <unistd.h>
+#include <vector>
 
 using namespace std;
 
 #define MODULE_INITED 1
 #define LOG_SIZE 10000
 #define MAX_STACK_DEPTH 100
-#define MAX_CALL_PATH_LEN 1300 // MAX_STACK_DEPTH * 13
 #define MAX_NAME_LEN 20
 #define MAX_ARGS_LEN 20
-#define MAX_COMM_WORLD_SIZE 100000
 #define MAX_WAIT_REQ 100
-#define MAX_TRACE_SIZE 25000000
+#define MAX_TRACE_SIZE 12500000 // of each of the two trace log buffers
 #define TRACE_LOG_LINE_SIZE 100
+#define P2P_TABLE_BITS 15 // P2P_TABLE_SIZE is at least twice LOG_SIZE
+#define P2P_TABLE_SIZE (1 << P2P_TABLE_BITS)
+#define COLL_TABLE_BITS 15 // COLL_TABLE_SIZE is at least twice LOG_SIZE
+#define COLL_TABLE_SIZE (1 << COLL_TABLE_BITS)
+#define TYPE_SIZE_CACHE_BITS 8
+#define TYPE_SIZE_CACHE_SIZE (1 << TYPE_SIZE_CACHE_BITS)
+#define WRITE_BUFFER_SIZE (1 << 20) // staging buffer of a log file
+#define WRITE_BUFFER_ALIGN 4096
+#define MAX_TEXT_FIELD_LEN 64
 #define MY_BT
 
 // #define DEBUG
@@ -80,24 +97,73 @@ using namespace std;
 #endif
 
 typedef struct CollInfoStruct {
-  char call_path[MAX_CALL_PATH_LEN] = {0};
-  MPI_Comm comm;
+  char type = 0; // 'c': blocking | 'C': non-blocking
+  int op = 0;    // COLL_OP_*
+  unsigned long long int key =
+      0; // hash of all the fields below but count, bytes and exe_time
+  unsigned long long int call_path_hash = 0;
+  unw_word_t call_path[MAX_STACK_DEPTH] = {0};
+  int call_path_len = 0;
+  int comm_id = 0;
+  // Size and world ranks of comm_info_table[comm_id], kept in the record for
+  // the writer thread
+  int comm_size = 0;
+  const int *world_ranks = NULL;
+  int root = -1; // world rank of the root of rooted collectives
   unsigned long long int count = 0;
+  unsigned long long int bytes = 0;
   double exe_time = 0.0;
 } CIS;
 
+typedef struct CommInfoStruct {
+  int size = 0;
+  int *world_ranks = nullptr; // world rank of each rank of the communicator
+} CMI;
+
+typedef struct TypeSizeStruct {
+  MPI_Datatype type;
+  int size = 0;
+  bool valid = false;
+} TSC;
+
 typedef struct P2PInfoStruct {
   char type =
       0; // 'r' 's' :blocking recv/send  | 'R' 'S': non-blocking recv/send
-  char call_path[MAX_CALL_PATH_LEN] = {0};
+  unsigned long long int key =
+      0; // hash of all the fields below but count, bytes and exe_time
+  unsigned long long int call_path_hash = 0;
+  unw_word_t call_path[MAX_STACK_DEPTH] = {0};
+  int call_path_len = 0;
   int request_count = 0;
   int source[MAX_WAIT_REQ] = {0};
   int dest[MAX_WAIT_REQ] = {0};
   int tag[MAX_WAIT_REQ] = {0};
   unsigned long long int count = 0;
+  unsigned long long int bytes = 0; // bytes of the buffers, 0 for waits
   double exe_time = 0.0;
 } PIS;
 
+// Back buffer of a double buffered log. The full front buffer is handed to the
+// writer thread by swapping it with the back one, which must be written before
+// the next swap.
+typedef struct LogBufferStruct {
+  void *data = nullptr;             // back buffer
+  unsigned long long int count = 0; // entries of the back buffer
+  volatile int pending = 0;         // back buffer is waiting to be written
+} LBS;
+
+// Writer thread of the logs, so that an MPI call filling a log swaps buffers
+// instead of writing files and stalling the peers waiting for this rank
+typedef struct TraceWriterStruct {
+  LBS coll_log;          // of coll_mpi_info_log
+  LBS p2p_log;           // of p2p_mpi_info_log
+  LBS trace_log;         // of trace_log
+  volatile int stop = 0; // writer thread should exit
+  sem_t sem;             // posted on swap and stop
+  pthread_t thread;      //
+  bool started = false;  // logs are written in place otherwise
+} TWS;
+
 struct RequestConverter {
   char data[sizeof(MPI_Request)];
   RequestConverter(MPI_Request *mpi_request) {
@@ -121,16 +187,32 @@ struct RequestConverter {
   }
 };
 
-static CIS coll_mpi_info_log[LOG_SIZE];
-static PIS p2p_mpi_info_log[LOG_SIZE];
+static CIS coll_mpi_info_logs[2][LOG_SIZE];
+static PIS p2p_mpi_info_logs[2][LOG_SIZE];
+// Front buffers filled by MPI calls, the other ones are back buffers
+static CIS *coll_mpi_info_log = coll_mpi_info_logs[0];
+static PIS *p2p_mpi_info_log = p2p_mpi_info_logs[0];
 static unsigned long long int coll_mpi_info_log_pointer = 0;
 static unsigned long long int p2p_mpi_info_log_pointer = 0;
-static unsigned int trace_log[MAX_TRACE_SIZE] = {0};
+// Open addressing table of indices of p2p_mpi_info_log plus 1, 0 if empty
+static unsigned int p2p_mpi_info_table[P2P_TABLE_SIZE] = {0};
+// Open addressing table of indices of coll_mpi_info_log plus 1, 0 if empty
+static unsigned int coll_mpi_info_table[COLL_TABLE_SIZE] = {0};
+// Communicators seen by collectives, indexed by their ids
+static vector<CMI> comm_info_table;
+static int comm_info_keyval = MPI_KEYVAL_INVALID;
+// Direct mapped cache of sizes of datatypes
+static TSC type_size_cache[TYPE_SIZE_CACHE_SIZE];
+static unsigned int trace_logs[2][MAX_TRACE_SIZE] = {{0}};
+static unsigned int *trace_log = trace_logs[0];
 static unsigned long long int trace_log_pointer = 0;
+static TWS trace_writer;
 
 map<RequestConverter, pair<int, int>> request_converter;
 map<RequestConverter, pair<int, int>>
     recv_init_request_converter; /* <src, tag> */
+map<RequestConverter, unsigned long long>
+    recv_init_request_bytes; /* bytes of the receive buffer */
 
 static int module_init = 0;
 // static char* addr_threshold;
@@ -138,113 +220,381 @@ bool mpi_finalize_flag = false;
 
 // int mpi_rank = -1;
 
+// Unwind in the mode of the samplers, so that SAMPLER_UNWIND=fp or cached also
+// spares unw_step on every frame of deep stacks at each MPI call
 int my_backtrace(unw_word_t *buffer, int max_depth) {
-  unw_cursor_t cursor;
-  unw_context_t context;
-
-  // Initialize cursor to current frame for local unwinding.
-  unw_getcontext(&context);
-  unw_init_local(&cursor, &context);
-
-  // Unwind frames one by one, going up the frame stack.
-  int depth = 0;
-  while (unw_step(&cursor) > 0 && depth < max_depth) {
-    unw_word_t pc;
-    unw_get_reg(&cursor, UNW_REG_IP, &pc);
-    if (pc == 0) {
-      break;
-    }
-    buffer[depth] = pc;
-    depth++;
+  baguatool::type::addr_t pcs[MAX_STACK_DEPTH];
+  int depth = baguatool::collector::Backtrace(pcs, max_depth);
+  for (int i = 0; i < depth; i++) {
+    buffer[i] = pcs[i];
   }
   return depth;
 }
 
-// Dump mpi info log
-static void writeCollMpiInfoLog() {
-  ofstream outputStream(
-      (string("dynamic_data/MPID") + to_string(mpi_rank) + string(".TXT")),
-      ios_base::app);
-  if (!outputStream.good()) {
+// Staging buffer of a log file, written out in large chunks from page aligned
+// memory instead of value by value
+typedef struct WriteBufferStruct {
+  int fd = -1;                           //
+  char *data = nullptr;                  // WRITE_BUFFER_SIZE bytes
+  size_t size = 0;                       // bytes buffered
+  unsigned long long int byte_count = 0; // bytes written to the file
+  unsigned long long int start_time = 0; // self stat time at open
+} WBS;
+
+static bool openWriteBuffer(WBS &buffer, const string &file_name) {
+  buffer.start_time = baguatool::core::GetSelfStatTime();
+  buffer.fd = open(file_name.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (buffer.fd < 0) {
     cout << "Failed to open sample file\n";
-    return;
+    return false;
+  }
+  if (posix_memalign((void **)&buffer.data, WRITE_BUFFER_ALIGN,
+                     WRITE_BUFFER_SIZE) != 0) {
+    cout << "Failed to allocate write buffer\n";
+    close(buffer.fd);
+    buffer.fd = -1;
+    buffer.data = nullptr;
+    return false;
   }
+  buffer.size = 0;
+  buffer.byte_count = 0;
+  return true;
+}
 
-  int comm_size = 0;
-  MPI_Group group1, group2;
-  MPI_Comm_group(MPI_COMM_WORLD, &group1);
-  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
-  int ranks1[MAX_COMM_WORLD_SIZE] = {0};
-  int ranks2[MAX_COMM_WORLD_SIZE] = {0};
-  for (int i = 0; i < comm_size; i++) {
-    ranks1[i] = i;
+static void flushWriteBuffer(WBS &buffer) {
+  size_t offset = 0;
+  while (offset < buffer.size) {
+    ssize_t written =
+        write(buffer.fd, buffer.data + offset, buffer.size - offset);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      cout << "Failed to write sample file\n";
+      break;
+    }
+    offset += written;
   }
+  buffer.byte_count += offset;
+  buffer.size = 0;
+}
 
-  // TODO: output different comm
-  for (int i = 0; i < coll_mpi_info_log_pointer; i++) {
-    MPI_Comm_group(coll_mpi_info_log[i].comm, &group2);
-    MPI_Group_translate_ranks(group1, comm_size, ranks1, group2, ranks2);
-    outputStream << "c ";
-    outputStream << coll_mpi_info_log[i].call_path << " | ";
-    for (int j = 0; j < comm_size; j++) {
-      outputStream << ranks2[j] << " ";
+// Write out the rest and account the time and bytes of the write of a log to
+// the self statistics
+static void closeWriteBuffer(WBS &buffer) {
+  flushWriteBuffer(buffer);
+  close(buffer.fd);
+  free(buffer.data);
+  buffer.fd = -1;
+  buffer.data = nullptr;
+  baguatool::core::AddSelfStat(baguatool::core::STAT_BYTES_WRITTEN,
+                               buffer.byte_count);
+  baguatool::core::AddSelfStat(baguatool::core::STAT_DUMP_TIME,
+                               baguatool::core::GetSelfStatTime() -
+                                   buffer.start_time);
+}
+
+static void bufferWrite(WBS &buffer, const void *data, size_t size) {
+  const char *bytes = (const char *)data;
+  while (size > 0) {
+    size_t n = min(size, (size_t)WRITE_BUFFER_SIZE - buffer.size);
+    memcpy(buffer.data + buffer.size, bytes, n);
+    buffer.size += n;
+    bytes += n;
+    size -= n;
+    if (buffer.size == WRITE_BUFFER_SIZE) {
+      flushWriteBuffer(buffer);
     }
-    outputStream << " | " << coll_mpi_info_log[i].count;
-    outputStream << " | " << coll_mpi_info_log[i].exe_time << '\n';
   }
+}
 
-  coll_mpi_info_log_pointer = 0;
+// Formatted text of at most MAX_TEXT_FIELD_LEN bytes, a field of a record
+static void bufferPrintf(WBS &buffer, const char *format, ...) {
+  if (WRITE_BUFFER_SIZE - buffer.size < MAX_TEXT_FIELD_LEN) {
+    flushWriteBuffer(buffer);
+  }
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(buffer.data + buffer.size, MAX_TEXT_FIELD_LEN, format,
+                    args);
+  va_end(args);
+  if (n > 0) {
+    buffer.size += min(n, MAX_TEXT_FIELD_LEN - 1);
+  }
+}
 
-  outputStream.close();
+// Decimal digits of a value followed by a separator, as printf does
+static inline void bufferUInt(WBS &buffer, unsigned int value,
+                              char separator) {
+  char digits[16];
+  int n = sizeof(digits);
+  digits[--n] = separator;
+  do {
+    digits[--n] = '0' + value % 10;
+    value /= 10;
+  } while (value != 0);
+  bufferWrite(buffer, digits + n, sizeof(digits) - n);
 }
 
-static void writeP2PMpiInfoLog() {
-  ofstream outputStream(
-      (string("dynamic_data/MPID") + to_string(mpi_rank) + string(".TXT")),
-      ios_base::app);
-  if (!outputStream.good()) {
-    cout << "Failed to open sample file\n";
+static bool mpiInfoTextFromEnv() {
+  const char *format = getenv("PERF_DATA_FORMAT");
+  return format != NULL && strcmp(format, "text") == 0;
+}
+
+// MPI info logs are binary unless PERF_DATA_FORMAT is "text", as PerfData
+static bool mpi_info_text_format = mpiInfoTextFromEnv();
+
+static_assert(sizeof(unw_word_t) == sizeof(uint64_t),
+              "call paths are written as 64-bit addresses");
+
+// Open the mpi info log of this rank for appending, and write the file header
+// of the binary format if the file is new
+static bool openMpiInfoLog(WBS &buffer) {
+  if (!openWriteBuffer(buffer, string("dynamic_data/MPID") +
+                                   to_string(mpi_rank) + string(".TXT"))) {
+    return false;
+  }
+  if (lseek(buffer.fd, 0, SEEK_END) == 0 && !mpi_info_text_format) {
+    MIFH header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MPI_INFO_MAGIC, MPI_INFO_MAGIC_LEN);
+    header.version = MPI_INFO_VERSION;
+    bufferWrite(buffer, &header, sizeof(header));
+  }
+  return true;
+}
+
+static void writeMpiInfoRecord(WBS &buffer, MIRH &record,
+                               const unw_word_t *call_path, const int *info) {
+  bufferWrite(buffer, &record, sizeof(record));
+  bufferWrite(buffer, call_path, record.call_path_len * sizeof(unw_word_t));
+  bufferWrite(buffer, info, record.info_len * sizeof(int));
+}
+
+static void writeCallPathText(WBS &buffer, const unw_word_t *call_path,
+                              int call_path_len) {
+  for (int i = 0; i < call_path_len; i++) {
+    bufferPrintf(buffer, "%llx ", (unsigned long long)call_path[i]);
+  }
+}
+
+// Dump mpi info log
+static void writeCollMpiInfoLog(const CIS *log, unsigned long long count) {
+  WBS buffer;
+  if (!openMpiInfoLog(buffer)) {
+    return;
+  }
+
+  // Communicators are written as the world ranks of their ranks, translated
+  // once when a communicator is first seen
+  for (unsigned long long i = 0; i < count; i++) {
+    const CIS *info = &log[i];
+    if (!mpi_info_text_format) {
+      MIRH record;
+      memset(&record, 0, sizeof(record));
+      record.type = info->type;
+      record.call_path_len = info->call_path_len;
+      record.info_len = info->comm_size;
+      record.comm_id = info->comm_id;
+      record.count = info->count;
+      record.exe_time = info->exe_time;
+      record.bytes = info->bytes;
+      record.op = info->op;
+      record.root = info->root;
+      writeMpiInfoRecord(buffer, record, info->call_path, info->world_ranks);
+      continue;
+    }
+    bufferPrintf(buffer, "%c ", info->type);
+    writeCallPathText(buffer, info->call_path, info->call_path_len);
+    bufferPrintf(buffer, " | %d %d %d : ", info->op, info->comm_id,
+                 info->root);
+    for (int j = 0; j < info->comm_size; j++) {
+      bufferPrintf(buffer, "%d ", info->world_ranks[j]);
+    }
+    bufferPrintf(buffer, " | %llu", info->count);
+    bufferPrintf(buffer, " | %g", info->exe_time);
+    bufferPrintf(buffer, " | %llu\n", info->bytes);
+  }
+
+  closeWriteBuffer(buffer);
+}
+
+static void writeP2PMpiInfoLog(const PIS *log, unsigned long long count) {
+  WBS buffer;
+  if (!openMpiInfoLog(buffer)) {
     return;
   }
 
   // TODO: output different comm
-  for (int i = 0; i < p2p_mpi_info_log_pointer; i++) {
-    outputStream << p2p_mpi_info_log[i].type << " ";
-    outputStream << p2p_mpi_info_log[i].call_path << " | ";
-    int request_count = p2p_mpi_info_log[i].request_count;
+  int requests[MAX_WAIT_REQ * 3] = {0};
+  for (unsigned long long i = 0; i < count; i++) {
+    const PIS *info = &log[i];
+    int request_count = info->request_count;
+    if (!mpi_info_text_format) {
+      for (int j = 0; j < request_count; j++) {
+        requests[j * 3] = info->source[j];
+        requests[j * 3 + 1] = info->dest[j];
+        requests[j * 3 + 2] = info->tag[j];
+      }
+      MIRH record;
+      memset(&record, 0, sizeof(record));
+      record.type = info->type;
+      record.call_path_len = info->call_path_len;
+      record.info_len = request_count * 3;
+      record.count = info->count;
+      record.exe_time = info->exe_time;
+      record.bytes = info->bytes;
+      record.root = -1;
+      writeMpiInfoRecord(buffer, record, info->call_path, requests);
+      continue;
+    }
+    bufferPrintf(buffer, "%c ", info->type);
+    writeCallPathText(buffer, info->call_path, info->call_path_len);
+    bufferPrintf(buffer, " | ");
     for (int j = 0; j < request_count; j++) {
-      outputStream << p2p_mpi_info_log[i].source[j] << " "
-                   << p2p_mpi_info_log[i].dest[j] << " "
-                   << p2p_mpi_info_log[i].tag[j] << " , ";
+      bufferPrintf(buffer, "%d %d %d , ", info->source[j], info->dest[j],
+                   info->tag[j]);
     }
-    outputStream << " | " << p2p_mpi_info_log[i].count;
-    outputStream << " | " << p2p_mpi_info_log[i].exe_time << '\n';
+    bufferPrintf(buffer, " | %llu", info->count);
+    bufferPrintf(buffer, " | %g", info->exe_time);
+    bufferPrintf(buffer, " | %llu\n", info->bytes);
   }
 
-  p2p_mpi_info_log_pointer = 0;
-
-  outputStream.close();
+  closeWriteBuffer(buffer);
 }
 
-static void writeTraceLog() {
-  ofstream outputStream(
-      (string("dynamic_data/MPIT") + to_string(mpi_rank) + string(".TXT")),
-      ios_base::app);
-  if (!outputStream.good()) {
-    cout << "Failed to open sample file\n";
+static void writeTraceLog(const unsigned int *log, unsigned long long count) {
+  WBS buffer;
+  if (!openWriteBuffer(buffer, string("dynamic_data/MPIT") +
+                                   to_string(mpi_rank) + string(".TXT"))) {
     return;
   }
 
-  for (int i = 0; i < trace_log_pointer; i += TRACE_LOG_LINE_SIZE) {
-    for (int j = i; j < i + TRACE_LOG_LINE_SIZE && j < trace_log_pointer; j++) {
-      outputStream << trace_log[j] << " ";
+  for (unsigned long long i = 0; i < count; i += TRACE_LOG_LINE_SIZE) {
+    for (unsigned long long j = i; j < i + TRACE_LOG_LINE_SIZE && j < count;
+         j++) {
+      bufferUInt(buffer, log[j], ' ');
     }
-    outputStream << '\n';
+    bufferWrite(buffer, "\n", 1);
   }
 
-  trace_log_pointer = 0;
+  closeWriteBuffer(buffer);
+}
+
+static void *traceWriterThread(void *arg) {
+  TWS *writer = (TWS *)arg;
+
+  while (true) {
+    while (sem_wait(&(writer->sem)) != 0) {
+    }
+    // Buffers swapped before stop are seen pending once stop is seen
+    int stop = writer->stop;
+    __sync_synchronize();
+    if (writer->coll_log.pending) {
+      writeCollMpiInfoLog((const CIS *)writer->coll_log.data,
+                          writer->coll_log.count);
+      __sync_lock_release(&(writer->coll_log.pending));
+    }
+    if (writer->p2p_log.pending) {
+      writeP2PMpiInfoLog((const PIS *)writer->p2p_log.data,
+                         writer->p2p_log.count);
+      __sync_lock_release(&(writer->p2p_log.pending));
+    }
+    if (writer->trace_log.pending) {
+      writeTraceLog((const unsigned int *)writer->trace_log.data,
+                    writer->trace_log.count);
+      __sync_lock_release(&(writer->trace_log.pending));
+    }
+    if (stop) {
+      break;
+    }
+  }
+  return nullptr;
+}
+
+// Logs are written by the writer thread from MPI_Init, or in place by the MPI
+// call filling them if it fails to start
+static void startTraceWriter() {
+  if (trace_writer.started) {
+    return;
+  }
+  trace_writer.coll_log.data = coll_mpi_info_logs[1];
+  trace_writer.p2p_log.data = p2p_mpi_info_logs[1];
+  trace_writer.trace_log.data = trace_logs[1];
+  sem_init(&(trace_writer.sem), 0, 0);
+  if (pthread_create(&(trace_writer.thread), nullptr, traceWriterThread,
+                     &trace_writer) != 0) {
+    cout << "Failed to create writer thread, logs are written in place\n";
+    sem_destroy(&(trace_writer.sem));
+    return;
+  }
+  trace_writer.started = true;
+}
+
+// The writer thread exits after writing the pending back buffers
+static void stopTraceWriter() {
+  if (!trace_writer.started) {
+    return;
+  }
+  trace_writer.started = false;
+  __sync_synchronize();
+  trace_writer.stop = 1;
+  sem_post(&(trace_writer.sem));
+  pthread_join(trace_writer.thread, nullptr);
+  sem_destroy(&(trace_writer.sem));
+}
+
+// Hand a full front buffer of a log to the writer thread, and get the back
+// buffer to fill next
+static void *swapLogBuffer(LBS *log_buffer, void *front,
+                           unsigned long long count) {
+  while (log_buffer->pending) {
+    sched_yield();
+  }
+  // Do not touch the back buffer before the writer thread is done with it
+  __sync_synchronize();
+  void *back = log_buffer->data;
+  log_buffer->data = front;
+  log_buffer->count = count;
+  // Publish the buffer only after it is set, test-and-set is just an acquire
+  // barrier
+  __sync_synchronize();
+  log_buffer->pending = 1;
+  sem_post(&(trace_writer.sem));
+  return back;
+}
 
-  outputStream.close();
+// Write out a log, through the writer thread if any, and start it over
+static void flushCollMpiInfoLog() {
+  if (trace_writer.started) {
+    coll_mpi_info_log = (CIS *)swapLogBuffer(
+        &(trace_writer.coll_log), coll_mpi_info_log, coll_mpi_info_log_pointer);
+  } else {
+    writeCollMpiInfoLog(coll_mpi_info_log, coll_mpi_info_log_pointer);
+  }
+  coll_mpi_info_log_pointer = 0;
+  memset(coll_mpi_info_table, 0, sizeof(coll_mpi_info_table));
+}
+
+static void flushP2PMpiInfoLog() {
+  if (trace_writer.started) {
+    p2p_mpi_info_log = (PIS *)swapLogBuffer(
+        &(trace_writer.p2p_log), p2p_mpi_info_log, p2p_mpi_info_log_pointer);
+  } else {
+    writeP2PMpiInfoLog(p2p_mpi_info_log, p2p_mpi_info_log_pointer);
+  }
+  p2p_mpi_info_log_pointer = 0;
+  memset(p2p_mpi_info_table, 0, sizeof(p2p_mpi_info_table));
+}
+
+static void flushTraceLog() {
+  if (trace_writer.started) {
+    trace_log = (unsigned int *)swapLogBuffer(&(trace_writer.trace_log),
+                                              trace_log, trace_log_pointer);
+  } else {
+    writeTraceLog(trace_log, trace_log_pointer);
+  }
+  trace_log_pointer = 0;
 }
 
 // static void init() __attribute__((constructor));
@@ -264,157 +614,315 @@ static void writeTraceLog() {
 //   }
 // }
 
-// Record mpi info to log
-
-void TRACE_COLL(MPI_Comm comm, double exe_time) {
-  /**
-#ifdef MY_BT
-unw_word_t buffer[MAX_STACK_DEPTH] = {0};
-#else
-void* buffer[MAX_STACK_DEPTH];
-memset(buffer, 0, sizeof(buffer));
-#endif
-unsigned int i, depth = 0;
-// memset(buffer, 0, sizeof(buffer));
-#ifdef MY_BT
-depth = my_backtrace(buffer, MAX_STACK_DEPTH);
-#else
-depth = unw_backtrace(buffer, MAX_STACK_DEPTH);
-#endif
-char call_path[MAX_CALL_PATH_LEN] = {0};
-  int offset = 0;
+// Mix a value into a hash, the high bits of which index tables
+static inline unsigned long long hashCombine(unsigned long long hash,
+                                             unsigned long long value) {
+  return (hash ^ value) * 0x9e3779b97f4a7c15ULL;
+}
 
-for (i = 0; i < depth; ++ i)
-  {
-          if( (void*)buffer[i] != NULL && (char*)buffer[i] < addr_threshold ){
-                  offset+=snprintf(call_path+offset, MAX_CALL_PATH_LEN - offset
-- 4 ,"%lx ",(void*)(buffer[i]-2));
-          }
+// Whether a p2p record has the same peers and tags
+static inline bool sameRequests(PIS *info, int request_count, int *source,
+                                int *dest, int *tag) {
+  if (info->request_count != request_count) {
+    return false;
+  }
+  for (int j = 0; j < request_count; j++) {
+    if (info->source[j] != source[j] || info->dest[j] != dest[j] ||
+        info->tag[j] != tag[j]) {
+      return false;
+    }
   }
+  return true;
+}
 
-  bool hasRecordFlag = false;
+// Id of a communicator in comm_info_table, where the world ranks of its ranks
+// are translated once. The id is cached as an attribute of the communicator,
+// which MPI_Comm_dup does not copy and MPI_Comm_free deletes, so that a
+// reused handle gets a new id.
+static int commId(MPI_Comm comm) {
+  if (comm_info_keyval == MPI_KEYVAL_INVALID) {
+    PMPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, MPI_COMM_NULL_DELETE_FN,
+                            &comm_info_keyval, NULL);
+  }
+  void *attr = NULL;
+  int flag = 0;
+  PMPI_Comm_get_attr(comm, comm_info_keyval, &attr, &flag);
+  if (flag) {
+    return (int)(intptr_t)attr;
+  }
 
-  for (i = 0; i < coll_mpi_info_log_pointer; i++){
-          if (strcmp(call_path, coll_mpi_info_log[i].call_path) == 0 ){
-                  int cmp_result;
-                  MPI_Comm_compare(comm, coll_mpi_info_log[i].comm,
-&cmp_result); if (cmp_result == MPI_CONGRUENT) { coll_mpi_info_log[i].count ++;
-                          coll_mpi_info_log[i].exe_time += exe_time;
-                          trace_log[trace_log_pointer ++ ] = i * 2;
-                          hasRecordFlag = true;
-                          break;
-                  }
-          }
+  CMI comm_info;
+  MPI_Group group, world_group;
+  PMPI_Comm_group(comm, &group);
+  PMPI_Comm_group(MPI_COMM_WORLD, &world_group);
+  PMPI_Group_size(group, &comm_info.size);
+  int *ranks = (int *)malloc(comm_info.size * sizeof(int));
+  comm_info.world_ranks = (int *)malloc(comm_info.size * sizeof(int));
+  for (int i = 0; i < comm_info.size; i++) {
+    ranks[i] = i;
   }
+  PMPI_Group_translate_ranks(group, comm_info.size, ranks, world_group,
+                             comm_info.world_ranks);
+  free(ranks);
+  PMPI_Group_free(&group);
+  PMPI_Group_free(&world_group);
+
+  int id = comm_info_table.size();
+  comm_info_table.push_back(comm_info);
+  PMPI_Comm_set_attr(comm, comm_info_keyval, (void *)(intptr_t)id);
+  return id;
+}
 
-  if(hasRecordFlag == false){
-          if(strlen(call_path) >= MAX_CALL_PATH_LEN){
-                  //LOG_WARN("Call path string length (%d) is longer than %d",
-strlen(call_path),MAX_CALL_PATH_LEN); }else{
-                  strcpy(coll_mpi_info_log[coll_mpi_info_log_pointer].call_path,
-call_path); MPI_Comm_dup(comm,
-&coll_mpi_info_log[coll_mpi_info_log_pointer].comm);
-                  coll_mpi_info_log[coll_mpi_info_log_pointer].count = 1;
-                  coll_mpi_info_log[coll_mpi_info_log_pointer].exe_time =
-exe_time; trace_log[trace_log_pointer ++ ] = coll_mpi_info_log_pointer * 2;
-                  coll_mpi_info_log_pointer++;
-          }
+// World rank of a rank of a communicator, ranks out of it such as
+// MPI_ANY_SOURCE are kept
+static inline int worldRank(int comm_id, int rank) {
+  CMI *comm_info = &comm_info_table[comm_id];
+  if (rank < 0 || rank >= comm_info->size) {
+    return rank;
   }
+  return comm_info->world_ranks[rank];
+}
+
+static inline int commSize(MPI_Comm comm) {
+  return comm_info_table[commId(comm)].size;
+}
+
+static inline TSC *typeSizeCacheEntry(MPI_Datatype type) {
+  unsigned long long handle = 0;
+  memcpy(&handle, &type,
+         sizeof(type) < sizeof(handle) ? sizeof(type) : sizeof(handle));
+  return &type_size_cache[hashCombine(0, handle) >>
+                          (64 - TYPE_SIZE_CACHE_BITS)];
+}
 
-if(coll_mpi_info_log_pointer >= LOG_SIZE-5){
-          writeCollMpiInfoLog();
+// Size of a datatype, cached until MPI_Type_free of the datatype
+static int typeSize(MPI_Datatype type) {
+  TSC *entry = typeSizeCacheEntry(type);
+  if (!entry->valid || entry->type != type) {
+    int size = 0;
+    PMPI_Type_size(type, &size);
+    entry->type = type;
+    entry->size = size;
+    entry->valid = true;
   }
-  if(trace_log_pointer >= MAX_TRACE_SIZE - 5){
-          writeTraceLog();
+  return entry->size;
+}
+
+static inline int commRank(MPI_Comm comm) {
+  int rank = 0;
+  PMPI_Comm_rank(comm, &rank);
+  return rank;
+}
+
+static inline unsigned long long dataBytes(unsigned long long count,
+                                           MPI_Datatype type) {
+  return count * typeSize(type);
+}
+
+// Bytes a rank sends in a collective, or receives if it sends in place
+static inline unsigned long long sendBytes(const void *sendbuf,
+                                           unsigned long long sendcount,
+                                           MPI_Datatype sendtype,
+                                           unsigned long long recvcount,
+                                           MPI_Datatype recvtype) {
+  if (sendbuf == MPI_IN_PLACE) {
+    return dataBytes(recvcount, recvtype);
   }
-  **/
+  return dataBytes(sendcount, sendtype);
 }
 
-#ifdef ENABLE_SUBCOMMUNICATOR
-void TRANSLATE_RANK(MPI_Comm comm, int rank, int *crank) {
-  MPI_Group group1, group2;
-  PMPI_Comm_group(comm, &group1);
-  PMPI_Comm_group(MPI_COMM_WORLD, &group2);
-  PMPI_Group_translate_ranks(group1, 1, &rank, group2, crank);
+static inline unsigned long long sumCounts(const int *counts, int n) {
+  unsigned long long sum = 0;
+  for (int i = 0; i < n; i++) {
+    sum += counts[i];
+  }
+  return sum;
 }
-#else
-void TRANSLATE_RANK(MPI_Comm comm, int rank, int *crank) { *crank = rank; }
-#endif
 
-void TRACE_P2P(char type, int request_count, int *source, int *dest, int *tag,
-               double exe_time) {
+// Call path of an MPI call in the program, return its length
+static int tracedCallPath(unw_word_t *call_path,
+                          unsigned long long *call_path_hash) {
 #ifdef MY_BT
   unw_word_t buffer[MAX_STACK_DEPTH] = {0};
 #else
   void *buffer[MAX_STACK_DEPTH];
   memset(buffer, 0, sizeof(buffer));
 #endif
-  unsigned int i, j, depth = 0;
+  unsigned int i, depth = 0;
 #ifdef MY_BT
   depth = my_backtrace(buffer, MAX_STACK_DEPTH);
 #else
   depth = unw_backtrace(buffer, MAX_STACK_DEPTH);
 #endif
-  char call_path[MAX_CALL_PATH_LEN] = {0};
-  int offset = 0;
-
+  int call_path_len = 0;
+  *call_path_hash = 0;
   for (i = 0; i < depth; ++i) {
     if ((void *)buffer[i] != NULL && (char *)buffer[i] < addr_threshold) {
-      offset += snprintf(call_path + offset, MAX_CALL_PATH_LEN - offset - 4,
-                         "%lx ", (void *)(buffer[i] - 2));
+      call_path[call_path_len++] = (unw_word_t)buffer[i] - 2;
+      *call_path_hash =
+          hashCombine(*call_path_hash, (unw_word_t)buffer[i] - 2);
+    }
+  }
+  return call_path_len;
+}
+
+// Record mpi info to log
+
+void TRACE_COLL(char type, int op, MPI_Comm comm, int root,
+                unsigned long long bytes, double exe_time) {
+  unsigned long long trace_start = baguatool::core::GetSelfStatTime();
+  unw_word_t call_path_pcs[MAX_STACK_DEPTH];
+  unsigned long long call_path_hash = 0;
+  int call_path_len = tracedCallPath(call_path_pcs, &call_path_hash);
+  unsigned int i;
+
+  int comm_id = commId(comm);
+  int world_root = root >= 0 ? worldRank(comm_id, root) : -1;
+  unsigned long long key =
+      hashCombine(hashCombine(call_path_hash, type), op);
+  key = hashCombine(hashCombine(key, comm_id), (unsigned int)world_root);
+  unsigned long long slot = key >> (64 - COLL_TABLE_BITS);
+  while (coll_mpi_info_table[slot] != 0) {
+    i = coll_mpi_info_table[slot] - 1;
+    CIS *info = &coll_mpi_info_log[i];
+    if (info->key == key && info->type == type && info->op == op &&
+        info->comm_id == comm_id && info->root == world_root &&
+        info->call_path_hash == call_path_hash &&
+        info->call_path_len == call_path_len &&
+        memcmp(info->call_path, call_path_pcs,
+               call_path_len * sizeof(unw_word_t)) == 0) {
+      info->count++;
+      info->bytes += bytes;
+      info->exe_time += exe_time;
+      trace_log[trace_log_pointer++] = i * 2;
+      break;
     }
+    slot = (slot + 1) & (COLL_TABLE_SIZE - 1);
   }
 
-  bool hasRecordFlag = false;
+  if (coll_mpi_info_table[slot] == 0) {
+    CIS *info = &coll_mpi_info_log[coll_mpi_info_log_pointer];
+    info->type = type;
+    info->op = op;
+    info->key = key;
+    info->call_path_hash = call_path_hash;
+    memcpy(info->call_path, call_path_pcs, call_path_len * sizeof(unw_word_t));
+    info->call_path_len = call_path_len;
+    info->comm_id = comm_id;
+    info->comm_size = comm_info_table[comm_id].size;
+    info->world_ranks = comm_info_table[comm_id].world_ranks;
+    info->root = world_root;
+    info->count = 1;
+    info->bytes = bytes;
+    info->exe_time = exe_time;
+    trace_log[trace_log_pointer++] = coll_mpi_info_log_pointer * 2;
+    coll_mpi_info_table[slot] = coll_mpi_info_log_pointer + 1;
+    coll_mpi_info_log_pointer++;
+  }
 
-  for (i = 0; i < p2p_mpi_info_log_pointer; i++) {
-    if (p2p_mpi_info_log[i].type == type &&
-        strcmp(call_path, p2p_mpi_info_log[i].call_path) == 0) {
-      if (p2p_mpi_info_log[i].request_count == request_count) {
-        for (j = 0; j < request_count; j++) {
-          if (p2p_mpi_info_log[i].source[j] != source[j] ||
-              p2p_mpi_info_log[i].dest[j] != dest[j] ||
-              p2p_mpi_info_log[i].tag[j] != tag[j]) {
-            goto k1;
-          }
-        }
-        p2p_mpi_info_log[i].count++;
-        p2p_mpi_info_log[i].exe_time += exe_time;
-        hasRecordFlag = true;
-        trace_log[trace_log_pointer++] = i * 2 + 1;
-        break;
-      k1:
-        continue;
-      }
+  // Memory of the logs filled so far
+  baguatool::core::AddSelfStat(baguatool::core::STAT_PEAK_MEM,
+                               coll_mpi_info_log_pointer * sizeof(CIS) +
+                                   p2p_mpi_info_log_pointer * sizeof(PIS) +
+                                   trace_log_pointer * sizeof(unsigned int));
+
+  if (coll_mpi_info_log_pointer >= LOG_SIZE - 5) {
+    flushCollMpiInfoLog();
+  }
+  if (trace_log_pointer >= MAX_TRACE_SIZE - 5) {
+    flushTraceLog();
+  }
+
+  // Cost of tracing, including hand-offs of full logs
+  unsigned long long trace_time =
+      baguatool::core::GetSelfStatTime() - trace_start;
+  baguatool::core::AddSelfStat(baguatool::core::STAT_TRACED_CALLS, 1);
+  baguatool::core::AddSelfStat(baguatool::core::STAT_TRACE_TIME, trace_time);
+}
+
+#ifdef ENABLE_SUBCOMMUNICATOR
+void TRANSLATE_RANK(MPI_Comm comm, int rank, int *crank) {
+  *crank = worldRank(commId(comm), rank);
+}
+#else
+void TRANSLATE_RANK(MPI_Comm comm, int rank, int *crank) { *crank = rank; }
+#endif
+
+void TRACE_P2P(char type, int request_count, int *source, int *dest, int *tag,
+               unsigned long long bytes, double exe_time) {
+  unsigned long long trace_start = baguatool::core::GetSelfStatTime();
+  unw_word_t call_path_pcs[MAX_STACK_DEPTH];
+  unsigned long long call_path_hash = 0;
+  int call_path_len = tracedCallPath(call_path_pcs, &call_path_hash);
+  unsigned int i, j;
+
+  // Records are found by a hash of the type, the call path and the peers and
+  // tags, only records of the same hash compare their call paths
+  unsigned long long key =
+      hashCombine(hashCombine(call_path_hash, type), request_count);
+  for (j = 0; j < request_count; j++) {
+    key = hashCombine(key, ((unsigned long long)(unsigned int)source[j] << 32) |
+                               (unsigned int)dest[j]);
+    key = hashCombine(key, (unsigned int)tag[j]);
+  }
+  unsigned long long slot = key >> (64 - P2P_TABLE_BITS);
+  while (p2p_mpi_info_table[slot] != 0) {
+    i = p2p_mpi_info_table[slot] - 1;
+    PIS *info = &p2p_mpi_info_log[i];
+    if (info->key == key && info->type == type &&
+        info->call_path_hash == call_path_hash &&
+        info->call_path_len == call_path_len &&
+        memcmp(info->call_path, call_path_pcs,
+               call_path_len * sizeof(unw_word_t)) == 0 &&
+        sameRequests(info, request_count, source, dest, tag)) {
+      info->count++;
+      info->bytes += bytes;
+      info->exe_time += exe_time;
+      trace_log[trace_log_pointer++] = i * 2 + 1;
+      break;
     }
+    slot = (slot + 1) & (P2P_TABLE_SIZE - 1);
   }
 
-  if (hasRecordFlag == false) {
-    if (strlen(call_path) >= MAX_CALL_PATH_LEN) {
-      // LOG_WARN("Call path string length (%d) is longer than %d",
-      // strlen(call_path),MAX_CALL_PATH_LEN);
-    } else {
-      p2p_mpi_info_log[p2p_mpi_info_log_pointer].type = type;
-      strcpy(p2p_mpi_info_log[p2p_mpi_info_log_pointer].call_path, call_path);
-      p2p_mpi_info_log[p2p_mpi_info_log_pointer].request_count = request_count;
-      for (i = 0; i < request_count; i++) {
-        p2p_mpi_info_log[p2p_mpi_info_log_pointer].source[i] = source[i];
-        p2p_mpi_info_log[p2p_mpi_info_log_pointer].dest[i] = dest[i];
-        p2p_mpi_info_log[p2p_mpi_info_log_pointer].tag[i] = tag[i];
-      }
-      p2p_mpi_info_log[p2p_mpi_info_log_pointer].count = 1;
-      p2p_mpi_info_log[p2p_mpi_info_log_pointer].exe_time = exe_time;
-      trace_log[trace_log_pointer++] = p2p_mpi_info_log_pointer * 2 + 1;
-      p2p_mpi_info_log_pointer++;
+  if (p2p_mpi_info_table[slot] == 0) {
+    PIS *info = &p2p_mpi_info_log[p2p_mpi_info_log_pointer];
+    info->type = type;
+    info->key = key;
+    info->call_path_hash = call_path_hash;
+    memcpy(info->call_path, call_path_pcs, call_path_len * sizeof(unw_word_t));
+    info->call_path_len = call_path_len;
+    info->request_count = request_count;
+    for (i = 0; i < request_count; i++) {
+      info->source[i] = source[i];
+      info->dest[i] = dest[i];
+      info->tag[i] = tag[i];
     }
+    info->count = 1;
+    info->bytes = bytes;
+    info->exe_time = exe_time;
+    trace_log[trace_log_pointer++] = p2p_mpi_info_log_pointer * 2 + 1;
+    p2p_mpi_info_table[slot] = p2p_mpi_info_log_pointer + 1;
+    p2p_mpi_info_log_pointer++;
   }
 
+  // Memory of the logs filled so far
+  baguatool::core::AddSelfStat(baguatool::core::STAT_PEAK_MEM,
+                               coll_mpi_info_log_pointer * sizeof(CIS) +
+                                   p2p_mpi_info_log_pointer * sizeof(PIS) +
+                                   trace_log_pointer * sizeof(unsigned int));
+
   if (p2p_mpi_info_log_pointer >= LOG_SIZE - 5) {
-    writeP2PMpiInfoLog();
+    flushP2PMpiInfoLog();
   }
   if (trace_log_pointer >= MAX_TRACE_SIZE - 5) {
-    writeTraceLog();
+    flushTraceLog();
   }
+
+  // Cost of tracing, including hand-offs of full logs
+  unsigned long long trace_time =
+      baguatool::core::GetSelfStatTime() - trace_start;
+  baguatool::core::AddSelfStat(baguatool::core::STAT_TRACED_CALLS, 1);
+  baguatool::core::AddSelfStat(baguatool::core::STAT_TRACE_TIME, trace_time);
 }
 
 // MPI_Init does all the communicator setup
@@ -458,6 +966,7 @@ _EXTERN_C_ int MPI_Init(int *argc, char ***argv) {
     }
 
     PMPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+    startTraceWriter();
   }
   return _wrap_py_return_val;
 }
@@ -503,6 +1012,7 @@ _EXTERN_C_ int MPI_Init_thread(int *argc, char ***argv, int required,
     // First call PMPI_Init()
     _wrap_py_return_val = PMPI_Init_thread(argc, argv, required, provided);
     PMPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+    startTraceWriter();
   }
   return _wrap_py_return_val;
 }
@@ -575,7 +1085,8 @@ _EXTERN_C_ int MPI_Send(const void *buf, int count, MPI_Datatype datatype,
 #ifdef DEBUG
     printf("%s\n", "MPI_Send");
 #endif
-    TRACE_P2P('s', 1, source_list, dest_list, tag_list, time);
+    TRACE_P2P('s', 1, source_list, dest_list, tag_list,
+              dataBytes(count, datatype), time);
   }
   return _wrap_py_return_val;
 }
@@ -660,7 +1171,8 @@ _EXTERN_C_ int MPI_Isend(const void *buf, int count, MPI_Datatype datatype,
 #ifdef DEBUG
     printf("%s\n", "MPI_Isend");
 #endif
-    TRACE_P2P('S', 1, source_list, dest_list, tag_list, time);
+    TRACE_P2P('S', 1, source_list, dest_list, tag_list,
+              dataBytes(count, datatype), time);
   }
   return _wrap_py_return_val;
 }
@@ -749,7 +1261,8 @@ _EXTERN_C_ int MPI_Recv(void *buf, int count, MPI_Datatype datatype, int source,
 #ifdef DEBUG
     printf("%s\n", "MPI_Recv");
 #endif
-    TRACE_P2P('r', 1, source_list, dest_list, tag_list, time);
+    TRACE_P2P('r', 1, source_list, dest_list, tag_list,
+              dataBytes(count, datatype), time);
   }
   return _wrap_py_return_val;
 }
@@ -852,7 +1365,8 @@ _EXTERN_C_ int MPI_Irecv(void *buf, int count, MPI_Datatype datatype,
 #ifdef DEBUG
     printf("%s\n", "MPI_Irecv");
 #endif
-    TRACE_P2P('R', 1, source_list, dest_list, tag_list, time);
+    TRACE_P2P('R', 1, source_list, dest_list, tag_list,
+              dataBytes(count, datatype), time);
   }
   return _wrap_py_return_val;
 }
@@ -955,8 +1469,10 @@ _EXTERN_C_ int MPI_Sendrecv(const void *sendbuf, int sendcount,
 #ifdef DEBUG
     printf("%s\n", "MPI_Sendrecv");
 #endif
-    TRACE_P2P('s', 1, myrank_list, dest_list, send_tag_list, time);
-    TRACE_P2P('r', 1, source_list, myrank_list, recv_tag_list, time);
+    TRACE_P2P('s', 1, myrank_list, dest_list, send_tag_list,
+              dataBytes(sendcount, sendtype), time);
+    TRACE_P2P('r', 1, source_list, myrank_list, recv_tag_list,
+              dataBytes(recvcount, recvtype), time);
   }
   return _wrap_py_return_val;
 }
@@ -1067,6 +1583,8 @@ _EXTERN_C_ int MPI_Recv_init(void *buf, int count, MPI_Datatype datatype,
 #endif
     recv_init_request_converter[RequestConverter(request)] =
         pair<int, int>(source, tag);
+    recv_init_request_bytes[RequestConverter(request)] =
+        dataBytes(count, datatype);
   }
   return _wrap_py_return_val;
 }
@@ -1168,7 +1686,7 @@ _EXTERN_C_ int MPI_Wait(MPI_Request *request, MPI_Status *status) {
 #ifdef DEBUG
     printf("%s\n", "MPI_Wait");
 #endif
-    TRACE_P2P('w', 1, source_list, dest_list, tag_list, time);
+    TRACE_P2P('w', 1, source_list, dest_list, tag_list, 0, time);
 
     return ret_val;
   }
@@ -1270,7 +1788,7 @@ _EXTERN_C_ int MPI_Waitall(int count, MPI_Request array_of_requests[],
       }
     }
 
-    TRACE_P2P('w', count, source_list, dest_list, tag_list, time);
+    TRACE_P2P('w', count, source_list, dest_list, tag_list, 0, time);
 
 #ifdef DEBUG
     printf("%s\n", "MPI_Waitall");
@@ -1354,6 +1872,7 @@ _EXTERN_C_ int MPI_Start(MPI_Request *request) {
 
     dest_list[0] = mpi_rank;
     bool valid_flag = false;
+    unsigned long long bytes = 0;
 
     map<RequestConverter, pair<int, int>>::iterator iter;
     iter = recv_init_request_converter.find(RequestConverter(request));
@@ -1366,6 +1885,7 @@ _EXTERN_C_ int MPI_Start(MPI_Request *request) {
       source_list[0] = src;
       tag_list[0] = tag;
       valid_flag = true;
+      bytes = recv_init_request_bytes[RequestConverter(request)];
       //}
       // recv_init_request_converter.erase(RequestConverter(request));
     }
@@ -1389,7 +1909,7 @@ _EXTERN_C_ int MPI_Start(MPI_Request *request) {
 #ifdef DEBUG
     printf("%s\n", "MPI_Start");
 #endif
-    TRACE_P2P('R', 1, source_list, dest_list, tag_list, time);
+    TRACE_P2P('R', 1, source_list, dest_list, tag_list, bytes, time);
 
     return ret_val;
   }
@@ -1430,20 +1950,2652 @@ _EXTERN_C_ void mpi_start__(MPI_Fint *request, MPI_Fint *ierr) {
 /* ================= End Wrappers for MPI_Start ================= */
 
 // collective communication
-// {{fn func MPI_Reduce MPI_Alltoall MPI_Allreduce MPI_Bcast MPI_Scatter
-// MPI_Gather MPI_Allgather}}{
-//    // First call collective communication
-//		auto st = chrono::system_clock::now();
-//    {{callfn}}
-//		auto ed = chrono::system_clock::now();
-//		double time = chrono::duration_cast<chrono::microseconds>(ed -
-// st).count();
-//
-//#ifdef DEBUG
-//		printf("%s\n", "{{func}}");
-//#endif
-//		TRACE_COLL(comm, time);
-// }{{endfn}}
+/* ================== C Wrappers for MPI_Barrier ================== */
+_EXTERN_C_ int PMPI_Barrier(MPI_Comm comm);
+_EXTERN_C_ int MPI_Barrier(MPI_Comm comm) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val = PMPI_Barrier(comm);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+#ifdef DEBUG
+    printf("%s\n", "MPI_Barrier");
+#endif
+    TRACE_COLL('c', COLL_OP_BARRIER, comm, -1, 0, time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Barrier =============== */
+static void MPI_Barrier_fortran_wrapper(MPI_Fint *comm, MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val = MPI_Barrier((MPI_Comm)(*comm));
+#else  /* MPI-2 safe call */
+  _wrap_py_return_val = MPI_Barrier(MPI_Comm_f2c(*comm));
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_BARRIER(MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Barrier_fortran_wrapper(comm, ierr);
+}
+
+_EXTERN_C_ void mpi_barrier(MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Barrier_fortran_wrapper(comm, ierr);
+}
+
+_EXTERN_C_ void mpi_barrier_(MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Barrier_fortran_wrapper(comm, ierr);
+}
+
+_EXTERN_C_ void mpi_barrier__(MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Barrier_fortran_wrapper(comm, ierr);
+}
+
+/* ================= End Wrappers for MPI_Barrier ================= */
+
+/* ================== C Wrappers for MPI_Ibarrier ================== */
+_EXTERN_C_ int PMPI_Ibarrier(MPI_Comm comm, MPI_Request *request);
+_EXTERN_C_ int MPI_Ibarrier(MPI_Comm comm, MPI_Request *request) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val = PMPI_Ibarrier(comm, request);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    // Waits of collective requests have no p2p peers
+    request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Ibarrier");
+#endif
+    TRACE_COLL('C', COLL_OP_BARRIER, comm, -1, 0, time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Ibarrier =============== */
+static void MPI_Ibarrier_fortran_wrapper(MPI_Fint *comm, MPI_Fint *request,
+                                         MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val = MPI_Ibarrier((MPI_Comm)(*comm), (MPI_Request *)request);
+#else  /* MPI-2 safe call */
+  MPI_Request temp_request;
+  temp_request = MPI_Request_f2c(*request);
+  _wrap_py_return_val = MPI_Ibarrier(MPI_Comm_f2c(*comm), &temp_request);
+  *request = MPI_Request_c2f(temp_request);
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_IBARRIER(MPI_Fint *comm, MPI_Fint *request,
+                             MPI_Fint *ierr) {
+  MPI_Ibarrier_fortran_wrapper(comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_ibarrier(MPI_Fint *comm, MPI_Fint *request,
+                             MPI_Fint *ierr) {
+  MPI_Ibarrier_fortran_wrapper(comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_ibarrier_(MPI_Fint *comm, MPI_Fint *request,
+                              MPI_Fint *ierr) {
+  MPI_Ibarrier_fortran_wrapper(comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_ibarrier__(MPI_Fint *comm, MPI_Fint *request,
+                               MPI_Fint *ierr) {
+  MPI_Ibarrier_fortran_wrapper(comm, request, ierr);
+}
+
+/* ================= End Wrappers for MPI_Ibarrier ================= */
+
+/* ================== C Wrappers for MPI_Bcast ================== */
+_EXTERN_C_ int PMPI_Bcast(void *buffer, int count, MPI_Datatype datatype,
+                          int root, MPI_Comm comm);
+_EXTERN_C_ int MPI_Bcast(void *buffer, int count, MPI_Datatype datatype,
+                         int root, MPI_Comm comm) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val = PMPI_Bcast(buffer, count, datatype, root, comm);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+#ifdef DEBUG
+    printf("%s\n", "MPI_Bcast");
+#endif
+    TRACE_COLL('c', COLL_OP_BCAST, comm, root, dataBytes(count, datatype),
+               time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Bcast =============== */
+static void MPI_Bcast_fortran_wrapper(MPI_Fint *buffer, MPI_Fint *count,
+                                      MPI_Fint *datatype, MPI_Fint *root,
+                                      MPI_Fint *comm, MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Bcast((void *)buffer, *count, (MPI_Datatype)(*datatype), *root,
+                (MPI_Comm)(*comm));
+#else  /* MPI-2 safe call */
+  _wrap_py_return_val =
+      MPI_Bcast((void *)buffer, *count, MPI_Type_f2c(*datatype), *root,
+                MPI_Comm_f2c(*comm));
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_BCAST(MPI_Fint *buffer, MPI_Fint *count, MPI_Fint *datatype,
+                          MPI_Fint *root, MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Bcast_fortran_wrapper(buffer, count, datatype, root, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_bcast(MPI_Fint *buffer, MPI_Fint *count, MPI_Fint *datatype,
+                          MPI_Fint *root, MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Bcast_fortran_wrapper(buffer, count, datatype, root, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_bcast_(MPI_Fint *buffer, MPI_Fint *count,
+                           MPI_Fint *datatype, MPI_Fint *root, MPI_Fint *comm,
+                           MPI_Fint *ierr) {
+  MPI_Bcast_fortran_wrapper(buffer, count, datatype, root, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_bcast__(MPI_Fint *buffer, MPI_Fint *count,
+                            MPI_Fint *datatype, MPI_Fint *root, MPI_Fint *comm,
+                            MPI_Fint *ierr) {
+  MPI_Bcast_fortran_wrapper(buffer, count, datatype, root, comm, ierr);
+}
+
+/* ================= End Wrappers for MPI_Bcast ================= */
+
+/* ================== C Wrappers for MPI_Ibcast ================== */
+_EXTERN_C_ int PMPI_Ibcast(void *buffer, int count, MPI_Datatype datatype,
+                           int root, MPI_Comm comm, MPI_Request *request);
+_EXTERN_C_ int MPI_Ibcast(void *buffer, int count, MPI_Datatype datatype,
+                          int root, MPI_Comm comm, MPI_Request *request) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Ibcast(buffer, count, datatype, root, comm, request);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    // Waits of collective requests have no p2p peers
+    request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Ibcast");
+#endif
+    TRACE_COLL('C', COLL_OP_BCAST, comm, root, dataBytes(count, datatype),
+               time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Ibcast =============== */
+static void MPI_Ibcast_fortran_wrapper(MPI_Fint *buffer, MPI_Fint *count,
+                                       MPI_Fint *datatype, MPI_Fint *root,
+                                       MPI_Fint *comm, MPI_Fint *request,
+                                       MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Ibcast((void *)buffer, *count, (MPI_Datatype)(*datatype), *root,
+                 (MPI_Comm)(*comm), (MPI_Request *)request);
+#else  /* MPI-2 safe call */
+  MPI_Request temp_request;
+  temp_request = MPI_Request_f2c(*request);
+  _wrap_py_return_val =
+      MPI_Ibcast((void *)buffer, *count, MPI_Type_f2c(*datatype), *root,
+                 MPI_Comm_f2c(*comm), &temp_request);
+  *request = MPI_Request_c2f(temp_request);
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_IBCAST(MPI_Fint *buffer, MPI_Fint *count,
+                           MPI_Fint *datatype, MPI_Fint *root, MPI_Fint *comm,
+                           MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Ibcast_fortran_wrapper(buffer, count, datatype, root, comm, request,
+                             ierr);
+}
+
+_EXTERN_C_ void mpi_ibcast(MPI_Fint *buffer, MPI_Fint *count,
+                           MPI_Fint *datatype, MPI_Fint *root, MPI_Fint *comm,
+                           MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Ibcast_fortran_wrapper(buffer, count, datatype, root, comm, request,
+                             ierr);
+}
+
+_EXTERN_C_ void mpi_ibcast_(MPI_Fint *buffer, MPI_Fint *count,
+                            MPI_Fint *datatype, MPI_Fint *root, MPI_Fint *comm,
+                            MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Ibcast_fortran_wrapper(buffer, count, datatype, root, comm, request,
+                             ierr);
+}
+
+_EXTERN_C_ void mpi_ibcast__(MPI_Fint *buffer, MPI_Fint *count,
+                             MPI_Fint *datatype, MPI_Fint *root, MPI_Fint *comm,
+                             MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Ibcast_fortran_wrapper(buffer, count, datatype, root, comm, request,
+                             ierr);
+}
+
+/* ================= End Wrappers for MPI_Ibcast ================= */
+
+/* ================== C Wrappers for MPI_Reduce ================== */
+_EXTERN_C_ int PMPI_Reduce(const void *sendbuf, void *recvbuf, int count,
+                           MPI_Datatype datatype, MPI_Op op, int root,
+                           MPI_Comm comm);
+_EXTERN_C_ int MPI_Reduce(const void *sendbuf, void *recvbuf, int count,
+                          MPI_Datatype datatype, MPI_Op op, int root,
+                          MPI_Comm comm) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Reduce(sendbuf, recvbuf, count, datatype, op, root, comm);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+#ifdef DEBUG
+    printf("%s\n", "MPI_Reduce");
+#endif
+    TRACE_COLL('c', COLL_OP_REDUCE, comm, root, dataBytes(count, datatype),
+               time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Reduce =============== */
+static void MPI_Reduce_fortran_wrapper(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                                       MPI_Fint *count, MPI_Fint *datatype,
+                                       MPI_Fint *op, MPI_Fint *root,
+                                       MPI_Fint *comm, MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Reduce((const void *)sendbuf, (void *)recvbuf, *count,
+                 (MPI_Datatype)(*datatype), (MPI_Op)(*op), *root,
+                 (MPI_Comm)(*comm));
+#else  /* MPI-2 safe call */
+  _wrap_py_return_val =
+      MPI_Reduce((const void *)sendbuf, (void *)recvbuf, *count,
+                 MPI_Type_f2c(*datatype), MPI_Op_f2c(*op), *root,
+                 MPI_Comm_f2c(*comm));
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_REDUCE(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                           MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                           MPI_Fint *root, MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Reduce_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, root, comm,
+                             ierr);
+}
+
+_EXTERN_C_ void mpi_reduce(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                           MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                           MPI_Fint *root, MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Reduce_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, root, comm,
+                             ierr);
+}
+
+_EXTERN_C_ void mpi_reduce_(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                            MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                            MPI_Fint *root, MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Reduce_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, root, comm,
+                             ierr);
+}
+
+_EXTERN_C_ void mpi_reduce__(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                             MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                             MPI_Fint *root, MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Reduce_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, root, comm,
+                             ierr);
+}
+
+/* ================= End Wrappers for MPI_Reduce ================= */
+
+/* ================== C Wrappers for MPI_Ireduce ================== */
+_EXTERN_C_ int PMPI_Ireduce(const void *sendbuf, void *recvbuf, int count,
+                            MPI_Datatype datatype, MPI_Op op, int root,
+                            MPI_Comm comm, MPI_Request *request);
+_EXTERN_C_ int MPI_Ireduce(const void *sendbuf, void *recvbuf, int count,
+                           MPI_Datatype datatype, MPI_Op op, int root,
+                           MPI_Comm comm, MPI_Request *request) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Ireduce(sendbuf, recvbuf, count, datatype, op, root, comm,
+                     request);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    // Waits of collective requests have no p2p peers
+    request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Ireduce");
+#endif
+    TRACE_COLL('C', COLL_OP_REDUCE, comm, root, dataBytes(count, datatype),
+               time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Ireduce =============== */
+static void MPI_Ireduce_fortran_wrapper(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                                        MPI_Fint *count, MPI_Fint *datatype,
+                                        MPI_Fint *op, MPI_Fint *root,
+                                        MPI_Fint *comm, MPI_Fint *request,
+                                        MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Ireduce((const void *)sendbuf, (void *)recvbuf, *count,
+                  (MPI_Datatype)(*datatype), (MPI_Op)(*op), *root,
+                  (MPI_Comm)(*comm), (MPI_Request *)request);
+#else  /* MPI-2 safe call */
+  MPI_Request temp_request;
+  temp_request = MPI_Request_f2c(*request);
+  _wrap_py_return_val =
+      MPI_Ireduce((const void *)sendbuf, (void *)recvbuf, *count,
+                  MPI_Type_f2c(*datatype), MPI_Op_f2c(*op), *root,
+                  MPI_Comm_f2c(*comm), &temp_request);
+  *request = MPI_Request_c2f(temp_request);
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_IREDUCE(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                            MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                            MPI_Fint *root, MPI_Fint *comm, MPI_Fint *request,
+                            MPI_Fint *ierr) {
+  MPI_Ireduce_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, root, comm,
+                              request, ierr);
+}
+
+_EXTERN_C_ void mpi_ireduce(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                            MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                            MPI_Fint *root, MPI_Fint *comm, MPI_Fint *request,
+                            MPI_Fint *ierr) {
+  MPI_Ireduce_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, root, comm,
+                              request, ierr);
+}
+
+_EXTERN_C_ void mpi_ireduce_(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                             MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                             MPI_Fint *root, MPI_Fint *comm, MPI_Fint *request,
+                             MPI_Fint *ierr) {
+  MPI_Ireduce_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, root, comm,
+                              request, ierr);
+}
+
+_EXTERN_C_ void mpi_ireduce__(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                              MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                              MPI_Fint *root, MPI_Fint *comm, MPI_Fint *request,
+                              MPI_Fint *ierr) {
+  MPI_Ireduce_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, root, comm,
+                              request, ierr);
+}
+
+/* ================= End Wrappers for MPI_Ireduce ================= */
+
+/* ================== C Wrappers for MPI_Allreduce ================== */
+_EXTERN_C_ int PMPI_Allreduce(const void *sendbuf, void *recvbuf, int count,
+                              MPI_Datatype datatype, MPI_Op op, MPI_Comm comm);
+_EXTERN_C_ int MPI_Allreduce(const void *sendbuf, void *recvbuf, int count,
+                             MPI_Datatype datatype, MPI_Op op, MPI_Comm comm) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Allreduce(sendbuf, recvbuf, count, datatype, op, comm);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+#ifdef DEBUG
+    printf("%s\n", "MPI_Allreduce");
+#endif
+    TRACE_COLL('c', COLL_OP_ALLREDUCE, comm, -1, dataBytes(count, datatype),
+               time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Allreduce =============== */
+static void MPI_Allreduce_fortran_wrapper(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                                          MPI_Fint *count, MPI_Fint *datatype,
+                                          MPI_Fint *op, MPI_Fint *comm,
+                                          MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Allreduce((const void *)sendbuf, (void *)recvbuf, *count,
+                    (MPI_Datatype)(*datatype), (MPI_Op)(*op),
+                    (MPI_Comm)(*comm));
+#else  /* MPI-2 safe call */
+  _wrap_py_return_val =
+      MPI_Allreduce((const void *)sendbuf, (void *)recvbuf, *count,
+                    MPI_Type_f2c(*datatype), MPI_Op_f2c(*op),
+                    MPI_Comm_f2c(*comm));
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_ALLREDUCE(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                              MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                              MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Allreduce_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm,
+                                ierr);
+}
+
+_EXTERN_C_ void mpi_allreduce(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                              MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                              MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Allreduce_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm,
+                                ierr);
+}
+
+_EXTERN_C_ void mpi_allreduce_(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                               MPI_Fint *count, MPI_Fint *datatype,
+                               MPI_Fint *op, MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Allreduce_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm,
+                                ierr);
+}
+
+_EXTERN_C_ void mpi_allreduce__(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                                MPI_Fint *count, MPI_Fint *datatype,
+                                MPI_Fint *op, MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Allreduce_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm,
+                                ierr);
+}
+
+/* ================= End Wrappers for MPI_Allreduce ================= */
+
+/* ================== C Wrappers for MPI_Iallreduce ================== */
+_EXTERN_C_ int PMPI_Iallreduce(const void *sendbuf, void *recvbuf, int count,
+                               MPI_Datatype datatype, MPI_Op op, MPI_Comm comm,
+                               MPI_Request *request);
+_EXTERN_C_ int MPI_Iallreduce(const void *sendbuf, void *recvbuf, int count,
+                              MPI_Datatype datatype, MPI_Op op, MPI_Comm comm,
+                              MPI_Request *request) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Iallreduce(sendbuf, recvbuf, count, datatype, op, comm, request);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    // Waits of collective requests have no p2p peers
+    request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Iallreduce");
+#endif
+    TRACE_COLL('C', COLL_OP_ALLREDUCE, comm, -1, dataBytes(count, datatype),
+               time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Iallreduce =============== */
+static void MPI_Iallreduce_fortran_wrapper(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                                           MPI_Fint *count, MPI_Fint *datatype,
+                                           MPI_Fint *op, MPI_Fint *comm,
+                                           MPI_Fint *request, MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Iallreduce((const void *)sendbuf, (void *)recvbuf, *count,
+                     (MPI_Datatype)(*datatype), (MPI_Op)(*op),
+                     (MPI_Comm)(*comm), (MPI_Request *)request);
+#else  /* MPI-2 safe call */
+  MPI_Request temp_request;
+  temp_request = MPI_Request_f2c(*request);
+  _wrap_py_return_val =
+      MPI_Iallreduce((const void *)sendbuf, (void *)recvbuf, *count,
+                     MPI_Type_f2c(*datatype), MPI_Op_f2c(*op),
+                     MPI_Comm_f2c(*comm), &temp_request);
+  *request = MPI_Request_c2f(temp_request);
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_IALLREDUCE(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                               MPI_Fint *count, MPI_Fint *datatype,
+                               MPI_Fint *op, MPI_Fint *comm, MPI_Fint *request,
+                               MPI_Fint *ierr) {
+  MPI_Iallreduce_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm,
+                                 request, ierr);
+}
+
+_EXTERN_C_ void mpi_iallreduce(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                               MPI_Fint *count, MPI_Fint *datatype,
+                               MPI_Fint *op, MPI_Fint *comm, MPI_Fint *request,
+                               MPI_Fint *ierr) {
+  MPI_Iallreduce_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm,
+                                 request, ierr);
+}
+
+_EXTERN_C_ void mpi_iallreduce_(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                                MPI_Fint *count, MPI_Fint *datatype,
+                                MPI_Fint *op, MPI_Fint *comm, MPI_Fint *request,
+                                MPI_Fint *ierr) {
+  MPI_Iallreduce_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm,
+                                 request, ierr);
+}
+
+_EXTERN_C_ void mpi_iallreduce__(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                                 MPI_Fint *count, MPI_Fint *datatype,
+                                 MPI_Fint *op, MPI_Fint *comm,
+                                 MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Iallreduce_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm,
+                                 request, ierr);
+}
+
+/* ================= End Wrappers for MPI_Iallreduce ================= */
+
+/* ================== C Wrappers for MPI_Scatter ================== */
+_EXTERN_C_ int PMPI_Scatter(const void *sendbuf, int sendcount,
+                            MPI_Datatype sendtype, void *recvbuf, int recvcount,
+                            MPI_Datatype recvtype, int root, MPI_Comm comm);
+_EXTERN_C_ int MPI_Scatter(const void *sendbuf, int sendcount,
+                           MPI_Datatype sendtype, void *recvbuf, int recvcount,
+                           MPI_Datatype recvtype, int root, MPI_Comm comm) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Scatter(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype,
+                     root, comm);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    unsigned long long bytes = 0;
+    if (commRank(comm) == root) {
+      bytes = dataBytes(sendcount, sendtype) * commSize(comm);
+    } else {
+      bytes = dataBytes(recvcount, recvtype);
+    }
+#ifdef DEBUG
+    printf("%s\n", "MPI_Scatter");
+#endif
+    TRACE_COLL('c', COLL_OP_SCATTER, comm, root, bytes, time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Scatter =============== */
+static void MPI_Scatter_fortran_wrapper(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                                        MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                                        MPI_Fint *recvcount, MPI_Fint *recvtype,
+                                        MPI_Fint *root, MPI_Fint *comm,
+                                        MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Scatter((const void *)sendbuf, *sendcount, (MPI_Datatype)(*sendtype),
+                  (void *)recvbuf, *recvcount, (MPI_Datatype)(*recvtype), *root,
+                  (MPI_Comm)(*comm));
+#else  /* MPI-2 safe call */
+  _wrap_py_return_val =
+      MPI_Scatter((const void *)sendbuf, *sendcount, MPI_Type_f2c(*sendtype),
+                  (void *)recvbuf, *recvcount, MPI_Type_f2c(*recvtype), *root,
+                  MPI_Comm_f2c(*comm));
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_SCATTER(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                            MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                            MPI_Fint *recvcount, MPI_Fint *recvtype,
+                            MPI_Fint *root, MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Scatter_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                              recvtype, root, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_scatter(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                            MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                            MPI_Fint *recvcount, MPI_Fint *recvtype,
+                            MPI_Fint *root, MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Scatter_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                              recvtype, root, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_scatter_(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                             MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                             MPI_Fint *recvcount, MPI_Fint *recvtype,
+                             MPI_Fint *root, MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Scatter_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                              recvtype, root, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_scatter__(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                              MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                              MPI_Fint *recvcount, MPI_Fint *recvtype,
+                              MPI_Fint *root, MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Scatter_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                              recvtype, root, comm, ierr);
+}
+
+/* ================= End Wrappers for MPI_Scatter ================= */
+
+/* ================== C Wrappers for MPI_Iscatter ================== */
+_EXTERN_C_ int PMPI_Iscatter(const void *sendbuf, int sendcount,
+                             MPI_Datatype sendtype, void *recvbuf,
+                             int recvcount, MPI_Datatype recvtype, int root,
+                             MPI_Comm comm, MPI_Request *request);
+_EXTERN_C_ int MPI_Iscatter(const void *sendbuf, int sendcount,
+                            MPI_Datatype sendtype, void *recvbuf, int recvcount,
+                            MPI_Datatype recvtype, int root, MPI_Comm comm,
+                            MPI_Request *request) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Iscatter(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                      recvtype, root, comm, request);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    unsigned long long bytes = 0;
+    if (commRank(comm) == root) {
+      bytes = dataBytes(sendcount, sendtype) * commSize(comm);
+    } else {
+      bytes = dataBytes(recvcount, recvtype);
+    }
+    // Waits of collective requests have no p2p peers
+    request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Iscatter");
+#endif
+    TRACE_COLL('C', COLL_OP_SCATTER, comm, root, bytes, time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Iscatter =============== */
+static void MPI_Iscatter_fortran_wrapper(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                                         MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                                         MPI_Fint *recvcount,
+                                         MPI_Fint *recvtype, MPI_Fint *root,
+                                         MPI_Fint *comm, MPI_Fint *request,
+                                         MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Iscatter((const void *)sendbuf, *sendcount, (MPI_Datatype)(*sendtype),
+                   (void *)recvbuf, *recvcount, (MPI_Datatype)(*recvtype),
+                   *root, (MPI_Comm)(*comm), (MPI_Request *)request);
+#else  /* MPI-2 safe call */
+  MPI_Request temp_request;
+  temp_request = MPI_Request_f2c(*request);
+  _wrap_py_return_val =
+      MPI_Iscatter((const void *)sendbuf, *sendcount, MPI_Type_f2c(*sendtype),
+                   (void *)recvbuf, *recvcount, MPI_Type_f2c(*recvtype), *root,
+                   MPI_Comm_f2c(*comm), &temp_request);
+  *request = MPI_Request_c2f(temp_request);
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_ISCATTER(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                             MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                             MPI_Fint *recvcount, MPI_Fint *recvtype,
+                             MPI_Fint *root, MPI_Fint *comm, MPI_Fint *request,
+                             MPI_Fint *ierr) {
+  MPI_Iscatter_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                               recvtype, root, comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_iscatter(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                             MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                             MPI_Fint *recvcount, MPI_Fint *recvtype,
+                             MPI_Fint *root, MPI_Fint *comm, MPI_Fint *request,
+                             MPI_Fint *ierr) {
+  MPI_Iscatter_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                               recvtype, root, comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_iscatter_(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                              MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                              MPI_Fint *recvcount, MPI_Fint *recvtype,
+                              MPI_Fint *root, MPI_Fint *comm, MPI_Fint *request,
+                              MPI_Fint *ierr) {
+  MPI_Iscatter_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                               recvtype, root, comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_iscatter__(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                               MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                               MPI_Fint *recvcount, MPI_Fint *recvtype,
+                               MPI_Fint *root, MPI_Fint *comm,
+                               MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Iscatter_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                               recvtype, root, comm, request, ierr);
+}
+
+/* ================= End Wrappers for MPI_Iscatter ================= */
+
+/* ================== C Wrappers for MPI_Scatterv ================== */
+_EXTERN_C_ int PMPI_Scatterv(const void *sendbuf, const int sendcounts[],
+                             const int displs[], MPI_Datatype sendtype,
+                             void *recvbuf, int recvcount,
+                             MPI_Datatype recvtype, int root, MPI_Comm comm);
+_EXTERN_C_ int MPI_Scatterv(const void *sendbuf, const int sendcounts[],
+                            const int displs[], MPI_Datatype sendtype,
+                            void *recvbuf, int recvcount, MPI_Datatype recvtype,
+                            int root, MPI_Comm comm) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Scatterv(sendbuf, sendcounts, displs, sendtype, recvbuf, recvcount,
+                      recvtype, root, comm);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    unsigned long long bytes = 0;
+    if (commRank(comm) == root) {
+      bytes = dataBytes(sumCounts(sendcounts, commSize(comm)), sendtype);
+    } else {
+      bytes = dataBytes(recvcount, recvtype);
+    }
+#ifdef DEBUG
+    printf("%s\n", "MPI_Scatterv");
+#endif
+    TRACE_COLL('c', COLL_OP_SCATTERV, comm, root, bytes, time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Scatterv =============== */
+static void MPI_Scatterv_fortran_wrapper(MPI_Fint *sendbuf,
+                                         MPI_Fint sendcounts[],
+                                         MPI_Fint displs[], MPI_Fint *sendtype,
+                                         MPI_Fint *recvbuf, MPI_Fint *recvcount,
+                                         MPI_Fint *recvtype, MPI_Fint *root,
+                                         MPI_Fint *comm, MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Scatterv((const void *)sendbuf, (const int *)sendcounts,
+                   (const int *)displs, (MPI_Datatype)(*sendtype),
+                   (void *)recvbuf, *recvcount, (MPI_Datatype)(*recvtype),
+                   *root, (MPI_Comm)(*comm));
+#else  /* MPI-2 safe call */
+  _wrap_py_return_val =
+      MPI_Scatterv((const void *)sendbuf, (const int *)sendcounts,
+                   (const int *)displs, MPI_Type_f2c(*sendtype),
+                   (void *)recvbuf, *recvcount, MPI_Type_f2c(*recvtype), *root,
+                   MPI_Comm_f2c(*comm));
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_SCATTERV(MPI_Fint *sendbuf, MPI_Fint sendcounts[],
+                             MPI_Fint displs[], MPI_Fint *sendtype,
+                             MPI_Fint *recvbuf, MPI_Fint *recvcount,
+                             MPI_Fint *recvtype, MPI_Fint *root, MPI_Fint *comm,
+                             MPI_Fint *ierr) {
+  MPI_Scatterv_fortran_wrapper(sendbuf, sendcounts, displs, sendtype, recvbuf,
+                               recvcount, recvtype, root, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_scatterv(MPI_Fint *sendbuf, MPI_Fint sendcounts[],
+                             MPI_Fint displs[], MPI_Fint *sendtype,
+                             MPI_Fint *recvbuf, MPI_Fint *recvcount,
+                             MPI_Fint *recvtype, MPI_Fint *root, MPI_Fint *comm,
+                             MPI_Fint *ierr) {
+  MPI_Scatterv_fortran_wrapper(sendbuf, sendcounts, displs, sendtype, recvbuf,
+                               recvcount, recvtype, root, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_scatterv_(MPI_Fint *sendbuf, MPI_Fint sendcounts[],
+                              MPI_Fint displs[], MPI_Fint *sendtype,
+                              MPI_Fint *recvbuf, MPI_Fint *recvcount,
+                              MPI_Fint *recvtype, MPI_Fint *root,
+                              MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Scatterv_fortran_wrapper(sendbuf, sendcounts, displs, sendtype, recvbuf,
+                               recvcount, recvtype, root, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_scatterv__(MPI_Fint *sendbuf, MPI_Fint sendcounts[],
+                               MPI_Fint displs[], MPI_Fint *sendtype,
+                               MPI_Fint *recvbuf, MPI_Fint *recvcount,
+                               MPI_Fint *recvtype, MPI_Fint *root,
+                               MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Scatterv_fortran_wrapper(sendbuf, sendcounts, displs, sendtype, recvbuf,
+                               recvcount, recvtype, root, comm, ierr);
+}
+
+/* ================= End Wrappers for MPI_Scatterv ================= */
+
+/* ================== C Wrappers for MPI_Iscatterv ================== */
+_EXTERN_C_ int PMPI_Iscatterv(const void *sendbuf, const int sendcounts[],
+                              const int displs[], MPI_Datatype sendtype,
+                              void *recvbuf, int recvcount,
+                              MPI_Datatype recvtype, int root, MPI_Comm comm,
+                              MPI_Request *request);
+_EXTERN_C_ int MPI_Iscatterv(const void *sendbuf, const int sendcounts[],
+                             const int displs[], MPI_Datatype sendtype,
+                             void *recvbuf, int recvcount,
+                             MPI_Datatype recvtype, int root, MPI_Comm comm,
+                             MPI_Request *request) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Iscatterv(sendbuf, sendcounts, displs, sendtype, recvbuf,
+                       recvcount, recvtype, root, comm, request);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    unsigned long long bytes = 0;
+    if (commRank(comm) == root) {
+      bytes = dataBytes(sumCounts(sendcounts, commSize(comm)), sendtype);
+    } else {
+      bytes = dataBytes(recvcount, recvtype);
+    }
+    // Waits of collective requests have no p2p peers
+    request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Iscatterv");
+#endif
+    TRACE_COLL('C', COLL_OP_SCATTERV, comm, root, bytes, time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Iscatterv =============== */
+static void MPI_Iscatterv_fortran_wrapper(MPI_Fint *sendbuf,
+                                          MPI_Fint sendcounts[],
+                                          MPI_Fint displs[], MPI_Fint *sendtype,
+                                          MPI_Fint *recvbuf,
+                                          MPI_Fint *recvcount,
+                                          MPI_Fint *recvtype, MPI_Fint *root,
+                                          MPI_Fint *comm, MPI_Fint *request,
+                                          MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Iscatterv((const void *)sendbuf, (const int *)sendcounts,
+                    (const int *)displs, (MPI_Datatype)(*sendtype),
+                    (void *)recvbuf, *recvcount, (MPI_Datatype)(*recvtype),
+                    *root, (MPI_Comm)(*comm), (MPI_Request *)request);
+#else  /* MPI-2 safe call */
+  MPI_Request temp_request;
+  temp_request = MPI_Request_f2c(*request);
+  _wrap_py_return_val =
+      MPI_Iscatterv((const void *)sendbuf, (const int *)sendcounts,
+                    (const int *)displs, MPI_Type_f2c(*sendtype),
+                    (void *)recvbuf, *recvcount, MPI_Type_f2c(*recvtype), *root,
+                    MPI_Comm_f2c(*comm), &temp_request);
+  *request = MPI_Request_c2f(temp_request);
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_ISCATTERV(MPI_Fint *sendbuf, MPI_Fint sendcounts[],
+                              MPI_Fint displs[], MPI_Fint *sendtype,
+                              MPI_Fint *recvbuf, MPI_Fint *recvcount,
+                              MPI_Fint *recvtype, MPI_Fint *root,
+                              MPI_Fint *comm, MPI_Fint *request,
+                              MPI_Fint *ierr) {
+  MPI_Iscatterv_fortran_wrapper(sendbuf, sendcounts, displs, sendtype, recvbuf,
+                                recvcount, recvtype, root, comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_iscatterv(MPI_Fint *sendbuf, MPI_Fint sendcounts[],
+                              MPI_Fint displs[], MPI_Fint *sendtype,
+                              MPI_Fint *recvbuf, MPI_Fint *recvcount,
+                              MPI_Fint *recvtype, MPI_Fint *root,
+                              MPI_Fint *comm, MPI_Fint *request,
+                              MPI_Fint *ierr) {
+  MPI_Iscatterv_fortran_wrapper(sendbuf, sendcounts, displs, sendtype, recvbuf,
+                                recvcount, recvtype, root, comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_iscatterv_(MPI_Fint *sendbuf, MPI_Fint sendcounts[],
+                               MPI_Fint displs[], MPI_Fint *sendtype,
+                               MPI_Fint *recvbuf, MPI_Fint *recvcount,
+                               MPI_Fint *recvtype, MPI_Fint *root,
+                               MPI_Fint *comm, MPI_Fint *request,
+                               MPI_Fint *ierr) {
+  MPI_Iscatterv_fortran_wrapper(sendbuf, sendcounts, displs, sendtype, recvbuf,
+                                recvcount, recvtype, root, comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_iscatterv__(MPI_Fint *sendbuf, MPI_Fint sendcounts[],
+                                MPI_Fint displs[], MPI_Fint *sendtype,
+                                MPI_Fint *recvbuf, MPI_Fint *recvcount,
+                                MPI_Fint *recvtype, MPI_Fint *root,
+                                MPI_Fint *comm, MPI_Fint *request,
+                                MPI_Fint *ierr) {
+  MPI_Iscatterv_fortran_wrapper(sendbuf, sendcounts, displs, sendtype, recvbuf,
+                                recvcount, recvtype, root, comm, request, ierr);
+}
+
+/* ================= End Wrappers for MPI_Iscatterv ================= */
+
+/* ================== C Wrappers for MPI_Gather ================== */
+_EXTERN_C_ int PMPI_Gather(const void *sendbuf, int sendcount,
+                           MPI_Datatype sendtype, void *recvbuf, int recvcount,
+                           MPI_Datatype recvtype, int root, MPI_Comm comm);
+_EXTERN_C_ int MPI_Gather(const void *sendbuf, int sendcount,
+                          MPI_Datatype sendtype, void *recvbuf, int recvcount,
+                          MPI_Datatype recvtype, int root, MPI_Comm comm) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Gather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype,
+                    root, comm);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    unsigned long long bytes =
+        sendBytes(sendbuf, sendcount, sendtype, recvcount, recvtype);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Gather");
+#endif
+    TRACE_COLL('c', COLL_OP_GATHER, comm, root, bytes, time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Gather =============== */
+static void MPI_Gather_fortran_wrapper(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                                       MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                                       MPI_Fint *recvcount, MPI_Fint *recvtype,
+                                       MPI_Fint *root, MPI_Fint *comm,
+                                       MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Gather((const void *)sendbuf, *sendcount, (MPI_Datatype)(*sendtype),
+                 (void *)recvbuf, *recvcount, (MPI_Datatype)(*recvtype), *root,
+                 (MPI_Comm)(*comm));
+#else  /* MPI-2 safe call */
+  _wrap_py_return_val =
+      MPI_Gather((const void *)sendbuf, *sendcount, MPI_Type_f2c(*sendtype),
+                 (void *)recvbuf, *recvcount, MPI_Type_f2c(*recvtype), *root,
+                 MPI_Comm_f2c(*comm));
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_GATHER(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                           MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                           MPI_Fint *recvcount, MPI_Fint *recvtype,
+                           MPI_Fint *root, MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Gather_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                             recvtype, root, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_gather(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                           MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                           MPI_Fint *recvcount, MPI_Fint *recvtype,
+                           MPI_Fint *root, MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Gather_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                             recvtype, root, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_gather_(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                            MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                            MPI_Fint *recvcount, MPI_Fint *recvtype,
+                            MPI_Fint *root, MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Gather_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                             recvtype, root, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_gather__(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                             MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                             MPI_Fint *recvcount, MPI_Fint *recvtype,
+                             MPI_Fint *root, MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Gather_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                             recvtype, root, comm, ierr);
+}
+
+/* ================= End Wrappers for MPI_Gather ================= */
+
+/* ================== C Wrappers for MPI_Igather ================== */
+_EXTERN_C_ int PMPI_Igather(const void *sendbuf, int sendcount,
+                            MPI_Datatype sendtype, void *recvbuf, int recvcount,
+                            MPI_Datatype recvtype, int root, MPI_Comm comm,
+                            MPI_Request *request);
+_EXTERN_C_ int MPI_Igather(const void *sendbuf, int sendcount,
+                           MPI_Datatype sendtype, void *recvbuf, int recvcount,
+                           MPI_Datatype recvtype, int root, MPI_Comm comm,
+                           MPI_Request *request) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Igather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype,
+                     root, comm, request);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    unsigned long long bytes =
+        sendBytes(sendbuf, sendcount, sendtype, recvcount, recvtype);
+    // Waits of collective requests have no p2p peers
+    request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Igather");
+#endif
+    TRACE_COLL('C', COLL_OP_GATHER, comm, root, bytes, time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Igather =============== */
+static void MPI_Igather_fortran_wrapper(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                                        MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                                        MPI_Fint *recvcount, MPI_Fint *recvtype,
+                                        MPI_Fint *root, MPI_Fint *comm,
+                                        MPI_Fint *request, MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Igather((const void *)sendbuf, *sendcount, (MPI_Datatype)(*sendtype),
+                  (void *)recvbuf, *recvcount, (MPI_Datatype)(*recvtype), *root,
+                  (MPI_Comm)(*comm), (MPI_Request *)request);
+#else  /* MPI-2 safe call */
+  MPI_Request temp_request;
+  temp_request = MPI_Request_f2c(*request);
+  _wrap_py_return_val =
+      MPI_Igather((const void *)sendbuf, *sendcount, MPI_Type_f2c(*sendtype),
+                  (void *)recvbuf, *recvcount, MPI_Type_f2c(*recvtype), *root,
+                  MPI_Comm_f2c(*comm), &temp_request);
+  *request = MPI_Request_c2f(temp_request);
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_IGATHER(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                            MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                            MPI_Fint *recvcount, MPI_Fint *recvtype,
+                            MPI_Fint *root, MPI_Fint *comm, MPI_Fint *request,
+                            MPI_Fint *ierr) {
+  MPI_Igather_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                              recvtype, root, comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_igather(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                            MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                            MPI_Fint *recvcount, MPI_Fint *recvtype,
+                            MPI_Fint *root, MPI_Fint *comm, MPI_Fint *request,
+                            MPI_Fint *ierr) {
+  MPI_Igather_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                              recvtype, root, comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_igather_(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                             MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                             MPI_Fint *recvcount, MPI_Fint *recvtype,
+                             MPI_Fint *root, MPI_Fint *comm, MPI_Fint *request,
+                             MPI_Fint *ierr) {
+  MPI_Igather_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                              recvtype, root, comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_igather__(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                              MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                              MPI_Fint *recvcount, MPI_Fint *recvtype,
+                              MPI_Fint *root, MPI_Fint *comm, MPI_Fint *request,
+                              MPI_Fint *ierr) {
+  MPI_Igather_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                              recvtype, root, comm, request, ierr);
+}
+
+/* ================= End Wrappers for MPI_Igather ================= */
+
+/* ================== C Wrappers for MPI_Gatherv ================== */
+_EXTERN_C_ int PMPI_Gatherv(const void *sendbuf, int sendcount,
+                            MPI_Datatype sendtype, void *recvbuf,
+                            const int recvcounts[], const int displs[],
+                            MPI_Datatype recvtype, int root, MPI_Comm comm);
+_EXTERN_C_ int MPI_Gatherv(const void *sendbuf, int sendcount,
+                           MPI_Datatype sendtype, void *recvbuf,
+                           const int recvcounts[], const int displs[],
+                           MPI_Datatype recvtype, int root, MPI_Comm comm) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Gatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs,
+                     recvtype, root, comm);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    unsigned long long bytes =
+        sendbuf == MPI_IN_PLACE
+            ? dataBytes(recvcounts[commRank(comm)], recvtype)
+            : dataBytes(sendcount, sendtype);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Gatherv");
+#endif
+    TRACE_COLL('c', COLL_OP_GATHERV, comm, root, bytes, time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Gatherv =============== */
+static void MPI_Gatherv_fortran_wrapper(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                                        MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                                        MPI_Fint recvcounts[],
+                                        MPI_Fint displs[], MPI_Fint *recvtype,
+                                        MPI_Fint *root, MPI_Fint *comm,
+                                        MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Gatherv((const void *)sendbuf, *sendcount, (MPI_Datatype)(*sendtype),
+                  (void *)recvbuf, (const int *)recvcounts, (const int *)displs,
+                  (MPI_Datatype)(*recvtype), *root, (MPI_Comm)(*comm));
+#else  /* MPI-2 safe call */
+  _wrap_py_return_val =
+      MPI_Gatherv((const void *)sendbuf, *sendcount, MPI_Type_f2c(*sendtype),
+                  (void *)recvbuf, (const int *)recvcounts, (const int *)displs,
+                  MPI_Type_f2c(*recvtype), *root, MPI_Comm_f2c(*comm));
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_GATHERV(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                            MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                            MPI_Fint recvcounts[], MPI_Fint displs[],
+                            MPI_Fint *recvtype, MPI_Fint *root, MPI_Fint *comm,
+                            MPI_Fint *ierr) {
+  MPI_Gatherv_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcounts,
+                              displs, recvtype, root, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_gatherv(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                            MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                            MPI_Fint recvcounts[], MPI_Fint displs[],
+                            MPI_Fint *recvtype, MPI_Fint *root, MPI_Fint *comm,
+                            MPI_Fint *ierr) {
+  MPI_Gatherv_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcounts,
+                              displs, recvtype, root, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_gatherv_(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                             MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                             MPI_Fint recvcounts[], MPI_Fint displs[],
+                             MPI_Fint *recvtype, MPI_Fint *root, MPI_Fint *comm,
+                             MPI_Fint *ierr) {
+  MPI_Gatherv_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcounts,
+                              displs, recvtype, root, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_gatherv__(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                              MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                              MPI_Fint recvcounts[], MPI_Fint displs[],
+                              MPI_Fint *recvtype, MPI_Fint *root,
+                              MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Gatherv_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcounts,
+                              displs, recvtype, root, comm, ierr);
+}
+
+/* ================= End Wrappers for MPI_Gatherv ================= */
+
+/* ================== C Wrappers for MPI_Igatherv ================== */
+_EXTERN_C_ int PMPI_Igatherv(const void *sendbuf, int sendcount,
+                             MPI_Datatype sendtype, void *recvbuf,
+                             const int recvcounts[], const int displs[],
+                             MPI_Datatype recvtype, int root, MPI_Comm comm,
+                             MPI_Request *request);
+_EXTERN_C_ int MPI_Igatherv(const void *sendbuf, int sendcount,
+                            MPI_Datatype sendtype, void *recvbuf,
+                            const int recvcounts[], const int displs[],
+                            MPI_Datatype recvtype, int root, MPI_Comm comm,
+                            MPI_Request *request) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Igatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs,
+                      recvtype, root, comm, request);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    unsigned long long bytes =
+        sendbuf == MPI_IN_PLACE
+            ? dataBytes(recvcounts[commRank(comm)], recvtype)
+            : dataBytes(sendcount, sendtype);
+    // Waits of collective requests have no p2p peers
+    request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Igatherv");
+#endif
+    TRACE_COLL('C', COLL_OP_GATHERV, comm, root, bytes, time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Igatherv =============== */
+static void MPI_Igatherv_fortran_wrapper(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                                         MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                                         MPI_Fint recvcounts[],
+                                         MPI_Fint displs[], MPI_Fint *recvtype,
+                                         MPI_Fint *root, MPI_Fint *comm,
+                                         MPI_Fint *request, MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Igatherv((const void *)sendbuf, *sendcount, (MPI_Datatype)(*sendtype),
+                   (void *)recvbuf, (const int *)recvcounts,
+                   (const int *)displs, (MPI_Datatype)(*recvtype), *root,
+                   (MPI_Comm)(*comm), (MPI_Request *)request);
+#else  /* MPI-2 safe call */
+  MPI_Request temp_request;
+  temp_request = MPI_Request_f2c(*request);
+  _wrap_py_return_val =
+      MPI_Igatherv((const void *)sendbuf, *sendcount, MPI_Type_f2c(*sendtype),
+                   (void *)recvbuf, (const int *)recvcounts,
+                   (const int *)displs, MPI_Type_f2c(*recvtype), *root,
+                   MPI_Comm_f2c(*comm), &temp_request);
+  *request = MPI_Request_c2f(temp_request);
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_IGATHERV(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                             MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                             MPI_Fint recvcounts[], MPI_Fint displs[],
+                             MPI_Fint *recvtype, MPI_Fint *root, MPI_Fint *comm,
+                             MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Igatherv_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                               recvcounts, displs, recvtype, root, comm,
+                               request, ierr);
+}
+
+_EXTERN_C_ void mpi_igatherv(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                             MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                             MPI_Fint recvcounts[], MPI_Fint displs[],
+                             MPI_Fint *recvtype, MPI_Fint *root, MPI_Fint *comm,
+                             MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Igatherv_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                               recvcounts, displs, recvtype, root, comm,
+                               request, ierr);
+}
+
+_EXTERN_C_ void mpi_igatherv_(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                              MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                              MPI_Fint recvcounts[], MPI_Fint displs[],
+                              MPI_Fint *recvtype, MPI_Fint *root,
+                              MPI_Fint *comm, MPI_Fint *request,
+                              MPI_Fint *ierr) {
+  MPI_Igatherv_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                               recvcounts, displs, recvtype, root, comm,
+                               request, ierr);
+}
+
+_EXTERN_C_ void mpi_igatherv__(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                               MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                               MPI_Fint recvcounts[], MPI_Fint displs[],
+                               MPI_Fint *recvtype, MPI_Fint *root,
+                               MPI_Fint *comm, MPI_Fint *request,
+                               MPI_Fint *ierr) {
+  MPI_Igatherv_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                               recvcounts, displs, recvtype, root, comm,
+                               request, ierr);
+}
+
+/* ================= End Wrappers for MPI_Igatherv ================= */
+
+/* ================== C Wrappers for MPI_Allgather ================== */
+_EXTERN_C_ int PMPI_Allgather(const void *sendbuf, int sendcount,
+                              MPI_Datatype sendtype, void *recvbuf,
+                              int recvcount, MPI_Datatype recvtype,
+                              MPI_Comm comm);
+_EXTERN_C_ int MPI_Allgather(const void *sendbuf, int sendcount,
+                             MPI_Datatype sendtype, void *recvbuf,
+                             int recvcount, MPI_Datatype recvtype,
+                             MPI_Comm comm) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Allgather(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                       recvtype, comm);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    unsigned long long bytes =
+        sendBytes(sendbuf, sendcount, sendtype, recvcount, recvtype);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Allgather");
+#endif
+    TRACE_COLL('c', COLL_OP_ALLGATHER, comm, -1, bytes, time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Allgather =============== */
+static void MPI_Allgather_fortran_wrapper(MPI_Fint *sendbuf,
+                                          MPI_Fint *sendcount,
+                                          MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                                          MPI_Fint *recvcount,
+                                          MPI_Fint *recvtype, MPI_Fint *comm,
+                                          MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Allgather((const void *)sendbuf, *sendcount,
+                    (MPI_Datatype)(*sendtype), (void *)recvbuf, *recvcount,
+                    (MPI_Datatype)(*recvtype), (MPI_Comm)(*comm));
+#else  /* MPI-2 safe call */
+  _wrap_py_return_val =
+      MPI_Allgather((const void *)sendbuf, *sendcount, MPI_Type_f2c(*sendtype),
+                    (void *)recvbuf, *recvcount, MPI_Type_f2c(*recvtype),
+                    MPI_Comm_f2c(*comm));
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_ALLGATHER(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                              MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                              MPI_Fint *recvcount, MPI_Fint *recvtype,
+                              MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Allgather_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                                recvcount, recvtype, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_allgather(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                              MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                              MPI_Fint *recvcount, MPI_Fint *recvtype,
+                              MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Allgather_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                                recvcount, recvtype, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_allgather_(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                               MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                               MPI_Fint *recvcount, MPI_Fint *recvtype,
+                               MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Allgather_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                                recvcount, recvtype, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_allgather__(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                                MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                                MPI_Fint *recvcount, MPI_Fint *recvtype,
+                                MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Allgather_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                                recvcount, recvtype, comm, ierr);
+}
+
+/* ================= End Wrappers for MPI_Allgather ================= */
+
+/* ================== C Wrappers for MPI_Iallgather ================== */
+_EXTERN_C_ int PMPI_Iallgather(const void *sendbuf, int sendcount,
+                               MPI_Datatype sendtype, void *recvbuf,
+                               int recvcount, MPI_Datatype recvtype,
+                               MPI_Comm comm, MPI_Request *request);
+_EXTERN_C_ int MPI_Iallgather(const void *sendbuf, int sendcount,
+                              MPI_Datatype sendtype, void *recvbuf,
+                              int recvcount, MPI_Datatype recvtype,
+                              MPI_Comm comm, MPI_Request *request) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Iallgather(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                        recvtype, comm, request);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    unsigned long long bytes =
+        sendBytes(sendbuf, sendcount, sendtype, recvcount, recvtype);
+    // Waits of collective requests have no p2p peers
+    request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Iallgather");
+#endif
+    TRACE_COLL('C', COLL_OP_ALLGATHER, comm, -1, bytes, time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Iallgather =============== */
+static void MPI_Iallgather_fortran_wrapper(MPI_Fint *sendbuf,
+                                           MPI_Fint *sendcount,
+                                           MPI_Fint *sendtype,
+                                           MPI_Fint *recvbuf,
+                                           MPI_Fint *recvcount,
+                                           MPI_Fint *recvtype, MPI_Fint *comm,
+                                           MPI_Fint *request, MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Iallgather((const void *)sendbuf, *sendcount,
+                     (MPI_Datatype)(*sendtype), (void *)recvbuf, *recvcount,
+                     (MPI_Datatype)(*recvtype), (MPI_Comm)(*comm),
+                     (MPI_Request *)request);
+#else  /* MPI-2 safe call */
+  MPI_Request temp_request;
+  temp_request = MPI_Request_f2c(*request);
+  _wrap_py_return_val =
+      MPI_Iallgather((const void *)sendbuf, *sendcount, MPI_Type_f2c(*sendtype),
+                     (void *)recvbuf, *recvcount, MPI_Type_f2c(*recvtype),
+                     MPI_Comm_f2c(*comm), &temp_request);
+  *request = MPI_Request_c2f(temp_request);
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_IALLGATHER(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                               MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                               MPI_Fint *recvcount, MPI_Fint *recvtype,
+                               MPI_Fint *comm, MPI_Fint *request,
+                               MPI_Fint *ierr) {
+  MPI_Iallgather_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                                 recvcount, recvtype, comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_iallgather(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                               MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                               MPI_Fint *recvcount, MPI_Fint *recvtype,
+                               MPI_Fint *comm, MPI_Fint *request,
+                               MPI_Fint *ierr) {
+  MPI_Iallgather_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                                 recvcount, recvtype, comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_iallgather_(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                                MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                                MPI_Fint *recvcount, MPI_Fint *recvtype,
+                                MPI_Fint *comm, MPI_Fint *request,
+                                MPI_Fint *ierr) {
+  MPI_Iallgather_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                                 recvcount, recvtype, comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_iallgather__(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                                 MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                                 MPI_Fint *recvcount, MPI_Fint *recvtype,
+                                 MPI_Fint *comm, MPI_Fint *request,
+                                 MPI_Fint *ierr) {
+  MPI_Iallgather_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                                 recvcount, recvtype, comm, request, ierr);
+}
+
+/* ================= End Wrappers for MPI_Iallgather ================= */
+
+/* ================== C Wrappers for MPI_Allgatherv ================== */
+_EXTERN_C_ int PMPI_Allgatherv(const void *sendbuf, int sendcount,
+                               MPI_Datatype sendtype, void *recvbuf,
+                               const int recvcounts[], const int displs[],
+                               MPI_Datatype recvtype, MPI_Comm comm);
+_EXTERN_C_ int MPI_Allgatherv(const void *sendbuf, int sendcount,
+                              MPI_Datatype sendtype, void *recvbuf,
+                              const int recvcounts[], const int displs[],
+                              MPI_Datatype recvtype, MPI_Comm comm) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Allgatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts,
+                        displs, recvtype, comm);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    unsigned long long bytes =
+        sendbuf == MPI_IN_PLACE
+            ? dataBytes(recvcounts[commRank(comm)], recvtype)
+            : dataBytes(sendcount, sendtype);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Allgatherv");
+#endif
+    TRACE_COLL('c', COLL_OP_ALLGATHERV, comm, -1, bytes, time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Allgatherv =============== */
+static void MPI_Allgatherv_fortran_wrapper(MPI_Fint *sendbuf,
+                                           MPI_Fint *sendcount,
+                                           MPI_Fint *sendtype,
+                                           MPI_Fint *recvbuf,
+                                           MPI_Fint recvcounts[],
+                                           MPI_Fint displs[],
+                                           MPI_Fint *recvtype, MPI_Fint *comm,
+                                           MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Allgatherv((const void *)sendbuf, *sendcount,
+                     (MPI_Datatype)(*sendtype), (void *)recvbuf,
+                     (const int *)recvcounts, (const int *)displs,
+                     (MPI_Datatype)(*recvtype), (MPI_Comm)(*comm));
+#else  /* MPI-2 safe call */
+  _wrap_py_return_val =
+      MPI_Allgatherv((const void *)sendbuf, *sendcount, MPI_Type_f2c(*sendtype),
+                     (void *)recvbuf, (const int *)recvcounts,
+                     (const int *)displs, MPI_Type_f2c(*recvtype),
+                     MPI_Comm_f2c(*comm));
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_ALLGATHERV(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                               MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                               MPI_Fint recvcounts[], MPI_Fint displs[],
+                               MPI_Fint *recvtype, MPI_Fint *comm,
+                               MPI_Fint *ierr) {
+  MPI_Allgatherv_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                                 recvcounts, displs, recvtype, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_allgatherv(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                               MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                               MPI_Fint recvcounts[], MPI_Fint displs[],
+                               MPI_Fint *recvtype, MPI_Fint *comm,
+                               MPI_Fint *ierr) {
+  MPI_Allgatherv_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                                 recvcounts, displs, recvtype, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_allgatherv_(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                                MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                                MPI_Fint recvcounts[], MPI_Fint displs[],
+                                MPI_Fint *recvtype, MPI_Fint *comm,
+                                MPI_Fint *ierr) {
+  MPI_Allgatherv_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                                 recvcounts, displs, recvtype, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_allgatherv__(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                                 MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                                 MPI_Fint recvcounts[], MPI_Fint displs[],
+                                 MPI_Fint *recvtype, MPI_Fint *comm,
+                                 MPI_Fint *ierr) {
+  MPI_Allgatherv_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                                 recvcounts, displs, recvtype, comm, ierr);
+}
+
+/* ================= End Wrappers for MPI_Allgatherv ================= */
+
+/* ================== C Wrappers for MPI_Iallgatherv ================== */
+_EXTERN_C_ int PMPI_Iallgatherv(const void *sendbuf, int sendcount,
+                                MPI_Datatype sendtype, void *recvbuf,
+                                const int recvcounts[], const int displs[],
+                                MPI_Datatype recvtype, MPI_Comm comm,
+                                MPI_Request *request);
+_EXTERN_C_ int MPI_Iallgatherv(const void *sendbuf, int sendcount,
+                               MPI_Datatype sendtype, void *recvbuf,
+                               const int recvcounts[], const int displs[],
+                               MPI_Datatype recvtype, MPI_Comm comm,
+                               MPI_Request *request) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Iallgatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts,
+                         displs, recvtype, comm, request);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    unsigned long long bytes =
+        sendbuf == MPI_IN_PLACE
+            ? dataBytes(recvcounts[commRank(comm)], recvtype)
+            : dataBytes(sendcount, sendtype);
+    // Waits of collective requests have no p2p peers
+    request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Iallgatherv");
+#endif
+    TRACE_COLL('C', COLL_OP_ALLGATHERV, comm, -1, bytes, time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Iallgatherv =============== */
+static void MPI_Iallgatherv_fortran_wrapper(MPI_Fint *sendbuf,
+                                            MPI_Fint *sendcount,
+                                            MPI_Fint *sendtype,
+                                            MPI_Fint *recvbuf,
+                                            MPI_Fint recvcounts[],
+                                            MPI_Fint displs[],
+                                            MPI_Fint *recvtype, MPI_Fint *comm,
+                                            MPI_Fint *request, MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Iallgatherv((const void *)sendbuf, *sendcount,
+                      (MPI_Datatype)(*sendtype), (void *)recvbuf,
+                      (const int *)recvcounts, (const int *)displs,
+                      (MPI_Datatype)(*recvtype), (MPI_Comm)(*comm),
+                      (MPI_Request *)request);
+#else  /* MPI-2 safe call */
+  MPI_Request temp_request;
+  temp_request = MPI_Request_f2c(*request);
+  _wrap_py_return_val =
+      MPI_Iallgatherv((const void *)sendbuf, *sendcount,
+                      MPI_Type_f2c(*sendtype), (void *)recvbuf,
+                      (const int *)recvcounts, (const int *)displs,
+                      MPI_Type_f2c(*recvtype), MPI_Comm_f2c(*comm),
+                      &temp_request);
+  *request = MPI_Request_c2f(temp_request);
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_IALLGATHERV(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                                MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                                MPI_Fint recvcounts[], MPI_Fint displs[],
+                                MPI_Fint *recvtype, MPI_Fint *comm,
+                                MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Iallgatherv_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                                  recvcounts, displs, recvtype, comm, request,
+                                  ierr);
+}
+
+_EXTERN_C_ void mpi_iallgatherv(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                                MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                                MPI_Fint recvcounts[], MPI_Fint displs[],
+                                MPI_Fint *recvtype, MPI_Fint *comm,
+                                MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Iallgatherv_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                                  recvcounts, displs, recvtype, comm, request,
+                                  ierr);
+}
+
+_EXTERN_C_ void mpi_iallgatherv_(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                                 MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                                 MPI_Fint recvcounts[], MPI_Fint displs[],
+                                 MPI_Fint *recvtype, MPI_Fint *comm,
+                                 MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Iallgatherv_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                                  recvcounts, displs, recvtype, comm, request,
+                                  ierr);
+}
+
+_EXTERN_C_ void mpi_iallgatherv__(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                                  MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                                  MPI_Fint recvcounts[], MPI_Fint displs[],
+                                  MPI_Fint *recvtype, MPI_Fint *comm,
+                                  MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Iallgatherv_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                                  recvcounts, displs, recvtype, comm, request,
+                                  ierr);
+}
+
+/* ================= End Wrappers for MPI_Iallgatherv ================= */
+
+/* ================== C Wrappers for MPI_Alltoall ================== */
+_EXTERN_C_ int PMPI_Alltoall(const void *sendbuf, int sendcount,
+                             MPI_Datatype sendtype, void *recvbuf,
+                             int recvcount, MPI_Datatype recvtype,
+                             MPI_Comm comm);
+_EXTERN_C_ int MPI_Alltoall(const void *sendbuf, int sendcount,
+                            MPI_Datatype sendtype, void *recvbuf, int recvcount,
+                            MPI_Datatype recvtype, MPI_Comm comm) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Alltoall(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                      recvtype, comm);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    unsigned long long bytes =
+        sendBytes(sendbuf, sendcount, sendtype, recvcount, recvtype) *
+        commSize(comm);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Alltoall");
+#endif
+    TRACE_COLL('c', COLL_OP_ALLTOALL, comm, -1, bytes, time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Alltoall =============== */
+static void MPI_Alltoall_fortran_wrapper(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                                         MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                                         MPI_Fint *recvcount,
+                                         MPI_Fint *recvtype, MPI_Fint *comm,
+                                         MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Alltoall((const void *)sendbuf, *sendcount, (MPI_Datatype)(*sendtype),
+                   (void *)recvbuf, *recvcount, (MPI_Datatype)(*recvtype),
+                   (MPI_Comm)(*comm));
+#else  /* MPI-2 safe call */
+  _wrap_py_return_val =
+      MPI_Alltoall((const void *)sendbuf, *sendcount, MPI_Type_f2c(*sendtype),
+                   (void *)recvbuf, *recvcount, MPI_Type_f2c(*recvtype),
+                   MPI_Comm_f2c(*comm));
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_ALLTOALL(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                             MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                             MPI_Fint *recvcount, MPI_Fint *recvtype,
+                             MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Alltoall_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                               recvtype, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_alltoall(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                             MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                             MPI_Fint *recvcount, MPI_Fint *recvtype,
+                             MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Alltoall_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                               recvtype, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_alltoall_(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                              MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                              MPI_Fint *recvcount, MPI_Fint *recvtype,
+                              MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Alltoall_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                               recvtype, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_alltoall__(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                               MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                               MPI_Fint *recvcount, MPI_Fint *recvtype,
+                               MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Alltoall_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                               recvtype, comm, ierr);
+}
+
+/* ================= End Wrappers for MPI_Alltoall ================= */
+
+/* ================== C Wrappers for MPI_Ialltoall ================== */
+_EXTERN_C_ int PMPI_Ialltoall(const void *sendbuf, int sendcount,
+                              MPI_Datatype sendtype, void *recvbuf,
+                              int recvcount, MPI_Datatype recvtype,
+                              MPI_Comm comm, MPI_Request *request);
+_EXTERN_C_ int MPI_Ialltoall(const void *sendbuf, int sendcount,
+                             MPI_Datatype sendtype, void *recvbuf,
+                             int recvcount, MPI_Datatype recvtype,
+                             MPI_Comm comm, MPI_Request *request) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Ialltoall(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                       recvtype, comm, request);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    unsigned long long bytes =
+        sendBytes(sendbuf, sendcount, sendtype, recvcount, recvtype) *
+        commSize(comm);
+    // Waits of collective requests have no p2p peers
+    request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Ialltoall");
+#endif
+    TRACE_COLL('C', COLL_OP_ALLTOALL, comm, -1, bytes, time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Ialltoall =============== */
+static void MPI_Ialltoall_fortran_wrapper(MPI_Fint *sendbuf,
+                                          MPI_Fint *sendcount,
+                                          MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                                          MPI_Fint *recvcount,
+                                          MPI_Fint *recvtype, MPI_Fint *comm,
+                                          MPI_Fint *request, MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Ialltoall((const void *)sendbuf, *sendcount,
+                    (MPI_Datatype)(*sendtype), (void *)recvbuf, *recvcount,
+                    (MPI_Datatype)(*recvtype), (MPI_Comm)(*comm),
+                    (MPI_Request *)request);
+#else  /* MPI-2 safe call */
+  MPI_Request temp_request;
+  temp_request = MPI_Request_f2c(*request);
+  _wrap_py_return_val =
+      MPI_Ialltoall((const void *)sendbuf, *sendcount, MPI_Type_f2c(*sendtype),
+                    (void *)recvbuf, *recvcount, MPI_Type_f2c(*recvtype),
+                    MPI_Comm_f2c(*comm), &temp_request);
+  *request = MPI_Request_c2f(temp_request);
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_IALLTOALL(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                              MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                              MPI_Fint *recvcount, MPI_Fint *recvtype,
+                              MPI_Fint *comm, MPI_Fint *request,
+                              MPI_Fint *ierr) {
+  MPI_Ialltoall_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                                recvcount, recvtype, comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_ialltoall(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                              MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                              MPI_Fint *recvcount, MPI_Fint *recvtype,
+                              MPI_Fint *comm, MPI_Fint *request,
+                              MPI_Fint *ierr) {
+  MPI_Ialltoall_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                                recvcount, recvtype, comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_ialltoall_(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                               MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                               MPI_Fint *recvcount, MPI_Fint *recvtype,
+                               MPI_Fint *comm, MPI_Fint *request,
+                               MPI_Fint *ierr) {
+  MPI_Ialltoall_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                                recvcount, recvtype, comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_ialltoall__(MPI_Fint *sendbuf, MPI_Fint *sendcount,
+                                MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                                MPI_Fint *recvcount, MPI_Fint *recvtype,
+                                MPI_Fint *comm, MPI_Fint *request,
+                                MPI_Fint *ierr) {
+  MPI_Ialltoall_fortran_wrapper(sendbuf, sendcount, sendtype, recvbuf,
+                                recvcount, recvtype, comm, request, ierr);
+}
+
+/* ================= End Wrappers for MPI_Ialltoall ================= */
+
+/* ================== C Wrappers for MPI_Alltoallv ================== */
+_EXTERN_C_ int PMPI_Alltoallv(const void *sendbuf, const int sendcounts[],
+                              const int sdispls[], MPI_Datatype sendtype,
+                              void *recvbuf, const int recvcounts[],
+                              const int rdispls[], MPI_Datatype recvtype,
+                              MPI_Comm comm);
+_EXTERN_C_ int MPI_Alltoallv(const void *sendbuf, const int sendcounts[],
+                             const int sdispls[], MPI_Datatype sendtype,
+                             void *recvbuf, const int recvcounts[],
+                             const int rdispls[], MPI_Datatype recvtype,
+                             MPI_Comm comm) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Alltoallv(sendbuf, sendcounts, sdispls, sendtype, recvbuf,
+                       recvcounts, rdispls, recvtype, comm);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    int comm_size = commSize(comm);
+    // sendcounts may be NULL when sending in place
+    unsigned long long bytes =
+        sendbuf == MPI_IN_PLACE
+            ? dataBytes(sumCounts(recvcounts, comm_size), recvtype)
+            : dataBytes(sumCounts(sendcounts, comm_size), sendtype);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Alltoallv");
+#endif
+    TRACE_COLL('c', COLL_OP_ALLTOALLV, comm, -1, bytes, time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Alltoallv =============== */
+static void MPI_Alltoallv_fortran_wrapper(MPI_Fint *sendbuf,
+                                          MPI_Fint sendcounts[],
+                                          MPI_Fint sdispls[],
+                                          MPI_Fint *sendtype, MPI_Fint *recvbuf,
+                                          MPI_Fint recvcounts[],
+                                          MPI_Fint rdispls[],
+                                          MPI_Fint *recvtype, MPI_Fint *comm,
+                                          MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Alltoallv((const void *)sendbuf, (const int *)sendcounts,
+                    (const int *)sdispls, (MPI_Datatype)(*sendtype),
+                    (void *)recvbuf, (const int *)recvcounts,
+                    (const int *)rdispls, (MPI_Datatype)(*recvtype),
+                    (MPI_Comm)(*comm));
+#else  /* MPI-2 safe call */
+  _wrap_py_return_val =
+      MPI_Alltoallv((const void *)sendbuf, (const int *)sendcounts,
+                    (const int *)sdispls, MPI_Type_f2c(*sendtype),
+                    (void *)recvbuf, (const int *)recvcounts,
+                    (const int *)rdispls, MPI_Type_f2c(*recvtype),
+                    MPI_Comm_f2c(*comm));
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_ALLTOALLV(MPI_Fint *sendbuf, MPI_Fint sendcounts[],
+                              MPI_Fint sdispls[], MPI_Fint *sendtype,
+                              MPI_Fint *recvbuf, MPI_Fint recvcounts[],
+                              MPI_Fint rdispls[], MPI_Fint *recvtype,
+                              MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Alltoallv_fortran_wrapper(sendbuf, sendcounts, sdispls, sendtype, recvbuf,
+                                recvcounts, rdispls, recvtype, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_alltoallv(MPI_Fint *sendbuf, MPI_Fint sendcounts[],
+                              MPI_Fint sdispls[], MPI_Fint *sendtype,
+                              MPI_Fint *recvbuf, MPI_Fint recvcounts[],
+                              MPI_Fint rdispls[], MPI_Fint *recvtype,
+                              MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Alltoallv_fortran_wrapper(sendbuf, sendcounts, sdispls, sendtype, recvbuf,
+                                recvcounts, rdispls, recvtype, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_alltoallv_(MPI_Fint *sendbuf, MPI_Fint sendcounts[],
+                               MPI_Fint sdispls[], MPI_Fint *sendtype,
+                               MPI_Fint *recvbuf, MPI_Fint recvcounts[],
+                               MPI_Fint rdispls[], MPI_Fint *recvtype,
+                               MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Alltoallv_fortran_wrapper(sendbuf, sendcounts, sdispls, sendtype, recvbuf,
+                                recvcounts, rdispls, recvtype, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_alltoallv__(MPI_Fint *sendbuf, MPI_Fint sendcounts[],
+                                MPI_Fint sdispls[], MPI_Fint *sendtype,
+                                MPI_Fint *recvbuf, MPI_Fint recvcounts[],
+                                MPI_Fint rdispls[], MPI_Fint *recvtype,
+                                MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Alltoallv_fortran_wrapper(sendbuf, sendcounts, sdispls, sendtype, recvbuf,
+                                recvcounts, rdispls, recvtype, comm, ierr);
+}
+
+/* ================= End Wrappers for MPI_Alltoallv ================= */
+
+/* ================== C Wrappers for MPI_Ialltoallv ================== */
+_EXTERN_C_ int PMPI_Ialltoallv(const void *sendbuf, const int sendcounts[],
+                               const int sdispls[], MPI_Datatype sendtype,
+                               void *recvbuf, const int recvcounts[],
+                               const int rdispls[], MPI_Datatype recvtype,
+                               MPI_Comm comm, MPI_Request *request);
+_EXTERN_C_ int MPI_Ialltoallv(const void *sendbuf, const int sendcounts[],
+                              const int sdispls[], MPI_Datatype sendtype,
+                              void *recvbuf, const int recvcounts[],
+                              const int rdispls[], MPI_Datatype recvtype,
+                              MPI_Comm comm, MPI_Request *request) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Ialltoallv(sendbuf, sendcounts, sdispls, sendtype, recvbuf,
+                        recvcounts, rdispls, recvtype, comm, request);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    int comm_size = commSize(comm);
+    // sendcounts may be NULL when sending in place
+    unsigned long long bytes =
+        sendbuf == MPI_IN_PLACE
+            ? dataBytes(sumCounts(recvcounts, comm_size), recvtype)
+            : dataBytes(sumCounts(sendcounts, comm_size), sendtype);
+    // Waits of collective requests have no p2p peers
+    request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Ialltoallv");
+#endif
+    TRACE_COLL('C', COLL_OP_ALLTOALLV, comm, -1, bytes, time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Ialltoallv =============== */
+static void MPI_Ialltoallv_fortran_wrapper(MPI_Fint *sendbuf,
+                                           MPI_Fint sendcounts[],
+                                           MPI_Fint sdispls[],
+                                           MPI_Fint *sendtype,
+                                           MPI_Fint *recvbuf,
+                                           MPI_Fint recvcounts[],
+                                           MPI_Fint rdispls[],
+                                           MPI_Fint *recvtype, MPI_Fint *comm,
+                                           MPI_Fint *request, MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Ialltoallv((const void *)sendbuf, (const int *)sendcounts,
+                     (const int *)sdispls, (MPI_Datatype)(*sendtype),
+                     (void *)recvbuf, (const int *)recvcounts,
+                     (const int *)rdispls, (MPI_Datatype)(*recvtype),
+                     (MPI_Comm)(*comm), (MPI_Request *)request);
+#else  /* MPI-2 safe call */
+  MPI_Request temp_request;
+  temp_request = MPI_Request_f2c(*request);
+  _wrap_py_return_val =
+      MPI_Ialltoallv((const void *)sendbuf, (const int *)sendcounts,
+                     (const int *)sdispls, MPI_Type_f2c(*sendtype),
+                     (void *)recvbuf, (const int *)recvcounts,
+                     (const int *)rdispls, MPI_Type_f2c(*recvtype),
+                     MPI_Comm_f2c(*comm), &temp_request);
+  *request = MPI_Request_c2f(temp_request);
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_IALLTOALLV(MPI_Fint *sendbuf, MPI_Fint sendcounts[],
+                               MPI_Fint sdispls[], MPI_Fint *sendtype,
+                               MPI_Fint *recvbuf, MPI_Fint recvcounts[],
+                               MPI_Fint rdispls[], MPI_Fint *recvtype,
+                               MPI_Fint *comm, MPI_Fint *request,
+                               MPI_Fint *ierr) {
+  MPI_Ialltoallv_fortran_wrapper(sendbuf, sendcounts, sdispls, sendtype,
+                                 recvbuf, recvcounts, rdispls, recvtype, comm,
+                                 request, ierr);
+}
+
+_EXTERN_C_ void mpi_ialltoallv(MPI_Fint *sendbuf, MPI_Fint sendcounts[],
+                               MPI_Fint sdispls[], MPI_Fint *sendtype,
+                               MPI_Fint *recvbuf, MPI_Fint recvcounts[],
+                               MPI_Fint rdispls[], MPI_Fint *recvtype,
+                               MPI_Fint *comm, MPI_Fint *request,
+                               MPI_Fint *ierr) {
+  MPI_Ialltoallv_fortran_wrapper(sendbuf, sendcounts, sdispls, sendtype,
+                                 recvbuf, recvcounts, rdispls, recvtype, comm,
+                                 request, ierr);
+}
+
+_EXTERN_C_ void mpi_ialltoallv_(MPI_Fint *sendbuf, MPI_Fint sendcounts[],
+                                MPI_Fint sdispls[], MPI_Fint *sendtype,
+                                MPI_Fint *recvbuf, MPI_Fint recvcounts[],
+                                MPI_Fint rdispls[], MPI_Fint *recvtype,
+                                MPI_Fint *comm, MPI_Fint *request,
+                                MPI_Fint *ierr) {
+  MPI_Ialltoallv_fortran_wrapper(sendbuf, sendcounts, sdispls, sendtype,
+                                 recvbuf, recvcounts, rdispls, recvtype, comm,
+                                 request, ierr);
+}
+
+_EXTERN_C_ void mpi_ialltoallv__(MPI_Fint *sendbuf, MPI_Fint sendcounts[],
+                                 MPI_Fint sdispls[], MPI_Fint *sendtype,
+                                 MPI_Fint *recvbuf, MPI_Fint recvcounts[],
+                                 MPI_Fint rdispls[], MPI_Fint *recvtype,
+                                 MPI_Fint *comm, MPI_Fint *request,
+                                 MPI_Fint *ierr) {
+  MPI_Ialltoallv_fortran_wrapper(sendbuf, sendcounts, sdispls, sendtype,
+                                 recvbuf, recvcounts, rdispls, recvtype, comm,
+                                 request, ierr);
+}
+
+/* ================= End Wrappers for MPI_Ialltoallv ================= */
+
+/* ================== C Wrappers for MPI_Reduce_scatter ================== */
+_EXTERN_C_ int PMPI_Reduce_scatter(const void *sendbuf, void *recvbuf,
+                                   const int recvcounts[],
+                                   MPI_Datatype datatype, MPI_Op op,
+                                   MPI_Comm comm);
+_EXTERN_C_ int MPI_Reduce_scatter(const void *sendbuf, void *recvbuf,
+                                  const int recvcounts[], MPI_Datatype datatype,
+                                  MPI_Op op, MPI_Comm comm) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Reduce_scatter(sendbuf, recvbuf, recvcounts, datatype, op, comm);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    unsigned long long bytes =
+        dataBytes(sumCounts(recvcounts, commSize(comm)), datatype);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Reduce_scatter");
+#endif
+    TRACE_COLL('c', COLL_OP_REDUCE_SCATTER, comm, -1, bytes, time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Reduce_scatter =============== */
+static void MPI_Reduce_scatter_fortran_wrapper(MPI_Fint *sendbuf,
+                                               MPI_Fint *recvbuf,
+                                               MPI_Fint recvcounts[],
+                                               MPI_Fint *datatype, MPI_Fint *op,
+                                               MPI_Fint *comm, MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Reduce_scatter((const void *)sendbuf, (void *)recvbuf,
+                         (const int *)recvcounts, (MPI_Datatype)(*datatype),
+                         (MPI_Op)(*op), (MPI_Comm)(*comm));
+#else  /* MPI-2 safe call */
+  _wrap_py_return_val =
+      MPI_Reduce_scatter((const void *)sendbuf, (void *)recvbuf,
+                         (const int *)recvcounts, MPI_Type_f2c(*datatype),
+                         MPI_Op_f2c(*op), MPI_Comm_f2c(*comm));
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_REDUCE_SCATTER(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                                   MPI_Fint recvcounts[], MPI_Fint *datatype,
+                                   MPI_Fint *op, MPI_Fint *comm,
+                                   MPI_Fint *ierr) {
+  MPI_Reduce_scatter_fortran_wrapper(sendbuf, recvbuf, recvcounts, datatype, op,
+                                     comm, ierr);
+}
+
+_EXTERN_C_ void mpi_reduce_scatter(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                                   MPI_Fint recvcounts[], MPI_Fint *datatype,
+                                   MPI_Fint *op, MPI_Fint *comm,
+                                   MPI_Fint *ierr) {
+  MPI_Reduce_scatter_fortran_wrapper(sendbuf, recvbuf, recvcounts, datatype, op,
+                                     comm, ierr);
+}
+
+_EXTERN_C_ void mpi_reduce_scatter_(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                                    MPI_Fint recvcounts[], MPI_Fint *datatype,
+                                    MPI_Fint *op, MPI_Fint *comm,
+                                    MPI_Fint *ierr) {
+  MPI_Reduce_scatter_fortran_wrapper(sendbuf, recvbuf, recvcounts, datatype, op,
+                                     comm, ierr);
+}
+
+_EXTERN_C_ void mpi_reduce_scatter__(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                                     MPI_Fint recvcounts[], MPI_Fint *datatype,
+                                     MPI_Fint *op, MPI_Fint *comm,
+                                     MPI_Fint *ierr) {
+  MPI_Reduce_scatter_fortran_wrapper(sendbuf, recvbuf, recvcounts, datatype, op,
+                                     comm, ierr);
+}
+
+/* ================= End Wrappers for MPI_Reduce_scatter ================= */
+
+/* ================== C Wrappers for MPI_Ireduce_scatter ================== */
+_EXTERN_C_ int PMPI_Ireduce_scatter(const void *sendbuf, void *recvbuf,
+                                    const int recvcounts[],
+                                    MPI_Datatype datatype, MPI_Op op,
+                                    MPI_Comm comm, MPI_Request *request);
+_EXTERN_C_ int MPI_Ireduce_scatter(const void *sendbuf, void *recvbuf,
+                                   const int recvcounts[],
+                                   MPI_Datatype datatype, MPI_Op op,
+                                   MPI_Comm comm, MPI_Request *request) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Ireduce_scatter(sendbuf, recvbuf, recvcounts, datatype, op, comm,
+                             request);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    unsigned long long bytes =
+        dataBytes(sumCounts(recvcounts, commSize(comm)), datatype);
+    // Waits of collective requests have no p2p peers
+    request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Ireduce_scatter");
+#endif
+    TRACE_COLL('C', COLL_OP_REDUCE_SCATTER, comm, -1, bytes, time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Ireduce_scatter =============== */
+static void MPI_Ireduce_scatter_fortran_wrapper(MPI_Fint *sendbuf,
+                                                MPI_Fint *recvbuf,
+                                                MPI_Fint recvcounts[],
+                                                MPI_Fint *datatype,
+                                                MPI_Fint *op, MPI_Fint *comm,
+                                                MPI_Fint *request,
+                                                MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Ireduce_scatter((const void *)sendbuf, (void *)recvbuf,
+                          (const int *)recvcounts, (MPI_Datatype)(*datatype),
+                          (MPI_Op)(*op), (MPI_Comm)(*comm),
+                          (MPI_Request *)request);
+#else  /* MPI-2 safe call */
+  MPI_Request temp_request;
+  temp_request = MPI_Request_f2c(*request);
+  _wrap_py_return_val =
+      MPI_Ireduce_scatter((const void *)sendbuf, (void *)recvbuf,
+                          (const int *)recvcounts, MPI_Type_f2c(*datatype),
+                          MPI_Op_f2c(*op), MPI_Comm_f2c(*comm), &temp_request);
+  *request = MPI_Request_c2f(temp_request);
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_IREDUCE_SCATTER(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                                    MPI_Fint recvcounts[], MPI_Fint *datatype,
+                                    MPI_Fint *op, MPI_Fint *comm,
+                                    MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Ireduce_scatter_fortran_wrapper(sendbuf, recvbuf, recvcounts, datatype,
+                                      op, comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_ireduce_scatter(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                                    MPI_Fint recvcounts[], MPI_Fint *datatype,
+                                    MPI_Fint *op, MPI_Fint *comm,
+                                    MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Ireduce_scatter_fortran_wrapper(sendbuf, recvbuf, recvcounts, datatype,
+                                      op, comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_ireduce_scatter_(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                                     MPI_Fint recvcounts[], MPI_Fint *datatype,
+                                     MPI_Fint *op, MPI_Fint *comm,
+                                     MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Ireduce_scatter_fortran_wrapper(sendbuf, recvbuf, recvcounts, datatype,
+                                      op, comm, request, ierr);
+}
+
+_EXTERN_C_ void mpi_ireduce_scatter__(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                                      MPI_Fint recvcounts[], MPI_Fint *datatype,
+                                      MPI_Fint *op, MPI_Fint *comm,
+                                      MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Ireduce_scatter_fortran_wrapper(sendbuf, recvbuf, recvcounts, datatype,
+                                      op, comm, request, ierr);
+}
+
+/* ================= End Wrappers for MPI_Ireduce_scatter ================= */
+
+/* ================== C Wrappers for MPI_Scan ================== */
+_EXTERN_C_ int PMPI_Scan(const void *sendbuf, void *recvbuf, int count,
+                         MPI_Datatype datatype, MPI_Op op, MPI_Comm comm);
+_EXTERN_C_ int MPI_Scan(const void *sendbuf, void *recvbuf, int count,
+                        MPI_Datatype datatype, MPI_Op op, MPI_Comm comm) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Scan(sendbuf, recvbuf, count, datatype, op, comm);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+#ifdef DEBUG
+    printf("%s\n", "MPI_Scan");
+#endif
+    TRACE_COLL('c', COLL_OP_SCAN, comm, -1, dataBytes(count, datatype), time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Scan =============== */
+static void MPI_Scan_fortran_wrapper(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                                     MPI_Fint *count, MPI_Fint *datatype,
+                                     MPI_Fint *op, MPI_Fint *comm,
+                                     MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Scan((const void *)sendbuf, (void *)recvbuf, *count,
+               (MPI_Datatype)(*datatype), (MPI_Op)(*op), (MPI_Comm)(*comm));
+#else  /* MPI-2 safe call */
+  _wrap_py_return_val =
+      MPI_Scan((const void *)sendbuf, (void *)recvbuf, *count,
+               MPI_Type_f2c(*datatype), MPI_Op_f2c(*op), MPI_Comm_f2c(*comm));
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_SCAN(MPI_Fint *sendbuf, MPI_Fint *recvbuf, MPI_Fint *count,
+                         MPI_Fint *datatype, MPI_Fint *op, MPI_Fint *comm,
+                         MPI_Fint *ierr) {
+  MPI_Scan_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_scan(MPI_Fint *sendbuf, MPI_Fint *recvbuf, MPI_Fint *count,
+                         MPI_Fint *datatype, MPI_Fint *op, MPI_Fint *comm,
+                         MPI_Fint *ierr) {
+  MPI_Scan_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_scan_(MPI_Fint *sendbuf, MPI_Fint *recvbuf, MPI_Fint *count,
+                          MPI_Fint *datatype, MPI_Fint *op, MPI_Fint *comm,
+                          MPI_Fint *ierr) {
+  MPI_Scan_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_scan__(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                           MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                           MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Scan_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm, ierr);
+}
+
+/* ================= End Wrappers for MPI_Scan ================= */
+
+/* ================== C Wrappers for MPI_Iscan ================== */
+_EXTERN_C_ int PMPI_Iscan(const void *sendbuf, void *recvbuf, int count,
+                          MPI_Datatype datatype, MPI_Op op, MPI_Comm comm,
+                          MPI_Request *request);
+_EXTERN_C_ int MPI_Iscan(const void *sendbuf, void *recvbuf, int count,
+                         MPI_Datatype datatype, MPI_Op op, MPI_Comm comm,
+                         MPI_Request *request) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Iscan(sendbuf, recvbuf, count, datatype, op, comm, request);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    // Waits of collective requests have no p2p peers
+    request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Iscan");
+#endif
+    TRACE_COLL('C', COLL_OP_SCAN, comm, -1, dataBytes(count, datatype), time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Iscan =============== */
+static void MPI_Iscan_fortran_wrapper(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                                      MPI_Fint *count, MPI_Fint *datatype,
+                                      MPI_Fint *op, MPI_Fint *comm,
+                                      MPI_Fint *request, MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Iscan((const void *)sendbuf, (void *)recvbuf, *count,
+                (MPI_Datatype)(*datatype), (MPI_Op)(*op), (MPI_Comm)(*comm),
+                (MPI_Request *)request);
+#else  /* MPI-2 safe call */
+  MPI_Request temp_request;
+  temp_request = MPI_Request_f2c(*request);
+  _wrap_py_return_val =
+      MPI_Iscan((const void *)sendbuf, (void *)recvbuf, *count,
+                MPI_Type_f2c(*datatype), MPI_Op_f2c(*op), MPI_Comm_f2c(*comm),
+                &temp_request);
+  *request = MPI_Request_c2f(temp_request);
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_ISCAN(MPI_Fint *sendbuf, MPI_Fint *recvbuf, MPI_Fint *count,
+                          MPI_Fint *datatype, MPI_Fint *op, MPI_Fint *comm,
+                          MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Iscan_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm,
+                            request, ierr);
+}
+
+_EXTERN_C_ void mpi_iscan(MPI_Fint *sendbuf, MPI_Fint *recvbuf, MPI_Fint *count,
+                          MPI_Fint *datatype, MPI_Fint *op, MPI_Fint *comm,
+                          MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Iscan_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm,
+                            request, ierr);
+}
+
+_EXTERN_C_ void mpi_iscan_(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                           MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                           MPI_Fint *comm, MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Iscan_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm,
+                            request, ierr);
+}
+
+_EXTERN_C_ void mpi_iscan__(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                            MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                            MPI_Fint *comm, MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Iscan_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm,
+                            request, ierr);
+}
+
+/* ================= End Wrappers for MPI_Iscan ================= */
+
+/* ================== C Wrappers for MPI_Exscan ================== */
+_EXTERN_C_ int PMPI_Exscan(const void *sendbuf, void *recvbuf, int count,
+                           MPI_Datatype datatype, MPI_Op op, MPI_Comm comm);
+_EXTERN_C_ int MPI_Exscan(const void *sendbuf, void *recvbuf, int count,
+                          MPI_Datatype datatype, MPI_Op op, MPI_Comm comm) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Exscan(sendbuf, recvbuf, count, datatype, op, comm);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+#ifdef DEBUG
+    printf("%s\n", "MPI_Exscan");
+#endif
+    TRACE_COLL('c', COLL_OP_EXSCAN, comm, -1, dataBytes(count, datatype), time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Exscan =============== */
+static void MPI_Exscan_fortran_wrapper(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                                       MPI_Fint *count, MPI_Fint *datatype,
+                                       MPI_Fint *op, MPI_Fint *comm,
+                                       MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Exscan((const void *)sendbuf, (void *)recvbuf, *count,
+                 (MPI_Datatype)(*datatype), (MPI_Op)(*op), (MPI_Comm)(*comm));
+#else  /* MPI-2 safe call */
+  _wrap_py_return_val =
+      MPI_Exscan((const void *)sendbuf, (void *)recvbuf, *count,
+                 MPI_Type_f2c(*datatype), MPI_Op_f2c(*op), MPI_Comm_f2c(*comm));
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_EXSCAN(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                           MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                           MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Exscan_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_exscan(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                           MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                           MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Exscan_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_exscan_(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                            MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                            MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Exscan_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm, ierr);
+}
+
+_EXTERN_C_ void mpi_exscan__(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                             MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                             MPI_Fint *comm, MPI_Fint *ierr) {
+  MPI_Exscan_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm, ierr);
+}
+
+/* ================= End Wrappers for MPI_Exscan ================= */
+
+/* ================== C Wrappers for MPI_Iexscan ================== */
+_EXTERN_C_ int PMPI_Iexscan(const void *sendbuf, void *recvbuf, int count,
+                            MPI_Datatype datatype, MPI_Op op, MPI_Comm comm,
+                            MPI_Request *request);
+_EXTERN_C_ int MPI_Iexscan(const void *sendbuf, void *recvbuf, int count,
+                           MPI_Datatype datatype, MPI_Op op, MPI_Comm comm,
+                           MPI_Request *request) {
+  int _wrap_py_return_val = 0;
+  {
+    // First call collective communication
+    auto st = chrono::system_clock::now();
+    _wrap_py_return_val =
+        PMPI_Iexscan(sendbuf, recvbuf, count, datatype, op, comm, request);
+    auto ed = chrono::system_clock::now();
+    double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+    // Waits of collective requests have no p2p peers
+    request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+    printf("%s\n", "MPI_Iexscan");
+#endif
+    TRACE_COLL('C', COLL_OP_EXSCAN, comm, -1, dataBytes(count, datatype), time);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Iexscan =============== */
+static void MPI_Iexscan_fortran_wrapper(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                                        MPI_Fint *count, MPI_Fint *datatype,
+                                        MPI_Fint *op, MPI_Fint *comm,
+                                        MPI_Fint *request, MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val =
+      MPI_Iexscan((const void *)sendbuf, (void *)recvbuf, *count,
+                  (MPI_Datatype)(*datatype), (MPI_Op)(*op), (MPI_Comm)(*comm),
+                  (MPI_Request *)request);
+#else  /* MPI-2 safe call */
+  MPI_Request temp_request;
+  temp_request = MPI_Request_f2c(*request);
+  _wrap_py_return_val =
+      MPI_Iexscan((const void *)sendbuf, (void *)recvbuf, *count,
+                  MPI_Type_f2c(*datatype), MPI_Op_f2c(*op), MPI_Comm_f2c(*comm),
+                  &temp_request);
+  *request = MPI_Request_c2f(temp_request);
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_IEXSCAN(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                            MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                            MPI_Fint *comm, MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Iexscan_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm,
+                              request, ierr);
+}
+
+_EXTERN_C_ void mpi_iexscan(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                            MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                            MPI_Fint *comm, MPI_Fint *request, MPI_Fint *ierr) {
+  MPI_Iexscan_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm,
+                              request, ierr);
+}
+
+_EXTERN_C_ void mpi_iexscan_(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                             MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                             MPI_Fint *comm, MPI_Fint *request,
+                             MPI_Fint *ierr) {
+  MPI_Iexscan_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm,
+                              request, ierr);
+}
+
+_EXTERN_C_ void mpi_iexscan__(MPI_Fint *sendbuf, MPI_Fint *recvbuf,
+                              MPI_Fint *count, MPI_Fint *datatype, MPI_Fint *op,
+                              MPI_Fint *comm, MPI_Fint *request,
+                              MPI_Fint *ierr) {
+  MPI_Iexscan_fortran_wrapper(sendbuf, recvbuf, count, datatype, op, comm,
+                              request, ierr);
+}
+
+/* ================= End Wrappers for MPI_Iexscan ================= */
+
+/* ================== C Wrappers for MPI_Type_free ================== */
+_EXTERN_C_ int PMPI_Type_free(MPI_Datatype *datatype);
+_EXTERN_C_ int MPI_Type_free(MPI_Datatype *datatype) {
+  int _wrap_py_return_val = 0;
+  {
+    // Sizes of freed datatypes are not cached, their handles may be reused
+    TSC *entry = typeSizeCacheEntry(*datatype);
+    if (entry->valid && entry->type == *datatype) {
+      entry->valid = false;
+    }
+    _wrap_py_return_val = PMPI_Type_free(datatype);
+  }
+  return _wrap_py_return_val;
+}
+
+/* =============== Fortran Wrappers for MPI_Type_free =============== */
+static void MPI_Type_free_fortran_wrapper(MPI_Fint *datatype, MPI_Fint *ierr) {
+  int _wrap_py_return_val = 0;
+#if (!defined(MPICH_HAS_C2F) && defined(MPICH_NAME) &&                         \
+     (MPICH_NAME == 1)) /* MPICH test */
+  _wrap_py_return_val = MPI_Type_free((MPI_Datatype *)datatype);
+#else  /* MPI-2 safe call */
+  MPI_Datatype temp_datatype;
+  temp_datatype = MPI_Type_f2c(*datatype);
+  _wrap_py_return_val = MPI_Type_free(&temp_datatype);
+  *datatype = MPI_Type_c2f(temp_datatype);
+#endif /* MPICH test */
+  *ierr = _wrap_py_return_val;
+}
+
+_EXTERN_C_ void MPI_TYPE_FREE(MPI_Fint *datatype, MPI_Fint *ierr) {
+  MPI_Type_free_fortran_wrapper(datatype, ierr);
+}
+
+_EXTERN_C_ void mpi_type_free(MPI_Fint *datatype, MPI_Fint *ierr) {
+  MPI_Type_free_fortran_wrapper(datatype, ierr);
+}
+
+_EXTERN_C_ void mpi_type_free_(MPI_Fint *datatype, MPI_Fint *ierr) {
+  MPI_Type_free_fortran_wrapper(datatype, ierr);
+}
+
+_EXTERN_C_ void mpi_type_free__(MPI_Fint *datatype, MPI_Fint *ierr) {
+  MPI_Type_free_fortran_wrapper(datatype, ierr);
+}
+
+/* ================= End Wrappers for MPI_Type_free ================= */
+
 
 /* ================== C Wrappers for MPI_Finalize ================== */
 _EXTERN_C_ int PMPI_Finalize();
@@ -1451,9 +4603,13 @@ _EXTERN_C_ int MPI_Finalize() {
   int _wrap_py_return_val = 0;
   {
     mpi_finalize_flag = true;
-    writeCollMpiInfoLog();
-    writeP2PMpiInfoLog();
-    writeTraceLog();
+    flushCollMpiInfoLog();
+    flushP2PMpiInfoLog();
+    flushTraceLog();
+    stopTraceWriter();
+    string selfStatsFileName =
+        string("dynamic_data/MPIS") + to_string(mpi_rank) + string(".TXT");
+    baguatool::core::DumpSelfStats(selfStatsFileName.c_str());
 #ifdef DEBUG
     printf("%s\n", "MPI_Finalize");
 #endif
@@ -23,7 +23,17 @@
 #include <libunwind.h>
 #include <chrono>
 #include <map>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include "baguatool.h"
 #include "dbg.h"
+#include "mpi_info_format.h"
 #include "mpi_init.h"
 
 using namespace std;
@@ -32,13 +42,20 @@ using namespace std;
 #define MODULE_INITED 1
 #define LOG_SIZE 10000
 #define MAX_STACK_DEPTH 100
-#define MAX_CALL_PATH_LEN 1300 // MAX_STACK_DEPTH * 13
 #define MAX_NAME_LEN 20
 #define MAX_ARGS_LEN 20
-#define MAX_COMM_WORLD_SIZE 100000
 #define MAX_WAIT_REQ 100
-#define MAX_TRACE_SIZE 25000000
+#define MAX_TRACE_SIZE 12500000 // of each of the two trace log buffers
 #define TRACE_LOG_LINE_SIZE 100
+#define P2P_TABLE_BITS 15 // P2P_TABLE_SIZE is at least twice LOG_SIZE
+#define P2P_TABLE_SIZE (1 << P2P_TABLE_BITS)
+#define COLL_TABLE_BITS 15 // COLL_TABLE_SIZE is at least twice LOG_SIZE
+#define COLL_TABLE_SIZE (1 << COLL_TABLE_BITS)
+#define TYPE_SIZE_CACHE_BITS 8
+#define TYPE_SIZE_CACHE_SIZE (1 << TYPE_SIZE_CACHE_BITS)
+#define WRITE_BUFFER_SIZE (1 << 20) // staging buffer of a log file
+#define WRITE_BUFFER_ALIGN 4096
+#define MAX_TEXT_FIELD_LEN 64
 #define MY_BT
 
 // #define DEBUG
@@ -50,23 +67,70 @@ using namespace std;
 #endif
 
 typedef struct CollInfoStruct{
-	char call_path[MAX_CALL_PATH_LEN] = {0};
-	MPI_Comm comm;
+	char type = 0;  // 'c': blocking | 'C': non-blocking
+	int op = 0;  // COLL_OP_*
+	unsigned long long int key = 0;  // hash of all the fields below but count, bytes and exe_time
+	unsigned long long int call_path_hash = 0;
+	unw_word_t call_path[MAX_STACK_DEPTH] = {0};
+	int call_path_len = 0;
+	int comm_id = 0;
+	// Size and world ranks of comm_info_table[comm_id], kept in the record for
+	// the writer thread
+	int comm_size = 0;
+	const int *world_ranks = NULL;
+	int root = -1;  // world rank of the root of rooted collectives
 	unsigned long long int count = 0;
+	unsigned long long int bytes = 0;
 	double exe_time = 0.0;
 }CIS;
 
+typedef struct CommInfoStruct{
+	int size = 0;
+	int *world_ranks = nullptr;  // world rank of each rank of the communicator
+}CMI;
+
+typedef struct TypeSizeStruct{
+	MPI_Datatype type;
+	int size = 0;
+	bool valid = false;
+}TSC;
+
 typedef struct P2PInfoStruct{
 	char type = 0;  // 'r' 's' :blocking recv/send  | 'R' 'S': non-blocking recv/send
-	char call_path[MAX_CALL_PATH_LEN] = {0};
+	unsigned long long int key = 0;  // hash of all the fields below but count, bytes and exe_time
+	unsigned long long int call_path_hash = 0;
+	unw_word_t call_path[MAX_STACK_DEPTH] = {0};
+	int call_path_len = 0;
 	int request_count = 0;
 	int source[MAX_WAIT_REQ] = {0};
 	int dest[MAX_WAIT_REQ] = {0};
 	int tag[MAX_WAIT_REQ] = {0};
 	unsigned long long int count = 0;
+	unsigned long long int bytes = 0; // bytes of the buffers, 0 for waits
 	double exe_time = 0.0;
 }PIS;
 
+// Back buffer of a double buffered log. The full front buffer is handed to the
+// writer thread by swapping it with the back one, which must be written before
+// the next swap.
+typedef struct LogBufferStruct{
+	void *data = nullptr;  // back buffer
+	unsigned long long int count = 0;  // entries of the back buffer
+	volatile int pending = 0;  // back buffer is waiting to be written
+}LBS;
+
+// Writer thread of the logs, so that an MPI call filling a log swaps buffers
+// instead of writing files and stalling the peers waiting for this rank
+typedef struct TraceWriterStruct{
+	LBS coll_log;  // of coll_mpi_info_log
+	LBS p2p_log;  // of p2p_mpi_info_log
+	LBS trace_log;  // of trace_log
+	volatile int stop = 0;  // writer thread should exit
+	sem_t sem;  // posted on swap and stop
+	pthread_t thread;
+	bool started = false;  // logs are written in place otherwise
+}TWS;
+
 struct RequestConverter {
     char data[sizeof(MPI_Request)];
     RequestConverter(MPI_Request * mpi_request) {
@@ -91,15 +155,30 @@ struct RequestConverter {
 };
 
 
-static CIS coll_mpi_info_log[LOG_SIZE];
-static PIS p2p_mpi_info_log[LOG_SIZE];
+static CIS coll_mpi_info_logs[2][LOG_SIZE];
+static PIS p2p_mpi_info_logs[2][LOG_SIZE];
+// Front buffers filled by MPI calls, the other ones are back buffers
+static CIS *coll_mpi_info_log = coll_mpi_info_logs[0];
+static PIS *p2p_mpi_info_log = p2p_mpi_info_logs[0];
 static unsigned long long int coll_mpi_info_log_pointer = 0;
 static unsigned long long int p2p_mpi_info_log_pointer = 0;
-static unsigned int trace_log[MAX_TRACE_SIZE] = {0};
+// Open addressing table of indices of p2p_mpi_info_log plus 1, 0 if empty
+static unsigned int p2p_mpi_info_table[P2P_TABLE_SIZE] = {0};
+// Open addressing table of indices of coll_mpi_info_log plus 1, 0 if empty
+static unsigned int coll_mpi_info_table[COLL_TABLE_SIZE] = {0};
+// Communicators seen by collectives, indexed by their ids
+static vector<CMI> comm_info_table;
+static int comm_info_keyval = MPI_KEYVAL_INVALID;
+// Direct mapped cache of sizes of datatypes
+static TSC type_size_cache[TYPE_SIZE_CACHE_SIZE];
+static unsigned int trace_logs[2][MAX_TRACE_SIZE] = {{0}};
+static unsigned int *trace_log = trace_logs[0];
 static unsigned long long int trace_log_pointer = 0;
+static TWS trace_writer;
 
 map <RequestConverter, pair<int,int>> request_converter;
 map <RequestConverter, pair<int,int>> recv_init_request_converter; /* <src, tag> */
+map <RequestConverter, unsigned long long> recv_init_request_bytes; /* bytes of the receive buffer */
 
 static int module_init = 0;
 // static char* addr_threshold;
@@ -107,106 +186,381 @@ bool mpi_finalize_flag = false;
 
 // int mpi_rank = -1;
 
+// Unwind in the mode of the samplers, so that SAMPLER_UNWIND=fp or cached also
+// spares unw_step on every frame of deep stacks at each MPI call
 int my_backtrace(unw_word_t *buffer, int max_depth) {
-  unw_cursor_t cursor;
-  unw_context_t context;
-
-  // Initialize cursor to current frame for local unwinding.
-  unw_getcontext(&context);
-  unw_init_local(&cursor, &context);
-
-  // Unwind frames one by one, going up the frame stack.
-  int depth = 0;
-  while (unw_step(&cursor) > 0 && depth < max_depth) {
-    unw_word_t pc;
-    unw_get_reg(&cursor, UNW_REG_IP, &pc);
-    if (pc == 0) {
-      break;
-    }
-    buffer[depth] = pc;
-    depth++;
+  baguatool::type::addr_t pcs[MAX_STACK_DEPTH];
+  int depth = baguatool::collector::Backtrace(pcs, max_depth);
+  for (int i = 0; i < depth; i++) {
+    buffer[i] = pcs[i];
   }
   return depth;
 }
 
-// Dump mpi info log
-static void writeCollMpiInfoLog(){
-	ofstream outputStream((string("dynamic_data/MPID") + to_string(mpi_rank) + string(".TXT")), ios_base::app);
-	if (!outputStream.good()) {
+// Staging buffer of a log file, written out in large chunks from page aligned
+// memory instead of value by value
+typedef struct WriteBufferStruct {
+	int fd = -1;                           //
+	char *data = nullptr;                  // WRITE_BUFFER_SIZE bytes
+	size_t size = 0;                       // bytes buffered
+	unsigned long long int byte_count = 0; // bytes written to the file
+	unsigned long long int start_time = 0; // self stat time at open
+} WBS;
+
+static bool openWriteBuffer(WBS &buffer, const string &file_name) {
+	buffer.start_time = baguatool::core::GetSelfStatTime();
+	buffer.fd = open(file_name.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+	if (buffer.fd < 0) {
 		cout << "Failed to open sample file\n";
-		return;
+		return false;
+	}
+	if (posix_memalign((void **)&buffer.data, WRITE_BUFFER_ALIGN,
+										 WRITE_BUFFER_SIZE) != 0) {
+		cout << "Failed to allocate write buffer\n";
+		close(buffer.fd);
+		buffer.fd = -1;
+		buffer.data = nullptr;
+		return false;
 	}
+	buffer.size = 0;
+	buffer.byte_count = 0;
+	return true;
+}
 
-	int comm_size = 0;
-	MPI_Group group1, group2;
-	MPI_Comm_group(MPI_COMM_WORLD, &group1);
-	MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
-	int ranks1[MAX_COMM_WORLD_SIZE] = {0};
-	int ranks2[MAX_COMM_WORLD_SIZE] = {0};
-	for (int i = 0; i < comm_size; i++) {
-		ranks1[i] = i;
+static void flushWriteBuffer(WBS &buffer) {
+	size_t offset = 0;
+	while (offset < buffer.size) {
+		ssize_t written =
+				write(buffer.fd, buffer.data + offset, buffer.size - offset);
+		if (written < 0 && errno == EINTR) {
+			continue;
+		}
+		if (written <= 0) {
+			cout << "Failed to write sample file\n";
+			break;
+		}
+		offset += written;
 	}
+	buffer.byte_count += offset;
+	buffer.size = 0;
+}
 
+// Write out the rest and account the time and bytes of the write of a log to
+// the self statistics
+static void closeWriteBuffer(WBS &buffer) {
+	flushWriteBuffer(buffer);
+	close(buffer.fd);
+	free(buffer.data);
+	buffer.fd = -1;
+	buffer.data = nullptr;
+	baguatool::core::AddSelfStat(baguatool::core::STAT_BYTES_WRITTEN,
+															 buffer.byte_count);
+	baguatool::core::AddSelfStat(baguatool::core::STAT_DUMP_TIME,
+															 baguatool::core::GetSelfStatTime() -
+																	 buffer.start_time);
+}
 
-	// TODO: output different comm
-	for (int i = 0; i < coll_mpi_info_log_pointer; i++){
-		MPI_Comm_group(coll_mpi_info_log[i].comm, &group2);
-		MPI_Group_translate_ranks(group1, comm_size, ranks1, group2, ranks2);
-		outputStream << "c ";
-		outputStream << coll_mpi_info_log[i].call_path << " | " ;
-		for (int j = 0; j < comm_size; j++){
-			outputStream << ranks2[j] << " ";
+static void bufferWrite(WBS &buffer, const void *data, size_t size) {
+	const char *bytes = (const char *)data;
+	while (size > 0) {
+		size_t n = min(size, (size_t)WRITE_BUFFER_SIZE - buffer.size);
+		memcpy(buffer.data + buffer.size, bytes, n);
+		buffer.size += n;
+		bytes += n;
+		size -= n;
+		if (buffer.size == WRITE_BUFFER_SIZE) {
+			flushWriteBuffer(buffer);
 		}
-		outputStream << " | " << coll_mpi_info_log[i].count ;
-		outputStream << " | " << coll_mpi_info_log[i].exe_time << '\n';
 	}
+}
 
-	coll_mpi_info_log_pointer = 0;
+// Formatted text of at most MAX_TEXT_FIELD_LEN bytes, a field of a record
+static void bufferPrintf(WBS &buffer, const char *format, ...) {
+	if (WRITE_BUFFER_SIZE - buffer.size < MAX_TEXT_FIELD_LEN) {
+		flushWriteBuffer(buffer);
+	}
+	va_list args;
+	va_start(args, format);
+	int n = vsnprintf(buffer.data + buffer.size, MAX_TEXT_FIELD_LEN, format,
+										args);
+	va_end(args);
+	if (n > 0) {
+		buffer.size += min(n, MAX_TEXT_FIELD_LEN - 1);
+	}
+}
 
-	outputStream.close();
+// Decimal digits of a value followed by a separator, as printf does
+static inline void bufferUInt(WBS &buffer, unsigned int value,
+															char separator) {
+	char digits[16];
+	int n = sizeof(digits);
+	digits[--n] = separator;
+	do {
+		digits[--n] = '0' + value % 10;
+		value /= 10;
+	} while (value != 0);
+	bufferWrite(buffer, digits + n, sizeof(digits) - n);
 }
 
-static void writeP2PMpiInfoLog(){
-	ofstream outputStream((string("dynamic_data/MPID") + to_string(mpi_rank) + string(".TXT")), ios_base::app);
-	if (!outputStream.good()) {
-		cout << "Failed to open sample file\n";
+static bool mpiInfoTextFromEnv() {
+	const char *format = getenv("PERF_DATA_FORMAT");
+	return format != NULL && strcmp(format, "text") == 0;
+}
+
+// MPI info logs are binary unless PERF_DATA_FORMAT is "text", as PerfData
+static bool mpi_info_text_format = mpiInfoTextFromEnv();
+
+static_assert(sizeof(unw_word_t) == sizeof(uint64_t),
+							"call paths are written as 64-bit addresses");
+
+// Open the mpi info log of this rank for appending, and write the file header
+// of the binary format if the file is new
+static bool openMpiInfoLog(WBS &buffer) {
+	if (!openWriteBuffer(buffer, string("dynamic_data/MPID") +
+																	 to_string(mpi_rank) + string(".TXT"))) {
+		return false;
+	}
+	if (lseek(buffer.fd, 0, SEEK_END) == 0 && !mpi_info_text_format) {
+		MIFH header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, MPI_INFO_MAGIC, MPI_INFO_MAGIC_LEN);
+		header.version = MPI_INFO_VERSION;
+		bufferWrite(buffer, &header, sizeof(header));
+	}
+	return true;
+}
+
+static void writeMpiInfoRecord(WBS &buffer, MIRH &record,
+															 const unw_word_t *call_path, const int *info) {
+	bufferWrite(buffer, &record, sizeof(record));
+	bufferWrite(buffer, call_path, record.call_path_len * sizeof(unw_word_t));
+	bufferWrite(buffer, info, record.info_len * sizeof(int));
+}
+
+static void writeCallPathText(WBS &buffer, const unw_word_t *call_path,
+															int call_path_len) {
+	for (int i = 0; i < call_path_len; i++) {
+		bufferPrintf(buffer, "%llx ", (unsigned long long)call_path[i]);
+	}
+}
+
+// Dump mpi info log
+static void writeCollMpiInfoLog(const CIS *log, unsigned long long count) {
+	WBS buffer;
+	if (!openMpiInfoLog(buffer)) {
 		return;
 	}
 
-	// TODO: output different comm
-	for (int i = 0; i < p2p_mpi_info_log_pointer; i++){
-		outputStream << p2p_mpi_info_log[i].type << " " ;
-		outputStream << p2p_mpi_info_log[i].call_path << " | " ;
-		int request_count = p2p_mpi_info_log[i].request_count;
-		for (int j = 0; j < request_count; j++){
-			outputStream << p2p_mpi_info_log[i].source[j] << " " << p2p_mpi_info_log[i].dest[j] << " " << p2p_mpi_info_log[i].tag[j] << " , ";
+	// Communicators are written as the world ranks of their ranks, translated
+	// once when a communicator is first seen
+	for (unsigned long long i = 0; i < count; i++) {
+		const CIS *info = &log[i];
+		if (!mpi_info_text_format) {
+			MIRH record;
+			memset(&record, 0, sizeof(record));
+			record.type = info->type;
+			record.call_path_len = info->call_path_len;
+			record.info_len = info->comm_size;
+			record.comm_id = info->comm_id;
+			record.count = info->count;
+			record.exe_time = info->exe_time;
+			record.bytes = info->bytes;
+			record.op = info->op;
+			record.root = info->root;
+			writeMpiInfoRecord(buffer, record, info->call_path, info->world_ranks);
+			continue;
 		}
-		outputStream << " | " << p2p_mpi_info_log[i].count ;
-		outputStream << " | " << p2p_mpi_info_log[i].exe_time << '\n';
+		bufferPrintf(buffer, "%c ", info->type);
+		writeCallPathText(buffer, info->call_path, info->call_path_len);
+		bufferPrintf(buffer, " | %d %d %d : ", info->op, info->comm_id,
+								 info->root);
+		for (int j = 0; j < info->comm_size; j++) {
+			bufferPrintf(buffer, "%d ", info->world_ranks[j]);
+		}
+		bufferPrintf(buffer, " | %llu", info->count);
+		bufferPrintf(buffer, " | %g", info->exe_time);
+		bufferPrintf(buffer, " | %llu\n", info->bytes);
 	}
 
-	p2p_mpi_info_log_pointer = 0;
+	closeWriteBuffer(buffer);
+}
 
-	outputStream.close();
+static void writeP2PMpiInfoLog(const PIS *log, unsigned long long count) {
+	WBS buffer;
+	if (!openMpiInfoLog(buffer)) {
+		return;
+	}
+
+	// TODO: output different comm
+	int requests[MAX_WAIT_REQ * 3] = {0};
+	for (unsigned long long i = 0; i < count; i++) {
+		const PIS *info = &log[i];
+		int request_count = info->request_count;
+		if (!mpi_info_text_format) {
+			for (int j = 0; j < request_count; j++) {
+				requests[j * 3] = info->source[j];
+				requests[j * 3 + 1] = info->dest[j];
+				requests[j * 3 + 2] = info->tag[j];
+			}
+			MIRH record;
+			memset(&record, 0, sizeof(record));
+			record.type = info->type;
+			record.call_path_len = info->call_path_len;
+			record.info_len = request_count * 3;
+			record.count = info->count;
+			record.exe_time = info->exe_time;
+			record.bytes = info->bytes;
+			record.root = -1;
+			writeMpiInfoRecord(buffer, record, info->call_path, requests);
+			continue;
+		}
+		bufferPrintf(buffer, "%c ", info->type);
+		writeCallPathText(buffer, info->call_path, info->call_path_len);
+		bufferPrintf(buffer, " | ");
+		for (int j = 0; j < request_count; j++) {
+			bufferPrintf(buffer, "%d %d %d , ", info->source[j], info->dest[j],
+									 info->tag[j]);
+		}
+		bufferPrintf(buffer, " | %llu", info->count);
+		bufferPrintf(buffer, " | %g", info->exe_time);
+		bufferPrintf(buffer, " | %llu\n", info->bytes);
+	}
+
+	closeWriteBuffer(buffer);
 }
 
-static void writeTraceLog(){
-	ofstream outputStream((string("dynamic_data/MPIT") + to_string(mpi_rank) + string(".TXT")), ios_base::app);
-	if (!outputStream.good()) {
-		cout << "Failed to open sample file\n";
+static void writeTraceLog(const unsigned int *log, unsigned long long count) {
+	WBS buffer;
+	if (!openWriteBuffer(buffer, string("dynamic_data/MPIT") +
+																	 to_string(mpi_rank) + string(".TXT"))) {
 		return;
 	}
 
-	for (int i = 0; i < trace_log_pointer; i+= TRACE_LOG_LINE_SIZE){
-		for (int j = i; j < i + TRACE_LOG_LINE_SIZE && j < trace_log_pointer; j++ ){
-			outputStream << trace_log[j] << " " ;
+	for (unsigned long long i = 0; i < count; i += TRACE_LOG_LINE_SIZE) {
+		for (unsigned long long j = i; j < i + TRACE_LOG_LINE_SIZE && j < count;
+				 j++) {
+			bufferUInt(buffer, log[j], ' ');
 		}
-		outputStream << '\n';
+		bufferWrite(buffer, "\n", 1);
 	}
 
-	trace_log_pointer = 0;
+	closeWriteBuffer(buffer);
+}
+
+static void *traceWriterThread(void *arg) {
+	TWS *writer = (TWS *)arg;
+
+	while (true) {
+		while (sem_wait(&(writer->sem)) != 0) {
+		}
+		// Buffers swapped before stop are seen pending once stop is seen
+		int stop = writer->stop;
+		__sync_synchronize();
+		if (writer->coll_log.pending) {
+			writeCollMpiInfoLog((const CIS *)writer->coll_log.data,
+													writer->coll_log.count);
+			__sync_lock_release(&(writer->coll_log.pending));
+		}
+		if (writer->p2p_log.pending) {
+			writeP2PMpiInfoLog((const PIS *)writer->p2p_log.data,
+												 writer->p2p_log.count);
+			__sync_lock_release(&(writer->p2p_log.pending));
+		}
+		if (writer->trace_log.pending) {
+			writeTraceLog((const unsigned int *)writer->trace_log.data,
+										writer->trace_log.count);
+			__sync_lock_release(&(writer->trace_log.pending));
+		}
+		if (stop) {
+			break;
+		}
+	}
+	return nullptr;
+}
+
+// Logs are written by the writer thread from MPI_Init, or in place by the MPI
+// call filling them if it fails to start
+static void startTraceWriter() {
+	if (trace_writer.started) {
+		return;
+	}
+	trace_writer.coll_log.data = coll_mpi_info_logs[1];
+	trace_writer.p2p_log.data = p2p_mpi_info_logs[1];
+	trace_writer.trace_log.data = trace_logs[1];
+	sem_init(&(trace_writer.sem), 0, 0);
+	if (pthread_create(&(trace_writer.thread), nullptr, traceWriterThread,
+										 &trace_writer) != 0) {
+		cout << "Failed to create writer thread, logs are written in place\n";
+		sem_destroy(&(trace_writer.sem));
+		return;
+	}
+	trace_writer.started = true;
+}
+
+// The writer thread exits after writing the pending back buffers
+static void stopTraceWriter() {
+	if (!trace_writer.started) {
+		return;
+	}
+	trace_writer.started = false;
+	__sync_synchronize();
+	trace_writer.stop = 1;
+	sem_post(&(trace_writer.sem));
+	pthread_join(trace_writer.thread, nullptr);
+	sem_destroy(&(trace_writer.sem));
+}
+
+// Hand a full front buffer of a log to the writer thread, and get the back
+// buffer to fill next
+static void *swapLogBuffer(LBS *log_buffer, void *front,
+													 unsigned long long count) {
+	while (log_buffer->pending) {
+		sched_yield();
+	}
+	// Do not touch the back buffer before the writer thread is done with it
+	__sync_synchronize();
+	void *back = log_buffer->data;
+	log_buffer->data = front;
+	log_buffer->count = count;
+	// Publish the buffer only after it is set, test-and-set is just an acquire
+	// barrier
+	__sync_synchronize();
+	log_buffer->pending = 1;
+	sem_post(&(trace_writer.sem));
+	return back;
+}
+
+// Write out a log, through the writer thread if any, and start it over
+static void flushCollMpiInfoLog() {
+	if (trace_writer.started) {
+		coll_mpi_info_log = (CIS *)swapLogBuffer(
+				&(trace_writer.coll_log), coll_mpi_info_log, coll_mpi_info_log_pointer);
+	} else {
+		writeCollMpiInfoLog(coll_mpi_info_log, coll_mpi_info_log_pointer);
+	}
+	coll_mpi_info_log_pointer = 0;
+	memset(coll_mpi_info_table, 0, sizeof(coll_mpi_info_table));
+}
+
+static void flushP2PMpiInfoLog() {
+	if (trace_writer.started) {
+		p2p_mpi_info_log = (PIS *)swapLogBuffer(
+				&(trace_writer.p2p_log), p2p_mpi_info_log, p2p_mpi_info_log_pointer);
+	} else {
+		writeP2PMpiInfoLog(p2p_mpi_info_log, p2p_mpi_info_log_pointer);
+	}
+	p2p_mpi_info_log_pointer = 0;
+	memset(p2p_mpi_info_table, 0, sizeof(p2p_mpi_info_table));
+}
 
-	outputStream.close();
+static void flushTraceLog() {
+	if (trace_writer.started) {
+		trace_log = (unsigned int *)swapLogBuffer(&(trace_writer.trace_log),
+																							trace_log, trace_log_pointer);
+	} else {
+		writeTraceLog(trace_log, trace_log_pointer);
+	}
+	trace_log_pointer = 0;
 }
 
 // static void init() __attribute__((constructor));
@@ -228,155 +582,303 @@ static void writeTraceLog(){
 // }
 
 
-// Record mpi info to log
+// Mix a value into a hash, the high bits of which index tables
+static inline unsigned long long hashCombine(unsigned long long hash, unsigned long long value){
+	return (hash ^ value) * 0x9e3779b97f4a7c15ULL;
+}
 
-void TRACE_COLL(MPI_Comm comm, double exe_time){
-	/**
-  #ifdef MY_BT
-    unw_word_t buffer[MAX_STACK_DEPTH] = {0};
-  #else
-    void* buffer[MAX_STACK_DEPTH];
-    memset(buffer, 0, sizeof(buffer));
-  #endif
-    unsigned int i, depth = 0;
-    // memset(buffer, 0, sizeof(buffer));
-  #ifdef MY_BT
-    depth = my_backtrace(buffer, MAX_STACK_DEPTH);
-  #else
-    depth = unw_backtrace(buffer, MAX_STACK_DEPTH);
-  #endif
-  char call_path[MAX_CALL_PATH_LEN] = {0};
-	int offset = 0;
-
-  for (i = 0; i < depth; ++ i)
-	{
-		if( (void*)buffer[i] != NULL && (char*)buffer[i] < addr_threshold ){ 
-			offset+=snprintf(call_path+offset, MAX_CALL_PATH_LEN - offset - 4 ,"%lx ",(void*)(buffer[i]-2));
+// Whether a p2p record has the same peers and tags
+static inline bool sameRequests(PIS *info, int request_count, int *source, int *dest, int *tag){
+	if (info->request_count != request_count) {
+		return false;
+	}
+	for (int j = 0; j < request_count; j++){
+		if (info->source[j] != source[j] || info->dest[j] != dest[j] || info->tag[j] != tag[j]) {
+			return false;
 		}
 	}
+	return true;
+}
 
-	bool hasRecordFlag = false;
-
-	for (i = 0; i < coll_mpi_info_log_pointer; i++){
-		if (strcmp(call_path, coll_mpi_info_log[i].call_path) == 0 ){
-			int cmp_result;
-			MPI_Comm_compare(comm, coll_mpi_info_log[i].comm, &cmp_result);
-			if (cmp_result == MPI_CONGRUENT) {
-				coll_mpi_info_log[i].count ++;
-				coll_mpi_info_log[i].exe_time += exe_time;
-				trace_log[trace_log_pointer ++ ] = i * 2;
-				hasRecordFlag = true;
-				break;
-			}
-		}
+// Id of a communicator in comm_info_table, where the world ranks of its ranks
+// are translated once. The id is cached as an attribute of the communicator,
+// which MPI_Comm_dup does not copy and MPI_Comm_free deletes, so that a
+// reused handle gets a new id.
+static int commId(MPI_Comm comm) {
+	if (comm_info_keyval == MPI_KEYVAL_INVALID) {
+		PMPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, MPI_COMM_NULL_DELETE_FN,
+														&comm_info_keyval, NULL);
+	}
+	void *attr = NULL;
+	int flag = 0;
+	PMPI_Comm_get_attr(comm, comm_info_keyval, &attr, &flag);
+	if (flag) {
+		return (int)(intptr_t)attr;
 	}
 
-	if(hasRecordFlag == false){
-		if(strlen(call_path) >= MAX_CALL_PATH_LEN){
-			//LOG_WARN("Call path string length (%d) is longer than %d", strlen(call_path),MAX_CALL_PATH_LEN);
-		}else{
-			strcpy(coll_mpi_info_log[coll_mpi_info_log_pointer].call_path, call_path);
-  		MPI_Comm_dup(comm, &coll_mpi_info_log[coll_mpi_info_log_pointer].comm);
-			coll_mpi_info_log[coll_mpi_info_log_pointer].count = 1;
-			coll_mpi_info_log[coll_mpi_info_log_pointer].exe_time = exe_time;
-			trace_log[trace_log_pointer ++ ] = coll_mpi_info_log_pointer * 2;
-			coll_mpi_info_log_pointer++;
-		}
+	CMI comm_info;
+	MPI_Group group, world_group;
+	PMPI_Comm_group(comm, &group);
+	PMPI_Comm_group(MPI_COMM_WORLD, &world_group);
+	PMPI_Group_size(group, &comm_info.size);
+	int *ranks = (int *)malloc(comm_info.size * sizeof(int));
+	comm_info.world_ranks = (int *)malloc(comm_info.size * sizeof(int));
+	for (int i = 0; i < comm_info.size; i++) {
+		ranks[i] = i;
 	}
+	PMPI_Group_translate_ranks(group, comm_info.size, ranks, world_group,
+														 comm_info.world_ranks);
+	free(ranks);
+	PMPI_Group_free(&group);
+	PMPI_Group_free(&world_group);
+
+	int id = comm_info_table.size();
+	comm_info_table.push_back(comm_info);
+	PMPI_Comm_set_attr(comm, comm_info_keyval, (void *)(intptr_t)id);
+	return id;
+}
 
-    if(coll_mpi_info_log_pointer >= LOG_SIZE-5){
-		writeCollMpiInfoLog();
+// World rank of a rank of a communicator, ranks out of it such as
+// MPI_ANY_SOURCE are kept
+static inline int worldRank(int comm_id, int rank) {
+	CMI *comm_info = &comm_info_table[comm_id];
+	if (rank < 0 || rank >= comm_info->size) {
+		return rank;
 	}
-	if(trace_log_pointer >= MAX_TRACE_SIZE - 5){
-		writeTraceLog();
+	return comm_info->world_ranks[rank];
+}
+
+static inline int commSize(MPI_Comm comm) {
+	return comm_info_table[commId(comm)].size;
+}
+
+static inline TSC *typeSizeCacheEntry(MPI_Datatype type) {
+	unsigned long long handle = 0;
+	memcpy(&handle, &type,
+				 sizeof(type) < sizeof(handle) ? sizeof(type) : sizeof(handle));
+	return &type_size_cache[hashCombine(0, handle) >>
+													(64 - TYPE_SIZE_CACHE_BITS)];
+}
+
+// Size of a datatype, cached until MPI_Type_free of the datatype
+static int typeSize(MPI_Datatype type) {
+	TSC *entry = typeSizeCacheEntry(type);
+	if (!entry->valid || entry->type != type) {
+		int size = 0;
+		PMPI_Type_size(type, &size);
+		entry->type = type;
+		entry->size = size;
+		entry->valid = true;
 	}
-	**/
+	return entry->size;
 }
 
-#ifdef ENABLE_SUBCOMMUNICATOR
-void TRANSLATE_RANK(MPI_Comm comm, int rank, int* crank)
-{
-  MPI_Group group1, group2;
-  PMPI_Comm_group(comm, &group1);
-  PMPI_Comm_group(MPI_COMM_WORLD, &group2);
-  PMPI_Group_translate_ranks(group1, 1, &rank, group2, crank);
+static inline int commRank(MPI_Comm comm) {
+	int rank = 0;
+	PMPI_Comm_rank(comm, &rank);
+	return rank;
 }
-#else
-void TRANSLATE_RANK(MPI_Comm comm, int rank, int* crank)
-{
-	*crank = rank;
+
+static inline unsigned long long dataBytes(unsigned long long count,
+																					 MPI_Datatype type) {
+	return count * typeSize(type);
 }
-#endif
 
-void TRACE_P2P(char type, int request_count, int *source, int *dest, int *tag, double exe_time){
+// Bytes a rank sends in a collective, or receives if it sends in place
+static inline unsigned long long sendBytes(const void *sendbuf,
+																					 unsigned long long sendcount,
+																					 MPI_Datatype sendtype,
+																					 unsigned long long recvcount,
+																					 MPI_Datatype recvtype) {
+	if (sendbuf == MPI_IN_PLACE) {
+		return dataBytes(recvcount, recvtype);
+	}
+	return dataBytes(sendcount, sendtype);
+}
+
+static inline unsigned long long sumCounts(const int *counts, int n) {
+	unsigned long long sum = 0;
+	for (int i = 0; i < n; i++) {
+		sum += counts[i];
+	}
+	return sum;
+}
+
+// Call path of an MPI call in the program, return its length
+static int tracedCallPath(unw_word_t *call_path,
+													unsigned long long *call_path_hash) {
 #ifdef MY_BT
-  unw_word_t buffer[MAX_STACK_DEPTH] = {0};
+	unw_word_t buffer[MAX_STACK_DEPTH] = {0};
 #else
-  void *buffer[MAX_STACK_DEPTH];
-  memset(buffer, 0, sizeof(buffer));
+	void *buffer[MAX_STACK_DEPTH];
+	memset(buffer, 0, sizeof(buffer));
 #endif
-   unsigned int i, j, depth = 0;
+	unsigned int i, depth = 0;
 #ifdef MY_BT
-  depth = my_backtrace(buffer, MAX_STACK_DEPTH);
+	depth = my_backtrace(buffer, MAX_STACK_DEPTH);
 #else
-   depth = unw_backtrace(buffer, MAX_STACK_DEPTH);
+	depth = unw_backtrace(buffer, MAX_STACK_DEPTH);
 #endif
-  char call_path[MAX_CALL_PATH_LEN] = {0};
-	int offset = 0;
+	int call_path_len = 0;
+	*call_path_hash = 0;
+	for (i = 0; i < depth; ++i) {
+		if ((void *)buffer[i] != NULL && (char *)buffer[i] < addr_threshold) {
+			call_path[call_path_len++] = (unw_word_t)buffer[i] - 2;
+			*call_path_hash =
+					hashCombine(*call_path_hash, (unw_word_t)buffer[i] - 2);
+		}
+	}
+	return call_path_len;
+}
+
+// Record mpi info to log
 
-  for (i = 0; i < depth; ++ i)
-	{
-		if( (void*)buffer[i] != NULL && (char*)buffer[i] < addr_threshold ){ 
-			offset+=snprintf(call_path+offset, MAX_CALL_PATH_LEN - offset - 4 ,"%lx ",(void*)(buffer[i]-2));
+void TRACE_COLL(char type, int op, MPI_Comm comm, int root,
+								unsigned long long bytes, double exe_time) {
+	unsigned long long trace_start = baguatool::core::GetSelfStatTime();
+	unw_word_t call_path_pcs[MAX_STACK_DEPTH];
+	unsigned long long call_path_hash = 0;
+	int call_path_len = tracedCallPath(call_path_pcs, &call_path_hash);
+	unsigned int i;
+
+	int comm_id = commId(comm);
+	int world_root = root >= 0 ? worldRank(comm_id, root) : -1;
+	unsigned long long key =
+			hashCombine(hashCombine(call_path_hash, type), op);
+	key = hashCombine(hashCombine(key, comm_id), (unsigned int)world_root);
+	unsigned long long slot = key >> (64 - COLL_TABLE_BITS);
+	while (coll_mpi_info_table[slot] != 0) {
+		i = coll_mpi_info_table[slot] - 1;
+		CIS *info = &coll_mpi_info_log[i];
+		if (info->key == key && info->type == type && info->op == op &&
+				info->comm_id == comm_id && info->root == world_root &&
+				info->call_path_hash == call_path_hash &&
+				info->call_path_len == call_path_len &&
+				memcmp(info->call_path, call_path_pcs, call_path_len * sizeof(unw_word_t)) == 0) {
+			info->count++;
+			info->bytes += bytes;
+			info->exe_time += exe_time;
+			trace_log[trace_log_pointer++] = i * 2;
+			break;
 		}
+		slot = (slot + 1) & (COLL_TABLE_SIZE - 1);
 	}
 
-	bool hasRecordFlag = false;
+	if (coll_mpi_info_table[slot] == 0) {
+		CIS *info = &coll_mpi_info_log[coll_mpi_info_log_pointer];
+		info->type = type;
+		info->op = op;
+		info->key = key;
+		info->call_path_hash = call_path_hash;
+		memcpy(info->call_path, call_path_pcs, call_path_len * sizeof(unw_word_t));
+		info->call_path_len = call_path_len;
+		info->comm_id = comm_id;
+		info->comm_size = comm_info_table[comm_id].size;
+		info->world_ranks = comm_info_table[comm_id].world_ranks;
+		info->root = world_root;
+		info->count = 1;
+		info->bytes = bytes;
+		info->exe_time = exe_time;
+		trace_log[trace_log_pointer++] = coll_mpi_info_log_pointer * 2;
+		coll_mpi_info_table[slot] = coll_mpi_info_log_pointer + 1;
+		coll_mpi_info_log_pointer++;
+	}
 
-	for (i = 0; i < p2p_mpi_info_log_pointer; i++){
-		if (p2p_mpi_info_log[i].type == type && strcmp(call_path, p2p_mpi_info_log[i].call_path) == 0 ){
-			if (p2p_mpi_info_log[i].request_count == request_count){
-				for (j = 0; j < request_count; j++){
-					if (p2p_mpi_info_log[i].source[j] != source[j] || p2p_mpi_info_log[i].dest[j] != dest[j] || p2p_mpi_info_log[i].tag[j] != tag[j]) {
-						goto k1;
-					}
-				}
-				p2p_mpi_info_log[i].count ++;
-				p2p_mpi_info_log[i].exe_time += exe_time;
-				hasRecordFlag = true;
-				trace_log[trace_log_pointer ++ ] = i * 2 + 1;
-				break;
-k1:
-				continue;
-			}
+	// Memory of the logs filled so far
+	baguatool::core::AddSelfStat(baguatool::core::STAT_PEAK_MEM,
+															 coll_mpi_info_log_pointer * sizeof(CIS) +
+																	 p2p_mpi_info_log_pointer * sizeof(PIS) +
+																	 trace_log_pointer * sizeof(unsigned int));
+
+	if (coll_mpi_info_log_pointer >= LOG_SIZE - 5) {
+		flushCollMpiInfoLog();
+	}
+	if (trace_log_pointer >= MAX_TRACE_SIZE - 5) {
+		flushTraceLog();
+	}
+
+	// Cost of tracing, including hand-offs of full logs
+	unsigned long long trace_time =
+			baguatool::core::GetSelfStatTime() - trace_start;
+	baguatool::core::AddSelfStat(baguatool::core::STAT_TRACED_CALLS, 1);
+	baguatool::core::AddSelfStat(baguatool::core::STAT_TRACE_TIME, trace_time);
+}
+
+#ifdef ENABLE_SUBCOMMUNICATOR
+void TRANSLATE_RANK(MPI_Comm comm, int rank, int *crank) {
+	*crank = worldRank(commId(comm), rank);
+}
+#else
+void TRANSLATE_RANK(MPI_Comm comm, int rank, int *crank) { *crank = rank; }
+#endif
+
+void TRACE_P2P(char type, int request_count, int *source, int *dest, int *tag,
+							 unsigned long long bytes, double exe_time) {
+	unsigned long long trace_start = baguatool::core::GetSelfStatTime();
+	unw_word_t call_path_pcs[MAX_STACK_DEPTH];
+	unsigned long long call_path_hash = 0;
+	int call_path_len = tracedCallPath(call_path_pcs, &call_path_hash);
+	unsigned int i, j;
+
+	// Records are found by a hash of the type, the call path and the peers and
+	// tags, only records of the same hash compare their call paths
+	unsigned long long key = hashCombine(hashCombine(call_path_hash, type), request_count);
+	for (j = 0; j < request_count; j++){
+		key = hashCombine(key, ((unsigned long long)(unsigned int)source[j] << 32) | (unsigned int)dest[j]);
+		key = hashCombine(key, (unsigned int)tag[j]);
+	}
+	unsigned long long slot = key >> (64 - P2P_TABLE_BITS);
+	while (p2p_mpi_info_table[slot] != 0){
+		i = p2p_mpi_info_table[slot] - 1;
+		PIS *info = &p2p_mpi_info_log[i];
+		if (info->key == key && info->type == type && info->call_path_hash == call_path_hash && info->call_path_len == call_path_len && memcmp(info->call_path, call_path_pcs, call_path_len * sizeof(unw_word_t)) == 0 && sameRequests(info, request_count, source, dest, tag)){
+			info->count ++;
+			info->bytes += bytes;
+			info->exe_time += exe_time;
+			trace_log[trace_log_pointer ++ ] = i * 2 + 1;
+			break;
 		}
+		slot = (slot + 1) & (P2P_TABLE_SIZE - 1);
 	}
 
-	if(hasRecordFlag == false){
-		if(strlen(call_path) >= MAX_CALL_PATH_LEN){
-			//LOG_WARN("Call path string length (%d) is longer than %d", strlen(call_path),MAX_CALL_PATH_LEN);
-		}else{
-			p2p_mpi_info_log[p2p_mpi_info_log_pointer].type = type;
-			strcpy(p2p_mpi_info_log[p2p_mpi_info_log_pointer].call_path, call_path);
-			p2p_mpi_info_log[p2p_mpi_info_log_pointer].request_count = request_count;
-			for (i = 0; i < request_count; i++){
-				p2p_mpi_info_log[p2p_mpi_info_log_pointer].source[i] = source[i];
-				p2p_mpi_info_log[p2p_mpi_info_log_pointer].dest[i] = dest[i];
-				p2p_mpi_info_log[p2p_mpi_info_log_pointer].tag[i] = tag[i];
-			}
-			p2p_mpi_info_log[p2p_mpi_info_log_pointer].count = 1;
-			p2p_mpi_info_log[p2p_mpi_info_log_pointer].exe_time = exe_time;
-			trace_log[trace_log_pointer ++ ] = p2p_mpi_info_log_pointer * 2 + 1;
-			p2p_mpi_info_log_pointer++;
+	if(p2p_mpi_info_table[slot] == 0){
+		PIS *info = &p2p_mpi_info_log[p2p_mpi_info_log_pointer];
+		info->type = type;
+		info->key = key;
+		info->call_path_hash = call_path_hash;
+		memcpy(info->call_path, call_path_pcs, call_path_len * sizeof(unw_word_t));
+		info->call_path_len = call_path_len;
+		info->request_count = request_count;
+		for (i = 0; i < request_count; i++){
+			info->source[i] = source[i];
+			info->dest[i] = dest[i];
+			info->tag[i] = tag[i];
 		}
+		info->count = 1;
+		info->bytes = bytes;
+		info->exe_time = exe_time;
+		trace_log[trace_log_pointer ++ ] = p2p_mpi_info_log_pointer * 2 + 1;
+		p2p_mpi_info_table[slot] = p2p_mpi_info_log_pointer + 1;
+		p2p_mpi_info_log_pointer++;
 	}
 
+  // Memory of the logs filled so far
+  baguatool::core::AddSelfStat(baguatool::core::STAT_PEAK_MEM,
+                               coll_mpi_info_log_pointer * sizeof(CIS) +
+                                   p2p_mpi_info_log_pointer * sizeof(PIS) +
+                                   trace_log_pointer * sizeof(unsigned int));
+
   if(p2p_mpi_info_log_pointer >= LOG_SIZE-5){
-		writeP2PMpiInfoLog();
+		flushP2PMpiInfoLog();
 	}
 	if(trace_log_pointer >= MAX_TRACE_SIZE - 5){
-		writeTraceLog();
+		flushTraceLog();
 	}
+
+  // Cost of tracing, including hand-offs of full logs
+  unsigned long long trace_time = baguatool::core::GetSelfStatTime() - trace_start;
+  baguatool::core::AddSelfStat(baguatool::core::STAT_TRACED_CALLS, 1);
+  baguatool::core::AddSelfStat(baguatool::core::STAT_TRACE_TIME, trace_time);
 }
 
 
@@ -386,6 +888,7 @@ k1:
     // First call PMPI_Init()
     {{callfn}}
     PMPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+    startTraceWriter();
 }{{endfn}}
 
 // P2P communication
@@ -413,7 +916,7 @@ k1:
 #ifdef DEBUG
 		printf("%s\n", "{{func}}");
 #endif
-		TRACE_P2P('s', 1, source_list, dest_list, tag_list, time);
+		TRACE_P2P('s', 1, source_list, dest_list, tag_list, dataBytes(count, datatype), time);
 }{{endfn}}
 
 {{fn func MPI_Isend}}{
@@ -441,7 +944,7 @@ k1:
 #ifdef DEBUG
 		printf("%s\n", "{{func}}");
 #endif
-		TRACE_P2P('S', 1, source_list, dest_list, tag_list, time);
+		TRACE_P2P('S', 1, source_list, dest_list, tag_list, dataBytes(count, datatype), time);
 
 }{{endfn}}
 
@@ -469,7 +972,7 @@ k1:
 #ifdef DEBUG
 		printf("%s\n", "{{func}}");
 #endif
-		TRACE_P2P('r', 1, source_list, dest_list, tag_list, time);
+		TRACE_P2P('r', 1, source_list, dest_list, tag_list, dataBytes(count, datatype), time);
 }{{endfn}}
 
 {{fn func MPI_Irecv}}{
@@ -503,7 +1006,7 @@ k1:
 #ifdef DEBUG
 		printf("%s\n", "{{func}}");
 #endif
-		TRACE_P2P('R', 1, source_list, dest_list, tag_list, time);
+		TRACE_P2P('R', 1, source_list, dest_list, tag_list, dataBytes(count, datatype), time);
 }{{endfn}}
 
 {{fn func MPI_Sendrecv}}{
@@ -539,8 +1042,8 @@ k1:
 #ifdef DEBUG
 		printf("%s\n", "{{func}}");
 #endif
-		TRACE_P2P('s', 1, myrank_list, dest_list, send_tag_list, time);
-		TRACE_P2P('r', 1, source_list, myrank_list, recv_tag_list, time);
+		TRACE_P2P('s', 1, myrank_list, dest_list, send_tag_list, dataBytes(sendcount, sendtype), time);
+		TRACE_P2P('r', 1, source_list, myrank_list, recv_tag_list, dataBytes(recvcount, recvtype), time);
 }{{endfn}}
 
 {{fn func MPI_Recv_init}}{
@@ -563,6 +1066,7 @@ k1:
 		}
 #endif
 		recv_init_request_converter[RequestConverter(request)] = pair<int, int>(source, tag);
+		recv_init_request_bytes[RequestConverter(request)] = dataBytes(count, datatype);
 }{{endfn}}
 
 {{fn func MPI_Wait}}{
@@ -602,7 +1106,7 @@ k1:
 #ifdef DEBUG
 		printf("%s\n", "{{func}}");
 #endif
-		TRACE_P2P('w', 1, source_list, dest_list, tag_list, time);
+		TRACE_P2P('w', 1, source_list, dest_list, tag_list, 0, time);
 
 		return ret_val;
 
@@ -656,7 +1160,7 @@ k1:
 			}
 		}
 
-		TRACE_P2P('w', count, source_list, dest_list, tag_list, time);
+		TRACE_P2P('w', count, source_list, dest_list, tag_list, 0, time);
 
 #ifdef DEBUG
 		printf("%s\n", "{{func}}");
@@ -678,6 +1182,7 @@ k1:
 
 		dest_list[0] = mpi_rank;
 		bool valid_flag = false;
+		unsigned long long bytes = 0;
 
 		map<RequestConverter, pair<int, int>> :: iterator iter;
 		iter = recv_init_request_converter.find(RequestConverter(request));
@@ -689,6 +1194,7 @@ k1:
 				source_list[0] = src;
 				tag_list[0] = tag;
 				valid_flag = true;
+				bytes = recv_init_request_bytes[RequestConverter(request)];
 			//}
 			// recv_init_request_converter.erase(RequestConverter(request));
 		}
@@ -712,7 +1218,7 @@ k1:
 #ifdef DEBUG
 		printf("%s\n", "{{func}}");
 #endif
-		TRACE_P2P('R', 1, source_list, dest_list, tag_list, time);
+		TRACE_P2P('R', 1, source_list, dest_list, tag_list, bytes, time);
 
 		return ret_val;
 
@@ -720,25 +1226,486 @@ k1:
 
 
 // collective communication
-// {{fn func MPI_Reduce MPI_Alltoall MPI_Allreduce MPI_Bcast MPI_Scatter MPI_Gather MPI_Allgather}}{
-//    // First call collective communication
-//		auto st = chrono::system_clock::now();
-//    {{callfn}} 
-//		auto ed = chrono::system_clock::now();
-//		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
-//
-//#ifdef DEBUG
-//		printf("%s\n", "{{func}}");
-//#endif
-//		TRACE_COLL(comm, time);
-// }{{endfn}}
+{{fn func MPI_Barrier}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('c', COLL_OP_BARRIER, comm, -1, 0, time);
+}{{endfn}}
+
+{{fn func MPI_Ibarrier}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		// Waits of collective requests have no p2p peers
+		request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('C', COLL_OP_BARRIER, comm, -1, 0, time);
+}{{endfn}}
+
+{{fn func MPI_Bcast}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('c', COLL_OP_BCAST, comm, root, dataBytes(count, datatype), time);
+}{{endfn}}
+
+{{fn func MPI_Ibcast}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		// Waits of collective requests have no p2p peers
+		request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('C', COLL_OP_BCAST, comm, root, dataBytes(count, datatype), time);
+}{{endfn}}
+
+{{fn func MPI_Reduce}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('c', COLL_OP_REDUCE, comm, root, dataBytes(count, datatype), time);
+}{{endfn}}
+
+{{fn func MPI_Ireduce}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		// Waits of collective requests have no p2p peers
+		request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('C', COLL_OP_REDUCE, comm, root, dataBytes(count, datatype), time);
+}{{endfn}}
+
+{{fn func MPI_Allreduce}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('c', COLL_OP_ALLREDUCE, comm, -1, dataBytes(count, datatype), time);
+}{{endfn}}
+
+{{fn func MPI_Iallreduce}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		// Waits of collective requests have no p2p peers
+		request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('C', COLL_OP_ALLREDUCE, comm, -1, dataBytes(count, datatype), time);
+}{{endfn}}
+
+{{fn func MPI_Scatter}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		unsigned long long bytes = 0;
+		if (commRank(comm) == root) {
+			bytes = dataBytes(sendcount, sendtype) * commSize(comm);
+		} else {
+			bytes = dataBytes(recvcount, recvtype);
+		}
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('c', COLL_OP_SCATTER, comm, root, bytes, time);
+}{{endfn}}
+
+{{fn func MPI_Iscatter}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		unsigned long long bytes = 0;
+		if (commRank(comm) == root) {
+			bytes = dataBytes(sendcount, sendtype) * commSize(comm);
+		} else {
+			bytes = dataBytes(recvcount, recvtype);
+		}
+		// Waits of collective requests have no p2p peers
+		request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('C', COLL_OP_SCATTER, comm, root, bytes, time);
+}{{endfn}}
+
+{{fn func MPI_Scatterv}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		unsigned long long bytes = 0;
+		if (commRank(comm) == root) {
+			bytes = dataBytes(sumCounts(sendcounts, commSize(comm)), sendtype);
+		} else {
+			bytes = dataBytes(recvcount, recvtype);
+		}
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('c', COLL_OP_SCATTERV, comm, root, bytes, time);
+}{{endfn}}
+
+{{fn func MPI_Iscatterv}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		unsigned long long bytes = 0;
+		if (commRank(comm) == root) {
+			bytes = dataBytes(sumCounts(sendcounts, commSize(comm)), sendtype);
+		} else {
+			bytes = dataBytes(recvcount, recvtype);
+		}
+		// Waits of collective requests have no p2p peers
+		request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('C', COLL_OP_SCATTERV, comm, root, bytes, time);
+}{{endfn}}
+
+{{fn func MPI_Gather}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		unsigned long long bytes = sendBytes(sendbuf, sendcount, sendtype, recvcount, recvtype);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('c', COLL_OP_GATHER, comm, root, bytes, time);
+}{{endfn}}
+
+{{fn func MPI_Igather}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		unsigned long long bytes = sendBytes(sendbuf, sendcount, sendtype, recvcount, recvtype);
+		// Waits of collective requests have no p2p peers
+		request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('C', COLL_OP_GATHER, comm, root, bytes, time);
+}{{endfn}}
+
+{{fn func MPI_Gatherv}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		unsigned long long bytes = sendbuf == MPI_IN_PLACE ? dataBytes(recvcounts[commRank(comm)], recvtype) : dataBytes(sendcount, sendtype);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('c', COLL_OP_GATHERV, comm, root, bytes, time);
+}{{endfn}}
+
+{{fn func MPI_Igatherv}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		unsigned long long bytes = sendbuf == MPI_IN_PLACE ? dataBytes(recvcounts[commRank(comm)], recvtype) : dataBytes(sendcount, sendtype);
+		// Waits of collective requests have no p2p peers
+		request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('C', COLL_OP_GATHERV, comm, root, bytes, time);
+}{{endfn}}
+
+{{fn func MPI_Allgather}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		unsigned long long bytes = sendBytes(sendbuf, sendcount, sendtype, recvcount, recvtype);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('c', COLL_OP_ALLGATHER, comm, -1, bytes, time);
+}{{endfn}}
+
+{{fn func MPI_Iallgather}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		unsigned long long bytes = sendBytes(sendbuf, sendcount, sendtype, recvcount, recvtype);
+		// Waits of collective requests have no p2p peers
+		request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('C', COLL_OP_ALLGATHER, comm, -1, bytes, time);
+}{{endfn}}
+
+{{fn func MPI_Allgatherv}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		unsigned long long bytes = sendbuf == MPI_IN_PLACE ? dataBytes(recvcounts[commRank(comm)], recvtype) : dataBytes(sendcount, sendtype);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('c', COLL_OP_ALLGATHERV, comm, -1, bytes, time);
+}{{endfn}}
+
+{{fn func MPI_Iallgatherv}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		unsigned long long bytes = sendbuf == MPI_IN_PLACE ? dataBytes(recvcounts[commRank(comm)], recvtype) : dataBytes(sendcount, sendtype);
+		// Waits of collective requests have no p2p peers
+		request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('C', COLL_OP_ALLGATHERV, comm, -1, bytes, time);
+}{{endfn}}
+
+{{fn func MPI_Alltoall}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		unsigned long long bytes = sendBytes(sendbuf, sendcount, sendtype, recvcount, recvtype) * commSize(comm);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('c', COLL_OP_ALLTOALL, comm, -1, bytes, time);
+}{{endfn}}
+
+{{fn func MPI_Ialltoall}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		unsigned long long bytes = sendBytes(sendbuf, sendcount, sendtype, recvcount, recvtype) * commSize(comm);
+		// Waits of collective requests have no p2p peers
+		request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('C', COLL_OP_ALLTOALL, comm, -1, bytes, time);
+}{{endfn}}
+
+{{fn func MPI_Alltoallv}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		int comm_size = commSize(comm);
+		// sendcounts may be NULL when sending in place
+		unsigned long long bytes = sendbuf == MPI_IN_PLACE ? dataBytes(sumCounts(recvcounts, comm_size), recvtype) : dataBytes(sumCounts(sendcounts, comm_size), sendtype);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('c', COLL_OP_ALLTOALLV, comm, -1, bytes, time);
+}{{endfn}}
+
+{{fn func MPI_Ialltoallv}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		int comm_size = commSize(comm);
+		// sendcounts may be NULL when sending in place
+		unsigned long long bytes = sendbuf == MPI_IN_PLACE ? dataBytes(sumCounts(recvcounts, comm_size), recvtype) : dataBytes(sumCounts(sendcounts, comm_size), sendtype);
+		// Waits of collective requests have no p2p peers
+		request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('C', COLL_OP_ALLTOALLV, comm, -1, bytes, time);
+}{{endfn}}
+
+{{fn func MPI_Reduce_scatter}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		unsigned long long bytes = dataBytes(sumCounts(recvcounts, commSize(comm)), datatype);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('c', COLL_OP_REDUCE_SCATTER, comm, -1, bytes, time);
+}{{endfn}}
+
+{{fn func MPI_Ireduce_scatter}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		unsigned long long bytes = dataBytes(sumCounts(recvcounts, commSize(comm)), datatype);
+		// Waits of collective requests have no p2p peers
+		request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('C', COLL_OP_REDUCE_SCATTER, comm, -1, bytes, time);
+}{{endfn}}
+
+{{fn func MPI_Scan}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('c', COLL_OP_SCAN, comm, -1, dataBytes(count, datatype), time);
+}{{endfn}}
+
+{{fn func MPI_Iscan}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		// Waits of collective requests have no p2p peers
+		request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('C', COLL_OP_SCAN, comm, -1, dataBytes(count, datatype), time);
+}{{endfn}}
+
+{{fn func MPI_Exscan}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('c', COLL_OP_EXSCAN, comm, -1, dataBytes(count, datatype), time);
+}{{endfn}}
+
+{{fn func MPI_Iexscan}}{
+		// First call collective communication
+		auto st = chrono::system_clock::now();
+    {{callfn}}
+		auto ed = chrono::system_clock::now();
+		double time = chrono::duration_cast<chrono::microseconds>(ed - st).count();
+
+		// Waits of collective requests have no p2p peers
+		request_converter[RequestConverter(request)] = pair<int, int>(-1, -1);
+#ifdef DEBUG
+		printf("%s\n", "{{func}}");
+#endif
+		TRACE_COLL('C', COLL_OP_EXSCAN, comm, -1, dataBytes(count, datatype), time);
+}{{endfn}}
+
+{{fn func MPI_Type_free}}{
+		// Sizes of freed datatypes are not cached, their handles may be reused
+		TSC *entry = typeSizeCacheEntry(*datatype);
+		if (entry->valid && entry->type == *datatype) {
+			entry->valid = false;
+		}
+    {{callfn}}
+}{{endfn}}
 
 
 {{fn func MPI_Finalize}}{
 		mpi_finalize_flag = true;
-		writeCollMpiInfoLog();
-		writeP2PMpiInfoLog();
-		writeTraceLog();
+		flushCollMpiInfoLog();
+		flushP2PMpiInfoLog();
+		flushTraceLog();
+		stopTraceWriter();
+		string selfStatsFileName = string("dynamic_data/MPIS") + to_string(mpi_rank) + string(".TXT");
+		baguatool::core::DumpSelfStats(selfStatsFileName.c_str());
 #ifdef DEBUG
 		printf("%s\n", "{{func}}");
 #endif
@@ -59,14 +59,18 @@ void RecordCallPath(int y) {
   record_perf_data_flag = true;
   baguatool::type::addr_t call_path[MAX_CALL_PATH_DEPTH] = {0};
   int call_path_len = sampler->GetBacktrace(call_path, MAX_CALL_PATH_DEPTH, 5);
+  baguatool::type::perf_data_t values[MAX_NUM_SAMPLE_METRICS] = {0};
+  int num_values = sampler->GetSampleValues(values, MAX_NUM_SAMPLE_METRICS);
   if (main_tid != gettid()) {
     perf_data->RecordVertexData(call_path, call_path_len,
                                 mpi_rank /* process_id */,
-                                record_thread_gid /* thread_id */, 1);
+                                record_thread_gid /* thread_id */,
+                                values, num_values);
   } else {
     perf_data->RecordVertexData(call_path, call_path_len,
                                 mpi_rank /* process_id */,
-                                main_thread_gid /* thread_id */, 1);
+                                main_thread_gid /* thread_id */,
+                                values, num_values);
   }
 }
 
@@ -118,16 +122,21 @@ static void init_mock() {
 
   void (*RecordCallPathPointer)(int) = &(RecordCallPath);
   sampler->SetOverflow(RecordCallPathPointer);
+
+  sampler->ConfigurePerfData(perf_data.get(), true);
+
   sampler->Start();
 }
 
 /** User-defined what to do at destructor */
 static void fini_mock() {
-  sampler->Stop();
   // dbg(perf_data->GetEdgeDataSize(), perf_data->GetVertexDataSize());
   char output_file_name[MAX_LINE_LEN] = {0};
   sprintf(output_file_name, "SAMPLE-%lu.TXT", gettid());
-  perf_data->Dump(output_file_name);
+  char self_stats_file_name[MAX_LINE_LEN] = {0};
+  sprintf(self_stats_file_name, "SELF-%lu.TXT", gettid());
+  sampler->FinishPerfData(perf_data.get(), output_file_name,
+                          self_stats_file_name);
 
   std::unique_ptr<baguatool::collector::SharedObjAnalysis> shared_obj_analysis =
       std::make_unique<baguatool::collector::SharedObjAnalysis>();
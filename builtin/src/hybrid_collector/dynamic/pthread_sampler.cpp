@@ -87,7 +87,10 @@ void print_call_path(baguatool::type::addr_t *call_path, int cal_path_len) {
 void RecordCallPath(int y) {
   baguatool::type::addr_t call_path[MAX_CALL_PATH_DEPTH] = {0};
   int call_path_len = sampler->GetBacktrace(call_path, MAX_CALL_PATH_DEPTH);
-  perf_data->RecordVertexData(call_path, call_path_len, 0, thread_gid, 1);
+  baguatool::type::perf_data_t values[MAX_NUM_SAMPLE_METRICS] = {0};
+  int num_values = sampler->GetSampleValues(values, MAX_NUM_SAMPLE_METRICS);
+  perf_data->RecordVertexData(call_path, call_path_len, 0, thread_gid,
+                              values, num_values);
 }
 
 static void *resolve_symbol(const char *symbol_name, int config) {
@@ -150,16 +153,18 @@ static void init_mock() {
   void (*RecordCallPathPointer)(int) = &(RecordCallPath);
   sampler->SetOverflow(RecordCallPathPointer);
 
+  // The writer thread of async dump would be traced by the pthread_create
+  // wrapper
+  sampler->ConfigurePerfData(perf_data.get(), false);
+
   sampler->Start();
 }
 
 // User-defined what to do at destructor
 static void fini_mock() {
-  sampler->Stop();
-
   // sampler->RecordLdLib();
 
-  perf_data->Dump("SAMPLE.TXT");
+  sampler->FinishPerfData(perf_data.get(), "SAMPLE.TXT", "SELF.TXT");
 
   // check memory leak
   // std::unordered_map<long, int>().swap(*tid_to_thread_gid);
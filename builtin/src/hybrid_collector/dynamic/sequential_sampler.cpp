@@ -25,8 +25,10 @@ char *addr_threshold;
 void RecordCallPath(int y) {
   baguatool::type::addr_t call_path[MAX_CALL_PATH_DEPTH] = {0};
   int call_path_len = sampler->GetBacktrace(call_path, MAX_CALL_PATH_DEPTH);
+  baguatool::type::perf_data_t values[MAX_NUM_SAMPLE_METRICS] = {0};
+  int num_values = sampler->GetSampleValues(values, MAX_NUM_SAMPLE_METRICS);
   perf_data->RecordVertexData(call_path, call_path_len, 0 /* process_id */,
-                              0 /* thread_id */, 1);
+                              0 /* thread_id */, values, num_values);
 }
 
 static void init_mock() __attribute__((constructor));
@@ -49,13 +51,15 @@ static void init_mock() {
   void (*RecordCallPathPointer)(int) = &(RecordCallPath);
   sampler->SetOverflow(RecordCallPathPointer);
 
+  sampler->ConfigurePerfData(perf_data.get(), true);
+
   sampler->Start();
 }
 
 // User-defined what to do at destructor
 static void fini_mock() {
-  sampler->Stop();
-  perf_data->Dump("dynamic_data/SAMPLE+0.TXT");
+  sampler->FinishPerfData(perf_data.get(), "dynamic_data/SAMPLE+0.TXT",
+                          "dynamic_data/SELF+0.TXT");
   // sampler->RecordLdLib();
 
   std::unique_ptr<baguatool::collector::SharedObjAnalysis> shared_obj_analysis =
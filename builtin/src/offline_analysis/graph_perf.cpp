@@ -1,4 +1,5 @@
 #include "graph_perf.h"
+#include "common/tokenizer.h"
 
 #define IGNORE_SHARED_OBJ
 
@@ -20,24 +21,41 @@ namespace graph_perf {
 
 using namespace baguatool;
 
-std::map<type::thread_t, std::pair<type::call_path_t, type::thread_t>>
+/** Extract the hash from the name of a graph file, [dir]/[hash].[ext] */
+static int GetGraphFileHash(const std::string &file_name) {
+  std::string_view name = file_name;
+  size_t slash = name.rfind('/');
+  if (slash != std::string_view::npos) {
+    name.remove_prefix(slash + 1);
+  }
+  int hash = 0;
+  ParseToken(name.substr(0, name.find('.')), hash);
+  return hash;
+}
+
+// Call paths of the creation of threads are kept from the outermost frame, so
+// that each sample of a thread is traced back without copying them
+std::map<type::thread_t, std::pair<std::vector<type::addr_t>, type::thread_t>>
     created_tid_2_callpath_and_tid;
 
 bool build_create_tid_to_callpath_and_tid_flag = false;
 void build_create_tid_to_callpath_and_tid(core::PerfData *perf_data) {
   /** Build created_tid_2_callpath_and_tid */
   auto edge_data_size = perf_data->GetEdgeDataSize();
+  std::vector<type::addr_t> buffer;
   for (unsigned long int i = 0; i < edge_data_size; i++) {
     /** Value of pthread_create is recorded as (-1), Value of GOMP_parallel is
      * recorded as (-2) */
     auto value = perf_data->GetEdgeDataValue(i);
     if (value <= (type::perf_data_t)(-1)) {
-      type::call_path_t src_call_path;
-      perf_data->GetEdgeDataSrcCallPath(i, src_call_path);
+      int src_call_path_len = 0;
+      type::addr_t *src_call_path =
+          perf_data->GetEdgeDataSrcCallPath(i, buffer, src_call_path_len);
       auto create_thread_id = perf_data->GetEdgeDataDestThreadId(i);
       auto thread_id = perf_data->GetEdgeDataSrcThreadId(i);
-      std::pair<type::call_path_t, int> tmp(src_call_path, thread_id);
-      created_tid_2_callpath_and_tid[create_thread_id] = tmp;
+      auto &tmp = created_tid_2_callpath_and_tid[create_thread_id];
+      tmp.first.assign(src_call_path, src_call_path + src_call_path_len);
+      tmp.second = thread_id;
       // printf("map[%d] = < %llx , %d > \n", create_thread_id,
       // src_call_path.top(), thread_id);
     }
@@ -67,6 +85,7 @@ GPerf::GPerf() {
   this->root_mpag = new core::MultiProgramAbstractionGraph();
   this->has_dyn_addr_debug_info = false;
   prune_flag = false;
+  inst_histogram_flag = false;
 }
 
 GPerf::~GPerf() {
@@ -101,13 +120,7 @@ void GPerf::ReadStaticControlFlowGraphs(const char *dir_name) {
     core::ControlFlowGraph *func_cfg = new core::ControlFlowGraph();
     func_cfg->ReadGraphGML(hash_str.c_str());
 
-    std::vector<std::string> split_vec, split_vec_1;
-    split(hash_str, std::string("/"), split_vec);
-    split(split_vec[split_vec.size() - 1], std::string("."), split_vec_1);
-    int hash = strtoull(split_vec_1[0].c_str(), NULL, 10);
-
-    FREE_CONTAINER(split_vec);
-    FREE_CONTAINER(split_vec_1);
+    int hash = GetGraphFileHash(hash_str);
 
     if (this->hash_to_entry_addr.find(hash) != this->hash_to_entry_addr.end()) {
       type::addr_t entry_addr = this->hash_to_entry_addr[hash];
@@ -136,18 +149,16 @@ void GPerf::GenerateDynAddrDebugInfo(
     std::string &binary_name) {
   /** Get debug info of shared object library addresses */
   dbg(binary_name);
-  auto data_size = perf_data->GetVertexDataSize();
   std::map<type::procs_t, std::unordered_set<type::addr_t>> all_addrs;
-  for (unsigned long int i = 0; i < data_size; i++) {
-    std::stack<unsigned long long> call_path;
-    perf_data->GetVertexDataCallPath(i, call_path);
-    auto procs_id = perf_data->GetVertexDataProcsId(i);
-
-    while (!call_path.empty()) {
-      type::addr_t call_addr = call_path.top();
-      call_path.pop();
-      if (type::IsDynAddr(call_addr)) {
-        all_addrs[procs_id].insert(call_addr);
+  auto data_end = perf_data->VertexDataEnd();
+  for (auto it = perf_data->VertexDataBegin(); it != data_end; ++it) {
+    const type::addr_t *call_path = it.GetCallPath();
+    int call_path_len = it.GetCallPathLen();
+    auto procs_id = it.GetProcsId();
+
+    for (int j = 0; j < call_path_len; j++) {
+      if (type::IsDynAddr(call_path[j])) {
+        all_addrs[procs_id].insert(call_path[j]);
       }
     }
   }
@@ -263,6 +274,12 @@ void GPerf::SetPruneFlag(bool flag) { this->prune_flag = flag; }
 
 bool GPerf::GetPruneFlag() { return this->prune_flag; }
 
+void GPerf::SetInstHistogramFlag(bool flag) {
+  this->inst_histogram_flag = flag;
+}
+
+bool GPerf::GetInstHistogramFlag() { return this->inst_histogram_flag; }
+
 void GPerf::PruneWithDynamicData() {
   // Set pruning flag
   this->SetPruneFlag(true);
@@ -313,6 +330,17 @@ void GPerf::ConvertDynAddrToOffset(type::call_path_t &call_path) {
   FREE_CONTAINER(tmp);
 }
 
+void GPerf::ConvertDynAddrToOffset(type::addr_t *call_path,
+                                   int call_path_len) {
+  for (int i = 0; i < call_path_len; i++) {
+    auto iter = this->dyn_addr_to_debug_info.find(call_path[i]);
+    if (iter != this->dyn_addr_to_debug_info.end() &&
+        iter->second->IsExecutable()) {
+      call_path[i] = iter->second->GetAddress();
+    }
+  }
+}
+
 void SetCallTypeAsStatic(core::ProgramCallGraph *pcg, type::edge_t edge_id,
                          void *extra) {
   pcg->SetEdgeType(edge_id, type::STA_CALL_EDGE); // static
@@ -658,13 +686,7 @@ void GPerf::ReadFunctionAbstractionGraphs(const char *dir_name) {
      * [bin_name].pag.map ([hash_str, entry_addr])
      */
 
-    std::vector<std::string> split_vec, split_vec_1;
-    split(hash_str, std::string("/"), split_vec);
-    split(split_vec[split_vec.size() - 1], std::string("."), split_vec_1);
-    int hash = strtoull(split_vec_1[0].c_str(), NULL, 10);
-
-    FREE_CONTAINER(split_vec);
-    FREE_CONTAINER(split_vec_1);
+    int hash = GetGraphFileHash(hash_str);
     if (this->hash_to_entry_addr.find(hash) != this->hash_to_entry_addr.end()) {
       type::addr_t entry_addr = this->hash_to_entry_addr[hash];
       this->func_entry_addr_to_pag[entry_addr] = new_pag;
@@ -905,7 +927,7 @@ void GPerf::DynamicInterProceduralAnalysis(core::PerfData *pthread_data) {
           }
 
           auto join_value = pthread_data->GetEdgeDataValue(j);
-          std::string metric = std::string("TOT_CYC");
+          std::string metric = pthread_data->GetMetricName(0);
           this->root_pag->GetGraphPerfData()->SetPerfData(
               pthread_join_vertex_id, metric,
               pthread_data->GetEdgeDataDestProcsId(j), dest_thread_id_join,
@@ -1141,14 +1163,13 @@ GPerf::GetVertexWithInterThreadAnalysis(type::thread_t thread_id,
   }
 
   /** Get the parent thread and its id and call path */
-  std::pair<type::call_path_t, type::thread_t> next_pair =
-      created_tid_2_callpath_and_tid[thread_id];
-  type::call_path_t &parent_call_path = next_pair.first;
+  auto &next_pair = created_tid_2_callpath_and_tid[thread_id];
+  auto &parent_call_path = next_pair.first;
   type::thread_t parent_thread_id = next_pair.second;
 
   /** Trace the pthread_create vertex that created this thread */
-  auto starting_vertex =
-      GetVertexWithInterThreadAnalysis(parent_thread_id, parent_call_path);
+  auto starting_vertex = GetVertexWithInterThreadAnalysis(
+      parent_thread_id, parent_call_path.data(), parent_call_path.size());
 
   /** Starting from the pthread_create vertex */
   if (call_path.empty()) {
@@ -1161,6 +1182,37 @@ GPerf::GetVertexWithInterThreadAnalysis(type::thread_t thread_id,
   return detected_vertex;
 }
 
+type::vertex_t
+GPerf::GetVertexWithInterThreadAnalysis(type::thread_t thread_id,
+                                        const type::addr_t *call_path,
+                                        int call_path_len) {
+  if (call_path_len == 0) {
+    return -1;
+  }
+
+  if (thread_id == 0) {
+    // Skip the outermost frame as the stack version pops it
+    if (call_path_len == 1) {
+      return -1;
+    }
+    return this->root_pag->GetVertexWithCallPath(0, call_path + 1,
+                                                 call_path_len - 1);
+  }
+
+  /** Get the parent thread and its id and call path */
+  auto &next_pair = created_tid_2_callpath_and_tid[thread_id];
+  auto &parent_call_path = next_pair.first;
+  type::thread_t parent_thread_id = next_pair.second;
+
+  /** Trace the pthread_create vertex that created this thread */
+  auto starting_vertex = GetVertexWithInterThreadAnalysis(
+      parent_thread_id, parent_call_path.data(), parent_call_path.size());
+
+  /** Starting from the pthread_create vertex */
+  return this->root_pag->GetVertexWithCallPath(starting_vertex, call_path,
+                                               call_path_len);
+}
+
 void GPerf::DataEmbedding(core::PerfData *perf_data) {
   // dbg("start data embedding");
   if (!build_create_tid_to_callpath_and_tid_flag) {
@@ -1169,40 +1221,126 @@ void GPerf::DataEmbedding(core::PerfData *perf_data) {
 
   // Query for each call path
   auto data_size = perf_data->GetVertexDataSize();
+  int num_metrics = perf_data->GetNumMetrics();
+  // Call paths are filled into one buffer instead of a stack per sample
+  std::vector<type::addr_t> buffer;
   for (unsigned long int i = 0; i < data_size; i++) {
-    type::call_path_t call_path;
-    perf_data->GetVertexDataCallPath(i, call_path);
+    int call_path_len = 0;
+    type::addr_t *call_path =
+        perf_data->GetVertexDataCallPath(i, buffer, call_path_len);
 
     // For cluster yes, the first address of the call path is _start_main
-    call_path.pop();
+    if (call_path_len > 0) {
+      call_path++;
+      call_path_len--;
+    }
 
-    auto value = perf_data->GetVertexDataValue(i);
     auto process_id = perf_data->GetVertexDataProcsId(i);
     auto thread_id = perf_data->GetVertexDataThreadId(i);
 
-    // type::vertex_t queried_vertex_id =
-    // this->root_pag->GetVertexWithCallPath(0, call_path);
     if (HasDynAddrDebugInfo()) {
-      ConvertDynAddrToOffset(call_path);
+      ConvertDynAddrToOffset(call_path, call_path_len);
     }
 
-    // DumpCallPath(call_path);
-
     // dbg("start querying");
     auto queried_vertex_id =
-        GetVertexWithInterThreadAnalysis(thread_id, call_path);
+        GetVertexWithInterThreadAnalysis(thread_id, call_path, call_path_len);
     // dbg(queried_vertex_id);
+    // Embed all metrics with one query of the call path
+    for (int m = 0; m < num_metrics; m++) {
+      auto value = perf_data->GetVertexDataValue(i, m);
+      type::perf_data_t data =
+          this->root_pag->GetGraphPerfData()->GetPerfData(
+              queried_vertex_id, perf_data->GetMetricName(m), process_id,
+              thread_id);
+      // dbg(data);
+      data += value;
+      this->root_pag->GetGraphPerfData()->SetPerfData(
+          queried_vertex_id, perf_data->GetMetricName(m), process_id,
+          thread_id, data);
+    }
+
+    if (this->inst_histogram_flag && call_path_len > 0) {
+      EmbedInstHistogram(perf_data, i, queried_vertex_id,
+                         call_path[call_path_len - 1]);
+    }
+  }
+
+} // function Dataembedding
+
+void GPerf::EmbedInstHistogram(core::PerfData *perf_data,
+                               unsigned long int data_index,
+                               type::vertex_t vertex_id,
+                               type::addr_t leaf_addr) {
+  if (vertex_id < 0) {
+    return;
+  }
+  auto vertex_type = this->root_pag->GetVertexType(vertex_id);
+  if (vertex_type != type::BB_NODE && vertex_type != type::INST_NODE) {
+    return;
+  }
+  // Call paths keep return addresses minus 2, but the leaf of a sample is the
+  // interrupted instruction
+  char label[32];
+  snprintf(label, sizeof(label), "@0x%lx", (unsigned long)(leaf_addr + 2));
+
+  auto process_id = perf_data->GetVertexDataProcsId(data_index);
+  auto thread_id = perf_data->GetVertexDataThreadId(data_index);
+  for (int m = 0; m < perf_data->GetNumMetrics(); m++) {
+    std::string metric = perf_data->GetMetricName(m) + std::string(label);
+    auto value = perf_data->GetVertexDataValue(data_index, m);
     type::perf_data_t data = this->root_pag->GetGraphPerfData()->GetPerfData(
-        queried_vertex_id, perf_data->GetMetricName(), process_id, thread_id);
-    // dbg(data);
+        vertex_id, metric, process_id, thread_id);
     data += value;
     this->root_pag->GetGraphPerfData()->SetPerfData(
-        queried_vertex_id, perf_data->GetMetricName(), process_id, thread_id,
-        data);
-    FREE_CONTAINER(call_path);
+        vertex_id, metric, process_id, thread_id, data);
   }
+}
 
-} // function Dataembedding
+void GPerf::DataEmbedding(core::PerfData *perf_data,
+                          std::vector<std::string> &labels) {
+  if (!build_create_tid_to_callpath_and_tid_flag) {
+    build_create_tid_to_callpath_and_tid(perf_data);
+  }
+
+  auto data_size = perf_data->GetVertexDataSize();
+  int num_metrics = perf_data->GetNumMetrics();
+  std::vector<type::addr_t> buffer;
+  for (unsigned long int i = 0; i < data_size; i++) {
+    int call_path_len = 0;
+    type::addr_t *call_path =
+        perf_data->GetVertexDataCallPath(i, buffer, call_path_len);
+
+    // For cluster yes, the first address of the call path is _start_main
+    if (call_path_len > 0) {
+      call_path++;
+      call_path_len--;
+    }
+
+    auto label_id = perf_data->GetVertexDataProcsId(i);
+    auto thread_id = perf_data->GetVertexDataThreadId(i);
+    if (label_id < 0 || (unsigned long int)label_id >= labels.size()) {
+      continue;
+    }
+
+    if (HasDynAddrDebugInfo()) {
+      ConvertDynAddrToOffset(call_path, call_path_len);
+    }
+
+    auto queried_vertex_id =
+        GetVertexWithInterThreadAnalysis(thread_id, call_path, call_path_len);
+    for (int m = 0; m < num_metrics; m++) {
+      std::string metric = perf_data->GetMetricName(m) + std::string("@") +
+                           labels[label_id];
+      auto value = perf_data->GetVertexDataValue(i, m);
+      type::perf_data_t data = this->root_pag->GetGraphPerfData()->GetPerfData(
+          queried_vertex_id, metric, 0, thread_id);
+      data += value;
+      this->root_pag->GetGraphPerfData()->SetPerfData(queried_vertex_id, metric,
+                                                      0, thread_id, data);
+    }
+  }
+}
 
 struct pthread_expansion_arg_t {
   core::MultiProgramAbstractionGraph *mpag;
@@ -1506,6 +1644,9 @@ void GPerf::AddCommEdgesToMPAG(core::PerfData *comm_data) {
   int pag_num_vertex = pag_vid_to_pre_order_seq_id.size();
   auto edge_data_size = comm_data->GetEdgeDataSize();
   // dbg(edge_data_size);
+  // Bytes are a second metric of the edges, absent in old files
+  std::string bytes_metric("BYTES");
+  int bytes_metric_index = comm_data->GetMetricIndex(bytes_metric);
   this->root_mpag->SetLazyEdgeTrunkSize(edge_data_size);
   for (unsigned long int i = 0; i < edge_data_size; i++) {
     auto value = comm_data->GetEdgeDataValue(i);
@@ -1571,6 +1712,11 @@ void GPerf::AddCommEdgesToMPAG(core::PerfData *comm_data) {
       // dbg(edge_id);
       if (edge_id != -1) {
         this->root_mpag->SetEdgeAttributeNumLazy("time", edge_id, value);
+        if (bytes_metric_index >= 0) {
+          this->root_mpag->SetEdgeAttributeNumLazy(
+              "bytes", edge_id,
+              comm_data->GetEdgeDataValue(i, bytes_metric_index));
+        }
       }
 
       FREE_CONTAINER(src_call_path);
@@ -33,6 +33,7 @@ private:
 
   bool has_dyn_addr_debug_info;
   bool prune_flag;
+  bool inst_histogram_flag;
   unordered_set<type::addr_t> dynamic_call_offsets;
 
 public:
@@ -129,6 +130,15 @@ public:
 
   void ConvertDynAddrToOffset(type::call_path_t &call_path);
 
+  /**
+   * @brief Convert dynamic address of the executed executable to offset
+   * address in place, for a call path held in an array.
+   *
+   * @param call_path - call path from the outermost frame
+   * @param call_path_len - length of the call path
+   */
+  void ConvertDynAddrToOffset(type::addr_t *call_path, int call_path_len);
+
   /**
    * @brief Prepare data for pruning, but pruning is done at the following
    * phases.
@@ -151,6 +161,15 @@ public:
    */
   bool GetPruneFlag();
 
+  /** Whether DataEmbedding also keeps a histogram of sampled instructions.
+   * The leaf address of each call path is embedded on its BB_NODE or
+   * INST_NODE vertex as the metric <metric>@<address in hex>, so that hot
+   * instructions of a basic block show up without perf annotate.
+   * @param flag - true to keep the histogram
+   */
+  void SetInstHistogramFlag(bool flag);
+  bool GetInstHistogramFlag();
+
   /** Program Call Graph **/
 
   /** Read static program call graph from an input file.
@@ -260,11 +279,43 @@ public:
   type::vertex_t GetVertexWithInterThreadAnalysis(int thread_id,
                                                   type::call_path_t &call_path);
 
+  /** Get corresponding vertex through inter-thread analysis, the same as above
+   * but with the call path as an array from the outermost frame.
+   * @param thread_id - thread id of a input call path
+   * @param call_path - call path from the outermost frame
+   * @param call_path_len - length of the call path
+   * @return id of the corresponding vertex of the input call path
+   */
+  type::vertex_t GetVertexWithInterThreadAnalysis(int thread_id,
+                                                  const type::addr_t *call_path,
+                                                  int call_path_len);
+
   /** Embed data to graph.
    * @param perf_data - performance data
    */
   void DataEmbedding(core::PerfData *perf_data);
 
+  /** Embed a piece of vertex type data on the histogram of sampled
+   * instructions of its vertex, if the vertex is a BB_NODE or INST_NODE.
+   * @param perf_data - performance data
+   * @param data_index - index of the piece of data
+   * @param vertex_id - vertex of the call path of the piece of data
+   * @param leaf_addr - leaf address of the call path, as an offset if the
+   * call path is converted
+   */
+  void EmbedInstHistogram(core::PerfData *perf_data,
+                          unsigned long int data_index,
+                          type::vertex_t vertex_id, type::addr_t leaf_addr);
+
+  /** Embed data to graph, the same as above but the process id of each piece
+   * of data indexes a label instead of a process, e.g. a file of I/O data.
+   * Values go to the metric named <metric>@<label> of process 0.
+   * @param perf_data - performance data
+   * @param labels - label of each process id
+   */
+  void DataEmbedding(core::PerfData *perf_data,
+                     std::vector<std::string> &labels);
+
   // /** Get performance data on the graph (GraphPerfData)
   //  * @return GraphPerfData
   //  */
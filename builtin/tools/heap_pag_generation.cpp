@@ -0,0 +1,81 @@
+#include "baguatool.h"
+#include "graph_perf.h"
+#include <cstring>
+#include <string>
+
+/** Embed heap data of heap_sampler into the program abstraction graph:
+ * bytes allocated, allocations, bytes still live at exit and lifetime of the
+ * freed allocations at each calling context */
+int main(int argc, char **argv) {
+  /** Setups */
+  const char *bin_name = argv[1];
+  const char *data_dir = argv[2];
+
+  /** == Read static data == */
+  auto graph_perf = std::make_unique<graph_perf::GPerf>();
+  std::string pag_dir_name = std::string(data_dir) +
+                             std::string("/static_data/") +
+                             std::string(bin_name) + std::string(".pag/");
+  graph_perf->ReadFunctionAbstractionGraphs(pag_dir_name.c_str());
+
+  /** == Read heap data == */
+  baguatool::core::PerfData *perf_data = new baguatool::core::PerfData();
+  std::string perf_data_file_name =
+      std::string(data_dir) + std::string("/dynamic_data/HEAP+0.TXT");
+  perf_data->Read(perf_data_file_name.c_str());
+
+  std::map<baguatool::type::procs_t, baguatool::collector::SharedObjAnalysis *>
+      all_shared_obj_analysis;
+  std::string somap_file_name_str =
+      std::string(data_dir) + std::string("/dynamic_data/SOMAP+0.TXT");
+  baguatool::collector::SharedObjAnalysis *shared_obj_analysis =
+      new baguatool::collector::SharedObjAnalysis();
+  shared_obj_analysis->ReadSharedObjMap(somap_file_name_str);
+  all_shared_obj_analysis[0] = shared_obj_analysis;
+  std::string bin_name_str = std::string(bin_name);
+  graph_perf->GenerateDynAddrDebugInfo(perf_data, all_shared_obj_analysis,
+                                       bin_name_str);
+
+  /** == Generate program abstraction graph == */
+  std::string pcg_name = std::string(data_dir) + std::string("/static_data/") +
+                         std::string(bin_name) + std::string(".pcg");
+  graph_perf->GenerateProgramCallGraph(pcg_name.c_str(), perf_data);
+  graph_perf->PruneWithDynamicData();
+  graph_perf->GenerateProgramAbstractionGraph(perf_data);
+  baguatool::core::ProgramAbstractionGraph *pag =
+      graph_perf->GetProgramAbstractionGraph();
+
+  /** == Data embedding, all metrics of heap data at once == */
+  graph_perf->DataEmbedding(perf_data);
+
+  /** == Reduce data == */
+  std::string op("SUM");
+  std::string metric("ALLOC_BYTES");
+  baguatool::type::perf_data_t total = pag->ReduceVertexPerfData(metric, op);
+  std::string sum_metric("ALLOC_BYTES_SUM");
+  std::string new_metric("ALLOCPERCENT");
+  pag->ConvertVertexReducedDataToPercent(sum_metric, total, new_metric);
+
+  std::string live_metric("LIVE_BYTES");
+  total = pag->ReduceVertexPerfData(live_metric, op);
+  std::string live_sum_metric("LIVE_BYTES_SUM");
+  std::string live_new_metric("LIVEPERCENT");
+  pag->ConvertVertexReducedDataToPercent(live_sum_metric, total,
+                                         live_new_metric);
+
+  pag->PreserveHotVertices("ALLOCPERCENT");
+
+  std::string output_pag_name =
+      std::string(data_dir) + std::string("/heap_pag.gml");
+  pag->DumpGraphGML(output_pag_name.c_str());
+  auto graph_perf_data = pag->GetGraphPerfData();
+  std::string output_pag_perf_data_name =
+      std::string(data_dir) + std::string("/heap_output.json");
+  graph_perf_data->Dump(output_pag_perf_data_name);
+
+  for (auto &kv : all_shared_obj_analysis) {
+    delete kv.second;
+  }
+  FREE_CONTAINER(all_shared_obj_analysis);
+  delete perf_data;
+}
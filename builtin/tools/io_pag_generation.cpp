@@ -0,0 +1,93 @@
+#include "baguatool.h"
+#include "graph_perf.h"
+#include <cstring>
+#include <fstream>
+#include <string>
+
+/** Embed I/O data of io_tracer into the program abstraction graph: bytes,
+ * calls and time of I/O at each calling context, in total and per file */
+int main(int argc, char **argv) {
+  /** Setups */
+  const char *bin_name = argv[1];
+  const char *data_dir = argv[2];
+
+  /** == Read static data == */
+  auto graph_perf = std::make_unique<graph_perf::GPerf>();
+  std::string pag_dir_name = std::string(data_dir) +
+                             std::string("/static_data/") +
+                             std::string(bin_name) + std::string(".pag/");
+  graph_perf->ReadFunctionAbstractionGraphs(pag_dir_name.c_str());
+
+  /** == Read I/O data == */
+  baguatool::core::PerfData *perf_data = new baguatool::core::PerfData();
+  std::string perf_data_file_name =
+      std::string(data_dir) + std::string("/dynamic_data/IO+0.TXT");
+  perf_data->Read(perf_data_file_name.c_str());
+  baguatool::core::PerfData *file_data = new baguatool::core::PerfData();
+  std::string file_data_file_name =
+      std::string(data_dir) + std::string("/dynamic_data/IOFILE+0.TXT");
+  file_data->Read(file_data_file_name.c_str());
+
+  // One "id name" per line, ids are in order
+  std::vector<std::string> file_names;
+  std::string file_name_file_name =
+      std::string(data_dir) + std::string("/dynamic_data/IONAME+0.TXT");
+  std::ifstream file_name_file(file_name_file_name);
+  std::string line;
+  while (std::getline(file_name_file, line)) {
+    auto pos = line.find(' ');
+    if (pos != std::string::npos) {
+      file_names.push_back(line.substr(pos + 1));
+    }
+  }
+
+  std::map<baguatool::type::procs_t, baguatool::collector::SharedObjAnalysis *>
+      all_shared_obj_analysis;
+  std::string somap_file_name_str =
+      std::string(data_dir) + std::string("/dynamic_data/SOMAP+0.TXT");
+  baguatool::collector::SharedObjAnalysis *shared_obj_analysis =
+      new baguatool::collector::SharedObjAnalysis();
+  shared_obj_analysis->ReadSharedObjMap(somap_file_name_str);
+  all_shared_obj_analysis[0] = shared_obj_analysis;
+  std::string bin_name_str = std::string(bin_name);
+  graph_perf->GenerateDynAddrDebugInfo(perf_data, all_shared_obj_analysis,
+                                       bin_name_str);
+
+  /** == Generate program abstraction graph == */
+  std::string pcg_name = std::string(data_dir) + std::string("/static_data/") +
+                         std::string(bin_name) + std::string(".pcg");
+  graph_perf->GenerateProgramCallGraph(pcg_name.c_str(), perf_data);
+  graph_perf->PruneWithDynamicData();
+  graph_perf->GenerateProgramAbstractionGraph(perf_data);
+  baguatool::core::ProgramAbstractionGraph *pag =
+      graph_perf->GetProgramAbstractionGraph();
+
+  /** == Data embedding, e.g. IO_TIME and IO_TIME@<file> == */
+  graph_perf->DataEmbedding(perf_data);
+  graph_perf->DataEmbedding(file_data, file_names);
+
+  /** == Reduce data == */
+  std::string metric("IO_TIME");
+  std::string op("SUM");
+  baguatool::type::perf_data_t total = pag->ReduceVertexPerfData(metric, op);
+  std::string sum_metric("IO_TIME_SUM");
+  std::string new_metric("IOPERCENT");
+  pag->ConvertVertexReducedDataToPercent(sum_metric, total, new_metric);
+
+  pag->PreserveHotVertices("IOPERCENT");
+
+  std::string output_pag_name =
+      std::string(data_dir) + std::string("/io_pag.gml");
+  pag->DumpGraphGML(output_pag_name.c_str());
+  auto graph_perf_data = pag->GetGraphPerfData();
+  std::string output_pag_perf_data_name =
+      std::string(data_dir) + std::string("/io_output.json");
+  graph_perf_data->Dump(output_pag_perf_data_name);
+
+  for (auto &kv : all_shared_obj_analysis) {
+    delete kv.second;
+  }
+  FREE_CONTAINER(all_shared_obj_analysis);
+  delete perf_data;
+  delete file_data;
+}
@@ -1,6 +1,8 @@
 #include <chrono>
 #include <cstring>
 #include <map>
+#include <string>
+#include <vector>
 
 #include "graph_perf.h"
 
@@ -28,18 +30,21 @@ int main(int argc, char **argv) {
   int num_procs = atoi(argv[3]);
   baguatool::core::PerfData *perf_data = new baguatool::core::PerfData();
   st = std::chrono::system_clock::now();
+  std::vector<std::string> perf_data_file_names;
   for (int pid = 0; pid < num_procs; pid++) {
     std::string perf_data_file_name = std::string(data_dir) +
                                       std::string("/dynamic_data/SAMPLE+") +
                                       std::to_string(pid) + std::string(".TXT");
-    perf_data->Read(perf_data_file_name.c_str());
+    perf_data_file_names.push_back(perf_data_file_name);
   }
   baguatool::core::PerfData *comm_data = new baguatool::core::PerfData();
   std::string comm_data_file_name = std::string(data_dir) +
                                     std::string("/dynamic_data/") +
                                     std::string(argv[5]);
   comm_data->Read(comm_data_file_name.c_str());
-  perf_data->Read(comm_data_file_name.c_str());
+  perf_data_file_names.push_back(comm_data_file_name);
+  // Parse files of all ranks concurrently on all cores
+  perf_data->ReadAll(perf_data_file_names, 0);
   ed = std::chrono::system_clock::now();
   time =
       std::chrono::duration_cast<std::chrono::microseconds>(ed - st).count() /
@@ -115,11 +120,12 @@ int main(int argc, char **argv) {
 
   /** == Reduce data == */
   st = std::chrono::system_clock::now();
-  std::string metric("TOT_CYC");
+  // Metric 0 counts the event that triggers samples
+  std::string metric = perf_data->GetMetricName(0);
   std::string op("SUM");
   baguatool::type::perf_data_t total;
   total = pag->ReduceVertexPerfData(metric, op);
-  std::string avg_metric("TOT_CYC_SUM");
+  std::string avg_metric = metric + std::string("_SUM");
   std::string new_metric("CYCAVGPERCENT");
   pag->ConvertVertexReducedDataToPercent(avg_metric, total, new_metric);
   ed = std::chrono::system_clock::now();
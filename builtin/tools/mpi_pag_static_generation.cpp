@@ -1,5 +1,7 @@
 #include "graph_perf.h"
 #include <cstring>
+#include <string>
+#include <vector>
 
 int main(int argc, char **argv) {
   /** Setups */
@@ -12,10 +14,11 @@ int main(int argc, char **argv) {
   // std::string shared_obj_map_file_name = std::string(argv[3]);
   int num_procs = atoi(argv[2]);
   baguatool::core::PerfData *perf_data = new baguatool::core::PerfData();
+  std::vector<std::string> perf_data_file_names;
   for (int i = 5; i < argc; i++) {
-    const char *perf_data_file_name = argv[i];
-    perf_data->Read(perf_data_file_name);
+    perf_data_file_names.push_back(std::string(argv[i]));
   }
+  perf_data->ReadAll(perf_data_file_names, 0);
   auto graph_perf = std::make_unique<graph_perf::GPerf>();
 
   /** Read confrol-flow graph and program call graph */
@@ -33,11 +36,12 @@ int main(int argc, char **argv) {
   auto graph_perf_data = pag->GetGraphPerfData();
   std::string output_file_name_str("output.json");
   graph_perf_data->Dump(output_file_name_str);
-  std::string metric("TOT_CYC");
+  // Metric 0 counts the event that triggers samples
+  std::string metric = perf_data->GetMetricName(0);
   std::string op("SUM");
   baguatool::type::perf_data_t total;
   total = pag->ReduceVertexPerfData(metric, op);
-  std::string avg_metric("TOT_CYC_SUM");
+  std::string avg_metric = metric + std::string("_SUM");
   std::string new_metric("CYCAVGPERCENT");
   pag->ConvertVertexReducedDataToPercent(avg_metric, total, new_metric);
   pag->DumpGraphGML("pag.gml");
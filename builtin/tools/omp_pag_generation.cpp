@@ -112,13 +112,14 @@ int main(int argc, char **argv) {
   cout << "Data embedding costs " << time << " seconds." << std::endl;
 
 
-  std::string metric("TOT_CYC");
+  // Metric 0 counts the event that triggers samples
+  std::string metric = perf_data->GetMetricName(0);
   graph_perf->OpenMPGroupThreadPerfData(metric, MAX_NUM_CORE);
 
 
   std::string op("SUM");
   baguatool::type::perf_data_t total = pag->ReduceVertexPerfData(metric, op);
-  std::string avg_metric("TOT_CYC_SUM");
+  std::string avg_metric = metric + std::string("_SUM");
   std::string new_metric("CYCAVGPERCENT");
   pag->ConvertVertexReducedDataToPercent(avg_metric, total, new_metric);
 
@@ -97,6 +97,11 @@ int main(int argc, char **argv) {
 
   /** == Data embedding == */
   st = std::chrono::system_clock::now();
+  // Histogram of sampled instructions on basic blocks, with "inst" as the
+  // third argument
+  if (argc > 3 && strcmp(argv[3], "inst") == 0) {
+    graph_perf->SetInstHistogramFlag(true);
+  }
   graph_perf->DataEmbedding(perf_data);
   ed = std::chrono::system_clock::now();
   time =
@@ -109,11 +114,12 @@ int main(int argc, char **argv) {
 
   /** == Reduce data == */
   st = std::chrono::system_clock::now();
-  std::string metric("TOT_CYC");
+  // Metric 0 counts the event that triggers samples
+  std::string metric = perf_data->GetMetricName(0);
   std::string op("SUM");
   baguatool::type::perf_data_t total;
   total = pag->ReduceVertexPerfData(metric, op);
-  std::string avg_metric("TOT_CYC_SUM");
+  std::string avg_metric = metric + std::string("_SUM");
   std::string new_metric("CYCAVGPERCENT");
   pag->ConvertVertexReducedDataToPercent(avg_metric, total, new_metric);
   ed = std::chrono::system_clock::now();
@@ -0,0 +1,106 @@
+#include "baguatool.h"
+#include "common/tokenizer.h"
+#include "common/utils.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Compare parsing sample lines of text performance data with split() and
+// with Tokenizer. Usage: tokenizer_bench [num_lines] [call_path_len]
+
+/** Parse lines as PerfData::Read did with split() */
+double ParseWithSplit(std::vector<std::string> &lines) {
+  double sum = 0;
+  std::vector<baguatool::type::addr_t> call_path;
+  for (auto &line : lines) {
+    std::vector<std::string> line_vec;
+    split(line, "|", line_vec);
+    if (line_vec.size() != 4) {
+      continue;
+    }
+    sum += atof(line_vec[1].c_str()) + atoi(line_vec[2].c_str()) +
+           atoi(line_vec[3].c_str());
+    std::vector<std::string> addr_vec;
+    split(line_vec[0], " ", addr_vec);
+    call_path.resize(addr_vec.size());
+    for (size_t i = 0; i < addr_vec.size(); i++) {
+      call_path[i] = strtoul(addr_vec[i].c_str(), 0, 16);
+      sum += call_path[i];
+    }
+  }
+  return sum;
+}
+
+/** Parse lines as PerfData::Read does with Tokenizer */
+double ParseWithTokenizer(std::vector<std::string> &lines) {
+  double sum = 0;
+  std::vector<baguatool::type::addr_t> call_path;
+  std::string_view fields[4];
+  for (auto &line : lines) {
+    Tokenizer field_tokenizer(line, "|");
+    int cnt = 0;
+    while (cnt < 4 && field_tokenizer.Next(fields[cnt])) {
+      cnt++;
+    }
+    if (cnt != 4) {
+      continue;
+    }
+    double value = 0;
+    int procs_id = 0, thread_id = 0;
+    ParseToken(fields[1], value);
+    ParseToken(fields[2], procs_id);
+    ParseToken(fields[3], thread_id);
+    sum += value + procs_id + thread_id;
+    call_path.clear();
+    Tokenizer addr_tokenizer(fields[0], " ");
+    std::string_view token;
+    while (addr_tokenizer.Next(token)) {
+      baguatool::type::addr_t addr = 0;
+      ParseToken(token, addr, 16);
+      call_path.push_back(addr);
+      sum += addr;
+    }
+  }
+  return sum;
+}
+
+int main(int argc, char **argv) {
+  unsigned long int num_lines = argc > 1 ? strtoul(argv[1], 0, 10) : 1000000;
+  int call_path_len = argc > 2 ? atoi(argv[2]) : 20;
+
+  // Lines in the format of PerfData::DumpTextSection
+  std::vector<std::string> lines(num_lines);
+  char buf[32];
+  srand(0);
+  for (auto &line : lines) {
+    for (int i = 0; i < call_path_len; i++) {
+      snprintf(buf, sizeof(buf), "%llx ", 0x400000ULL + rand() % 0x100000);
+      line += buf;
+    }
+    snprintf(buf, sizeof(buf), " | %lf | %d | %d", (double)(rand() % 100),
+             rand() % 4096, rand() % 64);
+    line += buf;
+  }
+
+  auto st = std::chrono::steady_clock::now();
+  double split_sum = ParseWithSplit(lines);
+  auto ed = std::chrono::steady_clock::now();
+  double split_time = std::chrono::duration<double>(ed - st).count();
+
+  st = std::chrono::steady_clock::now();
+  double tokenizer_sum = ParseWithTokenizer(lines);
+  ed = std::chrono::steady_clock::now();
+  double tokenizer_time = std::chrono::duration<double>(ed - st).count();
+
+  printf("%lu lines, %d frames per line\n", num_lines, call_path_len);
+  printf("split     : %.3f s\n", split_time);
+  printf("tokenizer : %.3f s (%.1fx)\n", tokenizer_time,
+         split_time / tokenizer_time);
+  if (split_sum != tokenizer_sum) {
+    printf("Results differ: %lf vs %lf\n", split_sum, tokenizer_sum);
+    return 1;
+  }
+  return 0;
+}
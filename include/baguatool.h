@@ -4,6 +4,7 @@
 #include "common/tprintf.h"
 #include "nlohmann/json.hpp"
 #include <fstream>
+#include <iterator>
 #include <map>
 #include <memory>
 #include <stack>
@@ -55,6 +56,21 @@ enum edge_type_t {
   NONE_EDGE_TYPE = -100
 };
 
+/** File format of dumped performance data */
+enum perf_data_format_t {
+  PERF_DATA_TEXT = 0,  /**<human-readable text, for debugging */
+  PERF_DATA_BINARY = 1 /**<versioned binary columns, memory-mappable */
+};
+
+/** What to do with a sample that finds no room under the memory cap */
+enum overflow_policy_t {
+  OVERFLOW_DROP = 0,      /**<drop the sample */
+  OVERFLOW_FLUSH = 1,     /**<flush records synchronously and retry, which may
+                             block on file I/O in the signal handler */
+  OVERFLOW_DOWNSAMPLE = 2 /**<drop the sample and halve the sampling rate,
+                             kept samples are weighted by the rate */
+};
+
 struct addr_debug_info_t {
   type::addr_t addr;
   std::string file_name;
@@ -720,6 +736,19 @@ public:
   GetVertexWithCallPath(type::vertex_t root_vertex_id,
                         std::stack<unsigned long long> &call_path);
 
+  /** Identify the vertex corresponding to the call path from a specific
+   * starting vertex, the same as above but with the call path as an array
+   * from the outermost frame, e.g. from PerfData::GetVertexDataCallPath with a
+   * buffer, so the call path is not copied into a stack.
+   * @param root_vertex_id - id of the starting vertex
+   * @param call_path - call path from the outermost frame
+   * @param call_path_len - length of the call path
+   * @return id of the identified vertex
+   */
+  type::vertex_t GetVertexWithCallPath(type::vertex_t root_vertex_id,
+                                       const type::addr_t *call_path,
+                                       int call_path_len);
+
   /** Identify the call vertex corresponding to the address from all vertices.
    * @param addr - address
    * @return id of the identified vertex
@@ -997,13 +1026,67 @@ public:
                        void *extra);
 };
 
+/** Counters of the cost of collectors themselves, kept per thread */
+enum SelfStat {
+  STAT_SAMPLES = 0,     /**<samples taken */
+  STAT_DROPPED_SAMPLES, /**<samples lost by samplers or dropped by PerfData */
+  STAT_HANDLER_TIME,    /**<nanoseconds in sample handlers */
+  STAT_UNWIND_TIME,     /**<nanoseconds unwinding call paths */
+  STAT_LOOKUP_TIME,     /**<nanoseconds aggregating records into hash tables */
+  STAT_TRACED_CALLS,    /**<communication calls traced */
+  STAT_TRACE_TIME,      /**<nanoseconds recording traces, without the calls */
+  STAT_DUMP_TIME,       /**<nanoseconds writing data to files */
+  STAT_BYTES_WRITTEN,   /**<bytes written to files */
+  STAT_PEAK_MEM,        /**<peak bytes of buffers, the max instead of the sum */
+  NUM_SELF_STATS
+};
+
+/** Add to a counter of the calling thread. It is async-signal-safe.
+ * @param stat - counter
+ * @param value - increment, or a value to keep the max of for STAT_PEAK_MEM
+ */
+void AddSelfStat(SelfStat stat, unsigned long long value);
+
+/** Get a counter summed over all threads, or the max for STAT_PEAK_MEM
+ * @param stat - counter
+ * @return value of the counter
+ */
+unsigned long long GetSelfStat(SelfStat stat);
+
+/** Get a monotonic time for the time counters. It is async-signal-safe.
+ * @return nanoseconds
+ */
+unsigned long long GetSelfStatTime();
+
+/** Write counters of each thread, their totals, and the share of time in
+ * handlers and tracing over the time since the process started. The share
+ * of the totals is over that time times the number of threads with
+ * counters, so it stays within [0, 1].
+ * @param file_name - name of the summary file
+ */
+void DumpSelfStats(const char *file_name);
+
 typedef struct VERTEX_DATA_STRUCT VDS;
 typedef struct EDGE_DATA_STRUCT EDS;
+typedef struct CCT_NODE_STRUCT CCTN;
+typedef struct THREAD_BUFFER_STRUCT TBS;
+typedef struct ASYNC_DUMP_STRUCT ADS;
+typedef struct ARENA_STRUCT ARENA;
+typedef struct READ_SHARD_STRUCT RSS;
+
+// Values carried by each record of PerfData, enough for the events of a
+// sampler and the wall-clock metrics, see MAX_NUM_SAMPLE_METRICS
+#ifndef MAX_NUM_METRICS
+#define MAX_NUM_METRICS 6
+#endif
 
 #ifndef MAX_LINE_LEN
 #define MAX_LINE_LEN 256
 #endif
 
+class VertexDataIterator;
+class VertexDataRange;
+
 class PerfData {
 private:
   VDS *vertex_perf_data =
@@ -1017,18 +1100,239 @@ private:
       0; /**<pre-allocate space size of edge type performance data*/
   unsigned long int edge_perf_data_count =
       0; /**<amount of recorded edge type performance data*/
+  unsigned long int *vertex_perf_data_index =
+      nullptr; /**<hash index (slot -> data index + 1) of vertex type
+                  performance data, 0 means an empty slot */
+  unsigned long int vertex_perf_data_index_size =
+      0; /**<number of slots of the vertex type index (power of 2) */
+  unsigned long int *edge_perf_data_index =
+      nullptr; /**<hash index (slot -> data index + 1) of edge type
+                  performance data, 0 means an empty slot */
+  unsigned long int edge_perf_data_index_size =
+      0; /**<number of slots of the edge type index (power of 2) */
+  CCTN *cct_nodes =
+      nullptr; /**<nodes of the calling context tree (CCT) of all call paths,
+                  node 0 is the root. Nodes never move once created, except
+                  in a read-only PerfData. */
+  unsigned long int cct_node_space_size =
+      0; /**<pre-allocate space size of CCT nodes */
+  unsigned long int cct_node_count = 0; /**<amount of CCT nodes */
+  unsigned long int *cct_node_index =
+      nullptr; /**<hash index (slot -> node id) of CCT nodes by (parent,
+                  address), 0 means an empty slot */
+  unsigned long int cct_node_index_size =
+      0; /**<number of slots of the CCT index (power of 2) */
+  unsigned long int cct_dumped_node_count =
+      0; /**<amount of CCT nodes written to the output file */
+  bool read_only = false; /**<only reads files, see PerfData(bool) */
+  TBS *thread_buffer_list =
+      nullptr; /**<lock-free list of per-thread vertex type sample buffers */
+  ARENA *sample_arena =
+      nullptr; /**<memory of per-thread sample buffers, bounded by the memory
+                  cap */
+  type::overflow_policy_t overflow_policy =
+      type::OVERFLOW_DROP; /**<what to do when the memory cap is reached */
+  volatile int downsample_rate =
+      1; /**<one of every downsample_rate samples is recorded */
+  volatile int downsampled =
+      0; /**<whether downsample_rate is raised since the last merge */
+  volatile unsigned long int dropped_sample_count =
+      0; /**<amount of samples dropped for lack of memory */
+  unsigned long int dumped_dropped_sample_count =
+      0; /**<amount of dropped samples reported in output files */
+  volatile unsigned long int truncated_call_path_count =
+      0; /**<amount of call paths truncated as the CCT is full */
+  unsigned long int reported_truncated_call_path_count =
+      0; /**<amount of truncated call paths reported by Dump */
+  unsigned long int instance_id =
+      0; /**<unique id to match thread-local buffer cache with this object */
+  volatile int shared_data_lock =
+      0; /**<spin lock of merged records and output file */
+  ADS *async_dump =
+      nullptr; /**<back buffer and writer thread, nullptr if dump is sync */
   FILE *perf_data_fp = nullptr;    /**<file handler for output */
   std::ifstream perf_data_in_file; /**<file handler for input */
   bool has_open_output_file =
       false; /**<flag for record whether output file has open or not*/
   char file_name[MAX_LINE_LEN] = {0}; /**<file name for output */
-  // TODO: design a method to make metric_name portable
-  std::string metric_name = std::string("TOT_CYC"); /**<metric name */
+  type::perf_data_format_t dump_format =
+      type::PERF_DATA_BINARY; /**<file format for output */
+  std::vector<std::string> metric_names = {
+      std::string("TOT_CYC")}; /**<names of the value columns of records */
+  bool has_metric_names = false; /**<whether metric_names are set or read,
+                                    otherwise they follow the first file read */
+  type::perf_data_t sample_period =
+      0; /**<events between two samples, 0 if unknown */
+  type::perf_data_t sample_event_rate =
+      0; /**<events per second of the sampling event, 0 if unknown */
+
+  /** Get the sample buffer of the calling thread, claim a free one or map a
+   * new one if the thread has none. The buffer is retired when the thread
+   * exits. Async-signal-safe.
+   * @return sample buffer of the calling thread, nullptr if out of memory
+   */
+  TBS *GetThreadBuffer();
+
+  /** Give up the sample buffer of the calling thread, it is merged and freed
+   * by the next MergeThreadBuffers. Async-signal-safe.
+   */
+  void RetireThreadBuffer();
+
+  /** Apply overflow_policy to a sample that finds no room under the memory
+   * cap. Async-signal-safe, a flush never waits for file I/O, so it only
+   * makes room when the shared records or the writer thread of async dump
+   * can take the samples.
+   * @param flushed - whether the sample has caused a flush, it is set if the
+   * sample causes one now
+   * @return true if room is made and the sample should be retried, false if
+   * the sample is dropped
+   */
+  bool HandleOverflow(bool *flushed);
+
+  /** Merge all per-thread sample buffers into the shared records. Caller must
+   * hold shared_data_lock.
+   * @param wait - whether to wait for buffers being recorded and for the
+   * writer thread when the shared records are full, or leave those buffers
+   * to the next merge. A signal handler must not wait.
+   */
+  void MergeThreadBuffers(bool wait);
+
+  /** Write the shared records to the output file and reset them. Caller must
+   * hold shared_data_lock.
+   */
+  void DumpSharedData();
+
+  /** Get the child of a CCT node, create it if absent. Caller must hold
+   * shared_data_lock.
+   * @param parent - id of the parent node
+   * @param addr - address of the child
+   * @param insert - whether to create the child if absent
+   * @return id of the child, CCT root if it is absent and not created
+   */
+  unsigned long int GetCCTChild(unsigned long int parent,
+                                baguatool::type::addr_t addr, bool insert);
+
+  /** Double the hash index of CCT nodes. Async-signal-safe.
+   * @return false if out of memory
+   */
+  bool ExpandCCTIndex();
+
+  /** Double the memory of CCT nodes of a read-only PerfData, which may move
+   * them
+   * @return false if out of memory
+   */
+  bool ExpandCCTMem();
+
+  /** Get the CCT node of a call path, create nodes if absent. Caller must
+   * hold shared_data_lock.
+   * @param call_path - call path, innermost frame first
+   * @param call_path_len - depth of the call path
+   * @return id of the node, a node of the longest prefix if the CCT is full
+   */
+  unsigned long int InsertCCTPath(baguatool::type::addr_t *call_path,
+                                  int call_path_len);
+
+  /** Find the CCT node of a call path
+   * @param call_path - call path, innermost frame first
+   * @param call_path_len - depth of the call path
+   * @return id of the node, -1 if absent
+   */
+  long int FindCCTPath(baguatool::type::addr_t *call_path,
+                       int call_path_len);
+
+  /** Make room in the shared records. Write them synchronously, or hand them
+   * to the writer thread and continue with the back buffer if dump is async.
+   * Caller must hold shared_data_lock.
+   * @param wait - whether to wait for the writer thread if the back buffer is
+   * still being written, or to write synchronously if dump is sync. A signal
+   * handler must not wait.
+   * @return false if no room is made as wait is false
+   */
+  bool FlushSharedData(bool wait);
+
+  /** Open the output file if it is not open
+   * @return false if the output file fails to open
+   */
+  bool OpenOutputFile();
+
+  /** Account the current memory of sample buffers, shared records and the
+   * CCT to the peak memory of the self statistics */
+  void UpdatePeakMem();
+
+  /** Map metrics of a file to metric indices of this PerfData by name. A
+   * PerfData without data or set metric names adopts the metrics of the file,
+   * unknown metrics are appended while there is room.
+   * @param metric_names - metric names of the file, empty if the file does
+   * not name its metrics, which are then mapped to the same indices
+   * @param num_metrics - number of metrics of the file
+   * @param metric_map - metric index here of each metric of the file, -1 if
+   * there is no room for it
+   */
+  void MapMetrics(std::vector<std::string> &metric_names, int num_metrics,
+                  std::vector<int> &metric_map);
+
+  /** Append records and the CCT nodes they need to the output file as a
+   * section of dump_format
+   * @param cct_node_count - amount of CCT nodes when the records are taken
+   * @param dropped_sample_count - amount of dropped samples when the records
+   * are taken, the ones not reported yet are written with the records
+   * @return number of bytes written
+   */
+  unsigned long int DumpSection(VDS *vertex_data,
+                                unsigned long int vertex_data_count,
+                                EDS *edge_data,
+                                unsigned long int edge_data_count,
+                                unsigned long int cct_node_count,
+                                unsigned long int dropped_sample_count);
+
+  /** Append records to the output file as a text section */
+  void DumpTextSection(VDS *vertex_data, unsigned long int vertex_data_count,
+                       EDS *edge_data, unsigned long int edge_data_count,
+                       unsigned long int dropped_sample_count);
+
+  /** Append records and CCT nodes to the output file as a binary section */
+  void DumpBinarySection(VDS *vertex_data,
+                         unsigned long int vertex_data_count, EDS *edge_data,
+                         unsigned long int edge_data_count,
+                         unsigned long int cct_node_count,
+                         unsigned long int dropped_sample_count);
+
+  /** Entry of the writer thread of async dump
+   * @param arg - the ADS of a PerfData
+   */
+  static void *AsyncDumpThread(void *arg);
+
+  /** Entry of a reader thread of ReadAll
+   * @param arg - the RSS of a shard
+   */
+  static void *ReadShardThread(void *arg);
+
+  /** Append records of another PerfData, whose CCT nodes are merged into
+   * this CCT. Records keep their order, as if the files of the other were
+   * read after the files of this one.
+   * @param perf_data - PerfData to append
+   */
+  void Append(PerfData *perf_data);
+
+  /** Read all sections of a text performance data file */
+  void ReadText(const char *file_name);
+
+  /** Read all sections of a binary performance data file through mmap
+   * @return false if the file is not a valid binary performance data file
+   */
+  bool ReadBinary(const char *file_name);
 
 public:
   /** Default Constructor
    */
   PerfData();
+  /** Constructor of a PerfData that may only read, append and dump files,
+   * e.g. a shard of ReadAll. It reserves no memory for samples and grows its
+   * CCT on demand instead of reserving MAX_CCT_MEM, so that many of them fit
+   * in a limited address space. It must not record samples nor dump async.
+   * @param read_only - whether the PerfData is read-only
+   */
+  explicit PerfData(bool read_only);
   /** Default Destructor
    */
   ~PerfData();
@@ -1045,17 +1349,87 @@ public:
    */
   void ExpandEdgeDataMem();
 
-  /** Read vertex type and edge type performance data (Input)
+  /**
+   * @brief Rebuild the hash index of Vertex Data after its memory is resized
+   * or its records are reset
+   *
+   */
+  void RebuildVertexDataIndex();
+
+  /**
+   * @brief Rebuild the hash index of Edge Data after its memory is resized or
+   * its records are reset
+   *
+   */
+  void RebuildEdgeDataIndex();
+
+  /** Read vertex type and edge type performance data (Input). Text and binary
+   * files are detected automatically.
    * @param file_name - name of input file
    */
   void Read(const char *file_name);
 
-  /** Dump vertex type and edge type performance data (Output)
+  /** Read multiple files of performance data concurrently. Files are split
+   * into contiguous shards parsed by reader threads, then the shards are
+   * appended in order, so the result is the same as reading the files one
+   * after another. Unreadable files are skipped.
+   * @param file_names - names of input files
+   * @param num_threads - number of reader threads, 0 for all online cores
+   */
+  void ReadAll(const std::vector<std::string> &file_names, int num_threads);
+
+  /** Merge per-thread sample buffers, then dump vertex type and edge type
+   * performance data (Output). Must not be called from a thread whose
+   * sampling is active, except from inside its overflow handler. Call paths
+   * truncated since the last dump, for lack of CCT memory, are logged.
    * @param file_name - name of output file
    */
   void Dump(const char *file_name);
 
-  /** Get size of recorded vertex type performance data
+  /** Enable or disable async dump. When enabled, full records are handed to
+   * a writer thread while recording continues into a back buffer, so that
+   * sampling never blocks on file I/O. The number of swaps and bytes written
+   * is reported when it is disabled or the PerfData is destroyed. Must not be
+   * called from a signal handler.
+   * @param enable - whether to dump asynchronously
+   */
+  void SetAsyncDump(bool enable);
+
+  /** Set memory cap of per-thread sample buffers. Default is
+   * MAX_SAMPLE_MEM bytes, or the environment variable PERF_DATA_MEM_CAP. Must
+   * be called before recording starts.
+   * @param mem_cap - memory cap in bytes
+   */
+  void SetMemoryCap(size_t mem_cap);
+
+  /** Set what to do with a sample that finds no room under the memory cap.
+   * Default is drop, or the environment variable PERF_DATA_OVERFLOW ("drop",
+   * "flush" or "downsample").
+   * @param policy - overflow policy
+   */
+  void SetOverflowPolicy(type::overflow_policy_t policy);
+
+  /** Get amount of samples dropped for lack of memory, including the ones
+   * read from files
+   * @return amount of dropped samples
+   */
+  unsigned long int GetDroppedSampleCount();
+
+  /** Set file format of Dump. Default is binary, or text if the environment
+   * variable PERF_DATA_FORMAT is "text". The format does not follow the
+   * extension of the file name. Collectors keep their .TXT names in both
+   * formats for the offline tools, and Read tells the formats apart by magic.
+   * @param format - file format
+   */
+  void SetDumpFormat(type::perf_data_format_t format);
+
+  /** Get file format of Dump
+   * @return file format
+   */
+  type::perf_data_format_t GetDumpFormat();
+
+  /** Get size of recorded vertex type performance data. Samples still held in
+   * per-thread buffers are not counted until Dump.
    * @return size of recorded vertex type performance data
    */
   unsigned long int GetVertexDataSize();
@@ -1075,6 +1449,54 @@ public:
    */
   std::string &GetMetricName();
 
+  /** Set names of all metrics, each record carries one value per metric. Must
+   * be called before recording starts.
+   * @param metric_names - names of the metrics, at most MAX_NUM_METRICS
+   */
+  void SetMetricNames(std::vector<std::string> &metric_names);
+
+  /** Get number of metrics
+   * @return number of metrics
+   */
+  int GetNumMetrics();
+
+  /** Get name of a metric
+   * @param metric_index - index of the metric
+   * @return name of the metric
+   */
+  std::string &GetMetricName(int metric_index);
+
+  /** Get index of a metric by its name
+   * @param metric_name - name of the metric
+   * @return index of the metric, -1 if absent
+   */
+  int GetMetricIndex(std::string &metric_name);
+
+  /** Set the sampling period of the records. It is written in every section
+   * of output files, so that offline analysis can turn sample counts into
+   * seconds.
+   * @param sample_period - events of the sampling event between two samples
+   * @param event_rate - events per second of the sampling event, as
+   * calibrated by the sampler
+   */
+  void SetSamplePeriod(type::perf_data_t sample_period,
+                       type::perf_data_t event_rate);
+
+  /** Get the sampling period of the records
+   * @return events between two samples, 0 if unknown
+   */
+  type::perf_data_t GetSamplePeriod();
+
+  /** Get the rate of the sampling event
+   * @return events per second, 0 if unknown
+   */
+  type::perf_data_t GetSampleEventRate();
+
+  /** Get the time a sample stands for
+   * @return seconds between two samples, 0 if unknown
+   */
+  type::perf_data_t GetSampleTime();
+
   /** Query a piece of vertex type performance data by (call path, call path
    * length, process id, thread id)
    * @param call_path - call path
@@ -1103,7 +1525,9 @@ public:
                     int out_call_path_len, int procs_id, int out_procs_id,
                     int thread_id, int out_thread_id);
 
-  /** Record a piece of vertex type performance data
+  /** Record a piece of vertex type performance data into the buffer of the
+   * calling thread. Lock-free with respect to other threads and
+   * async-signal-safe.
    * @param call_path - call path
    * @param call_path_len - depth of the call path
    * @param procs_id - process id
@@ -1114,6 +1538,27 @@ public:
                         int procs_id, int thread_id,
                         baguatool::type::perf_data_t value);
 
+  /** Record a value of a metric of a piece of vertex type performance data,
+   * the same as above but for the metric metric_index instead of the first
+   * one. An unknown metric_index drops the value silently, unlike
+   * RecordEdgeData, as logging an error is not async-signal-safe.
+   * @param metric_index - index of the metric
+   */
+  void RecordVertexData(baguatool::type::addr_t *call_path, int call_path_len,
+                        int procs_id, int thread_id, int metric_index,
+                        baguatool::type::perf_data_t value);
+
+  /** Record values of the first num_values metrics of a piece of vertex type
+   * performance data at once, e.g. all counters read at one overflow, so the
+   * call path is looked up only once
+   * @param values - values of metrics 0 to num_values - 1
+   * @param num_values - number of values
+   */
+  void RecordVertexData(baguatool::type::addr_t *call_path, int call_path_len,
+                        int procs_id, int thread_id,
+                        const baguatool::type::perf_data_t *values,
+                        int num_values);
+
   /** Record a piece of edge type performance data
    * @param call_path - call path of source
    * @param call_path_len - depth of the call path of source
@@ -1131,6 +1576,17 @@ public:
                       int thread_id, int out_thread_id,
                       baguatool::type::perf_data_t value);
 
+  /** Record a value of a metric of a piece of edge type performance data, the
+   * same as above but for the metric metric_index instead of the first one.
+   * An unknown metric_index is logged as an error and the value is dropped.
+   * @param metric_index - index of the metric
+   */
+  void RecordEdgeData(baguatool::type::addr_t *call_path, int call_path_len,
+                      baguatool::type::addr_t *out_call_path,
+                      int out_call_path_len, int procs_id, int out_procs_id,
+                      int thread_id, int out_thread_id, int metric_index,
+                      baguatool::type::perf_data_t value);
+
   /** Query call path of a piece of vertex type performance data through index
    * @param data_index - index of the piece of data
    * @param call_path - call path of this piece of data
@@ -1163,18 +1619,136 @@ public:
   void GetEdgeDataDestCallPath(unsigned long int data_index,
                                std::stack<unsigned long long> &call_path);
 
+  /** Query call path of a piece of vertex type performance data through index
+   * without allocating a stack. The call path is filtered as above and filled
+   * into the tail of a buffer, which only grows when a deeper call path is
+   * met, so it can be reused across pieces of data.
+   * @param data_index - index of the piece of data
+   * @param buffer - reusable buffer to fill the call path into
+   * @param call_path_len - length of the call path
+   * @return pointer to the outermost frame of the call path in buffer
+   */
+  baguatool::type::addr_t *
+  GetVertexDataCallPath(unsigned long int data_index,
+                        std::vector<baguatool::type::addr_t> &buffer,
+                        int &call_path_len);
+
+  /** Query source call path of a piece of edge type performance data through
+   * index without allocating a stack, see the vertex version above
+   * @param data_index - index of the piece of data
+   * @param buffer - reusable buffer to fill the call path into
+   * @param call_path_len - length of the call path
+   * @return pointer to the outermost frame of the call path in buffer
+   */
+  baguatool::type::addr_t *
+  GetEdgeDataSrcCallPath(unsigned long int data_index,
+                         std::vector<baguatool::type::addr_t> &buffer,
+                         int &call_path_len);
+
+  /** Query destination call path of a piece of edge type performance data
+   * through index without allocating a stack, see the vertex version above
+   * @param data_index - index of the piece of data
+   * @param buffer - reusable buffer to fill the call path into
+   * @param call_path_len - length of the call path
+   * @return pointer to the outermost frame of the call path in buffer
+   */
+  baguatool::type::addr_t *
+  GetEdgeDataDestCallPath(unsigned long int data_index,
+                          std::vector<baguatool::type::addr_t> &buffer,
+                          int &call_path_len);
+
+  /** Get an iterator to the first piece of vertex type performance data
+   * @return iterator
+   */
+  VertexDataIterator VertexDataBegin();
+
+  /** Get an iterator past the last piece of vertex type performance data
+   * @return iterator
+   */
+  VertexDataIterator VertexDataEnd();
+
+  /** Get all vertex type performance data as a range
+   * @return range from VertexDataBegin to VertexDataEnd
+   */
+  VertexDataRange GetVertexDataRange();
+
+  /** Query CCT node of the call path of a piece of vertex type performance
+   * data through index. Walk the call path with GetCCTNodeAddr and
+   * GetCCTNodeParent instead of copying it.
+   * @param data_index - index of the piece of data
+   * @return id of the CCT node
+   */
+  unsigned long int GetVertexDataCCTNode(unsigned long int data_index);
+
+  /** Query CCT node of the source call path of a piece of edge type
+   * performance data through index
+   * @param data_index - index of the piece of data
+   * @return id of the CCT node
+   */
+  unsigned long int GetEdgeDataSrcCCTNode(unsigned long int data_index);
+
+  /** Query CCT node of the destination call path of a piece of edge type
+   * performance data through index
+   * @param data_index - index of the piece of data
+   * @return id of the CCT node
+   */
+  unsigned long int GetEdgeDataDestCCTNode(unsigned long int data_index);
+
+  /** Get number of CCT nodes, including the root (node 0)
+   * @return number of CCT nodes
+   */
+  unsigned long int GetCCTSize();
+
+  /** Get address of a CCT node, which is the innermost frame of its call path
+   * @param node_id - id of the CCT node
+   * @return address
+   */
+  baguatool::type::addr_t GetCCTNodeAddr(unsigned long int node_id);
+
+  /** Get parent of a CCT node, which is the caller of its innermost frame. A
+   * walk from a node to the root (node 0) visits its call path from the
+   * innermost frame.
+   * @param node_id - id of the CCT node
+   * @return id of the parent node
+   */
+  unsigned long int GetCCTNodeParent(unsigned long int node_id);
+
+  /** Get depth of a CCT node, which is the length of its call path
+   * @param node_id - id of the CCT node
+   * @return depth, 0 for the root
+   */
+  int GetCCTNodeDepth(unsigned long int node_id);
+
   /** Query value of a piece of vertex type performance data through index
    * @param data_index - index of the piece of data
    * @return value of the queried piece of data
    */
   baguatool::type::perf_data_t GetVertexDataValue(unsigned long int data_index);
 
+  /** Query value of a metric of a piece of vertex type performance data
+   * through index
+   * @param data_index - index of the piece of data
+   * @param metric_index - index of the metric
+   * @return value of the metric of the queried piece of data
+   */
+  baguatool::type::perf_data_t GetVertexDataValue(unsigned long int data_index,
+                                                  int metric_index);
+
   /** Query value of a piece of edge type performance data through index
    * @param data_index - index of the piece of data
    * @return value of the queried piece of data
    */
   baguatool::type::perf_data_t GetEdgeDataValue(unsigned long int data_index);
 
+  /** Query value of a metric of a piece of edge type performance data through
+   * index
+   * @param data_index - index of the piece of data
+   * @param metric_index - index of the metric
+   * @return value of the metric of the queried piece of data
+   */
+  baguatool::type::perf_data_t GetEdgeDataValue(unsigned long int data_index,
+                                                int metric_index);
+
   /** Query process id of a piece of vertex type performance data through index
    * @param data_index - index of the piece of data
    * @return process id of the queried piece of data
@@ -1216,6 +1790,128 @@ public:
   int GetEdgeDataDestThreadId(unsigned long int data_index);
 };
 
+/** Forward iterator over vertex type performance data. The call path of the
+ * current piece of data is exposed as an array from the outermost frame,
+ * filled into a buffer owned by the iterator, so a pass over all samples
+ * does not allocate per sample. Dereferencing yields the iterator itself,
+ * a view of the current piece of data.
+ *   for (const auto &data : perf_data->GetVertexDataRange()) {
+ *     Use(data.GetCallPath(), data.GetCallPathLen());
+ *   }
+ */
+class VertexDataIterator {
+private:
+  PerfData *perf_data;                         /**<iterated data */
+  unsigned long int data_index;                /**<index of current data */
+  std::vector<baguatool::type::addr_t> buffer; /**<reused call path buffer */
+  int call_path_offset = 0; /**<start of call path in buffer, an offset
+                               rather than a pointer so that copies own
+                               their call path */
+  int call_path_len = 0;    /**<length of call path */
+
+  /** Fill the call path of current piece of data */
+  void Load();
+
+public:
+  typedef std::forward_iterator_tag iterator_category;
+  typedef VertexDataIterator value_type;
+  typedef long int difference_type;
+  typedef const VertexDataIterator *pointer;
+  typedef const VertexDataIterator &reference;
+
+  /** Constructor.
+   * @param perf_data - performance data to iterate
+   * @param data_index - index of the first piece of data to visit
+   */
+  VertexDataIterator(PerfData *perf_data, unsigned long int data_index);
+
+  /** Move to the next piece of data
+   * @return this iterator
+   */
+  VertexDataIterator &operator++();
+
+  /** Move to the next piece of data
+   * @return a copy of this iterator before the move
+   */
+  VertexDataIterator operator++(int);
+
+  /** Get current piece of data, valid until the iterator moves
+   * @return this iterator
+   */
+  reference operator*() const;
+
+  /** Access current piece of data, valid until the iterator moves
+   * @return this iterator
+   */
+  pointer operator->() const;
+
+  /** Compare positions of two iterators
+   * @param other - another iterator over the same data
+   * @return true if the iterators are at the same piece of data
+   */
+  bool operator==(const VertexDataIterator &other) const;
+
+  /** Compare positions of two iterators
+   * @param other - another iterator over the same data
+   * @return true if the iterators are at different pieces of data
+   */
+  bool operator!=(const VertexDataIterator &other) const;
+
+  /** Get index of current piece of data, to query it through PerfData
+   * @return index of current piece of data
+   */
+  unsigned long int GetDataIndex() const;
+
+  /** Get call path of current piece of data. It is valid until the iterator
+   * moves.
+   * @return pointer to the outermost frame of the call path
+   */
+  const baguatool::type::addr_t *GetCallPath() const;
+
+  /** Get length of call path of current piece of data
+   * @return length of the call path
+   */
+  int GetCallPathLen() const;
+
+  /** Get value of a metric of current piece of data
+   * @param metric_index - index of the metric
+   * @return value of the metric
+   */
+  baguatool::type::perf_data_t GetValue(int metric_index) const;
+
+  /** Get process id of current piece of data
+   * @return process id
+   */
+  int GetProcsId() const;
+
+  /** Get thread id of current piece of data
+   * @return thread id
+   */
+  int GetThreadId() const;
+};
+
+/** Range of all vertex type performance data, for range-based for loops */
+class VertexDataRange {
+private:
+  PerfData *perf_data; /**<iterated data */
+
+public:
+  /** Constructor.
+   * @param perf_data - performance data to iterate
+   */
+  explicit VertexDataRange(PerfData *perf_data);
+
+  /** Get an iterator to the first piece of data
+   * @return iterator
+   */
+  VertexDataIterator begin() const;
+
+  /** Get an iterator past the last piece of data
+   * @return iterator
+   */
+  VertexDataIterator end() const;
+};
+
 // class HybridAnalysis {
 //  private:
 //   std::map<std::string, ControlFlowGraph*> func_cfg_map; /**<control-flow
@@ -1345,16 +2041,58 @@ public:
 class LongLongVec;
 class SamplerImpl;
 
+#ifndef MAX_NUM_EVENTS
+#define MAX_NUM_EVENTS 4
+#endif
+
+// Event index passed to the overflow function in wall-clock samples
+#define WALL_CLOCK_EVENT MAX_NUM_EVENTS
+
+// Metrics of a sample, the events and the wall-clock metrics
+#define MAX_NUM_SAMPLE_METRICS (MAX_NUM_EVENTS + 2)
+
+/** Backends of Sampler */
+enum SamplerBackend {
+  PAPI_SAMPLER = 0,       /**<PAPI_overflow on PAPI_TOT_CYC */
+  PERF_EVENT_SAMPLER = 1, /**<perf_event_open with mmap ring buffers */
+};
+
+/** Ways to unwind call paths in Sampler::GetBacktrace and Backtrace */
+enum UnwindMode {
+  LIBUNWIND_UNWIND = 0,     /**<unw_step on every frame */
+  FRAME_POINTER_UNWIND = 1, /**<walk of saved frame pointers */
+  CACHED_UNWIND = 2,        /**<per-thread cache of frame layouts keyed by
+                               return address, unw_step on misses */
+};
+
+/** Cost of unwinding call paths, summed over all threads */
+typedef struct UnwindCostStruct {
+  unsigned long long num_unwinds = 0; /**<number of unwound call paths */
+  unsigned long long num_frames = 0;  /**<number of walked frames */
+  unsigned long long num_steps = 0;   /**<frames walked with unw_step */
+  unsigned long long time = 0;        /**<time of unwinding in nanoseconds */
+} UnwindCost;
+
+/** Unwind the call path of the calling thread in the unwind mode of the
+ * samplers, for collectors that record call paths outside samples, e.g. at
+ * MPI calls.
+ * @param pcs - return addresses, from the caller of Backtrace outward (output)
+ * @param max_depth - max depth of call path
+ * @return depth of call path
+ */
+int Backtrace(type::addr_t *pcs, int max_depth);
+
 /** Runtime sampler.
  *
  */
 class Sampler {
 private:
-  std::unique_ptr<SamplerImpl> sa; /**< wrapper of sampler based on papi tool*/
+  std::unique_ptr<SamplerImpl> sa; /**< wrapper of the sampler backend */
+  SamplerBackend backend;          /**< backend in use */
 
 public:
-  /** Constructor.
-   *
+  /** Constructor. The backend is PAPI, or perf_event if the environment
+   * variable SAMPLER_BACKEND is "perf_event".
    */
   Sampler();
 
@@ -1363,11 +2101,140 @@ public:
    */
   ~Sampler();
 
-  /** Set sampling frequence to input value.
+  /** Choose the backend. It must be called before Setup.
+   * PERF_EVENT_SAMPLER needs no PAPI nor hardware counter access: it samples
+   * cycles if they are available, and cpu-clock or task-clock software events
+   * otherwise. Samples are read from a ring buffer in batches, and their call
+   * paths are unwound by the kernel through frame pointers.
+   * @param backend - backend of the sampler
+   */
+  void SetBackend(SamplerBackend backend);
+
+  /** Get the backend in use
+   * @return backend of the sampler
+   */
+  SamplerBackend GetBackend();
+
+  /** Choose events to count, which are PAPI_TOT_CYC for PAPI and cycles for
+   * perf_event by default. The first event triggers samples at the sampling
+   * frequency, and all of them are read at each sample. It must be called
+   * before SetOverflow. The environment variable SAMPLER_EVENTS sets them as
+   * a comma-separated list, e.g. "PAPI_TOT_CYC,PAPI_L1_DCM,PAPI_TOT_INS", or
+   * "cycles,cache-misses,instructions" for perf_event.
+   * @param event_names - names of at most MAX_NUM_EVENTS events
+   */
+  void SetEvents(std::vector<std::string> &event_names);
+
+  /** Get number of counted events
+   * @return number of events
+   */
+  int GetNumEvents();
+
+  /** Get name of an event
+   * @param event_index - index of the event, 0 for the one triggering samples
+   * @return name of the event
+   */
+  std::string &GetEventName(int event_index);
+
+  /** Get increments of the counters of all events on the calling thread since
+   * the last call. In the overflow function they are the counts to attribute
+   * to the sampled call path.
+   * @param deltas - increments of the counters (output)
+   * @param max_num_events - size of deltas
+   * @return number of events filled into deltas
+   */
+  int GetEventDeltas(long long *deltas, int max_num_events);
+
+  /** Set sampling frequence to input value. The period of the first event is
+   * its rate divided by freq, and Setup measures the rate on a busy loop, e.g.
+   * the effective cycle rate with turbo.
    * @param freq - frequence
    */
   void SetSamplingFreq(int freq);
 
+  /** Get the sampling period
+   * @return events of the first event between two samples
+   */
+  unsigned long long GetSamplePeriod();
+
+  /** Get the rate of the first event measured by Setup, or its nominal rate
+   * if it could not be measured
+   * @return events per second
+   */
+  double GetEventRate();
+
+  /** Bound the overhead of sampling. Each thread measures the time of its
+   * sample handlers over its CPU time, and multiplies the sampling period by
+   * a power of two, up to SAMPLER_MAX_PERIOD_SCALE, to stay under the target.
+   * Samples must then be weighted by GetSampleWeight. The environment
+   * variable SAMPLER_MAX_OVERHEAD sets it, e.g. "0.02".
+   * @param max_overhead - fraction of time in sample handlers, 0 to sample at
+   * a fixed period
+   */
+  void SetMaxOverhead(double max_overhead);
+
+  /** Get the target overhead of sampling
+   * @return fraction of time in sample handlers, 0 if the period is fixed
+   */
+  double GetMaxOverhead();
+
+  /** Get the weight of the sample being handled on the calling thread
+   * @return number of sampling periods (GetSamplePeriod) it stands for
+   */
+  type::perf_data_t GetSampleWeight();
+
+  /** Also take wall-clock samples of each thread with a POSIX timer of
+   * CLOCK_MONOTONIC, whether the thread is on-CPU or blocked, e.g. in I/O,
+   * locks or MPI_Wait. The overflow function is executed with
+   * WALL_CLOCK_EVENT for them. Blocking calls are interrupted by samples and
+   * restarted, but sleep and some others return early with EINTR. The
+   * environment variable SAMPLER_WALL_CLOCK_FREQ sets it. It must be called
+   * before SetOverflow.
+   * @param freq - wall-clock samples per second of each thread, 0 to disable
+   */
+  void SetWallClockFreq(int freq);
+
+  /** Get the frequency of wall-clock samples
+   * @return samples per second, 0 if disabled
+   */
+  int GetWallClockFreq();
+
+  /** Get names of the metrics of samples: the events, of which the first one
+   * counts sampling periods, then WALL_TIME and OFF_CPU in seconds if
+   * wall-clock samples are taken
+   * @param metric_names - names of at most MAX_NUM_SAMPLE_METRICS metrics
+   * (output)
+   */
+  void GetMetricNames(std::vector<std::string> &metric_names);
+
+  /** Get values of the metrics of the sample being handled by the calling
+   * thread, in the order of GetMetricNames. A wall-clock sample only has
+   * WALL_TIME, and OFF_CPU if the thread was blocked, which is the case if it
+   * ran less than half of the time since its last wall-clock sample.
+   * @param values - values of metrics (output)
+   * @param max_num_values - size of values
+   * @return number of values filled
+   */
+  int GetSampleValues(type::perf_data_t *values, int max_num_values);
+
+  /** Prepare a PerfData for the samples of this sampler: name its metrics
+   * after GetMetricNames and record the sample period. It must be called
+   * after Setup, SetSamplingFreq and SetOverflow, and before Start.
+   * @param perf_data - performance data the overflow function records into
+   * @param async_dump - whether to hand full buffers to a writer thread
+   * instead of writing them in the overflow function
+   */
+  void ConfigurePerfData(core::PerfData *perf_data, bool async_dump);
+
+  /** Stop sampling, then dump the samples and the cost of the collector
+   * itself, which includes the last dump
+   * @param perf_data - performance data the overflow function records into
+   * @param file_name - name of the output file of samples
+   * @param self_stats_file_name - name of the output file of self statistics
+   */
+  void FinishPerfData(core::PerfData *perf_data, const char *file_name,
+                      const char *self_stats_file_name);
+
   /** Setup (Initialize).
    *
    */
@@ -1411,6 +2278,34 @@ public:
    */
   int GetOverflowEvent(LongLongVec *overflow_vector);
 
+  /** Choose how GetBacktrace unwinds call paths. It applies to all threads and
+   * samplers of the process. The environment variable SAMPLER_UNWIND sets it
+   * as "libunwind" (default), "fp" or "cached".
+   * FRAME_POINTER_UNWIND is the cheapest, but skips or truncates frames of code
+   * built without frame pointers. In the overflow function of PAPI it starts
+   * from the interrupted instruction, so start_depth of GetBacktrace is
+   * ignored. CACHED_UNWIND remembers the frame layout at each return address,
+   * and only calls unw_step for addresses met for the first time. Both fall
+   * back to LIBUNWIND_UNWIND on other architectures than x86_64.
+   * @param mode - unwind mode
+   */
+  void SetUnwindMode(UnwindMode mode);
+
+  /** Get the unwind mode in use
+   * @return unwind mode
+   */
+  UnwindMode GetUnwindMode();
+
+  /** Get the cost of unwinding since the start of the process
+   * @param cost - cost of unwinding (output)
+   */
+  void GetUnwindCost(UnwindCost &cost);
+
+  /** Print the cost of unwinding per call path if the environment variable
+   * SAMPLER_UNWIND_REPORT is set, to compare unwind modes on an application.
+   */
+  void ReportUnwindCost();
+
   /** backtrace.
    * @param call_path - call path (output)
    * @param max_call_path_depth - max depth of call path
@@ -0,0 +1,105 @@
+#ifndef TOKENIZER_H_
+#define TOKENIZER_H_
+
+#include <charconv>
+#include <cstdlib>
+#include <string_view>
+#include <system_error>
+
+/** Split a string into tokens in place, without copying it or allocating.
+ * Like strtok, consecutive delimiters are merged and empty tokens are
+ * skipped. The string must outlive the tokens.
+ */
+class Tokenizer {
+private:
+  std::string_view str; /**<rest of the string to split */
+  std::string_view delims; /**<delimiter characters */
+
+public:
+  /** Constructor.
+   * @param str - string to split
+   * @param delims - delimiter characters
+   */
+  Tokenizer(std::string_view str, std::string_view delims)
+      : str(str), delims(delims) {}
+
+  /** Get the next token
+   * @param token - the next token
+   * @return false if no token is left
+   */
+  bool Next(std::string_view &token) {
+    const char *p = this->str.data();
+    const char *end = p + this->str.size();
+    while (p < end && this->IsDelim(*p)) {
+      p++;
+    }
+    if (p == end) {
+      this->str = std::string_view();
+      return false;
+    }
+    const char *begin = p;
+    while (p < end && !this->IsDelim(*p)) {
+      p++;
+    }
+    token = std::string_view(begin, p - begin);
+    this->str = std::string_view(p, end - p);
+    return true;
+  }
+
+private:
+  // A plain loop over a few delimiters is much faster than find_first_of
+  bool IsDelim(char c) const {
+    for (char delim : this->delims) {
+      if (c == delim) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+/** Remove leading and trailing spaces of a token */
+inline std::string_view TrimToken(std::string_view token) {
+  size_t begin = token.find_first_not_of(" \t\r\n");
+  if (begin == std::string_view::npos) {
+    return std::string_view();
+  }
+  size_t end = token.find_last_not_of(" \t\r\n");
+  return token.substr(begin, end - begin + 1);
+}
+
+/** Parse an integer token in place with std::from_chars. Surrounding spaces
+ * are ignored.
+ * @param token - token to parse
+ * @param value - parsed value
+ * @param base - base of the integer, e.g. 16 for hex addresses without "0x"
+ * @return false if the token is not a whole integer
+ */
+template <class T>
+inline bool ParseToken(std::string_view token, T &value, int base = 10) {
+  token = TrimToken(token);
+  const char *end = token.data() + token.size();
+  std::from_chars_result res = std::from_chars(token.data(), end, value, base);
+  return res.ec == std::errc() && res.ptr == end;
+}
+
+/** Parse a floating-point token in place
+ * @param token - token to parse
+ * @param value - parsed value
+ * @return false if the token is not a whole number
+ */
+inline bool ParseToken(std::string_view token, double &value) {
+  token = TrimToken(token);
+  const char *end = token.data() + token.size();
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+  std::from_chars_result res = std::from_chars(token.data(), end, value);
+  return res.ec == std::errc() && res.ptr == end;
+#else
+  // strtod stops at the delimiter that follows the token
+  char *parse_end = nullptr;
+  value = strtod(token.data(), &parse_end);
+  return !token.empty() && parse_end == end;
+#endif
+}
+
+#endif
@@ -35,13 +35,17 @@ void split(const string &str, const string &delim, vector<string> &res) {
   char *d = new char[delim.length() + 1];
   strcpy(d, delim.c_str());
 
-  char *p = strtok(strs, d);
+  // strtok_r instead of strtok, files are parsed by concurrent threads
+  char *save = nullptr;
+  char *p = strtok_r(strs, d, &save);
   while (p) {
     string s = p;     // convert splited p from char* to string
     res.push_back(s); // store in res(result)
-    p = strtok(NULL, d);
+    p = strtok_r(NULL, d, &save);
   }
 
+  delete[] strs;
+  delete[] d;
   return;
 }
 
@@ -1,128 +1,188 @@
 #include "sampler.h"
 #include "baguatool.h"
+#include "collector/dynamic/wall_clock.h"
 
 namespace baguatool::collector {
 
-Sampler::Sampler() { this->sa = std::make_unique<SamplerImpl>(); }
+static __thread void (*func_at_overflow_1)(int) = nullptr;
+static __thread int EventSet;
+// PAPI codes of events in EventSet, in the order of the event set
+static __thread int event_codes[MAX_NUM_EVENTS];
+// Index in the event set of each event of the sampler, -1 if not counted
+static __thread int event_slots[MAX_NUM_EVENTS];
+static __thread int num_set_events = 0;
+static __thread int num_sampler_events = 0;
+// Threshold of the first event at the base sampling period
+static __thread int base_threshold = 0;
+// Counts accumulated since the last GetEventDeltas
+static __thread long long event_deltas[MAX_NUM_EVENTS];
+
+static void papi_handler(int EventSet, void *address, long_long overflow_vector,
+                         void *context);
+
+/** Stop counting and accumulate the counts, as PAPI_start resets counters */
+static void StopAndAccumulate() {
+  long long values[MAX_NUM_EVENTS] = {0};
+  TRY(PAPI_stop(EventSet, values), PAPI_OK);
+  for (int i = 0; i < num_sampler_events; i++) {
+    if (event_slots[i] >= 0) {
+      event_deltas[i] += values[event_slots[i]];
+    }
+  }
+}
 
-Sampler::~Sampler() {}
+PapiSamplerImpl::PapiSamplerImpl() {
+  cyc_sample_count = 0;
+  freq = DEFAULT_CYC_SAMPLE_COUNT;
+  event_names.push_back("PAPI_TOT_CYC");
+}
 
-void Sampler::SetSamplingFreq(int freq) { sa->SetSamplingFreq(freq); }
-void Sampler::Setup() { sa->Setup(); }
-void Sampler::AddThread() { sa->AddThread(); }
-void Sampler::RemoveThread() { sa->RemoveThread(); }
-void Sampler::UnsetOverflow() { sa->UnsetOverflow(); }
-void Sampler::SetOverflow(void (*FUNC_AT_OVERFLOW)(int)) {
-  sa->SetOverflow(FUNC_AT_OVERFLOW);
+void PapiSamplerImpl::SetEvents(std::vector<std::string> &event_names) {
+  std::string first_event = this->event_names[0];
+  SamplerImpl::SetEvents(event_names);
+  if (this->calibrated && this->event_names[0] != first_event) {
+    this->Calibrate();
+    this->UpdateSamplePeriod();
+  }
 }
-void Sampler::Start() { sa->Start(); }
-void Sampler::Stop() { sa->Stop(); }
-int Sampler::GetOverflowEvent(LongLongVec *overflow_vector) {
-  return sa->GetOverflowEvent(overflow_vector);
+
+void PapiSamplerImpl::SetSamplingFreq(int freq) {
+  // PAPI setup for main thread
+  // char* str = getenv("CYC_SAMPLE_COUNT");
+  // CYC_SAMPLE_COUNT = (str ? atoi(str) : DEFAULT_CYC_SAMPLE_COUNT);
+  this->freq = (freq > 0) ? freq : DEFAULT_CYC_SAMPLE_COUNT;
+  this->UpdateSamplePeriod();
 }
-int Sampler::GetBacktrace(type::addr_t *call_path, int max_call_path_depth) {
-  return sa->GetBacktrace(call_path, max_call_path_depth);
+
+void PapiSamplerImpl::UpdateSamplePeriod() {
+  // PAPI_overflow takes an int threshold
+  double period = this->event_rate / this->freq;
+  this->cyc_sample_count = (period < INT_MAX) ? (int)period : INT_MAX;
+  LOG_INFO("SET sampling interval to %d events of %s\n", this->cyc_sample_count,
+           this->event_names[0].c_str());
 }
-int Sampler::GetBacktrace(type::addr_t *call_path, int max_call_path_depth,
-                          int start_depth) {
-  return sa->GetBacktrace(call_path, max_call_path_depth, start_depth);
+
+unsigned long long PapiSamplerImpl::GetSamplePeriod() {
+  return this->cyc_sample_count;
 }
 
-static __thread void (*func_at_overflow_1)(int) = nullptr;
-static __thread int EventSet;
+void PapiSamplerImpl::Calibrate() {
+  int event_set = PAPI_NULL;
+  int code = PAPI_NULL;
+  long long count = 0;
+  long long elapsed = 0;
+  this->calibrated = true;
+  if (PAPI_event_name_to_code((char *)this->event_names[0].c_str(), &code) !=
+          PAPI_OK ||
+      PAPI_create_eventset(&event_set) != PAPI_OK) {
+    LOG_ERROR("Cannot calibrate %s\n", this->event_names[0].c_str());
+    return;
+  }
+  if (PAPI_add_event(event_set, code) == PAPI_OK &&
+      PAPI_start(event_set) == PAPI_OK) {
+    elapsed = this->SpinForCalibration();
+    if (PAPI_stop(event_set, &count) != PAPI_OK) {
+      count = 0;
+    }
+  }
+  PAPI_cleanup_eventset(event_set);
+  PAPI_destroy_eventset(&event_set);
 
-void SamplerImpl::SetSamplingFreq(int freq) {
-  // PAPI setup for main thread
-  // char* str = getenv("CYC_SAMPLE_COUNT");
-  // CYC_SAMPLE_COUNT = (str ? atoi(str) : DEFAULT_CYC_SAMPLE_COUNT);
-  if (freq > 0) {
-    this->cyc_sample_count = (3.1 * 1e9) / freq;
-  } else {
-    this->cyc_sample_count = (3.1 * 1e9) / DEFAULT_CYC_SAMPLE_COUNT;
+  if (count <= 0 || elapsed <= 0) {
+    LOG_ERROR("Cannot calibrate %s, assume %.3e events per second\n",
+              this->event_names[0].c_str(), this->event_rate);
+    return;
   }
-  // this->cyc_sample_count = (3.1 * 1e9) / (freq ? freq :
-  // DEFAULT_CYC_SAMPLE_COUNT);
-  LOG_INFO("SET sampling interval to %d cycles\n", this->cyc_sample_count);
+  this->event_rate = count * 1e9 / elapsed;
+  LOG_INFO("Calibrated %s at %.3e events per second\n",
+           this->event_names[0].c_str(), this->event_rate);
 }
 
-void SamplerImpl::Setup() {
+void PapiSamplerImpl::Setup() {
   TRY(PAPI_library_init(PAPI_VER_CURRENT), PAPI_VER_CURRENT);
   TRY(PAPI_thread_init(pthread_self), PAPI_OK);
+  this->Calibrate();
+  this->UpdateSamplePeriod();
 }
 
-void SamplerImpl::SetOverflow(void (*FUNC_AT_OVERFLOW)(int)) {
-  int Events[NUM_EVENTS];
-
+void PapiSamplerImpl::SetOverflow(void (*FUNC_AT_OVERFLOW)(int)) {
   EventSet = PAPI_NULL;
   TRY(PAPI_create_eventset(&(EventSet)), PAPI_OK);
 
-  Events[0] = PAPI_TOT_CYC;
-  // Events[1] = PAPI_L2_DCM;
-  // Events[1] = PAPI_L1_DCM;
-  // Events[1] = PAPI_TOT_INS;
-  // Events[1] = PAPI_LD_INS;
-  // Events[2] = PAPI_SR_INS;
-  // Events[3] = PAPI_L1_DCM;
-  // Events[3] = PAPI_L3_DCA;
-
-  TRY(PAPI_add_events(EventSet, (int *)Events, NUM_EVENTS), PAPI_OK);
-
-  // PAPI_overflow_handler_t *_papi_overflow_handler =
-  // (PAPI_overflow_handler_t*) &(this->papi_handler) (int EventSet, void
-  // *address, long_long overflow_vector, void *context ); void (*)(int, void*,
-  // long long int, void*) PAPI_overflow_handler_t _papi_overflow_handler = void
-  // (*)(int, void*, long long int, void*) &(papi_handler);
+  // Add events one by one, so that an unavailable counter only loses its own
+  // metric
+  num_set_events = 0;
+  num_sampler_events = this->event_names.size();
+  for (int i = 0; i < num_sampler_events; i++) {
+    const char *name = this->event_names[i].c_str();
+    int code = PAPI_NULL;
+    event_slots[i] = -1;
+    event_deltas[i] = 0;
+    if (PAPI_event_name_to_code((char *)name, &code) != PAPI_OK) {
+      LOG_ERROR("Unknown PAPI event %s\n", name);
+      continue;
+    }
+    int retval = PAPI_add_event(EventSet, code);
+    if (retval != PAPI_OK) {
+      LOG_ERROR("Cannot count %s, ErrCode: %s\n", name, PAPI_strerror(retval));
+      continue;
+    }
+    event_slots[i] = num_set_events;
+    event_codes[num_set_events++] = code;
+  }
+  if (event_slots[0] < 0) {
+    LOG_ERROR("No sample is taken without event %s\n",
+              this->event_names[0].c_str());
+    return;
+  }
+
+  // The first event triggers samples
   PAPI_overflow_handler_t _papi_overflow_handler =
       (PAPI_overflow_handler_t) & (papi_handler);
-  TRY(PAPI_overflow(EventSet, PAPI_TOT_CYC, this->cyc_sample_count, 0,
-                    _papi_overflow_handler),
+  TRY(PAPI_overflow(EventSet, event_codes[event_slots[0]],
+                    this->cyc_sample_count, 0, _papi_overflow_handler),
       PAPI_OK);
-  // TRY(PAPI_overflow(EventSet, PAPI_LD_INS, INS_SAMPLE_COUNT, 0,
-  // papi_handler), PAPI_OK); TRY(PAPI_overflow(EventSet, PAPI_SR_INS,
-  // INS_SAMPLE_COUNT, 0, papi_handler), PAPI_OK); TRY(PAPI_overflow(EventSet,
-  // PAPI_L1_DCM, CM_SAMPLE_COUNT, 0, papi_handler), PAPI_OK);
-  // TRY(PAPI_overflow(EventSet, PAPI_L3_DCA, CM_SAMPLE_COUNT, 0, papi_handler),
-  // PAPI_OK);
+  base_threshold = this->cyc_sample_count;
+  ResetSamplePeriodScale();
 
   // this->func_at_overflow = FUNC_AT_OVERFLOW;
   func_at_overflow_1 = FUNC_AT_OVERFLOW;
+  InitUnwindStack();
 }
 
-void SamplerImpl::AddThread() { TRY(PAPI_register_thread(), PAPI_OK); }
+void PapiSamplerImpl::AddThread() { TRY(PAPI_register_thread(), PAPI_OK); }
 
-void SamplerImpl::RemoveThread() { TRY(PAPI_unregister_thread(), PAPI_OK); }
-
-void SamplerImpl::UnsetOverflow() {
-  int Events[NUM_EVENTS];
-
-  Events[0] = PAPI_TOT_CYC;
-  // Events[1] = PAPI_L2_DCM;
-  // Events[1] = PAPI_L1_DCM;
-  // Events[1] = PAPI_TOT_INS;
-  // Events[1] = PAPI_LD_INS;
-  // Events[2] = PAPI_SR_INS;
-  // Events[3] = PAPI_L1_DCM;
-  // Events[3] = PAPI_L3_DCA;
+void PapiSamplerImpl::RemoveThread() {
+  TRY(PAPI_unregister_thread(), PAPI_OK);
+}
 
-  TRY(PAPI_overflow(EventSet, PAPI_TOT_CYC, 0, 0, papi_handler), PAPI_OK);
-  TRY(PAPI_remove_events(EventSet, (int *)Events, NUM_EVENTS), PAPI_OK);
+void PapiSamplerImpl::UnsetOverflow() {
+  if (num_set_events > 0 && event_slots[0] >= 0) {
+    TRY(PAPI_overflow(EventSet, event_codes[event_slots[0]], 0, 0,
+                      papi_handler),
+        PAPI_OK);
+  }
+  if (num_set_events > 0) {
+    TRY(PAPI_remove_events(EventSet, event_codes, num_set_events), PAPI_OK);
+  }
   TRY(PAPI_destroy_eventset(&(EventSet)), PAPI_OK);
+  num_set_events = 0;
 }
 
-void SamplerImpl::Start() { TRY(PAPI_start(EventSet), PAPI_OK); }
+void PapiSamplerImpl::Start() { TRY(PAPI_start(EventSet), PAPI_OK); }
 
-void SamplerImpl::Stop() { TRY(PAPI_stop(EventSet, NULL), PAPI_OK); }
+void PapiSamplerImpl::Stop() { StopAndAccumulate(); }
 
-int SamplerImpl::GetOverflowEvent(LongLongVec *overflow_vector) {
-  int Events[NUM_EVENTS], number, x, y;
-  number = NUM_EVENTS;
+int PapiSamplerImpl::GetOverflowEvent(LongLongVec *overflow_vector) {
+  int Events[MAX_NUM_EVENTS], number, x, y = 0;
+  number = MAX_NUM_EVENTS;
 
   TRY(PAPI_get_overflow_event_index(EventSet, overflow_vector->overflow_vector,
                                     Events, &number),
       PAPI_OK);
 
   for (x = 0; x < number; x++) {
-    for (y = 0; y < NUM_EVENTS; y++) {
+    for (y = 0; y < num_set_events; y++) {
       if (Events[x] == y) {
         break;
       }
@@ -131,119 +191,47 @@ int SamplerImpl::GetOverflowEvent(LongLongVec *overflow_vector) {
   return y;
 }
 
-#define MY_BT
-
-int SamplerImpl::GetBacktrace(type::addr_t *call_path,
-                              int max_call_path_depth) {
-#ifdef MY_BT
-  unw_word_t buffer[MAX_STACK_DEPTH] = {0};
-#else
-  void *buffer[MAX_STACK_DEPTH];
-  memset(buffer, 0, sizeof(buffer));
-#endif
-  unsigned int i, depth = 0;
-
-#ifdef MY_BT
-  depth = my_backtrace(buffer, max_call_path_depth);
-#else
-  depth = unw_backtrace(buffer, max_call_path_depth);
-#endif
-  unsigned int addr_log_pointer = 0;
-
-#ifdef MY_BT
-  for (i = 1; i < depth; ++i) {
-    if (buffer[i] != 0) {
-      call_path[addr_log_pointer] = (type::addr_t)(buffer[i]) - 2;
-      addr_log_pointer++;
-    }
-  }
-#else
-  for (i = 1; i < depth; ++i) {
-    if ((void *)buffer[i] != NULL) {
-      call_path[addr_log_pointer] = (type::addr_t)(buffer[i]) - 2;
-      addr_log_pointer++;
-    }
-  }
-#endif
-
-  return addr_log_pointer;
-}
-
-int SamplerImpl::GetBacktrace(type::addr_t *call_path, int max_call_path_depth,
-                              int start_depth) {
-#ifdef MY_BT
-  unw_word_t buffer[MAX_STACK_DEPTH] = {0};
-#else
-  void *buffer[MAX_STACK_DEPTH];
-  memset(buffer, 0, sizeof(buffer));
-#endif
-  unsigned int i, depth = 0;
-
-#ifdef MY_BT
-  depth = my_backtrace(buffer, max_call_path_depth);
-#else
-  depth = unw_backtrace(buffer, max_call_path_depth);
-#endif
-  unsigned int addr_log_pointer = 0;
-
-#ifdef MY_BT
-  for (i = start_depth; i < depth; ++i) {
-    if (buffer[i] != 0) {
-      call_path[addr_log_pointer] = (type::addr_t)(buffer[i]) - 2;
-      addr_log_pointer++;
-    }
-  }
-
-#else
-  for (i = start_depth; i < depth; ++i) {
-    if ((void *)buffer[i] != NULL) {
-      call_path[addr_log_pointer] = (type::addr_t)(buffer[i]) - 2;
-      addr_log_pointer++;
-    }
+int PapiSamplerImpl::GetEventDeltas(long long *deltas, int max_num_events) {
+  int num_events = num_sampler_events < max_num_events ? num_sampler_events
+                                                       : max_num_events;
+  for (int i = 0; i < num_events; i++) {
+    deltas[i] = event_deltas[i];
+    event_deltas[i] = 0;
   }
-
-#endif
-
-  return addr_log_pointer;
+  return num_events;
 }
 
-int my_backtrace(unw_word_t *buffer, int max_depth) {
-  unw_cursor_t cursor;
-  unw_context_t context;
-
-  // Initialize cursor to current frame for local unwinding.
-  unw_getcontext(&context);
-  unw_init_local(&cursor, &context);
-
-  // Unwind frames one by one, going up the frame stack.
-  int depth = 0;
-  while (unw_step(&cursor) > 0 && depth < max_depth) {
-    unw_word_t pc;
-    unw_get_reg(&cursor, UNW_REG_IP, &pc);
-    if (pc == 0) {
-      break;
-    }
-    buffer[depth] = pc;
-    depth++;
+/** Change the threshold of the first event, while EventSet is stopped */
+static void ScaleThreshold(int scale) {
+  long long threshold = (long long)base_threshold * scale;
+  if (threshold > INT_MAX) {
+    threshold = INT_MAX;
   }
-  return depth;
+  int code = event_codes[event_slots[0]];
+  TRY(PAPI_overflow(EventSet, code, 0, 0, papi_handler), PAPI_OK);
+  TRY(PAPI_overflow(EventSet, code, (int)threshold, 0, papi_handler), PAPI_OK);
 }
 
 void papi_handler(int EventSet, void *address, long_long overflow_vector,
                   void *context) {
+  // PAPI installs the signal handler, so wall-clock samples can not be masked
+  // by it, defer them instead
+  BlockWallClockSamples();
+  unsigned long long start_time = core::GetSelfStatTime();
+  long long handler_start = StartSampleHandler();
   // this->Stop();
-  TRY(PAPI_stop(EventSet, NULL), PAPI_OK);
+  StopAndAccumulate();
 
   // int y = this->GetOverflowEvent(overflow_vector);
 
-  int Events[NUM_EVENTS], number, x, y;
-  number = NUM_EVENTS;
+  int Events[MAX_NUM_EVENTS], number, x, y = 0;
+  number = MAX_NUM_EVENTS;
 
   TRY(PAPI_get_overflow_event_index(EventSet, overflow_vector, Events, &number),
       PAPI_OK);
 
   for (x = 0; x < number; x++) {
-    for (y = 0; y < NUM_EVENTS; y++) {
+    for (y = 0; y < num_set_events; y++) {
       if (Events[x] == y) {
         break;
       }
@@ -252,9 +240,20 @@ void papi_handler(int EventSet, void *address, long_long overflow_vector,
   // return y;
 
   // printf("interrupt\n");
+  SetUnwindSignalContext(context, address);
   (*(func_at_overflow_1))(y);
+  SetUnwindSignalContext(nullptr, nullptr);
+
+  int scale = AdaptSamplePeriod(handler_start);
+  if (scale > 0) {
+    ScaleThreshold(scale);
+  }
 
   TRY(PAPI_start(EventSet), PAPI_OK);
   // this->Start();
+  core::AddSelfStat(core::STAT_SAMPLES, 1);
+  core::AddSelfStat(core::STAT_HANDLER_TIME,
+                    core::GetSelfStatTime() - start_time);
+  UnblockWallClockSamples();
 }
 } // namespace baguatool::collector
@@ -2,14 +2,13 @@
 #define SAMPLER_H_
 
 //#define _GNU_SOURCE
-#define UNW_LOCAL_ONLY
-
+#include "collector/dynamic/sampler_impl.h"
 #include "baguatool.h"
 #include "common/tprintf.h"
 #include <assert.h>
 #include <dlfcn.h>
+#include <limits.h>
 #include <execinfo.h>
-#include <libunwind.h>
 #include <malloc.h>
 #include <papi.h>
 #include <pthread.h>
@@ -37,14 +36,6 @@
 #define DEFAULT_INS_SAMPLE_COUNT (20000000) // 10ms
 #define DEFAULT_CM_SAMPLE_COUNT (100000)    // 10ms
 
-#ifndef MAX_STACK_DEPTH
-#define MAX_STACK_DEPTH 100
-#endif
-
-#ifndef NUM_EVENTS
-#define NUM_EVENTS 1
-#endif
-
 #ifndef __cplusplus
 
 #define bool _Bool
@@ -59,46 +50,43 @@ namespace baguatool::collector {
 
 // typedef unsigned long long int addr_t;
 
-struct LongLongVec {
-  long_long overflow_vector;
-};
-
-class SamplerImpl {
+/** Sampler backend based on PAPI_overflow on the first event, PAPI_TOT_CYC by
+ * default */
+class PapiSamplerImpl : public SamplerImpl {
 private:
   int mpiRank = -1;
 
   // thread_local static int EventSet;
   // void (*func_at_overflow)(int);
   int cyc_sample_count;
+  int freq;                // sampling frequency
+  bool calibrated = false; // whether event_rate is measured
+
+  /** Measure the rate of the first event on a busy loop */
+  void Calibrate();
+
+  /** Compute the sampling period of the first event from the frequency */
+  void UpdateSamplePeriod();
 
 public:
-  SamplerImpl() {
-    // EventSet = PAPI_NULL;
-    // func_at_overflow = nullptr;
-    cyc_sample_count = 0;
-  };
-  ~SamplerImpl(){};
-
-  void SetSamplingFreq(int freq);
-  void Setup();
-  void AddThread();
-  void RemoveThread();
-  void UnsetOverflow();
-  void SetOverflow(void (*FUNC_AT_OVERFLOW)(int));
-  void Start();
-  void Stop();
-  int GetOverflowEvent(LongLongVec *overflow_vector);
-  int GetBacktrace(type::addr_t *call_path, int max_call_path_depth);
-  int GetBacktrace(type::addr_t *call_path, int max_call_path_depth,
-                   int start_depth);
+  PapiSamplerImpl();
+  ~PapiSamplerImpl(){};
+
+  void SetEvents(std::vector<std::string> &event_names) override;
+  unsigned long long GetSamplePeriod() override;
+  void SetSamplingFreq(int freq) override;
+  void Setup() override;
+  void AddThread() override;
+  void RemoveThread() override;
+  void UnsetOverflow() override;
+  void SetOverflow(void (*FUNC_AT_OVERFLOW)(int)) override;
+  void Start() override;
+  void Stop() override;
+  int GetOverflowEvent(LongLongVec *overflow_vector) override;
+  int GetEventDeltas(long long *deltas, int max_num_events) override;
 };
 
-int my_backtrace(unw_word_t *buffer, int max_depth);
-
 // static void* resolve_symbol(const char* symbol_name, int config);
 
-static void papi_handler(int EventSet, void *address, long_long overflow_vector,
-                         void *context);
-
 } // namespace baguatool::collector
 #endif // SAMPLER_H_
\ No newline at end of file
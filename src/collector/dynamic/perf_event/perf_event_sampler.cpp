@@ -0,0 +1,510 @@
+#include "perf_event_sampler.h"
+#include "baguatool.h"
+#include "collector/dynamic/wall_clock.h"
+#include <errno.h>
+
+namespace baguatool::collector {
+
+static __thread void (*func_at_overflow_2)(int) = nullptr;
+static __thread int event_fd = -1; // group leader
+static __thread struct perf_event_mmap_page *ring = nullptr;
+static __thread volatile int draining = 0;
+static __thread unsigned long int num_lost_samples = 0;
+// Call path of the sample being handled, len is -1 out of a sample
+static __thread type::addr_t sample_call_path[MAX_STACK_DEPTH];
+static __thread int sample_call_path_len = -1;
+// Events in the order of counts read from the group
+static __thread int member_fds[MAX_NUM_EVENTS];
+static __thread int group_events[MAX_NUM_EVENTS];
+static __thread int num_group_events = 0;
+static __thread int num_sampler_events = 0;
+// Period of the first event at the base sampling period
+static __thread uint64_t base_period = 0;
+// Counts of each event at the last read, and increments since then
+static __thread uint64_t last_counts[MAX_NUM_EVENTS];
+static __thread long long event_deltas[MAX_NUM_EVENTS];
+
+static size_t page_size = 0;
+
+/** Events by the names of perf tools */
+static const struct {
+  const char *name;
+  uint32_t type;
+  uint64_t config;
+} perf_events[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cache-references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    {"cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branch-instructions", PERF_TYPE_HARDWARE,
+     PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+    {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"ref-cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_REF_CPU_CYCLES},
+    {"cpu-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_CLOCK},
+    {"task-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    {"context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+};
+
+static bool LookupEvent(const std::string &name, uint32_t &type,
+                        uint64_t &config) {
+  for (auto &event : perf_events) {
+    if (name == event.name) {
+      type = event.type;
+      config = event.config;
+      return true;
+    }
+  }
+  return false;
+}
+
+/** Accumulate increments of a group read { u64 nr; u64 values[nr]; } */
+static void AccumulateCounts(const uint64_t *values, uint64_t nr) {
+  for (uint64_t i = 0; i < nr && i < (uint64_t)num_group_events; i++) {
+    int event_index = group_events[i];
+    event_deltas[event_index] += values[i] - last_counts[event_index];
+    last_counts[event_index] = values[i];
+  }
+}
+
+static long PerfEventOpen(struct perf_event_attr *attr, pid_t pid, int cpu,
+                          int group_fd, unsigned long flags) {
+  return syscall(__NR_perf_event_open, attr, pid, cpu, group_fd, flags);
+}
+
+static size_t GetRingSize() { return (PERF_EVENT_RING_PAGES + 1) * page_size; }
+
+/** Copy bytes at offset of the data area of the ring, which may wrap around
+ * its end */
+static void ReadRing(char *data, uint64_t data_size, uint64_t offset,
+                     void *dst, size_t len) {
+  uint64_t pos = offset & (data_size - 1);
+  size_t first = (len < data_size - pos) ? len : data_size - pos;
+  memcpy(dst, data + pos, first);
+  if (first < len) {
+    memcpy((char *)dst + first, data, len - first);
+  }
+}
+
+/** Handle a PERF_RECORD_SAMPLE, of which the body is
+ * { u64 ip; u32 pid, tid; u64 nr; u64 values[nr]; u64 nr; u64 ips[nr]; } */
+static void HandleSample(char *data, uint64_t data_size, uint64_t offset) {
+  uint64_t ip = 0, nr = 0;
+  ReadRing(data, data_size, offset, &ip, sizeof(ip));
+  offset += 16;
+
+  // Counts of the group at this sample
+  uint64_t values[MAX_NUM_EVENTS];
+  ReadRing(data, data_size, offset, &nr, sizeof(nr));
+  offset += 8;
+  uint64_t num_values = (nr < MAX_NUM_EVENTS) ? nr : MAX_NUM_EVENTS;
+  ReadRing(data, data_size, offset, values, num_values * sizeof(uint64_t));
+  AccumulateCounts(values, num_values);
+  offset += nr * sizeof(uint64_t);
+
+  // Leave room for context markers such as PERF_CONTEXT_USER
+  uint64_t ips[MAX_STACK_DEPTH + 4];
+  ReadRing(data, data_size, offset, &nr, sizeof(nr));
+  offset += 8;
+  if (nr > MAX_STACK_DEPTH + 4) {
+    nr = MAX_STACK_DEPTH + 4;
+  }
+  ReadRing(data, data_size, offset, ips, nr * sizeof(uint64_t));
+
+  int len = 0;
+  for (uint64_t i = 0; i < nr && len < MAX_STACK_DEPTH; i++) {
+    if (ips[i] >= (uint64_t)PERF_CONTEXT_MAX || ips[i] == 0) {
+      continue;
+    }
+    // The same adjustment as GetBacktrace of the other backends
+    sample_call_path[len++] = (type::addr_t)ips[i] - 2;
+  }
+  if (len == 0) {
+    sample_call_path[len++] = (type::addr_t)ip - 2;
+  }
+
+  sample_call_path_len = len;
+  core::AddSelfStat(core::STAT_SAMPLES, 1);
+  if (func_at_overflow_2 != nullptr) {
+    (*(func_at_overflow_2))(0);
+  }
+  sample_call_path_len = -1;
+}
+
+/** Execute the overflow function for each sample buffered in the ring of the
+ * calling thread. It runs in the signal handler or in Stop, and never
+ * reenters itself. */
+static void DrainRing() {
+  if (ring == nullptr || draining) {
+    return;
+  }
+  draining = 1;
+  // Also out of the handler, e.g. in Stop
+  BlockWallClockSamples();
+
+  char *data = (char *)ring + page_size;
+  uint64_t data_size = PERF_EVENT_RING_PAGES * page_size;
+  uint64_t head = ring->data_head;
+  __sync_synchronize();
+  uint64_t tail = ring->data_tail;
+
+  while (tail < head) {
+    struct perf_event_header header;
+    ReadRing(data, data_size, tail, &header, sizeof(header));
+    if (header.size == 0) {
+      break;
+    }
+    if (header.type == PERF_RECORD_SAMPLE) {
+      HandleSample(data, data_size, tail + sizeof(header));
+    } else if (header.type == PERF_RECORD_LOST) {
+      // { u64 id; u64 lost; }
+      uint64_t lost = 0;
+      ReadRing(data, data_size, tail + sizeof(header) + 8, &lost,
+               sizeof(lost));
+      num_lost_samples += lost;
+      core::AddSelfStat(core::STAT_DROPPED_SAMPLES, lost);
+    }
+    tail += header.size;
+  }
+
+  __sync_synchronize();
+  ring->data_tail = tail;
+  UnblockWallClockSamples();
+  draining = 0;
+}
+
+static void perf_event_handler(int sig, siginfo_t *info, void *context) {
+  int saved_errno = errno;
+  unsigned long long start_time = core::GetSelfStatTime();
+  long long handler_start = StartSampleHandler();
+  DrainRing();
+  // Buffered samples were taken at the current period, so change it after
+  int scale = AdaptSamplePeriod(handler_start);
+  if (scale > 0 && event_fd >= 0) {
+    uint64_t period = base_period * scale;
+    ioctl(event_fd, PERF_EVENT_IOC_PERIOD, &period);
+  }
+  core::AddSelfStat(core::STAT_HANDLER_TIME,
+                    core::GetSelfStatTime() - start_time);
+  errno = saved_errno;
+}
+
+void PerfEventSamplerImpl::SetEvents(std::vector<std::string> &event_names) {
+  SamplerImpl::SetEvents(event_names);
+  if (this->event_probed) {
+    this->ProbeEvent();
+  }
+}
+
+void PerfEventSamplerImpl::SetSamplingFreq(int freq) {
+  this->freq = (freq > 0) ? freq : DEFAULT_PERF_EVENT_SAMPLE_FREQ;
+  if (this->event_probed && this->event_known[0]) {
+    this->UpdateSamplePeriod();
+  }
+}
+
+void PerfEventSamplerImpl::UpdateSamplePeriod() {
+  this->sample_period = this->event_rate / this->freq;
+  if (this->sample_period == 0) {
+    this->sample_period = 1;
+  }
+}
+
+unsigned long long PerfEventSamplerImpl::GetSamplePeriod() {
+  return this->sample_period;
+}
+
+void PerfEventSamplerImpl::Calibrate() {
+  if (this->event_types[0] == PERF_TYPE_SOFTWARE &&
+      (this->event_configs[0] == PERF_COUNT_SW_CPU_CLOCK ||
+       this->event_configs[0] == PERF_COUNT_SW_TASK_CLOCK)) {
+    // Software clocks count nanoseconds
+    this->event_rate = 1e9;
+    return;
+  }
+
+  // Count the first event alone, without sampling
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(struct perf_event_attr));
+  attr.size = sizeof(struct perf_event_attr);
+  attr.type = this->event_types[0];
+  attr.config = this->event_configs[0];
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  uint64_t count = 0;
+  long long elapsed = 0;
+  int fd = PerfEventOpen(&attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+  if (fd >= 0) {
+    elapsed = this->SpinForCalibration();
+    if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+      count = 0;
+    }
+    close(fd);
+  }
+
+  if (count == 0 || elapsed <= 0) {
+    LOG_ERROR("Cannot calibrate %s, assume %.3e events per second\n",
+              this->event_names[0].c_str(), this->event_rate);
+    return;
+  }
+  this->event_rate = count * 1e9 / elapsed;
+  LOG_INFO("Calibrated %s at %.3e events per second\n",
+           this->event_names[0].c_str(), this->event_rate);
+}
+
+void PerfEventSamplerImpl::InitEventAttr(struct perf_event_attr *attr,
+                                         int event_index) {
+  memset(attr, 0, sizeof(struct perf_event_attr));
+  attr->size = sizeof(struct perf_event_attr);
+  attr->type = this->event_types[event_index];
+  attr->config = this->event_configs[event_index];
+  // Unprivileged users could only count events in user space
+  attr->exclude_kernel = 1;
+  attr->exclude_hv = 1;
+  if (event_index > 0) {
+    // Members are counted along with the leader and read in its samples
+    return;
+  }
+  attr->sample_period = this->sample_period;
+  attr->sample_type = PERF_SAMPLE_IP | PERF_SAMPLE_TID | PERF_SAMPLE_READ |
+                      PERF_SAMPLE_CALLCHAIN;
+  attr->read_format = PERF_FORMAT_GROUP;
+  attr->disabled = 1;
+  attr->exclude_callchain_kernel = 1;
+  attr->wakeup_events = PERF_EVENT_WAKEUP_SAMPLES;
+}
+
+void PerfEventSamplerImpl::ProbeEvent() {
+  this->event_probed = true;
+  for (size_t i = 0; i < this->event_names.size(); i++) {
+    this->event_known[i] = LookupEvent(this->event_names[i],
+                                       this->event_types[i],
+                                       this->event_configs[i]);
+    if (!this->event_known[i]) {
+      LOG_ERROR("Unknown perf event %s\n", this->event_names[i].c_str());
+    }
+  }
+
+  // Fall back to software clocks if the first event is not available
+  const char *candidates[] = {this->event_names[0].c_str(), "cpu-clock",
+                              "task-clock"};
+  std::string trigger_name = this->event_names[0];
+  for (const char *name : candidates) {
+    if (!LookupEvent(name, this->event_types[0], this->event_configs[0])) {
+      continue;
+    }
+    this->UpdateSamplePeriod();
+
+    struct perf_event_attr attr;
+    this->InitEventAttr(&attr, 0);
+    int fd = PerfEventOpen(&attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+    if (fd >= 0) {
+      close(fd);
+      this->event_names[0] = name;
+      this->event_known[0] = true;
+      this->Calibrate();
+      this->UpdateSamplePeriod();
+      LOG_INFO("SET sampling event %s, interval %lu\n", name,
+               (unsigned long)this->sample_period);
+      return;
+    }
+    LOG_INFO("Cannot open %s event: %s\n", name, strerror(errno));
+  }
+
+  this->event_known[0] = false;
+  this->sample_period = 0;
+  LOG_ERROR("No event to sample, %s\n",
+            "check /proc/sys/kernel/perf_event_paranoid");
+}
+
+void PerfEventSamplerImpl::Setup() {
+  page_size = sysconf(_SC_PAGESIZE);
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_sigaction = perf_event_handler;
+  sa.sa_flags = SA_SIGINFO | SA_RESTART;
+  // The overflow function is not reentrant
+  sigemptyset(&sa.sa_mask);
+  sigaddset(&sa.sa_mask, WALL_CLOCK_SIGNAL);
+  if (sigaction(PERF_EVENT_SIGNAL, &sa, nullptr) != 0) {
+    LOG_ERROR("sigaction failed: %s\n", strerror(errno));
+  }
+
+  this->ProbeEvent();
+}
+
+void PerfEventSamplerImpl::OpenThreadEvents() {
+  InitUnwindStack();
+  if (!this->event_probed) {
+    this->ProbeEvent();
+  }
+  if (this->sample_period == 0 || event_fd >= 0) {
+    return;
+  }
+
+  struct perf_event_attr attr;
+  this->InitEventAttr(&attr, 0);
+  int fd = PerfEventOpen(&attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+  if (fd < 0) {
+    LOG_ERROR("perf_event_open failed: %s\n", strerror(errno));
+    return;
+  }
+
+  // Other events join the group of the first one, so that their counts are
+  // read in each sample
+  num_sampler_events = this->event_names.size();
+  num_group_events = 0;
+  group_events[num_group_events++] = 0;
+  for (int i = 0; i < num_sampler_events; i++) {
+    member_fds[i] = -1;
+    last_counts[i] = 0;
+    event_deltas[i] = 0;
+    if (i == 0 || !this->event_known[i]) {
+      continue;
+    }
+    struct perf_event_attr member_attr;
+    this->InitEventAttr(&member_attr, i);
+    member_fds[i] =
+        PerfEventOpen(&member_attr, 0, -1, fd, PERF_FLAG_FD_CLOEXEC);
+    if (member_fds[i] < 0) {
+      LOG_ERROR("Cannot count %s: %s\n", this->event_names[i].c_str(),
+                strerror(errno));
+      continue;
+    }
+    group_events[num_group_events++] = i;
+  }
+
+  void *buffer = mmap(nullptr, GetRingSize(), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+  if (buffer == MAP_FAILED) {
+    LOG_ERROR("mmap of ring buffer failed: %s\n", strerror(errno));
+    close(fd);
+    return;
+  }
+
+  // Deliver wakeups of the ring to the calling thread only
+  struct f_owner_ex owner;
+  owner.type = F_OWNER_TID;
+  owner.pid = syscall(__NR_gettid);
+  if (fcntl(fd, F_SETOWN_EX, &owner) != 0 ||
+      fcntl(fd, F_SETSIG, PERF_EVENT_SIGNAL) != 0 ||
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_ASYNC | O_NONBLOCK) != 0) {
+    LOG_ERROR("fcntl on perf event failed: %s\n", strerror(errno));
+  }
+
+  ring = (struct perf_event_mmap_page *)buffer;
+  event_fd = fd;
+  base_period = this->sample_period;
+  ResetSamplePeriodScale();
+}
+
+void PerfEventSamplerImpl::CloseThreadEvents() {
+  if (event_fd < 0) {
+    return;
+  }
+  ioctl(event_fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  DrainRing();
+
+  struct perf_event_mmap_page *buffer = ring;
+  ring = nullptr;
+  munmap(buffer, GetRingSize());
+  for (int i = 0; i < num_sampler_events; i++) {
+    if (member_fds[i] >= 0) {
+      close(member_fds[i]);
+      member_fds[i] = -1;
+    }
+  }
+  close(event_fd);
+  event_fd = -1;
+  num_group_events = 0;
+
+  if (num_lost_samples > 0) {
+    LOG_INFO("Lost %lu samples, the ring buffer is full\n", num_lost_samples);
+    num_lost_samples = 0;
+  }
+}
+
+void PerfEventSamplerImpl::SetOverflow(void (*FUNC_AT_OVERFLOW)(int)) {
+  func_at_overflow_2 = FUNC_AT_OVERFLOW;
+  this->func_at_overflow = FUNC_AT_OVERFLOW;
+  this->OpenThreadEvents();
+}
+
+void PerfEventSamplerImpl::UnsetOverflow() { this->CloseThreadEvents(); }
+
+void PerfEventSamplerImpl::AddThread() {
+  // A thread added after SetOverflow on another thread executes the same
+  // overflow function
+  if (func_at_overflow_2 == nullptr) {
+    func_at_overflow_2 = this->func_at_overflow;
+  }
+  this->OpenThreadEvents();
+}
+
+void PerfEventSamplerImpl::RemoveThread() { this->CloseThreadEvents(); }
+
+void PerfEventSamplerImpl::Start() {
+  if (event_fd >= 0) {
+    ioctl(event_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+void PerfEventSamplerImpl::Stop() {
+  if (event_fd >= 0) {
+    ioctl(event_fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    // Samples left in the ring would be lost if the thread exits
+    DrainRing();
+  }
+}
+
+int PerfEventSamplerImpl::GetOverflowEvent(LongLongVec *overflow_vector) {
+  // Only the group leader triggers samples
+  return num_group_events > 0 ? group_events[0] : -1;
+}
+
+int PerfEventSamplerImpl::GetEventDeltas(long long *deltas,
+                                         int max_num_events) {
+  // Out of a sample, read the current counts of the group
+  if (sample_call_path_len < 0 && event_fd >= 0 && !draining) {
+    uint64_t buffer[MAX_NUM_EVENTS + 1];
+    ssize_t size = read(event_fd, buffer, sizeof(buffer));
+    if (size >= (ssize_t)sizeof(uint64_t)) {
+      uint64_t nr = (size / sizeof(uint64_t)) - 1;
+      AccumulateCounts(buffer + 1, nr < buffer[0] ? nr : buffer[0]);
+    }
+  }
+  int num_events = num_sampler_events < max_num_events ? num_sampler_events
+                                                       : max_num_events;
+  for (int i = 0; i < num_events; i++) {
+    deltas[i] = event_deltas[i];
+    event_deltas[i] = 0;
+  }
+  return num_events;
+}
+
+int PerfEventSamplerImpl::GetBacktrace(type::addr_t *call_path,
+                                       int max_call_path_depth) {
+  if (sample_call_path_len >= 0) {
+    return this->GetBacktrace(call_path, max_call_path_depth, 0);
+  }
+  // Skip this frame besides the one of SamplerImpl::GetBacktrace
+  return SamplerImpl::GetBacktrace(call_path, max_call_path_depth, 2);
+}
+
+int PerfEventSamplerImpl::GetBacktrace(type::addr_t *call_path,
+                                       int max_call_path_depth,
+                                       int start_depth) {
+  // The call path of a sample starts at the interrupted frame, so there is no
+  // frame of the handler to skip
+  if (sample_call_path_len >= 0) {
+    int len = sample_call_path_len < max_call_path_depth ? sample_call_path_len
+                                                         : max_call_path_depth;
+    memcpy(call_path, sample_call_path, len * sizeof(type::addr_t));
+    return len;
+  }
+  return SamplerImpl::GetBacktrace(call_path, max_call_path_depth,
+                                   start_depth + 1);
+}
+
+} // namespace baguatool::collector
@@ -0,0 +1,107 @@
+#ifndef PERF_EVENT_SAMPLER_H_
+#define PERF_EVENT_SAMPLER_H_
+
+#include "baguatool.h"
+#include "collector/dynamic/sampler_impl.h"
+#include "common/tprintf.h"
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Number of data pages of the ring buffer of each thread, a power of two
+#ifndef PERF_EVENT_RING_PAGES
+#define PERF_EVENT_RING_PAGES 8
+#endif
+
+// Number of samples buffered in the ring before the thread is signaled
+#ifndef PERF_EVENT_WAKEUP_SAMPLES
+#define PERF_EVENT_WAKEUP_SAMPLES 16
+#endif
+
+// Signal to deliver ring buffer wakeups
+#ifndef PERF_EVENT_SIGNAL
+#define PERF_EVENT_SIGNAL SIGPROF
+#endif
+
+#define DEFAULT_PERF_EVENT_SAMPLE_FREQ (1000)
+
+namespace baguatool::collector {
+
+/** Sampler backend based on perf_event_open. Each thread opens its own group
+ * of events with a mmap ring buffer that the kernel fills with samples, the
+ * counts of the group and the user call paths. The thread is only signaled
+ * every PERF_EVENT_WAKEUP_SAMPLES samples, then the overflow function is
+ * executed once per buffered sample, and GetBacktrace returns the call path
+ * of that sample instead of unwinding.
+ */
+class PerfEventSamplerImpl : public SamplerImpl {
+private:
+  int freq;                  // sampling frequency
+  uint64_t sample_period;    // events between two samples
+  bool event_probed = false; // whether events are resolved
+  // type and config of each event, the first one leads the group of events
+  uint32_t event_types[MAX_NUM_EVENTS];
+  uint64_t event_configs[MAX_NUM_EVENTS];
+  bool event_known[MAX_NUM_EVENTS];
+  // Overflow function of threads added by AddThread
+  void (*func_at_overflow)(int) = nullptr;
+
+  /** Fill the attribute of an event of this sampler
+   * @param attr - attribute (output)
+   * @param event_index - index of the event, 0 for the group leader
+   */
+  void InitEventAttr(struct perf_event_attr *attr, int event_index);
+
+  /** Resolve names of events, and choose the first event that can be opened
+   * to trigger samples, the first event, then cpu-clock and task-clock.
+   * Compute the sampling period of it. */
+  void ProbeEvent();
+
+  /** Compute the sampling period of the first event from the frequency */
+  void UpdateSamplePeriod();
+
+  /** Measure the rate of the first event on a busy loop, software clocks
+   * count nanoseconds */
+  void Calibrate();
+
+  /** Open the group of events and the ring buffer of the calling thread if
+   * they are not open. Counting starts at Start. */
+  void OpenThreadEvents();
+
+  /** Drain the ring buffer of the calling thread, then close it and the
+   * group of events */
+  void CloseThreadEvents();
+
+public:
+  PerfEventSamplerImpl() {
+    freq = DEFAULT_PERF_EVENT_SAMPLE_FREQ;
+    sample_period = 0;
+    event_names.push_back("cycles");
+  };
+  ~PerfEventSamplerImpl(){};
+
+  void SetEvents(std::vector<std::string> &event_names) override;
+  unsigned long long GetSamplePeriod() override;
+  void SetSamplingFreq(int freq) override;
+  void Setup() override;
+  void AddThread() override;
+  void RemoveThread() override;
+  void UnsetOverflow() override;
+  void SetOverflow(void (*FUNC_AT_OVERFLOW)(int)) override;
+  void Start() override;
+  void Stop() override;
+  int GetOverflowEvent(LongLongVec *overflow_vector) override;
+  int GetEventDeltas(long long *deltas, int max_num_events) override;
+  int GetBacktrace(type::addr_t *call_path, int max_call_path_depth) override;
+  int GetBacktrace(type::addr_t *call_path, int max_call_path_depth,
+                   int start_depth) override;
+};
+
+} // namespace baguatool::collector
+#endif // PERF_EVENT_SAMPLER_H_
@@ -0,0 +1,88 @@
+#include "period_controller.h"
+#include <stdlib.h>
+#include <time.h>
+
+namespace baguatool::collector {
+
+static double MaxOverheadFromEnv() {
+  const char *overhead_str = getenv("SAMPLER_MAX_OVERHEAD");
+  if (overhead_str == nullptr) {
+    return 0;
+  }
+  double max_overhead = atof(overhead_str);
+  if (max_overhead < 0 || max_overhead >= 1) {
+    LOG_ERROR("Invalid max overhead %s, sample at a fixed period\n",
+              overhead_str);
+    return 0;
+  }
+  return max_overhead;
+}
+
+static double max_overhead = MaxOverheadFromEnv();
+
+// Multiple of the sampling period, and time in handlers since window_start
+static __thread int period_scale = 1;
+static __thread long long window_start = 0;
+static __thread long long handler_time = 0;
+
+static inline long long GetThreadTime() {
+  struct timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+void SetMaxOverhead(double overhead) {
+  max_overhead = (overhead > 0 && overhead < 1) ? overhead : 0;
+}
+
+double GetMaxOverhead() { return max_overhead; }
+
+int GetSamplePeriodScale() { return period_scale; }
+
+void ResetSamplePeriodScale() {
+  period_scale = 1;
+  window_start = 0;
+  handler_time = 0;
+}
+
+long long StartSampleHandler() {
+  if (max_overhead <= 0) {
+    return 0;
+  }
+  return GetThreadTime();
+}
+
+int AdaptSamplePeriod(long long start_time) {
+  if (start_time == 0) {
+    return 0;
+  }
+  long long now = GetThreadTime();
+  handler_time += now - start_time;
+  if (window_start == 0) {
+    window_start = start_time;
+  }
+  long long elapsed = now - window_start;
+  if (elapsed < SAMPLER_ADAPT_INTERVAL) {
+    return 0;
+  }
+
+  double overhead = (double)handler_time / elapsed;
+  int scale = period_scale;
+  while (overhead > max_overhead && scale < SAMPLER_MAX_PERIOD_SCALE) {
+    scale *= 2;
+    overhead /= 2;
+  }
+  if (scale == period_scale && overhead < max_overhead / 4 && scale > 1) {
+    scale /= 2;
+  }
+  window_start = now;
+  handler_time = 0;
+
+  if (scale == period_scale) {
+    return 0;
+  }
+  period_scale = scale;
+  return scale;
+}
+
+} // namespace baguatool::collector
@@ -0,0 +1,48 @@
+#ifndef PERIOD_CONTROLLER_H_
+#define PERIOD_CONTROLLER_H_
+
+#include "baguatool.h"
+#include "common/tprintf.h"
+
+// Thread CPU time between two adjustments of the sampling period, in
+// nanoseconds
+#ifndef SAMPLER_ADAPT_INTERVAL
+#define SAMPLER_ADAPT_INTERVAL 100000000
+#endif
+
+// Max multiple of the sampling period of the sampler
+#ifndef SAMPLER_MAX_PERIOD_SCALE
+#define SAMPLER_MAX_PERIOD_SCALE 1024
+#endif
+
+namespace baguatool::collector {
+
+/** Set the target of time in sample handlers over thread CPU time, 0 to
+ * sample at a fixed period */
+void SetMaxOverhead(double max_overhead);
+double GetMaxOverhead();
+
+/** Get the multiple of the sampling period of the sampler in effect on the
+ * calling thread */
+int GetSamplePeriodScale();
+
+/** Sample at the sampling period of the sampler on the calling thread, when
+ * it starts sampling */
+void ResetSamplePeriodScale();
+
+/** Start timing a sample handler. It is async-signal-safe.
+ * @return thread CPU time in nanoseconds, 0 if the period is fixed
+ */
+long long StartSampleHandler();
+
+/** Account the time of a sample handler to the calling thread. Once every
+ * SAMPLER_ADAPT_INTERVAL, the scale of the period is doubled while the
+ * overhead exceeds the target, or halved if the overhead is below a quarter
+ * of it. It is async-signal-safe.
+ * @param start_time - return value of StartSampleHandler
+ * @return new scale of the period for the backend to apply, 0 if unchanged
+ */
+int AdaptSamplePeriod(long long start_time);
+
+} // namespace baguatool::collector
+#endif // PERIOD_CONTROLLER_H_
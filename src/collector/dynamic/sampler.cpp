@@ -0,0 +1,265 @@
+#include "baguatool.h"
+#include "common/tokenizer.h"
+#include "papi/sampler.h"
+#include "perf_event/perf_event_sampler.h"
+#include "sampler_impl.h"
+#include "wall_clock.h"
+#include <string.h>
+#include <time.h>
+
+namespace baguatool::collector {
+
+// Every metric of a sample is recorded as a value of a PerfData record
+static_assert(MAX_NUM_SAMPLE_METRICS <= MAX_NUM_METRICS,
+              "MAX_NUM_METRICS must hold the events and wall-clock metrics");
+
+static std::unique_ptr<SamplerImpl> CreateSamplerImpl(SamplerBackend backend) {
+  if (backend == PERF_EVENT_SAMPLER) {
+    return std::make_unique<PerfEventSamplerImpl>();
+  }
+  return std::make_unique<PapiSamplerImpl>();
+}
+
+/** Set events of a backend from SAMPLER_EVENTS, a comma-separated list of
+ * event names of which the first one triggers samples */
+static void SetEventsFromEnv(SamplerImpl *sa) {
+  const char *events_str = getenv("SAMPLER_EVENTS");
+  if (events_str == nullptr) {
+    return;
+  }
+  std::vector<std::string> event_names;
+  Tokenizer tokenizer(events_str, ", ");
+  std::string_view token;
+  while (tokenizer.Next(token)) {
+    event_names.emplace_back(token);
+  }
+  if (!event_names.empty()) {
+    sa->SetEvents(event_names);
+  }
+}
+
+Sampler::Sampler() {
+  // SAMPLER_BACKEND=perf_event switches existing collectors without rebuilding
+  SamplerBackend backend = PAPI_SAMPLER;
+  const char *backend_str = getenv("SAMPLER_BACKEND");
+  if (backend_str != nullptr && strcmp(backend_str, "perf_event") == 0) {
+    backend = PERF_EVENT_SAMPLER;
+  }
+  this->backend = backend;
+  this->sa = CreateSamplerImpl(backend);
+  SetEventsFromEnv(this->sa.get());
+}
+
+Sampler::~Sampler() {}
+
+void Sampler::SetBackend(SamplerBackend backend) {
+  if (backend != this->backend) {
+    this->backend = backend;
+    this->sa = CreateSamplerImpl(backend);
+    SetEventsFromEnv(this->sa.get());
+  }
+}
+
+void Sampler::SetEvents(std::vector<std::string> &event_names) {
+  sa->SetEvents(event_names);
+}
+int Sampler::GetNumEvents() { return sa->GetNumEvents(); }
+std::string &Sampler::GetEventName(int event_index) {
+  return sa->GetEventName(event_index);
+}
+int Sampler::GetEventDeltas(long long *deltas, int max_num_events) {
+  return sa->GetEventDeltas(deltas, max_num_events);
+}
+
+SamplerBackend Sampler::GetBackend() { return this->backend; }
+unsigned long long Sampler::GetSamplePeriod() { return sa->GetSamplePeriod(); }
+double Sampler::GetEventRate() { return sa->GetEventRate(); }
+
+void Sampler::SetMaxOverhead(double max_overhead) {
+  baguatool::collector::SetMaxOverhead(max_overhead);
+}
+double Sampler::GetMaxOverhead() {
+  return baguatool::collector::GetMaxOverhead();
+}
+type::perf_data_t Sampler::GetSampleWeight() {
+  return GetSamplePeriodScale();
+}
+
+void Sampler::SetWallClockFreq(int freq) {
+  baguatool::collector::SetWallClockFreq(freq);
+}
+int Sampler::GetWallClockFreq() {
+  return baguatool::collector::GetWallClockFreq();
+}
+
+void Sampler::GetMetricNames(std::vector<std::string> &metric_names) {
+  metric_names.clear();
+  for (int i = 0; i < sa->GetNumEvents(); i++) {
+    metric_names.push_back(sa->GetEventName(i));
+  }
+  if (baguatool::collector::GetWallClockFreq() > 0) {
+    metric_names.push_back("WALL_TIME");
+    metric_names.push_back("OFF_CPU");
+  }
+}
+
+void Sampler::ConfigurePerfData(core::PerfData *perf_data, bool async_dump) {
+  if (async_dump) {
+    perf_data->SetAsyncDump(true);
+  }
+  std::vector<std::string> metric_names;
+  this->GetMetricNames(metric_names);
+  perf_data->SetMetricNames(metric_names);
+  // Record the period to convert sample counts to time
+  perf_data->SetSamplePeriod(this->GetSamplePeriod(), this->GetEventRate());
+}
+
+void Sampler::FinishPerfData(core::PerfData *perf_data, const char *file_name,
+                             const char *self_stats_file_name) {
+  this->Stop();
+  this->ReportUnwindCost();
+  perf_data->Dump(file_name);
+  core::DumpSelfStats(self_stats_file_name);
+}
+
+int Sampler::GetSampleValues(type::perf_data_t *values, int max_num_values) {
+  type::perf_data_t sample_values[MAX_NUM_SAMPLE_METRICS] = {0};
+  int num_events = sa->GetNumEvents();
+  int num_values = num_events;
+  if (baguatool::collector::GetWallClockFreq() > 0) {
+    num_values += 2;
+  }
+
+  double seconds = 0;
+  bool blocked = false;
+  if (GetWallClockSample(seconds, blocked)) {
+    // Counts are left to the next sample of the first event
+    sample_values[num_events] = seconds;
+    sample_values[num_events + 1] = blocked ? seconds : 0;
+  } else {
+    // Metric 0 counts sampling periods, the others are deltas of the other
+    // events
+    long long deltas[MAX_NUM_EVENTS] = {0};
+    int num_deltas = sa->GetEventDeltas(deltas, MAX_NUM_EVENTS);
+    sample_values[0] = GetSamplePeriodScale();
+    for (int i = 1; i < num_deltas; i++) {
+      sample_values[i] = deltas[i];
+    }
+  }
+
+  if (num_values > max_num_values) {
+    num_values = max_num_values;
+  }
+  for (int i = 0; i < num_values; i++) {
+    values[i] = sample_values[i];
+  }
+  return num_values;
+}
+
+void Sampler::SetUnwindMode(UnwindMode mode) {
+  baguatool::collector::SetUnwindMode(mode);
+}
+UnwindMode Sampler::GetUnwindMode() {
+  return baguatool::collector::GetUnwindMode();
+}
+void Sampler::GetUnwindCost(UnwindCost &cost) {
+  baguatool::collector::GetUnwindCost(cost);
+}
+void Sampler::ReportUnwindCost() { baguatool::collector::ReportUnwindCost(); }
+
+void Sampler::SetSamplingFreq(int freq) { sa->SetSamplingFreq(freq); }
+void Sampler::Setup() { sa->Setup(); }
+void Sampler::AddThread() { sa->AddThread(); }
+void Sampler::RemoveThread() { sa->RemoveThread(); }
+void Sampler::UnsetOverflow() {
+  DeleteWallClockTimer();
+  sa->UnsetOverflow();
+}
+void Sampler::SetOverflow(void (*FUNC_AT_OVERFLOW)(int)) {
+  sa->SetOverflow(FUNC_AT_OVERFLOW);
+  CreateWallClockTimer(FUNC_AT_OVERFLOW);
+}
+void Sampler::Start() {
+  sa->Start();
+  StartWallClockTimer();
+}
+void Sampler::Stop() {
+  StopWallClockTimer();
+  sa->Stop();
+}
+int Sampler::GetOverflowEvent(LongLongVec *overflow_vector) {
+  return sa->GetOverflowEvent(overflow_vector);
+}
+int Sampler::GetBacktrace(type::addr_t *call_path, int max_call_path_depth) {
+  return sa->GetBacktrace(call_path, max_call_path_depth);
+}
+int Sampler::GetBacktrace(type::addr_t *call_path, int max_call_path_depth,
+                          int start_depth) {
+  return sa->GetBacktrace(call_path, max_call_path_depth, start_depth);
+}
+
+void SamplerImpl::SetEvents(std::vector<std::string> &event_names) {
+  if (event_names.empty()) {
+    return;
+  }
+  this->event_names = event_names;
+  if (this->event_names.size() > MAX_NUM_EVENTS) {
+    LOG_ERROR("Only the first %d events are counted\n", MAX_NUM_EVENTS);
+    this->event_names.resize(MAX_NUM_EVENTS);
+  }
+}
+
+int SamplerImpl::GetNumEvents() { return this->event_names.size(); }
+
+double SamplerImpl::GetEventRate() { return this->event_rate; }
+
+long long SamplerImpl::SpinForCalibration() {
+  struct timespec start_time, now;
+  long long elapsed = 0;
+  volatile unsigned long work = 0;
+  clock_gettime(CLOCK_MONOTONIC, &start_time);
+  do {
+    for (int i = 0; i < 1000; i++) {
+      work += i;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed = (now.tv_sec - start_time.tv_sec) * 1000000000LL + now.tv_nsec -
+              start_time.tv_nsec;
+  } while (elapsed < SAMPLER_CALIBRATION_TIME);
+  return elapsed;
+}
+
+std::string &SamplerImpl::GetEventName(int event_index) {
+  return this->event_names[event_index];
+}
+
+int SamplerImpl::GetBacktrace(type::addr_t *call_path,
+                              int max_call_path_depth) {
+  unw_word_t buffer[MAX_STACK_DEPTH] = {0};
+  // Skip the frame of GetBacktrace
+  int depth = Unwind(buffer, max_call_path_depth, 1);
+  int addr_log_pointer = 0;
+  for (int i = 0; i < depth; ++i) {
+    if (buffer[i] != 0) {
+      call_path[addr_log_pointer] = (type::addr_t)(buffer[i]) - 2;
+      addr_log_pointer++;
+    }
+  }
+  return addr_log_pointer;
+}
+
+int SamplerImpl::GetBacktrace(type::addr_t *call_path, int max_call_path_depth,
+                              int start_depth) {
+  unw_word_t buffer[MAX_STACK_DEPTH] = {0};
+  int depth = Unwind(buffer, max_call_path_depth, start_depth);
+  int addr_log_pointer = 0;
+  for (int i = 0; i < depth; ++i) {
+    if (buffer[i] != 0) {
+      call_path[addr_log_pointer] = (type::addr_t)(buffer[i]) - 2;
+      addr_log_pointer++;
+    }
+  }
+  return addr_log_pointer;
+}
+
+} // namespace baguatool::collector
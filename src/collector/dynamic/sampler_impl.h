@@ -0,0 +1,73 @@
+#ifndef SAMPLER_IMPL_H_
+#define SAMPLER_IMPL_H_
+
+#include "baguatool.h"
+#include "collector/dynamic/period_controller.h"
+#include "collector/dynamic/unwinder.h"
+#include "common/tprintf.h"
+#include <string>
+#include <vector>
+
+// Events per second assumed for the sampling event until it is calibrated
+#ifndef DEFAULT_EVENT_RATE
+#define DEFAULT_EVENT_RATE (3.1 * 1e9)
+#endif
+
+// Time to count the sampling event for calibration, in nanoseconds
+#ifndef SAMPLER_CALIBRATION_TIME
+#define SAMPLER_CALIBRATION_TIME 20000000
+#endif
+
+namespace baguatool::collector {
+
+struct LongLongVec {
+  long long overflow_vector;
+};
+
+/** Backend of Sampler. A backend counts events of the calling thread and
+ * executes the overflow function every time a sample is taken.
+ */
+class SamplerImpl {
+protected:
+  // Events to count, the first one triggers samples
+  std::vector<std::string> event_names;
+  // Events per second of the first event on a busy thread
+  double event_rate = DEFAULT_EVENT_RATE;
+
+  /** Keep the calling thread busy for SAMPLER_CALIBRATION_TIME, while the
+   * first event is counted to measure its rate
+   * @return elapsed nanoseconds
+   */
+  long long SpinForCalibration();
+
+public:
+  SamplerImpl(){};
+  virtual ~SamplerImpl(){};
+
+  virtual void SetEvents(std::vector<std::string> &event_names);
+  int GetNumEvents();
+  std::string &GetEventName(int event_index);
+  virtual int GetEventDeltas(long long *deltas, int max_num_events) = 0;
+  double GetEventRate();
+  virtual unsigned long long GetSamplePeriod() = 0;
+
+  virtual void SetSamplingFreq(int freq) = 0;
+  virtual void Setup() = 0;
+  virtual void AddThread() = 0;
+  virtual void RemoveThread() = 0;
+  virtual void UnsetOverflow() = 0;
+  virtual void SetOverflow(void (*FUNC_AT_OVERFLOW)(int)) = 0;
+  virtual void Start() = 0;
+  virtual void Stop() = 0;
+  virtual int GetOverflowEvent(LongLongVec *overflow_vector) = 0;
+
+  /** Unwind the stack of the calling thread in the unwind mode of the process.
+   * Backends that deliver call paths with samples override it.
+   */
+  virtual int GetBacktrace(type::addr_t *call_path, int max_call_path_depth);
+  virtual int GetBacktrace(type::addr_t *call_path, int max_call_path_depth,
+                           int start_depth);
+};
+
+} // namespace baguatool::collector
+#endif // SAMPLER_IMPL_H_
@@ -18,41 +18,52 @@ void SharedObjAnalysis::CollectSharedObjMap() {
 
   std::string line;
 
+  std::string_view fields[6];
   while (getline(fin, line)) {
-    std::vector<std::string> line_vec, line_vec_1;
-    split(line, " ", line_vec);
-
-    int cnt = line_vec.size();
+    // address perms offset dev inode pathname, parsed in place
+    Tokenizer tokenizer(line, " ");
+    int cnt = 0;
+    std::string_view field;
+    while (tokenizer.Next(field)) {
+      if (cnt < 6) {
+        fields[cnt] = field;
+      }
+      cnt++;
+    }
 
     if (cnt == 6) {
-      auto seg_size = strtol(line_vec[4].c_str(), 0, 10);
+      long seg_size = 0;
+      ParseToken(fields[4], seg_size);
       if (seg_size > 0) {
         // dbg(cnt, line);
-        split(line_vec[0], "-", line_vec_1);
-        type::addr_t start_addr = strtoull(line_vec_1[0].c_str(), 0, 16);
-        type::addr_t end_addr = strtoull(line_vec_1[1].c_str(), 0, 16);
+        std::string_view addr_range = fields[0];
+        size_t dash = addr_range.find('-');
+        type::addr_t start_addr = 0;
+        type::addr_t end_addr = 0;
+        ParseToken(addr_range.substr(0, dash), start_addr, 16);
+        if (dash != std::string_view::npos) {
+          ParseToken(addr_range.substr(dash + 1), end_addr, 16);
+        }
 
         auto shared_obj_map_size = this->shared_obj_map.size();
         if (shared_obj_map_size > 0) {
-          auto last_shared_obj = this->shared_obj_map[shared_obj_map_size - 1];
-          auto last_shared_obj_name = std::get<2>(last_shared_obj);
+          auto &last_shared_obj = this->shared_obj_map[shared_obj_map_size - 1];
+          auto &last_shared_obj_name = std::get<2>(last_shared_obj);
           if (last_shared_obj_name ==
-              std::string(line_vec[5])) { // If last object is same as current
-                                          // one, only update the end address
+              fields[5]) { // If last object is same as current
+                           // one, only update the end address
             std::get<1>(this->shared_obj_map[shared_obj_map_size - 1]) =
                 end_addr;
           } else {
             this->shared_obj_map.push_back(std::make_tuple(
-                start_addr, end_addr, std::string(line_vec[5])));
+                start_addr, end_addr, std::string(fields[5])));
           }
         } else {
           this->shared_obj_map.push_back(
-              std::make_tuple(start_addr, end_addr, std::string(line_vec[5])));
+              std::make_tuple(start_addr, end_addr, std::string(fields[5])));
         }
       }
     }
-    FREE_CONTAINER(line_vec);
-    FREE_CONTAINER(line_vec_1);
   }
   fin.close();
 }
@@ -66,12 +77,22 @@ void SharedObjAnalysis::ReadSharedObjMap(std::string &file_name) {
   std::string line;
   type::addr_t start_addr;
   type::addr_t end_addr;
-  std::string shared_obj;
   while (getline(fin, line)) {
-    std::stringstream ss(line);
-    ss >> start_addr >> end_addr >> shared_obj;
+    // start_addr end_addr shared_obj, parsed in place
+    Tokenizer tokenizer(line, " ");
+    std::string_view token;
+    start_addr = end_addr = 0;
+    if (tokenizer.Next(token)) {
+      ParseToken(token, start_addr);
+    }
+    if (tokenizer.Next(token)) {
+      ParseToken(token, end_addr);
+    }
+    if (!tokenizer.Next(token)) {
+      continue;
+    }
     this->shared_obj_map.push_back(
-        std::make_tuple(start_addr, end_addr, std::string(shared_obj)));
+        std::make_tuple(start_addr, end_addr, std::string(token)));
   }
   fin.close();
 }
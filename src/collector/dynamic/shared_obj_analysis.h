@@ -4,6 +4,7 @@
 #define _OPEN_SYS_ITOA_EXT
 
 #include "baguatool.h"
+#include "common/tokenizer.h"
 #include "common/utils.h"
 #include <cxxabi.h> // needed for abi::__cxa_demangle
 #include <fcntl.h>
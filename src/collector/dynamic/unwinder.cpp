@@ -0,0 +1,313 @@
+#include "unwinder.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+
+namespace baguatool::collector {
+
+static UnwindMode UnwindModeFromEnv() {
+  const char *mode_str = getenv("SAMPLER_UNWIND");
+  if (mode_str == nullptr) {
+    return LIBUNWIND_UNWIND;
+  }
+  if (strcmp(mode_str, "fp") == 0) {
+    return FRAME_POINTER_UNWIND;
+  }
+  if (strcmp(mode_str, "cached") == 0) {
+    return CACHED_UNWIND;
+  }
+  if (strcmp(mode_str, "libunwind") != 0) {
+    LOG_ERROR("Unknown unwind mode %s, use libunwind\n", mode_str);
+  }
+  return LIBUNWIND_UNWIND;
+}
+
+static UnwindMode unwind_mode = UnwindModeFromEnv();
+
+// Cost of unwinding of all threads
+static unsigned long long num_unwinds = 0;
+static unsigned long long num_unwind_frames = 0;
+static unsigned long long num_unwind_steps = 0;
+static unsigned long long unwind_time = 0;
+
+// Bounds of the stack of the thread, 0 if unknown
+static __thread unw_word_t stack_lo = 0;
+static __thread unw_word_t stack_hi = 0;
+// ucontext_t of the signal being handled
+static __thread void *signal_context = nullptr;
+
+/** Walk frames with unw_step from a context of a caller */
+static int LibunwindWalk(unw_context_t *context, unw_word_t *buffer,
+                         int max_depth, int skip_depth, int &num_steps) {
+  unw_cursor_t cursor;
+  unw_init_local(&cursor, context);
+
+  int depth = 0;
+  for (int i = 0; i < max_depth && unw_step(&cursor) > 0; i++) {
+    unw_word_t pc;
+    unw_get_reg(&cursor, UNW_REG_IP, &pc);
+    num_steps++;
+    if (pc == 0) {
+      break;
+    }
+    if (i >= skip_depth) {
+      buffer[depth++] = pc;
+    }
+  }
+  return depth;
+}
+
+#if defined(__x86_64__)
+
+// Layout of a frame at a return address: where the canonical frame address
+// (CFA, the stack pointer of the caller) and the rbp of the caller are
+enum UnwindRule {
+  SP_RULE = 0, // CFA = sp + cfa_offset
+  FP_RULE = 1, // CFA = rbp + 16, rbp of the caller at rbp
+};
+
+struct UnwindRecipe {
+  unw_word_t pc;   // address of the frame, 0 for an empty entry
+  int rule;        // UnwindRule
+  int cfa_offset;  // for SP_RULE
+  int rbp_offset;  // rbp of the caller at CFA - rbp_offset, 0 if unchanged
+};
+
+static __thread UnwindRecipe recipe_cache[UNWIND_CACHE_SIZE];
+
+/** Whether pc is at the sigreturn trampoline (mov $15, %rax; syscall), whose
+ * frame holds the context of the interrupted code */
+static inline bool IsSignalFrame(unw_word_t pc) {
+  static const unsigned char sigreturn_code[] = {0x48, 0xc7, 0xc0, 0x0f, 0x00,
+                                                 0x00, 0x00, 0x0f, 0x05};
+  return memcmp((void *)pc, sigreturn_code, sizeof(sigreturn_code)) == 0;
+}
+
+static inline UnwindRecipe *GetRecipe(unw_word_t pc) {
+  return &recipe_cache[(pc ^ (pc >> 12)) & (UNWIND_CACHE_SIZE - 1)];
+}
+
+/** Walk frames with the cached layouts, and with unw_step for a frame whose
+ * layout is unknown, which is then added to the cache */
+static int CachedWalk(unw_context_t *context, unw_word_t *buffer,
+                      int max_depth, int skip_depth, int &num_steps) {
+  greg_t *gregs = context->uc_mcontext.gregs;
+  unw_word_t pc = gregs[REG_RIP], sp = gregs[REG_RSP], rbp = gregs[REG_RBP];
+  unw_word_t context_lo = (unw_word_t)context;
+  unw_word_t context_hi = context_lo + sizeof(unw_context_t);
+  unw_cursor_t cursor;
+  bool stepping = false; // whether cursor is at the current frame
+
+  int depth = 0;
+  for (int i = 0; i < max_depth; i++) {
+    unw_word_t cfa, caller_pc, caller_rbp;
+    UnwindRecipe *recipe = GetRecipe(pc);
+    if (recipe->pc == pc) {
+      if (recipe->rule == FP_RULE) {
+        cfa = rbp + 16;
+        caller_rbp = *(unw_word_t *)rbp;
+      } else {
+        cfa = sp + recipe->cfa_offset;
+        caller_rbp = recipe->rbp_offset
+                         ? *(unw_word_t *)(cfa - recipe->rbp_offset)
+                         : rbp;
+      }
+      caller_pc = *(unw_word_t *)(cfa - 8);
+      stepping = false;
+    } else {
+      if (!stepping) {
+        gregs[REG_RIP] = pc;
+        gregs[REG_RSP] = sp;
+        gregs[REG_RBP] = rbp;
+        unw_init_local(&cursor, context);
+        stepping = true;
+      }
+      if (unw_step(&cursor) <= 0) {
+        break;
+      }
+      num_steps++;
+      unw_get_reg(&cursor, UNW_REG_IP, &caller_pc);
+      unw_get_reg(&cursor, UNW_REG_SP, &cfa);
+      unw_get_reg(&cursor, UNW_X86_64_RBP, &caller_rbp);
+      // Layouts of signal frames depend on the interrupted code
+      if (!IsSignalFrame(pc) && cfa > sp &&
+          caller_pc == *(unw_word_t *)(cfa - 8)) {
+        // rbp of the caller is saved in this frame, or left unchanged
+        int rbp_offset = 0;
+        unw_save_loc_t loc;
+        if (unw_get_save_loc(&cursor, UNW_X86_64_RBP, &loc) == 0 &&
+            loc.type == UNW_SLT_MEMORY && loc.u.addr >= sp &&
+            loc.u.addr < cfa &&
+            (loc.u.addr < context_lo || loc.u.addr >= context_hi)) {
+          rbp_offset = cfa - loc.u.addr;
+        }
+        // Publish pc last, as a signal handler may unwind in between
+        recipe->pc = 0;
+        __sync_synchronize();
+        recipe->rule =
+            (cfa == rbp + 16 && rbp_offset == 16) ? FP_RULE : SP_RULE;
+        recipe->cfa_offset = cfa - sp;
+        recipe->rbp_offset = rbp_offset;
+        __sync_synchronize();
+        recipe->pc = pc;
+      }
+    }
+    if (caller_pc == 0 || cfa <= sp) {
+      break;
+    }
+    pc = caller_pc;
+    sp = cfa;
+    rbp = caller_rbp;
+    if (i >= skip_depth) {
+      buffer[depth++] = pc;
+    }
+  }
+  return depth;
+}
+
+/** Walk saved frame pointers from a frame, confined to the stack */
+static int FramePointerWalk(unw_word_t fp, unw_word_t sp, unw_word_t *buffer,
+                            int max_depth, int skip_depth) {
+  unw_word_t lo = stack_lo, hi = stack_hi;
+  if (hi == 0 || sp < lo || sp >= hi) {
+    lo = sp;
+    hi = sp + UNWIND_MAX_STACK_SIZE;
+  }
+
+  int depth = 0;
+  for (int i = 0; i < max_depth; i++) {
+    if ((fp & 7) != 0 || fp < lo || fp + 16 > hi) {
+      break;
+    }
+    unw_word_t pc = ((unw_word_t *)fp)[1];
+    unw_word_t caller_fp = ((unw_word_t *)fp)[0];
+    if (pc == 0) {
+      break;
+    }
+    if (i >= skip_depth) {
+      buffer[depth++] = pc;
+    }
+    if (caller_fp <= fp) {
+      break;
+    }
+    fp = caller_fp;
+  }
+  return depth;
+}
+
+#endif // defined(__x86_64__)
+
+int Unwind(unw_word_t *buffer, int max_depth, int skip_depth) {
+  struct timespec start_time, end_time;
+  clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+  int depth = 0, num_steps = 0;
+  unw_context_t context;
+  switch (unwind_mode) {
+#if defined(__x86_64__)
+  case FRAME_POINTER_UNWIND:
+    if (signal_context != nullptr) {
+      // Frames of the signal handler may not keep frame pointers, so start
+      // from the interrupted instruction
+      greg_t *gregs = ((ucontext_t *)signal_context)->uc_mcontext.gregs;
+      buffer[depth++] = gregs[REG_RIP];
+      depth += FramePointerWalk(gregs[REG_RBP], gregs[REG_RSP], buffer + 1,
+                                max_depth - 1, 0);
+    } else {
+      if (stack_hi == 0) {
+        InitUnwindStack();
+      }
+      unw_word_t fp = (unw_word_t)__builtin_frame_address(0);
+      depth = FramePointerWalk(fp, fp, buffer, max_depth, skip_depth);
+    }
+    break;
+  case CACHED_UNWIND:
+    unw_getcontext(&context);
+    depth = CachedWalk(&context, buffer, max_depth, skip_depth, num_steps);
+    break;
+#endif // defined(__x86_64__)
+  default:
+    unw_getcontext(&context);
+    depth = LibunwindWalk(&context, buffer, max_depth, skip_depth, num_steps);
+    break;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &end_time);
+  unsigned long long time =
+      (end_time.tv_sec - start_time.tv_sec) * 1000000000ULL +
+      end_time.tv_nsec - start_time.tv_nsec;
+  __sync_fetch_and_add(&num_unwinds, 1);
+  __sync_fetch_and_add(&num_unwind_frames, depth);
+  __sync_fetch_and_add(&num_unwind_steps, num_steps);
+  __sync_fetch_and_add(&unwind_time, time);
+  core::AddSelfStat(core::STAT_UNWIND_TIME, time);
+  return depth;
+}
+
+void SetUnwindMode(UnwindMode mode) { unwind_mode = mode; }
+
+UnwindMode GetUnwindMode() { return unwind_mode; }
+
+void GetUnwindCost(UnwindCost &cost) {
+  cost.num_unwinds = num_unwinds;
+  cost.num_frames = num_unwind_frames;
+  cost.num_steps = num_unwind_steps;
+  cost.time = unwind_time;
+}
+
+void ReportUnwindCost() {
+  if (getenv("SAMPLER_UNWIND_REPORT") == nullptr) {
+    return;
+  }
+  const char *mode_names[] = {"libunwind", "fp", "cached"};
+  UnwindCost cost;
+  GetUnwindCost(cost);
+  unsigned long long n = cost.num_unwinds ? cost.num_unwinds : 1;
+  LOG_INFO("Unwind (%s): %llu call paths, %.1f frames and %.1f unw_step per "
+           "call path, %llu ns per call path, %.3f s in total\n",
+           mode_names[unwind_mode], cost.num_unwinds,
+           (double)cost.num_frames / n, (double)cost.num_steps / n,
+           cost.time / n, cost.time / 1e9);
+}
+
+void InitUnwindStack() {
+  pthread_attr_t attr;
+  void *stack_addr;
+  size_t stack_size;
+  if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+    return;
+  }
+  if (pthread_attr_getstack(&attr, &stack_addr, &stack_size) == 0) {
+    stack_lo = (unw_word_t)stack_addr;
+    stack_hi = stack_lo + stack_size;
+  }
+  pthread_attr_destroy(&attr);
+}
+
+void SetUnwindSignalContext(void *context, void *address) {
+#if defined(__x86_64__)
+  // Only trust a context whose instruction is the interrupted one
+  if (context != nullptr &&
+      (void *)((ucontext_t *)context)->uc_mcontext.gregs[REG_RIP] != address) {
+    context = nullptr;
+  }
+#endif
+  signal_context = context;
+}
+
+int Backtrace(type::addr_t *pcs, int max_depth) {
+  unw_word_t buffer[MAX_STACK_DEPTH] = {0};
+  if (max_depth > MAX_STACK_DEPTH) {
+    max_depth = MAX_STACK_DEPTH;
+  }
+  // Skip the frame of Backtrace
+  int depth = Unwind(buffer, max_depth, 1);
+  for (int i = 0; i < depth; i++) {
+    pcs[i] = buffer[i];
+  }
+  return depth;
+}
+
+} // namespace baguatool::collector
@@ -0,0 +1,54 @@
+#ifndef UNWINDER_H_
+#define UNWINDER_H_
+
+#define UNW_LOCAL_ONLY
+
+#include "baguatool.h"
+#include "common/tprintf.h"
+#include <libunwind.h>
+
+#ifndef MAX_STACK_DEPTH
+#define MAX_STACK_DEPTH 100
+#endif
+
+// Number of cached frame layouts of each thread, a power of two
+#ifndef UNWIND_CACHE_SIZE
+#define UNWIND_CACHE_SIZE 4096
+#endif
+
+// Walked stack size if the bounds of the stack of a thread are unknown
+#ifndef UNWIND_MAX_STACK_SIZE
+#define UNWIND_MAX_STACK_SIZE (8 * 1024 * 1024)
+#endif
+
+namespace baguatool::collector {
+
+/** Unwind the call path of the calling thread in the current unwind mode
+ * @param buffer - return addresses, from the caller of Unwind outward (output)
+ * @param max_depth - max number of walked frames
+ * @param skip_depth - number of innermost frames not to record. It is ignored
+ * when frame pointers are walked from a signal context.
+ * @return number of recorded frames
+ */
+int Unwind(unw_word_t *buffer, int max_depth, int skip_depth);
+
+void SetUnwindMode(UnwindMode mode);
+UnwindMode GetUnwindMode();
+void GetUnwindCost(UnwindCost &cost);
+void ReportUnwindCost();
+
+/** Record the bounds of the stack of the calling thread, which confine the
+ * walk of frame pointers. It is not async-signal-safe, so samplers call it
+ * when a thread starts sampling.
+ */
+void InitUnwindStack();
+
+/** Set the context of the signal being handled by the calling thread, from
+ * which frame pointers are walked, or nullptr when the handler returns.
+ * @param context - ucontext_t of the signal
+ * @param address - interrupted instruction, to check context
+ */
+void SetUnwindSignalContext(void *context, void *address);
+
+} // namespace baguatool::collector
+#endif // UNWINDER_H_
@@ -0,0 +1,168 @@
+#include "wall_clock.h"
+#include "collector/dynamic/perf_event/perf_event_sampler.h"
+#include "collector/dynamic/unwinder.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+// Older glibc does not name the thread of SIGEV_THREAD_ID
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+namespace baguatool::collector {
+
+static int WallClockFreqFromEnv() {
+  const char *freq_str = getenv("SAMPLER_WALL_CLOCK_FREQ");
+  return freq_str != nullptr ? atoi(freq_str) : 0;
+}
+
+static int wall_clock_freq = WallClockFreqFromEnv();
+static int wall_clock_handler_installed = 0;
+
+static __thread void (*func_at_overflow_3)(int) = nullptr;
+static __thread timer_t wall_clock_timer;
+static __thread bool has_wall_clock_timer = false;
+// Times at the last sample, in nanoseconds
+static __thread long long last_wall_time = 0;
+static __thread long long last_cpu_time = 0;
+// Wall-clock sample being handled, seconds is 0 out of a sample
+static __thread double sample_seconds = 0;
+static __thread bool sample_blocked = false;
+// Depth of BlockWallClockSamples, and expirations deferred by it
+static __thread int wall_clock_block_depth = 0;
+static __thread int deferred_expirations = 0;
+
+static inline long long GetClockTime(clockid_t clock) {
+  struct timespec now;
+  clock_gettime(clock, &now);
+  return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static void wall_clock_handler(int sig, siginfo_t *info, void *context) {
+  if (!has_wall_clock_timer || func_at_overflow_3 == nullptr ||
+      sample_seconds > 0) {
+    return;
+  }
+  int saved_errno = errno;
+  // Expirations missed while the signal was pending add to this sample
+  int overrun = timer_getoverrun(wall_clock_timer);
+  int expirations = 1 + (overrun > 0 ? overrun : 0);
+  if (wall_clock_block_depth > 0) {
+    // A sample of the sampler is being handled on this thread, e.g. in
+    // DrainRing, and GetBacktrace would return the call path of that sample
+    deferred_expirations += expirations;
+    errno = saved_errno;
+    return;
+  }
+  unsigned long long start_time = core::GetSelfStatTime();
+
+  long long wall_time = GetClockTime(CLOCK_MONOTONIC);
+  long long cpu_time = GetClockTime(CLOCK_THREAD_CPUTIME_ID);
+  sample_seconds = (double)(expirations + deferred_expirations) /
+                   wall_clock_freq;
+  deferred_expirations = 0;
+  sample_blocked = 2 * (cpu_time - last_cpu_time) < wall_time - last_wall_time;
+
+  void *address = nullptr;
+#if defined(__x86_64__)
+  address = (void *)((ucontext_t *)context)->uc_mcontext.gregs[REG_RIP];
+#endif
+  SetUnwindSignalContext(context, address);
+  (*(func_at_overflow_3))(WALL_CLOCK_EVENT);
+  SetUnwindSignalContext(nullptr, nullptr);
+
+  sample_seconds = 0;
+  last_wall_time = wall_time;
+  last_cpu_time = cpu_time;
+  core::AddSelfStat(core::STAT_SAMPLES, 1);
+  core::AddSelfStat(core::STAT_HANDLER_TIME,
+                    core::GetSelfStatTime() - start_time);
+  errno = saved_errno;
+}
+
+void SetWallClockFreq(int freq) { wall_clock_freq = freq > 0 ? freq : 0; }
+
+int GetWallClockFreq() { return wall_clock_freq; }
+
+void CreateWallClockTimer(void (*FUNC_AT_OVERFLOW)(int)) {
+  func_at_overflow_3 = FUNC_AT_OVERFLOW;
+  if (wall_clock_freq <= 0 || has_wall_clock_timer) {
+    return;
+  }
+  if (__sync_bool_compare_and_swap(&wall_clock_handler_installed, 0, 1)) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = wall_clock_handler;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    // The overflow function is not reentrant, so samples of the sampler wait
+    // for this handler. SIGPROF is the overflow signal of PAPI.
+    sigemptyset(&sa.sa_mask);
+    sigaddset(&sa.sa_mask, PERF_EVENT_SIGNAL);
+    sigaddset(&sa.sa_mask, SIGPROF);
+    if (sigaction(WALL_CLOCK_SIGNAL, &sa, nullptr) != 0) {
+      LOG_ERROR("sigaction failed: %s\n", strerror(errno));
+    }
+  }
+
+  // Expirations are delivered to the calling thread only, on-CPU or not
+  struct sigevent sev;
+  memset(&sev, 0, sizeof(sev));
+  sev.sigev_notify = SIGEV_THREAD_ID;
+  sev.sigev_signo = WALL_CLOCK_SIGNAL;
+  sev.sigev_notify_thread_id = syscall(SYS_gettid);
+  if (timer_create(CLOCK_MONOTONIC, &sev, &wall_clock_timer) != 0) {
+    LOG_ERROR("timer_create failed: %s\n", strerror(errno));
+    return;
+  }
+  has_wall_clock_timer = true;
+}
+
+void DeleteWallClockTimer() {
+  if (has_wall_clock_timer) {
+    has_wall_clock_timer = false;
+    timer_delete(wall_clock_timer);
+  }
+}
+
+void StartWallClockTimer() {
+  if (!has_wall_clock_timer) {
+    return;
+  }
+  last_wall_time = GetClockTime(CLOCK_MONOTONIC);
+  last_cpu_time = GetClockTime(CLOCK_THREAD_CPUTIME_ID);
+  struct itimerspec spec;
+  long long interval = 1000000000LL / wall_clock_freq;
+  spec.it_interval.tv_sec = interval / 1000000000LL;
+  spec.it_interval.tv_nsec = interval % 1000000000LL;
+  spec.it_value = spec.it_interval;
+  timer_settime(wall_clock_timer, 0, &spec, nullptr);
+}
+
+void StopWallClockTimer() {
+  if (!has_wall_clock_timer) {
+    return;
+  }
+  struct itimerspec spec;
+  memset(&spec, 0, sizeof(spec));
+  timer_settime(wall_clock_timer, 0, &spec, nullptr);
+}
+
+void BlockWallClockSamples() { wall_clock_block_depth++; }
+
+void UnblockWallClockSamples() { wall_clock_block_depth--; }
+
+bool GetWallClockSample(double &seconds, bool &blocked) {
+  if (sample_seconds <= 0) {
+    return false;
+  }
+  seconds = sample_seconds;
+  blocked = sample_blocked;
+  return true;
+}
+
+} // namespace baguatool::collector
@@ -0,0 +1,48 @@
+#ifndef WALL_CLOCK_H_
+#define WALL_CLOCK_H_
+
+#include "baguatool.h"
+#include "common/tprintf.h"
+#include <signal.h>
+
+// Signal of the wall-clock timers of threads
+#ifndef WALL_CLOCK_SIGNAL
+#define WALL_CLOCK_SIGNAL (SIGRTMIN + 4)
+#endif
+
+namespace baguatool::collector {
+
+/** Set the frequency of wall-clock samples, 0 to disable them. It must be
+ * called before CreateWallClockTimer. */
+void SetWallClockFreq(int freq);
+int GetWallClockFreq();
+
+/** Create the wall-clock timer of the calling thread, which executes the
+ * overflow function with WALL_CLOCK_EVENT when it expires
+ * @param FUNC_AT_OVERFLOW - overflow function
+ */
+void CreateWallClockTimer(void (*FUNC_AT_OVERFLOW)(int));
+void DeleteWallClockTimer();
+
+/** Arm or disarm the wall-clock timer of the calling thread */
+void StartWallClockTimer();
+void StopWallClockTimer();
+
+/** Get the wall-clock sample being handled by the calling thread. The thread
+ * is blocked if it ran less than half of the time since its last sample.
+ * @param seconds - wall-clock time the sample stands for (output)
+ * @param blocked - whether the thread was off-CPU (output)
+ * @return false out of a wall-clock sample
+ */
+bool GetWallClockSample(double &seconds, bool &blocked);
+
+/** Defer wall-clock samples of the calling thread while a sample of the
+ * sampler is being handled, as the overflow function is not reentrant. A
+ * deferred sample adds its time to the next one. Calls may nest, and they
+ * are async-signal-safe.
+ */
+void BlockWallClockSamples();
+void UnblockWallClockSamples();
+
+} // namespace baguatool::collector
+#endif // WALL_CLOCK_H_
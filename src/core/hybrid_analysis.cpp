@@ -222,26 +222,33 @@ ProgramAbstractionGraph *HybridAnalysis::GetProgramAbstractionGraph() {
 
 void HybridAnalysis::DataEmbedding(PerfData *perf_data) {
   // Query for each call path
-  auto data_size = perf_data->GetVertexDataSize();
-  for (unsigned long int i = 0; i < data_size; i++) {
-    std::stack<unsigned long long> call_path;
-    perf_data->GetVertexDataCallPath(i, call_path);
-    if (!call_path.empty()) {
-      call_path.pop();
+  int num_metrics = perf_data->GetNumMetrics();
+  auto data_end = perf_data->VertexDataEnd();
+  for (auto it = perf_data->VertexDataBegin(); it != data_end; ++it) {
+    // Skip the outermost frame
+    const type::addr_t *call_path = it.GetCallPath();
+    int call_path_len = it.GetCallPathLen();
+    if (call_path_len > 0) {
+      call_path++;
+      call_path_len--;
     }
-    auto value = perf_data->GetVertexDataValue(i);
-    auto process_id = perf_data->GetVertexDataProcsId(i);
-    auto thread_id = perf_data->GetVertexDataThreadId(i);
+    auto process_id = it.GetProcsId();
+    auto thread_id = it.GetThreadId();
 
     type::vertex_t queried_vertex_id =
-        this->root_pag->GetVertexWithCallPath(0, call_path);
+        this->root_pag->GetVertexWithCallPath(0, call_path, call_path_len);
     // dbg(queried_vertex_id);
-    perf_data_t data = this->graph_perf_data->GetPerfData(
-        queried_vertex_id, perf_data->GetMetricName(), process_id, thread_id);
-    data += value;
-    this->graph_perf_data->SetPerfData(queried_vertex_id,
-                                       perf_data->GetMetricName(), process_id,
-                                       thread_id, data);
+    // Embed all metrics with one query of the call path
+    for (int m = 0; m < num_metrics; m++) {
+      auto value = it.GetValue(m);
+      perf_data_t data = this->graph_perf_data->GetPerfData(
+          queried_vertex_id, perf_data->GetMetricName(m), process_id,
+          thread_id);
+      data += value;
+      this->graph_perf_data->SetPerfData(queried_vertex_id,
+                                         perf_data->GetMetricName(m),
+                                         process_id, thread_id, data);
+    }
   }
 
 } // function Dataembedding
@@ -1,8 +1,124 @@
 #include "perf_data.h"
+#include "common/tokenizer.h"
 #include "dbg.h"
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <sched.h>
+#include <set>
+#include <sys/mman.h>
+#include <unistd.h>
 
 namespace baguatool::core {
 
+static unsigned long int perf_data_instance_count = 0;
+
+/** Thread-local cache of the sample buffer, valid only for the PerfData with
+ * the same instance id */
+static __thread TBS *thread_buffer = nullptr;
+static __thread unsigned long int thread_buffer_instance_id = 0;
+// Samples skipped by the calling thread since the last kept one
+static __thread unsigned long int thread_skipped_sample_count = 0;
+
+static inline void SpinLock(volatile int *lock) {
+  while (__sync_lock_test_and_set(lock, 1)) {
+    while (*lock) {
+    }
+  }
+}
+
+static inline bool SpinTryLock(volatile int *lock) {
+  return __sync_lock_test_and_set(lock, 1) == 0;
+}
+
+static inline void SpinUnlock(volatile int *lock) { __sync_lock_release(lock); }
+
+/** Ids of PerfData objects not destroyed yet, so that a thread exiting after
+ * its PerfData does not touch an unmapped buffer. Never freed, as threads may
+ * exit after static destructors. */
+static std::set<unsigned long int> *live_instance_ids = nullptr;
+static volatile int live_instance_lock = 0;
+static pthread_key_t thread_buffer_key;
+
+/** Destructor of thread_buffer_key, retire the sample buffer of an exiting
+ * thread, so that it is merged and reused instead of staying active */
+static void RetireExitingThreadBuffer(void *) {
+  SpinLock(&live_instance_lock);
+  if (thread_buffer != nullptr &&
+      live_instance_ids->count(thread_buffer_instance_id) > 0) {
+    __sync_bool_compare_and_swap(&(thread_buffer->state), TBS_ACTIVE,
+                                 TBS_RETIRED);
+  }
+  thread_buffer = nullptr;
+  SpinUnlock(&live_instance_lock);
+}
+
+/** Wait for the writer thread to finish the back buffer. Not for signal
+ * handlers, which must not wait for it. */
+static void WaitAsyncDump(ADS *async_dump) {
+  while (async_dump->pending) {
+    sched_yield();
+  }
+  // Do not touch the back buffer before the writer thread is done with it
+  __sync_synchronize();
+}
+
+static_assert(offsetof(PDH, num_dropped_samples) == PERF_DATA_MIN_HEADER_SIZE,
+              "fields of PDH before num_dropped_samples must not change");
+static_assert(offsetof(PDH, sample_period) == PERF_DATA_V3_HEADER_SIZE &&
+                  sizeof(PDH) == PERF_DATA_PERIOD_HEADER_SIZE,
+              "PDH only grows at its end");
+
+/** Map zeroed memory, async-signal-safe unlike malloc. Pages are committed on
+ * first touch.
+ * @return nullptr if out of memory
+ */
+static void *MapMem(size_t size) {
+  void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  return mem == MAP_FAILED ? nullptr : mem;
+}
+
+/** Grow memory from MapMem, async-signal-safe unlike realloc
+ * @return nullptr if out of memory, and mem is kept
+ */
+static void *RemapMem(void *mem, size_t old_size, size_t size) {
+  void *new_mem = mremap(mem, old_size, size, MREMAP_MAYMOVE);
+  return new_mem == MAP_FAILED ? nullptr : new_mem;
+}
+
+static void UnmapMem(void *mem, size_t size) {
+  if (mem != nullptr) {
+    munmap(mem, size);
+  }
+}
+
+static bool ArenaInit(ARENA *arena, size_t size) {
+  arena->base = (char *)MapMem(size);
+  arena->size = arena->base != nullptr ? size : 0;
+  arena->used_size = 0;
+  return arena->base != nullptr;
+}
+
+/** Carve a chunk from an arena. Async-signal-safe and thread-safe.
+ * @return nullptr if the arena is full
+ */
+static void *ArenaAlloc(ARENA *arena, size_t size) {
+  size = (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+  size_t offset = __sync_fetch_and_add(&(arena->used_size), size);
+  if (offset + size > arena->size) {
+    return nullptr;
+  }
+  return arena->base + offset;
+}
+
+static void ArenaDestroy(ARENA *arena) {
+  UnmapMem(arena->base, arena->size);
+  arena->base = nullptr;
+  arena->size = 0;
+  arena->used_size = 0;
+}
+
 /** TODO: need to rename these two functions */
 void preserve_call_path_tail_so_addr(std::stack<type::addr_t> &call_path) {
   std::stack<type::addr_t> tmp;
@@ -45,42 +161,737 @@ void delete_all_so_addr(std::stack<type::addr_t> &call_path) {
   FREE_CONTAINER(tmp);
 }
 
-PerfData::PerfData() {
-  this->vertex_perf_data_space_size = MAX_TRACE_MEM / sizeof(VDS);
+PerfData::PerfData() : PerfData(false) {}
+
+PerfData::PerfData(bool read_only) {
+  this->read_only = read_only;
+  size_t trace_mem = read_only ? READ_ONLY_INIT_MEM : MAX_TRACE_MEM;
+  this->vertex_perf_data_space_size = trace_mem / sizeof(VDS);
   // dbg(this->vertex_perf_data_space_size);
   // this->vertex_perf_data = new VDS[this->vertex_perf_data_space_size];
   this->vertex_perf_data =
-      (VDS *)malloc(this->vertex_perf_data_space_size * sizeof(VDS));
+      (VDS *)MapMem(this->vertex_perf_data_space_size * sizeof(VDS));
   this->vertex_perf_data_count = 0;
 
-  this->edge_perf_data_space_size = MAX_TRACE_MEM / sizeof(EDS);
+  this->edge_perf_data_space_size = trace_mem / sizeof(EDS);
   // this->edge_perf_data = new EDS[this->edge_perf_data_space_size];
   this->edge_perf_data =
-      (EDS *)malloc(this->edge_perf_data_space_size * sizeof(EDS));
+      (EDS *)MapMem(this->edge_perf_data_space_size * sizeof(EDS));
   this->edge_perf_data_count = 0;
+  if (this->vertex_perf_data == nullptr || this->edge_perf_data == nullptr) {
+    ERR_EXIT("Failed to map performance data");
+  }
+
+  this->RebuildVertexDataIndex();
+  this->RebuildEdgeDataIndex();
+
+  // CCT nodes never move, so that the writer thread of async dump can read
+  // them while new nodes are appended. Only touched pages take memory.
+  // Read-only ones grow instead, as reserved memory still counts against
+  // ulimit -v and strict overcommit.
+  this->cct_node_space_size =
+      (read_only ? READ_ONLY_INIT_MEM : MAX_CCT_MEM) / sizeof(CCTN);
+  void *mem = MapMem(this->cct_node_space_size * sizeof(CCTN));
+  if (mem == nullptr) {
+    ERR_EXIT("Failed to map CCT nodes");
+  }
+  this->cct_nodes = new (mem) CCTN(); // root
+  this->cct_node_count = 1;
+  this->cct_node_index_size = CCT_INDEX_INIT_SIZE;
+  mem = MapMem(this->cct_node_index_size * sizeof(unsigned long int));
+  if (mem == nullptr) {
+    ERR_EXIT("Failed to map CCT index");
+  }
+  this->cct_node_index = (unsigned long int *)mem;
+
+  this->sample_arena = new ARENA();
+  const char *mem_cap = getenv("PERF_DATA_MEM_CAP");
+  size_t sample_mem_size = mem_cap != nullptr ? strtoul(mem_cap, 0, 10) : 0;
+  if (sample_mem_size == 0) {
+    sample_mem_size = MAX_SAMPLE_MEM;
+  }
+  if (!read_only && !ArenaInit(this->sample_arena, sample_mem_size)) {
+    LOG_ERROR("Failed to reserve %lu bytes for samples\n", sample_mem_size);
+  }
+
+  const char *overflow = getenv("PERF_DATA_OVERFLOW");
+  if (overflow != nullptr && strcmp(overflow, "flush") == 0) {
+    this->overflow_policy = type::OVERFLOW_FLUSH;
+  } else if (overflow != nullptr && strcmp(overflow, "downsample") == 0) {
+    this->overflow_policy = type::OVERFLOW_DOWNSAMPLE;
+  }
+
+  this->instance_id = __sync_add_and_fetch(&perf_data_instance_count, 1);
+  SpinLock(&live_instance_lock);
+  if (live_instance_ids == nullptr) {
+    live_instance_ids = new std::set<unsigned long int>();
+    pthread_key_create(&thread_buffer_key, RetireExitingThreadBuffer);
+  }
+  live_instance_ids->insert(this->instance_id);
+  SpinUnlock(&live_instance_lock);
 
   strcpy(this->file_name, "SAMPLE.TXT");
+
+  const char *format = getenv("PERF_DATA_FORMAT");
+  if (format != nullptr && strcmp(format, "text") == 0) {
+    this->dump_format = type::PERF_DATA_TEXT;
+  }
 }
 PerfData::~PerfData() {
+  SpinLock(&live_instance_lock);
+  live_instance_ids->erase(this->instance_id);
+  SpinUnlock(&live_instance_lock);
+  this->SetAsyncDump(false);
   // delete[] this->vertex_perf_data;
   // delete[] this->edge_perf_data;
-  free(this->vertex_perf_data);
-  free(this->edge_perf_data);
+  UnmapMem(this->vertex_perf_data,
+           this->vertex_perf_data_space_size * sizeof(VDS));
+  UnmapMem(this->edge_perf_data,
+           this->edge_perf_data_space_size * sizeof(EDS));
+  UnmapMem(this->vertex_perf_data_index,
+           this->vertex_perf_data_index_size * sizeof(unsigned long int));
+  UnmapMem(this->edge_perf_data_index,
+           this->edge_perf_data_index_size * sizeof(unsigned long int));
+  UnmapMem(this->cct_nodes, this->cct_node_space_size * sizeof(CCTN));
+  UnmapMem(this->cct_node_index,
+           this->cct_node_index_size * sizeof(unsigned long int));
+  // Thread buffers are chunks of the arena
+  ArenaDestroy(this->sample_arena);
+  delete this->sample_arena;
   if (this->has_open_output_file) {
     fclose(this->perf_data_fp);
   }
 }
 
 void PerfData::ExpandVertexDataMem() {
-  this->vertex_perf_data_space_size += MAX_TRACE_MEM / sizeof(VDS);
-  this->vertex_perf_data = (VDS *)realloc(
-      this->vertex_perf_data, this->vertex_perf_data_space_size * sizeof(VDS));
+  size_t old_size = this->vertex_perf_data_space_size * sizeof(VDS);
+  size_t size = old_size + MAX_TRACE_MEM / sizeof(VDS) * sizeof(VDS);
+  // Front and back buffers are swapped, keep them in the same size
+  if (this->async_dump != nullptr) {
+    WaitAsyncDump(this->async_dump);
+    VDS *back = (VDS *)RemapMem(this->async_dump->vertex_data, old_size, size);
+    if (back == nullptr) {
+      ERR_EXIT("Failed to expand vertex data");
+    }
+    this->async_dump->vertex_data = back;
+  }
+  VDS *front = (VDS *)RemapMem(this->vertex_perf_data, old_size, size);
+  if (front == nullptr) {
+    ERR_EXIT("Failed to expand vertex data");
+  }
+  this->vertex_perf_data = front;
+  this->vertex_perf_data_space_size = size / sizeof(VDS);
+  this->RebuildVertexDataIndex();
 }
 
 void PerfData::ExpandEdgeDataMem() {
-  this->edge_perf_data_space_size = MAX_TRACE_MEM / sizeof(EDS);
-  this->edge_perf_data = (EDS *)realloc(
-      this->edge_perf_data, this->edge_perf_data_space_size * sizeof(EDS));
+  size_t old_size = this->edge_perf_data_space_size * sizeof(EDS);
+  size_t size = old_size + MAX_TRACE_MEM / sizeof(EDS) * sizeof(EDS);
+  if (this->async_dump != nullptr) {
+    WaitAsyncDump(this->async_dump);
+    EDS *back = (EDS *)RemapMem(this->async_dump->edge_data, old_size, size);
+    if (back == nullptr) {
+      ERR_EXIT("Failed to expand edge data");
+    }
+    this->async_dump->edge_data = back;
+  }
+  EDS *front = (EDS *)RemapMem(this->edge_perf_data, old_size, size);
+  if (front == nullptr) {
+    ERR_EXIT("Failed to expand edge data");
+  }
+  this->edge_perf_data = front;
+  this->edge_perf_data_space_size = size / sizeof(EDS);
+  this->RebuildEdgeDataIndex();
+}
+
+void PerfData::SetMemoryCap(size_t mem_cap) {
+  SpinLock(&(this->shared_data_lock));
+  if (this->sample_arena->used_size > 0) {
+    LOG_ERROR("Failed to set memory cap, %s\n", "samples are recorded");
+  } else {
+    ArenaDestroy(this->sample_arena);
+    if (!ArenaInit(this->sample_arena, mem_cap)) {
+      LOG_ERROR("Failed to reserve %lu bytes for samples\n", mem_cap);
+    }
+  }
+  SpinUnlock(&(this->shared_data_lock));
+}
+
+void PerfData::SetOverflowPolicy(type::overflow_policy_t policy) {
+  this->overflow_policy = policy;
+}
+
+unsigned long int PerfData::GetDroppedSampleCount() {
+  return this->dropped_sample_count;
+}
+
+void PerfData::SetAsyncDump(bool enable) {
+  if (enable && this->read_only) {
+    // The writer thread would read CCT nodes that may move
+    LOG_ERROR("Failed to set async dump, %s\n", "PerfData is read-only");
+    return;
+  }
+  if (enable && this->async_dump == nullptr) {
+    ADS *async_dump = new ADS();
+    async_dump->perf_data = this;
+    async_dump->vertex_data =
+        (VDS *)MapMem(this->vertex_perf_data_space_size * sizeof(VDS));
+    async_dump->edge_data =
+        (EDS *)MapMem(this->edge_perf_data_space_size * sizeof(EDS));
+    sem_init(&(async_dump->sem), 0, 0);
+    if (async_dump->vertex_data == nullptr ||
+        async_dump->edge_data == nullptr ||
+        pthread_create(&(async_dump->thread), nullptr,
+                       PerfData::AsyncDumpThread, async_dump) != 0) {
+      LOG_ERROR("Failed to create writer thread, %s\n", "dump is sync");
+      sem_destroy(&(async_dump->sem));
+      UnmapMem(async_dump->vertex_data,
+               this->vertex_perf_data_space_size * sizeof(VDS));
+      UnmapMem(async_dump->edge_data,
+               this->edge_perf_data_space_size * sizeof(EDS));
+      delete async_dump;
+      return;
+    }
+    SpinLock(&(this->shared_data_lock));
+    this->async_dump = async_dump;
+    SpinUnlock(&(this->shared_data_lock));
+  } else if (!enable && this->async_dump != nullptr) {
+    SpinLock(&(this->shared_data_lock));
+    ADS *async_dump = this->async_dump;
+    this->async_dump = nullptr;
+    SpinUnlock(&(this->shared_data_lock));
+
+    // The writer thread exits after writing the pending back buffer
+    async_dump->stop = 1;
+    sem_post(&(async_dump->sem));
+    pthread_join(async_dump->thread, nullptr);
+    LOG_INFO("Async dump: %lu swaps, %lu bytes written\n",
+             async_dump->swap_count, async_dump->byte_count);
+
+    sem_destroy(&(async_dump->sem));
+    UnmapMem(async_dump->vertex_data,
+             this->vertex_perf_data_space_size * sizeof(VDS));
+    UnmapMem(async_dump->edge_data,
+             this->edge_perf_data_space_size * sizeof(EDS));
+    delete async_dump;
+  }
+}
+
+void *PerfData::AsyncDumpThread(void *arg) {
+  ADS *async_dump = (ADS *)arg;
+  PerfData *perf_data = async_dump->perf_data;
+
+  while (true) {
+    while (sem_wait(&(async_dump->sem)) != 0) {
+    }
+    if (async_dump->pending) {
+      if (perf_data->OpenOutputFile()) {
+        async_dump->byte_count += perf_data->DumpSection(
+            async_dump->vertex_data, async_dump->vertex_data_count,
+            async_dump->edge_data, async_dump->edge_data_count,
+            async_dump->cct_node_count, async_dump->dropped_sample_count);
+      }
+      async_dump->vertex_data_count = 0;
+      async_dump->edge_data_count = 0;
+      __sync_lock_release(&(async_dump->pending));
+    }
+    if (async_dump->stop) {
+      break;
+    }
+  }
+  return nullptr;
+}
+
+bool CallPathCmp(type::addr_t *cp_1, int cp_1_len, type::addr_t *cp_2,
+                 int cp_2_len) {
+  if (cp_1_len != cp_2_len) {
+    return false;
+  } else {
+    for (int i = 0; i < cp_1_len; i++) {
+      if (cp_1[i] != cp_2[i]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/** Hash a call path with FNV-1a, seeded by the previous hash value */
+static unsigned long long CallPathHash(type::addr_t *call_path,
+                                       int call_path_len,
+                                       unsigned long long hash) {
+  for (int i = 0; i < call_path_len; i++) {
+    hash ^= call_path[i];
+    hash *= 0x100000001b3ULL;
+  }
+  hash ^= (unsigned long long)call_path_len;
+  hash *= 0x100000001b3ULL;
+  return hash;
+}
+
+/** Mix an id into a hash value */
+static unsigned long long IdHash(int id, unsigned long long hash) {
+  hash ^= (unsigned long long)(unsigned int)id;
+  hash *= 0x100000001b3ULL;
+  return hash;
+}
+
+static unsigned long long SampleDataHash(type::addr_t *call_path,
+                                         int call_path_len, int procs_id,
+                                         int thread_id) {
+  unsigned long long hash = 0xcbf29ce484222325ULL;
+  hash = CallPathHash(call_path, call_path_len, hash);
+  hash = IdHash(procs_id, hash);
+  hash = IdHash(thread_id, hash);
+  return hash;
+}
+
+/** Mix a CCT node id into a hash value */
+static unsigned long long NodeHash(unsigned long int node_id,
+                                   unsigned long long hash) {
+  hash ^= (unsigned long long)node_id;
+  hash *= 0x100000001b3ULL;
+  return hash;
+}
+
+static unsigned long long CCTNodeHash(unsigned long int parent,
+                                      type::addr_t addr) {
+  unsigned long long hash = 0xcbf29ce484222325ULL;
+  hash = NodeHash(parent, hash);
+  hash = NodeHash(addr, hash);
+  return hash;
+}
+
+static unsigned long long VertexDataHash(unsigned long int cct_node_id,
+                                         int procs_id, int thread_id) {
+  unsigned long long hash = 0xcbf29ce484222325ULL;
+  hash = NodeHash(cct_node_id, hash);
+  hash = IdHash(procs_id, hash);
+  hash = IdHash(thread_id, hash);
+  return hash;
+}
+
+static unsigned long long EdgeDataHash(unsigned long int cct_node_id,
+                                       unsigned long int out_cct_node_id,
+                                       int procs_id, int out_procs_id,
+                                       int thread_id, int out_thread_id) {
+  unsigned long long hash = 0xcbf29ce484222325ULL;
+  hash = NodeHash(cct_node_id, hash);
+  hash = NodeHash(out_cct_node_id, hash);
+  hash = IdHash(procs_id, hash);
+  hash = IdHash(out_procs_id, hash);
+  hash = IdHash(thread_id, hash);
+  hash = IdHash(out_thread_id, hash);
+  return hash;
+}
+
+/** The smallest power of 2 that keeps the load factor of an index <= 0.5 */
+static unsigned long int IndexSizeFor(unsigned long int space_size) {
+  unsigned long int index_size = 1;
+  while (index_size < 2 * space_size) {
+    index_size <<= 1;
+  }
+  return index_size;
+}
+
+/** Append the i-th record to the end of its probe chain, so that a query
+ * always hits the earliest record of a key */
+static void IndexVertexData(unsigned long int *index,
+                            unsigned long int index_size, VDS *vertex_data,
+                            unsigned long int i) {
+  VDS *data = &(vertex_data[i]);
+  unsigned long int mask = index_size - 1;
+  unsigned long int slot =
+      VertexDataHash(data->cct_node_id, data->procs_id, data->thread_id) &
+      mask;
+  while (index[slot] != 0) {
+    slot = (slot + 1) & mask;
+  }
+  index[slot] = i + 1;
+}
+
+static void IndexEdgeData(unsigned long int *index,
+                          unsigned long int index_size, EDS *edge_data,
+                          unsigned long int i) {
+  EDS *data = &(edge_data[i]);
+  unsigned long int mask = index_size - 1;
+  unsigned long int slot =
+      EdgeDataHash(data->cct_node_id, data->out_cct_node_id, data->procs_id,
+                   data->out_procs_id, data->thread_id, data->out_thread_id) &
+      mask;
+  while (index[slot] != 0) {
+    slot = (slot + 1) & mask;
+  }
+  index[slot] = i + 1;
+}
+
+/** Aggregate values of the first num_values metrics of a sample into a sample
+ * table with its hash index, append a new sample if the key is absent. Not
+ * thread-safe.
+ * @return false if a new sample is needed but the table is full
+ */
+static bool AggregateSampleData(SDS *sample_data, unsigned long int *count,
+                                unsigned long int space_size,
+                                unsigned long int *index,
+                                unsigned long int index_size,
+                                type::addr_t *call_path, int call_path_len,
+                                int procs_id, int thread_id,
+                                const perf_data_t *value, int num_values) {
+  unsigned long int mask = index_size - 1;
+  unsigned long int slot =
+      SampleDataHash(call_path, call_path_len, procs_id, thread_id) & mask;
+  while (index[slot] != 0) {
+    SDS *data = &(sample_data[index[slot] - 1]);
+    if (data->thread_id == thread_id && data->procs_id == procs_id &&
+        CallPathCmp(call_path, call_path_len, data->call_path,
+                    data->call_path_len) == true) {
+      for (int i = 0; i < num_values; i++) {
+        data->value[i] += value[i];
+      }
+      return true;
+    }
+    slot = (slot + 1) & mask;
+  }
+
+  if (*count >= space_size) {
+    return false;
+  }
+  unsigned long int x = (*count)++;
+  sample_data[x].call_path_len = call_path_len;
+  for (int i = 0; i < call_path_len; i++) {
+    sample_data[x].call_path[i] = call_path[i];
+  }
+  // Slots are reused after merge
+  memset(sample_data[x].value, 0, sizeof(sample_data[x].value));
+  for (int i = 0; i < num_values; i++) {
+    sample_data[x].value[i] = value[i];
+  }
+  sample_data[x].thread_id = thread_id;
+  sample_data[x].procs_id = procs_id;
+  index[slot] = x + 1;
+  return true;
+}
+
+/** Aggregate values of all metrics of a sample into a record table with its
+ * hash index, append a new record if the key is absent. Not thread-safe.
+ * @return false if a new record is needed but the table is full
+ */
+static bool AggregateVertexData(VDS *vertex_data, unsigned long int *count,
+                                unsigned long int space_size,
+                                unsigned long int *index,
+                                unsigned long int index_size,
+                                unsigned long int cct_node_id, int procs_id,
+                                int thread_id, const perf_data_t *value) {
+  unsigned long int mask = index_size - 1;
+  unsigned long int slot =
+      VertexDataHash(cct_node_id, procs_id, thread_id) & mask;
+  while (index[slot] != 0) {
+    VDS *data = &(vertex_data[index[slot] - 1]);
+    if (data->cct_node_id == cct_node_id && data->thread_id == thread_id &&
+        data->procs_id == procs_id) {
+      for (int i = 0; i < MAX_NUM_METRICS; i++) {
+        data->value[i] += value[i];
+      }
+      return true;
+    }
+    slot = (slot + 1) & mask;
+  }
+
+  if (*count >= space_size) {
+    return false;
+  }
+  unsigned long int x = (*count)++;
+  vertex_data[x].cct_node_id = cct_node_id;
+  memcpy(vertex_data[x].value, value, sizeof(vertex_data[x].value));
+  vertex_data[x].thread_id = thread_id;
+  vertex_data[x].procs_id = procs_id;
+  index[slot] = x + 1;
+  return true;
+}
+
+void PerfData::RebuildVertexDataIndex() {
+  unsigned long int index_size =
+      IndexSizeFor(this->vertex_perf_data_space_size);
+  if (index_size != this->vertex_perf_data_index_size) {
+    UnmapMem(this->vertex_perf_data_index,
+             this->vertex_perf_data_index_size * sizeof(unsigned long int));
+    this->vertex_perf_data_index =
+        (unsigned long int *)MapMem(index_size * sizeof(unsigned long int));
+    if (this->vertex_perf_data_index == nullptr) {
+      ERR_EXIT("Failed to map vertex data index");
+    }
+    this->vertex_perf_data_index_size = index_size;
+  }
+  memset(this->vertex_perf_data_index, 0,
+         index_size * sizeof(unsigned long int));
+
+  for (unsigned long int i = 0; i < this->vertex_perf_data_count; i++) {
+    IndexVertexData(this->vertex_perf_data_index, index_size,
+                    this->vertex_perf_data, i);
+  }
+}
+
+void PerfData::RebuildEdgeDataIndex() {
+  unsigned long int index_size = IndexSizeFor(this->edge_perf_data_space_size);
+  if (index_size != this->edge_perf_data_index_size) {
+    UnmapMem(this->edge_perf_data_index,
+             this->edge_perf_data_index_size * sizeof(unsigned long int));
+    this->edge_perf_data_index =
+        (unsigned long int *)MapMem(index_size * sizeof(unsigned long int));
+    if (this->edge_perf_data_index == nullptr) {
+      ERR_EXIT("Failed to map edge data index");
+    }
+    this->edge_perf_data_index_size = index_size;
+  }
+  memset(this->edge_perf_data_index, 0,
+         index_size * sizeof(unsigned long int));
+
+  for (unsigned long int i = 0; i < this->edge_perf_data_count; i++) {
+    IndexEdgeData(this->edge_perf_data_index, index_size,
+                  this->edge_perf_data, i);
+  }
+}
+
+TBS *PerfData::GetThreadBuffer() {
+  if (thread_buffer != nullptr &&
+      thread_buffer_instance_id == this->instance_id) {
+    return thread_buffer;
+  }
+
+  // Claim a buffer given up by other threads
+  TBS *buffer = this->thread_buffer_list;
+  while (buffer != nullptr) {
+    if (buffer->state == TBS_FREE &&
+        __sync_bool_compare_and_swap(&(buffer->state), TBS_FREE,
+                                     TBS_ACTIVE)) {
+      break;
+    }
+    buffer = buffer->next;
+  }
+
+  // Or carve a new one from the arena, which is async-signal-safe while
+  // malloc is not
+  if (buffer == nullptr) {
+    unsigned long int space_size = MAX_THREAD_BUFFER_MEM / sizeof(SDS);
+    unsigned long int index_size = IndexSizeFor(space_size);
+    size_t mem_size = sizeof(TBS) + space_size * sizeof(SDS) +
+                      index_size * sizeof(unsigned long int);
+    void *mem = ArenaAlloc(this->sample_arena, mem_size);
+    if (mem == nullptr) {
+      return nullptr;
+    }
+    buffer = new (mem) TBS();
+    buffer->state = TBS_ACTIVE;
+    buffer->sample_data = (SDS *)((char *)mem + sizeof(TBS));
+    buffer->sample_data_space_size = space_size;
+    buffer->sample_data_index =
+        (unsigned long int *)(buffer->sample_data + space_size);
+    buffer->sample_data_index_size = index_size;
+    buffer->mem_size = mem_size;
+    this->UpdatePeakMem();
+
+    // Lock-free push to the head of the list
+    do {
+      buffer->next = this->thread_buffer_list;
+    } while (!__sync_bool_compare_and_swap(&(this->thread_buffer_list),
+                                           buffer->next, buffer));
+  }
+
+  thread_buffer = buffer;
+  thread_buffer_instance_id = this->instance_id;
+  // Any non-null value makes the key destructor run at thread exit
+  pthread_setspecific(thread_buffer_key, buffer);
+  return buffer;
+}
+
+void PerfData::RetireThreadBuffer() {
+  if (thread_buffer != nullptr &&
+      thread_buffer_instance_id == this->instance_id) {
+    __sync_bool_compare_and_swap(&(thread_buffer->state), TBS_ACTIVE,
+                                 TBS_RETIRED);
+    thread_buffer = nullptr;
+  }
+}
+
+void PerfData::MergeThreadBuffers(bool wait) {
+  for (TBS *buffer = this->thread_buffer_list; buffer != nullptr;
+       buffer = buffer->next) {
+    if (buffer->state == TBS_FREE) {
+      continue;
+    }
+    // Wait for the owner to finish recording the current sample. In a signal
+    // handler the owner may be the interrupted code on the same thread, so
+    // skip a busy buffer instead.
+    if (wait) {
+      SpinLock(&(buffer->lock));
+    } else if (!SpinTryLock(&(buffer->lock))) {
+      continue;
+    }
+    // Make room for the whole buffer, or leave it to the next merge
+    if (this->vertex_perf_data_count + buffer->sample_data_count >
+            this->vertex_perf_data_space_size - 5 &&
+        !this->FlushSharedData(wait)) {
+      SpinUnlock(&(buffer->lock));
+      continue;
+    }
+    for (unsigned long int i = 0; i < buffer->sample_data_count; i++) {
+      SDS *data = &(buffer->sample_data[i]);
+      unsigned long int cct_node_id =
+          this->InsertCCTPath(data->call_path, data->call_path_len);
+      // Room is made above, a sample adds at most one record
+      AggregateVertexData(
+          this->vertex_perf_data, &(this->vertex_perf_data_count),
+          this->vertex_perf_data_space_size - 5, this->vertex_perf_data_index,
+          this->vertex_perf_data_index_size, cct_node_id, data->procs_id,
+          data->thread_id, data->value);
+    }
+    if (buffer->sample_data_count > 0) {
+      memset(buffer->sample_data_index, 0,
+             buffer->sample_data_index_size * sizeof(unsigned long int));
+      buffer->sample_data_count = 0;
+    }
+    __sync_bool_compare_and_swap(&(buffer->state), TBS_RETIRED, TBS_FREE);
+    SpinUnlock(&(buffer->lock));
+  }
+  this->downsampled = 0;
+}
+
+unsigned long int PerfData::GetCCTChild(unsigned long int parent,
+                                        type::addr_t addr, bool insert) {
+  unsigned long int mask = this->cct_node_index_size - 1;
+  unsigned long int slot = CCTNodeHash(parent, addr) & mask;
+  while (this->cct_node_index[slot] != 0) {
+    CCTN *node = &(this->cct_nodes[this->cct_node_index[slot]]);
+    if (node->parent == parent && node->addr == addr) {
+      return this->cct_node_index[slot];
+    }
+    slot = (slot + 1) & mask;
+  }
+  if (!insert) {
+    return CCT_ROOT;
+  }
+
+  if (this->cct_node_count >= this->cct_node_space_size &&
+      (!this->read_only || !this->ExpandCCTMem())) {
+    return CCT_ROOT;
+  }
+  // Keep the load factor of the index <= 0.5
+  if (2 * this->cct_node_count > this->cct_node_index_size) {
+    if (!this->ExpandCCTIndex()) {
+      return CCT_ROOT;
+    }
+    return this->GetCCTChild(parent, addr, insert);
+  }
+
+  unsigned long int x = this->cct_node_count;
+  this->cct_nodes[x].addr = addr;
+  this->cct_nodes[x].parent = parent;
+  this->cct_nodes[x].depth = this->cct_nodes[parent].depth + 1;
+  this->cct_node_index[slot] = x;
+  // Publish the node after it is filled, for the writer thread
+  __sync_synchronize();
+  this->cct_node_count = x + 1;
+  return x;
+}
+
+bool PerfData::ExpandCCTIndex() {
+  // MapMem instead of malloc, as it may be called in a signal handler
+  unsigned long int index_size = 2 * this->cct_node_index_size;
+  void *mem = MapMem(index_size * sizeof(unsigned long int));
+  if (mem == nullptr) {
+    // The call path is truncated by the caller and reported by Dump
+    return false;
+  }
+  unsigned long int *index = (unsigned long int *)mem;
+  unsigned long int mask = index_size - 1;
+  for (unsigned long int i = 1; i < this->cct_node_count; i++) {
+    unsigned long int slot =
+        CCTNodeHash(this->cct_nodes[i].parent, this->cct_nodes[i].addr) & mask;
+    while (index[slot] != 0) {
+      slot = (slot + 1) & mask;
+    }
+    index[slot] = i;
+  }
+  UnmapMem(this->cct_node_index,
+           this->cct_node_index_size * sizeof(unsigned long int));
+  this->cct_node_index = index;
+  this->cct_node_index_size = index_size;
+  return true;
+}
+
+bool PerfData::ExpandCCTMem() {
+  size_t old_size = this->cct_node_space_size * sizeof(CCTN);
+  CCTN *nodes = (CCTN *)RemapMem(this->cct_nodes, old_size, 2 * old_size);
+  if (nodes == nullptr) {
+    return false;
+  }
+  this->cct_nodes = nodes;
+  this->cct_node_space_size *= 2;
+  return true;
+}
+
+unsigned long int PerfData::InsertCCTPath(type::addr_t *call_path,
+                                          int call_path_len) {
+  // Insert from the outermost frame, so that call paths share prefixes
+  unsigned long int node_id = CCT_ROOT;
+  for (int i = call_path_len - 1; i >= 0; i--) {
+    unsigned long int child_id = this->GetCCTChild(node_id, call_path[i], true);
+    if (child_id == CCT_ROOT) {
+      // Logging is not async-signal-safe, Dump reports the count
+      __sync_fetch_and_add(&(this->truncated_call_path_count), 1);
+      break;
+    }
+    node_id = child_id;
+  }
+  return node_id;
+}
+
+long int PerfData::FindCCTPath(type::addr_t *call_path, int call_path_len) {
+  unsigned long int node_id = CCT_ROOT;
+  for (int i = call_path_len - 1; i >= 0; i--) {
+    node_id = this->GetCCTChild(node_id, call_path[i], false);
+    if (node_id == CCT_ROOT) {
+      return -1;
+    }
+  }
+  return node_id;
+}
+
+bool PerfData::FlushSharedData(bool wait) {
+  ADS *async_dump = this->async_dump;
+  // File I/O is not async-signal-safe, and the writer thread may take long
+  if (!wait && (async_dump == nullptr || async_dump->pending)) {
+    return false;
+  }
+  if (async_dump == nullptr) {
+    this->DumpSharedData();
+    return true;
+  }
+  WaitAsyncDump(async_dump);
+
+  // Swap front and back buffers, the hash index stays with the front one
+  VDS *vertex_data = async_dump->vertex_data;
+  async_dump->vertex_data = this->vertex_perf_data;
+  async_dump->vertex_data_count = this->vertex_perf_data_count;
+  this->vertex_perf_data = vertex_data;
+  this->vertex_perf_data_count = 0;
+  memset(this->vertex_perf_data_index, 0,
+         this->vertex_perf_data_index_size * sizeof(unsigned long int));
+
+  EDS *edge_data = async_dump->edge_data;
+  async_dump->edge_data = this->edge_perf_data;
+  async_dump->edge_data_count = this->edge_perf_data_count;
+  this->edge_perf_data = edge_data;
+  this->edge_perf_data_count = 0;
+  memset(this->edge_perf_data_index, 0,
+         this->edge_perf_data_index_size * sizeof(unsigned long int));
+
+  async_dump->cct_node_count = this->cct_node_count;
+  async_dump->dropped_sample_count = this->dropped_sample_count;
+  async_dump->swap_count++;
+  __sync_lock_test_and_set(&(async_dump->pending), 1);
+  sem_post(&(async_dump->sem));
+  return true;
 }
 
 // Sequential read
@@ -90,194 +901,791 @@ void PerfData::Read(const char *infile_name) {
 
   // dbg(infile_name);
 
-  this->perf_data_in_file.open(std::string(infile_name), std::ios::in);
-  if (!(this->perf_data_in_file.is_open())) {
+  // Peek the magic to tell a binary file from a text one
+  FILE *fp = fopen(infile_name, "rb");
+  if (!fp) {
     LOG_INFO("Failed to open %s\n", infile_name);
     this->vertex_perf_data_count =
         __sync_and_and_fetch(&this->vertex_perf_data_count, 0);
+    this->RebuildVertexDataIndex();
     return;
   }
+  char magic[PERF_DATA_MAGIC_LEN] = {0};
+  size_t magic_len = fread(magic, 1, PERF_DATA_MAGIC_LEN, fp);
+  fclose(fp);
+
+  if (magic_len == PERF_DATA_MAGIC_LEN &&
+      memcmp(magic, PERF_DATA_MAGIC, PERF_DATA_MAGIC_LEN) == 0) {
+    if (!this->ReadBinary(infile_name)) {
+      LOG_ERROR("Failed to read %s, %s\n", infile_name,
+                "not a valid binary performance data file");
+    }
+  } else {
+    this->ReadText(infile_name);
+  }
+}
 
-  // char line[MAX_LINE_LEN];
-  std::string line;
-  // Read a line for VDS counts
-  // this->perf_data_in_file.getline(line, MAX_CALL_PATH_LEN);
-  getline(this->perf_data_in_file, line);
-  unsigned long int count = strtoul(line.c_str(), 0, 10);
-  // dbg(count);
-
-  if (this->vertex_perf_data_count + count >
-      this->vertex_perf_data_space_size) {
+void *PerfData::ReadShardThread(void *arg) {
+  RSS *shard = (RSS *)arg;
+  for (unsigned long int i = shard->begin; i < shard->end; i++) {
+    const char *file_name = (*shard->file_names)[i].c_str();
+    // Read drops records read so far on a missing file, skip it instead
+    if (access(file_name, R_OK) != 0) {
+      LOG_INFO("Failed to open %s\n", file_name);
+      continue;
+    }
+    shard->perf_data->Read(file_name);
+  }
+  return nullptr;
+}
+
+void PerfData::ReadAll(const std::vector<std::string> &file_names,
+                       int num_threads) {
+  if (num_threads <= 0) {
+    num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  unsigned long int num_files = file_names.size();
+  unsigned long int num_shards =
+      std::min((unsigned long int)std::max(num_threads, 1), num_files);
+  if (num_shards <= 1) {
+    RSS shard;
+    shard.perf_data = this;
+    shard.file_names = &file_names;
+    shard.end = num_files;
+    PerfData::ReadShardThread(&shard);
+    return;
+  }
+
+  // The first shard is read into this PerfData by the calling thread
+  std::vector<RSS> shards(num_shards);
+  for (unsigned long int i = 0; i < num_shards; i++) {
+    shards[i].perf_data = i == 0 ? this : new PerfData(true);
+    shards[i].file_names = &file_names;
+    shards[i].begin = num_files * i / num_shards;
+    shards[i].end = num_files * (i + 1) / num_shards;
+  }
+  std::vector<bool> started(num_shards, false);
+  for (unsigned long int i = 1; i < num_shards; i++) {
+    started[i] = pthread_create(&(shards[i].thread), nullptr,
+                                PerfData::ReadShardThread, &shards[i]) == 0;
+  }
+  PerfData::ReadShardThread(&shards[0]);
+
+  for (unsigned long int i = 1; i < num_shards; i++) {
+    if (started[i]) {
+      pthread_join(shards[i].thread, nullptr);
+    } else {
+      // Read the shard here if its thread fails to start
+      PerfData::ReadShardThread(&shards[i]);
+    }
+    this->Append(shards[i].perf_data);
+    delete shards[i].perf_data;
+  }
+}
+
+/** Add values of metrics to metric indices given by metric_map */
+static void RemapValues(perf_data_t *value, const perf_data_t *other_value,
+                        std::vector<int> &metric_map) {
+  memset(value, 0, MAX_NUM_METRICS * sizeof(perf_data_t));
+  for (size_t m = 0; m < metric_map.size(); m++) {
+    if (metric_map[m] >= 0) {
+      value[metric_map[m]] += other_value[m];
+    }
+  }
+}
+
+void PerfData::Append(PerfData *perf_data) {
+  std::vector<std::string> metric_names;
+  if (perf_data->has_metric_names) {
+    metric_names = perf_data->metric_names;
+  }
+  std::vector<int> metric_map;
+  this->MapMetrics(metric_names, perf_data->metric_names.size(), metric_map);
+  if (this->sample_period == 0) {
+    this->sample_period = perf_data->sample_period;
+    this->sample_event_rate = perf_data->sample_event_rate;
+  }
+
+  // A node always follows its parent, so that it is remapped after its parent
+  std::vector<unsigned long int> cct_node_map(perf_data->cct_node_count,
+                                              CCT_ROOT);
+  for (unsigned long int i = 1; i < perf_data->cct_node_count; i++) {
+    CCTN *node = &(perf_data->cct_nodes[i]);
+    cct_node_map[i] =
+        this->GetCCTChild(cct_node_map[node->parent], node->addr, true);
+  }
+
+  while (this->vertex_perf_data_count + perf_data->vertex_perf_data_count >
+         this->vertex_perf_data_space_size) {
     this->ExpandVertexDataMem();
   }
+  for (unsigned long int i = 0; i < perf_data->vertex_perf_data_count; i++) {
+    unsigned long int x = this->vertex_perf_data_count++;
+    this->vertex_perf_data[x] = perf_data->vertex_perf_data[i];
+    this->vertex_perf_data[x].cct_node_id =
+        cct_node_map[perf_data->vertex_perf_data[i].cct_node_id];
+    RemapValues(this->vertex_perf_data[x].value,
+                perf_data->vertex_perf_data[i].value, metric_map);
+    IndexVertexData(this->vertex_perf_data_index,
+                    this->vertex_perf_data_index_size, this->vertex_perf_data,
+                    x);
+  }
 
-  // Read lines, each line is a VDS
-  while (count-- && getline(this->perf_data_in_file, line)) {
-    // Read a line
-    // this->perf_data_in_file.getline(line, MAX_CALL_PATH_LEN);
-
-    // Parse the line
-    // First '|'
-    // std::vector<std::string> line_vec = split(line, "|");
-    std::vector<std::string> line_vec;
-    split(line, "|", line_vec);
-    int cnt = line_vec.size();
-
-    int procs_id = atoi(line_vec[2].c_str());
-
-    // dbg(cnt);
-
-    if (cnt == 4 && procs_id >= 0) {
-      unsigned long int x =
-          __sync_fetch_and_add(&this->vertex_perf_data_count, 1);
-
-      // dbg(count, line_vec[0],line_vec[1].c_str(), x, MAX_TRACE_MEM /
-      // sizeof(VDS));
-      this->vertex_perf_data[x].value = atof(line_vec[1].c_str());
-      this->vertex_perf_data[x].procs_id = atoi(line_vec[2].c_str());
-      this->vertex_perf_data[x].thread_id = atoi(line_vec[3].c_str());
-
-      // Then parse call path
-      std::vector<std::string> addr_vec;
-      split(line_vec[0], " ", addr_vec);
-      int call_path_len = addr_vec.size();
-      this->vertex_perf_data[x].call_path_len = call_path_len;
-      for (int i = 0; i < call_path_len; i++) {
-        this->vertex_perf_data[x].call_path[i] =
-            strtoul(addr_vec[i].c_str(), 0, 16);
-        // dbg(this->vertex_perf_data[x].call_path[i]);
+  while (this->edge_perf_data_count + perf_data->edge_perf_data_count >
+         this->edge_perf_data_space_size) {
+    this->ExpandEdgeDataMem();
+  }
+  for (unsigned long int i = 0; i < perf_data->edge_perf_data_count; i++) {
+    unsigned long int x = this->edge_perf_data_count++;
+    this->edge_perf_data[x] = perf_data->edge_perf_data[i];
+    this->edge_perf_data[x].cct_node_id =
+        cct_node_map[perf_data->edge_perf_data[i].cct_node_id];
+    this->edge_perf_data[x].out_cct_node_id =
+        cct_node_map[perf_data->edge_perf_data[i].out_cct_node_id];
+    RemapValues(this->edge_perf_data[x].value,
+                perf_data->edge_perf_data[i].value, metric_map);
+    IndexEdgeData(this->edge_perf_data_index, this->edge_perf_data_index_size,
+                  this->edge_perf_data, x);
+  }
+
+  this->dropped_sample_count += perf_data->dropped_sample_count;
+}
+
+/** Split a line into fields by '|' in place, empty fields are skipped
+ * @return number of fields, of which at most max_fields are stored
+ */
+static int SplitFields(std::string_view line, std::string_view *fields,
+                       int max_fields) {
+  Tokenizer tokenizer(line, "|");
+  std::string_view field;
+  int cnt = 0;
+  while (tokenizer.Next(field)) {
+    if (cnt < max_fields) {
+      fields[cnt] = field;
+    }
+    cnt++;
+  }
+  return cnt;
+}
+
+/** Parse a text call path of hex addresses from the innermost frame */
+static void ParseCallPath(std::string_view str,
+                          std::vector<type::addr_t> &call_path) {
+  call_path.clear();
+  Tokenizer tokenizer(str, " ");
+  std::string_view token;
+  while (tokenizer.Next(token)) {
+    type::addr_t addr = 0;
+    ParseToken(token, addr, 16);
+    call_path.push_back(addr);
+  }
+}
+
+/** Parse values of metrics separated by spaces, which are mapped to metric
+ * indices by metric_map */
+static void ParseValues(std::string_view str, std::vector<int> &metric_map,
+                        perf_data_t *value) {
+  memset(value, 0, MAX_NUM_METRICS * sizeof(perf_data_t));
+  Tokenizer tokenizer(str, " ");
+  std::string_view token;
+  for (size_t m = 0; m < metric_map.size() && tokenizer.Next(token); m++) {
+    perf_data_t metric_value = 0;
+    if (metric_map[m] >= 0 && ParseToken(token, metric_value)) {
+      value[metric_map[m]] += metric_value;
+    }
+  }
+}
+
+void PerfData::ReadText(const char *infile_name) {
+  this->perf_data_in_file.open(std::string(infile_name), std::ios::in);
+  if (!(this->perf_data_in_file.is_open())) {
+    LOG_INFO("Failed to open %s\n", infile_name);
+    return;
+  }
+
+  // Lines are parsed in place, buffers are reused so that no line allocates
+  std::string line;
+  std::string_view fields[7];
+  std::vector<type::addr_t> call_path;
+  std::vector<std::string> metric_names;
+  std::vector<int> metric_map;
+  // A file holds one (VDS, EDS) section per dump of a full buffer
+  while (getline(this->perf_data_in_file, line)) {
+    // Read a line for VDS counts, amount of dropped samples and metric names
+    // may follow, missing in old files
+    Tokenizer count_tokenizer(line, " ");
+    std::string_view token;
+    unsigned long int count = 0;
+    unsigned long int dropped = 0;
+    if (count_tokenizer.Next(token)) {
+      ParseToken(token, count);
+    }
+    if (count_tokenizer.Next(token) && ParseToken(token, dropped)) {
+      this->dropped_sample_count += dropped;
+    }
+    metric_names.clear();
+    while (count_tokenizer.Next(token)) {
+      size_t eq = token.find('=');
+      if (eq == std::string_view::npos) {
+        metric_names.push_back(std::string(token));
+        continue;
+      }
+      std::string_view key = token.substr(0, eq);
+      perf_data_t value = 0;
+      if (ParseToken(token.substr(eq + 1), value) && value > 0) {
+        if (key == "sample_period") {
+          this->sample_period = value;
+        } else if (key == "sample_event_rate") {
+          this->sample_event_rate = value;
+        }
       }
+    }
+    this->MapMetrics(metric_names, std::max((int)metric_names.size(), 1),
+                     metric_map);
 
-      // LOG_INFO("DATA[%lu]: %s | %lf | %d |%d\n", x, line_vec[0].c_str(),
-      // this->vertex_perf_data[x].value,
-      //         this->vertex_perf_data[x].procs_id,
-      //         this->vertex_perf_data[x].thread_id);
+    while (this->vertex_perf_data_count + count >
+           this->vertex_perf_data_space_size) {
+      this->ExpandVertexDataMem();
+    }
+    unsigned long int first_read_index = this->vertex_perf_data_count;
+
+    // Read lines, each line is a VDS
+    while (count-- && getline(this->perf_data_in_file, line)) {
+      // call path | values | procs_id | thread_id
+      int cnt = SplitFields(line, fields, 4);
+      int procs_id = -1;
+      if (cnt == 4) {
+        ParseToken(fields[2], procs_id);
+      }
 
-      FREE_CONTAINER(addr_vec);
-    } else {
-      // dbg(cnt, line);
+      if (cnt == 4 && procs_id >= 0) {
+        unsigned long int x =
+            __sync_fetch_and_add(&this->vertex_perf_data_count, 1);
+
+        VDS *data = &(this->vertex_perf_data[x]);
+        ParseValues(fields[1], metric_map, data->value);
+        data->procs_id = procs_id;
+        data->thread_id = 0;
+        ParseToken(fields[3], data->thread_id);
+
+        // Then parse call path
+        ParseCallPath(fields[0], call_path);
+        data->cct_node_id =
+            this->InsertCCTPath(call_path.data(), call_path.size());
+      } else {
+        // dbg(cnt, line);
+      }
+    }
+    for (unsigned long int i = first_read_index;
+         i < this->vertex_perf_data_count; i++) {
+      IndexVertexData(this->vertex_perf_data_index,
+                      this->vertex_perf_data_index_size,
+                      this->vertex_perf_data, i);
     }
 
-    FREE_CONTAINER(line_vec);
+    // Read a line for EDS counts
+    getline(this->perf_data_in_file, line);
+    count = 0;
+    ParseToken(line, count);
+
+    while (this->edge_perf_data_count + count >
+           this->edge_perf_data_space_size) {
+      this->ExpandEdgeDataMem();
+    }
+    first_read_index = this->edge_perf_data_count;
+
+    while (count-- && getline(this->perf_data_in_file, line)) {
+      // call path | out call path | values | procs_id | out_procs_id |
+      // thread_id | out_thread_id
+      int cnt = SplitFields(line, fields, 7);
+
+      if (cnt == 7) {
+        // First fetch as x, then add 1
+        unsigned long int x =
+            __sync_fetch_and_add(&this->edge_perf_data_count, 1);
+
+        EDS *data = &(this->edge_perf_data[x]);
+        data->procs_id = data->out_procs_id = 0;
+        data->thread_id = data->out_thread_id = 0;
+        ParseValues(fields[2], metric_map, data->value);
+        ParseToken(fields[3], data->procs_id);
+        ParseToken(fields[4], data->out_procs_id);
+        ParseToken(fields[5], data->thread_id);
+        ParseToken(fields[6], data->out_thread_id);
+
+        // Then parse call paths
+        ParseCallPath(fields[0], call_path);
+        data->cct_node_id =
+            this->InsertCCTPath(call_path.data(), call_path.size());
+        ParseCallPath(fields[1], call_path);
+        data->out_cct_node_id =
+            this->InsertCCTPath(call_path.data(), call_path.size());
+      } else {
+        dbg(cnt, line);
+      }
+    }
+    for (unsigned long int i = first_read_index; i < this->edge_perf_data_count;
+         i++) {
+      IndexEdgeData(this->edge_perf_data_index, this->edge_perf_data_index_size,
+                    this->edge_perf_data, i);
+    }
   }
 
-  // Read a line for EDS counts
-  // this->perf_data_in_file.getline(line, MAX_CALL_PATH_LEN);
-  getline(this->perf_data_in_file, line);
-  count = strtoul(line.c_str(), 0, 10);
-  // dbg(count);
+  this->perf_data_in_file.close();
+}
 
-  if (this->edge_perf_data_count + count > this->edge_perf_data_space_size) {
-    this->ExpandEdgeDataMem();
+bool PerfData::ReadBinary(const char *infile_name) {
+  FILE *fp = fopen(infile_name, "rb");
+  if (!fp) {
+    LOG_INFO("Failed to open %s\n", infile_name);
+    return false;
   }
+  fseek(fp, 0, SEEK_END);
+  long file_size = ftell(fp);
+  if (file_size <= 0) {
+    fclose(fp);
+    return false;
+  }
+  void *mem = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+  fclose(fp);
+  if (mem == MAP_FAILED) {
+    LOG_ERROR("Failed to map %s\n", infile_name);
+    return false;
+  }
+
+  // A file holds one section per dump of a full buffer
+  const char *file = (const char *)mem;
+  uint64_t offset = 0;
+  bool valid = true;
+  // CCT node id in the file -> CCT node id here
+  std::vector<unsigned long int> cct_node_map(1, CCT_ROOT);
+  while (offset < (uint64_t)file_size) {
+    uint64_t remain = file_size - offset;
+    const PDH *header = (const PDH *)(file + offset);
+    // A section truncated by a killed writer may not even hold the fields
+    // before num_dropped_samples
+    if (remain < PERF_DATA_MIN_HEADER_SIZE ||
+        memcmp(header->magic, PERF_DATA_MAGIC, PERF_DATA_MAGIC_LEN) != 0 ||
+        (header->version != PERF_DATA_VERSION && header->version != 2)) {
+      valid = false;
+      break;
+    }
+    // Version 2 has one unnamed metric, and its headers written before
+    // num_dropped_samples was added are shorter
+    bool has_metrics = header->version == PERF_DATA_VERSION;
+    if (header->header_size < (has_metrics ? PERF_DATA_V3_HEADER_SIZE
+                                           : PERF_DATA_MIN_HEADER_SIZE) ||
+        header->header_size % 8 != 0 ||
+        header->section_size < header->header_size ||
+        header->section_size > remain) {
+      valid = false;
+      break;
+    }
+
+    // Bound every count and product by the section size before computing
+    // column sizes, so that a corrupted header can not overflow them. The
+    // sum below is then at most 10 times the size of a mapped file.
+    uint64_t nv = header->num_vertex_data;
+    uint64_t ne = header->num_edge_data;
+    uint64_t nn = header->num_cct_nodes;
+    uint64_t nm = has_metrics ? header->num_metrics : 1;
+    uint64_t body_size = header->section_size - header->header_size;
+    uint64_t body_words = body_size / 8;
+    if (nv > body_words || ne > body_words || nn > body_words || nm == 0 ||
+        (has_metrics && nm > body_size / MAX_METRIC_NAME_LEN) ||
+        (nv + ne > 0 && nm > body_words / (nv + ne))) {
+      valid = false;
+      break;
+    }
+    uint64_t names_size = has_metrics ? nm * MAX_METRIC_NAME_LEN : 0;
+    if (names_size + (2 * nn + nv + 2 * ne + nm * (nv + ne)) * 8 +
+                (2 * nv + 4 * ne) * 4 >
+            body_size ||
+        header->first_cct_node != cct_node_map.size()) {
+      valid = false;
+      break;
+    }
+
+    // Present in all headers but the shortest ones
+    if (header->header_size > PERF_DATA_MIN_HEADER_SIZE) {
+      this->dropped_sample_count += header->num_dropped_samples;
+    }
+    if (header->header_size >= PERF_DATA_PERIOD_HEADER_SIZE &&
+        header->sample_period > 0) {
+      this->sample_period = header->sample_period;
+      this->sample_event_rate = header->sample_event_rate;
+    }
 
-  while (count-- && getline(this->perf_data_in_file, line)) {
-    // Read a line
-    // this->perf_data_in_file.getline(line, MAX_CALL_PATH_LEN);
-
-    // Parse the line
-    // First '|'
-    // char delim[] = "|";
-    // line_vec[4][MAX_CALL_PATH_LEN];
-    std::vector<std::string> line_vec;
-    split(line, "|", line_vec);
-    int cnt = line_vec.size();
-
-    // dbg(cnt);
-
-    if (cnt == 7) {
-      // First fetch as x, then add 1
-      unsigned long int x =
-          __sync_fetch_and_add(&this->edge_perf_data_count, 1);
-
-      this->edge_perf_data[x].value = atof(line_vec[2].c_str());
-      this->edge_perf_data[x].procs_id = atoi(line_vec[3].c_str());
-      this->edge_perf_data[x].out_procs_id = atoi(line_vec[4].c_str());
-      this->edge_perf_data[x].thread_id = atoi(line_vec[5].c_str());
-      this->edge_perf_data[x].out_thread_id = atoi(line_vec[6].c_str());
-
-      // Then parse call path
-      std::vector<std::string> addr_vec;
-      split(line_vec[0], " ", addr_vec);
-      int call_path_len = addr_vec.size();
-      this->edge_perf_data[x].call_path_len = call_path_len;
-      for (int i = 0; i < call_path_len; i++) {
-        this->edge_perf_data[x].call_path[i] =
-            strtoul(addr_vec[i].c_str(), 0, 16);
+    // Metrics of the file -> metrics here
+    const char *body = file + offset + header->header_size;
+    std::vector<std::string> metric_names;
+    for (uint64_t m = 0; has_metrics && m < nm; m++) {
+      const char *name = body + m * MAX_METRIC_NAME_LEN;
+      metric_names.push_back(
+          std::string(name, strnlen(name, MAX_METRIC_NAME_LEN)));
+    }
+    std::vector<int> metric_map;
+    this->MapMetrics(metric_names, nm, metric_map);
+
+    // Columns
+    const uint64_t *node_parents = (const uint64_t *)(body + names_size);
+    const type::addr_t *node_addrs = (const type::addr_t *)(node_parents + nn);
+    const uint64_t *v_node_ids = (const uint64_t *)(node_addrs + nn);
+    const perf_data_t *v_values = (const perf_data_t *)(v_node_ids + nv);
+    const uint64_t *e_src_node_ids = (const uint64_t *)(v_values + nm * nv);
+    const uint64_t *e_dest_node_ids = e_src_node_ids + ne;
+    const perf_data_t *e_values = (const perf_data_t *)(e_dest_node_ids + ne);
+    const int32_t *v_procs_ids = (const int32_t *)(e_values + nm * ne);
+    const int32_t *v_thread_ids = v_procs_ids + nv;
+    const int32_t *e_procs_ids = v_thread_ids + nv;
+    const int32_t *e_out_procs_ids = e_procs_ids + ne;
+    const int32_t *e_thread_ids = e_out_procs_ids + ne;
+    const int32_t *e_out_thread_ids = e_thread_ids + ne;
+
+    // CCT nodes of the file are merged into this CCT, a node always follows
+    // its parent
+    for (uint64_t i = 0; i < nn; i++) {
+      if (node_parents[i] >= cct_node_map.size()) {
+        valid = false;
+        break;
       }
-      FREE_CONTAINER(addr_vec);
-
-      split(line_vec[1], " ", addr_vec);
-      int out_call_path_len = addr_vec.size();
-      this->edge_perf_data[x].out_call_path_len = out_call_path_len;
-      for (int i = 0; i < out_call_path_len; i++) {
-        this->edge_perf_data[x].out_call_path[i] =
-            strtoul(addr_vec[i].c_str(), 0, 16);
+      cct_node_map.push_back(this->GetCCTChild(cct_node_map[node_parents[i]],
+                                               node_addrs[i], true));
+    }
+    for (uint64_t i = 0; valid && i < nv; i++) {
+      valid = v_node_ids[i] < cct_node_map.size();
+    }
+    for (uint64_t i = 0; valid && i < ne; i++) {
+      valid = e_src_node_ids[i] < cct_node_map.size() &&
+              e_dest_node_ids[i] < cct_node_map.size();
+    }
+    if (!valid) {
+      break;
+    }
+
+    // VDS
+    while (this->vertex_perf_data_count + nv >
+           this->vertex_perf_data_space_size) {
+      this->ExpandVertexDataMem();
+    }
+    for (uint64_t i = 0; i < nv; i++) {
+      unsigned long int x = this->vertex_perf_data_count++;
+      VDS *data = &(this->vertex_perf_data[x]);
+      data->cct_node_id = cct_node_map[v_node_ids[i]];
+      memset(data->value, 0, sizeof(data->value));
+      for (uint64_t m = 0; m < nm; m++) {
+        if (metric_map[m] >= 0) {
+          data->value[metric_map[m]] += v_values[m * nv + i];
+        }
       }
-      FREE_CONTAINER(addr_vec);
+      data->procs_id = v_procs_ids[i];
+      data->thread_id = v_thread_ids[i];
+      IndexVertexData(this->vertex_perf_data_index,
+                      this->vertex_perf_data_index_size,
+                      this->vertex_perf_data, x);
+    }
 
-      // LOG_INFO("DATA[%lu]: %s | %lf | %d |%d\n", x, line_vec[0].c_str(),
-      //          this->edge_perf_data[x].value,
-      //          this->edge_perf_data[x].procs_id,
-      //          this->edge_perf_data[x].thread_id);
-    } else {
-      dbg(cnt, line);
+    // EDS
+    while (this->edge_perf_data_count + ne > this->edge_perf_data_space_size) {
+      this->ExpandEdgeDataMem();
+    }
+    for (uint64_t i = 0; i < ne; i++) {
+      unsigned long int x = this->edge_perf_data_count++;
+      EDS *data = &(this->edge_perf_data[x]);
+      data->cct_node_id = cct_node_map[e_src_node_ids[i]];
+      data->out_cct_node_id = cct_node_map[e_dest_node_ids[i]];
+      memset(data->value, 0, sizeof(data->value));
+      for (uint64_t m = 0; m < nm; m++) {
+        if (metric_map[m] >= 0) {
+          data->value[metric_map[m]] += e_values[m * ne + i];
+        }
+      }
+      data->procs_id = e_procs_ids[i];
+      data->out_procs_id = e_out_procs_ids[i];
+      data->thread_id = e_thread_ids[i];
+      data->out_thread_id = e_out_thread_ids[i];
+      IndexEdgeData(this->edge_perf_data_index, this->edge_perf_data_index_size,
+                    this->edge_perf_data, x);
     }
+
+    offset += header->section_size;
   }
 
-  this->perf_data_in_file.close();
+  munmap(mem, file_size);
+  FREE_CONTAINER(cct_node_map);
+  return valid;
 }
 
 void PerfData::Dump(const char *output_file_name) {
-  if (output_file_name != nullptr) {
+  SpinLock(&(this->shared_data_lock));
+  // Let the writer thread finish the back buffer with the current file
+  if (this->async_dump != nullptr) {
+    WaitAsyncDump(this->async_dump);
+  }
+  if (output_file_name != nullptr &&
+      strcmp(this->file_name, output_file_name) != 0) {
+    if (this->has_open_output_file) {
+      fclose(this->perf_data_fp);
+      this->has_open_output_file = false;
+    }
     strcpy(this->file_name, output_file_name);
   }
+  this->MergeThreadBuffers(true);
+  // The merge may have handed a buffer to the writer thread, which must be
+  // written before the front one to keep the sections in order
+  if (this->async_dump != nullptr) {
+    WaitAsyncDump(this->async_dump);
+  }
+  this->DumpSharedData();
+  unsigned long int truncated_call_path_count =
+      this->truncated_call_path_count;
+  if (truncated_call_path_count > this->reported_truncated_call_path_count) {
+    LOG_ERROR("CCT is full, %lu call paths are truncated\n",
+              truncated_call_path_count -
+                  this->reported_truncated_call_path_count);
+    this->reported_truncated_call_path_count = truncated_call_path_count;
+  }
+  SpinUnlock(&(this->shared_data_lock));
+}
+
+void PerfData::DumpSharedData() {
+  if (this->OpenOutputFile()) {
+    unsigned long int byte_count = this->DumpSection(
+        this->vertex_perf_data, this->vertex_perf_data_count,
+        this->edge_perf_data, this->edge_perf_data_count,
+        this->cct_node_count, this->dropped_sample_count);
+    if (this->async_dump != nullptr) {
+      this->async_dump->byte_count += byte_count;
+    }
+  }
+
+  this->vertex_perf_data_count =
+      __sync_and_and_fetch(&this->vertex_perf_data_count, 0);
+  memset(this->vertex_perf_data_index, 0,
+         this->vertex_perf_data_index_size * sizeof(unsigned long int));
+  this->edge_perf_data_count =
+      __sync_and_and_fetch(&this->edge_perf_data_count, 0);
+  memset(this->edge_perf_data_index, 0,
+         this->edge_perf_data_index_size * sizeof(unsigned long int));
+}
+
+bool PerfData::OpenOutputFile() {
   if (!has_open_output_file) {
-    this->perf_data_fp = fopen(this->file_name, "w");
+    const char *mode = this->dump_format == type::PERF_DATA_TEXT ? "w" : "wb";
+    this->perf_data_fp = fopen(this->file_name, mode);
     if (!this->perf_data_fp) {
       LOG_INFO("Failed to open %s\n", this->file_name);
-      this->vertex_perf_data_count =
-          __sync_and_and_fetch(&this->vertex_perf_data_count, 0);
-      return;
+      return false;
     }
+    // Keep the file open, so that dumps of a full buffer are not overwritten
+    this->has_open_output_file = true;
+    // A new file carries all CCT nodes again, except the root
+    this->cct_dumped_node_count = 1;
+  }
+  return true;
+}
+
+unsigned long int
+PerfData::DumpSection(VDS *vertex_data, unsigned long int vertex_data_count,
+                      EDS *edge_data, unsigned long int edge_data_count,
+                      unsigned long int cct_node_count,
+                      unsigned long int dropped_sample_count) {
+  unsigned long long dump_start = GetSelfStatTime();
+  this->UpdatePeakMem();
+  long begin = ftell(this->perf_data_fp);
+  // Samples dropped since the last section
+  unsigned long int dropped =
+      dropped_sample_count - this->dumped_dropped_sample_count;
+  if (this->dump_format == type::PERF_DATA_TEXT) {
+    this->DumpTextSection(vertex_data, vertex_data_count, edge_data,
+                          edge_data_count, dropped);
+  } else {
+    this->DumpBinarySection(vertex_data, vertex_data_count, edge_data,
+                            edge_data_count, cct_node_count, dropped);
+  }
+  this->cct_dumped_node_count = cct_node_count;
+  this->dumped_dropped_sample_count = dropped_sample_count;
+  long end = ftell(this->perf_data_fp);
+  unsigned long int byte_count =
+      (begin >= 0 && end >= begin) ? end - begin : 0;
+  AddSelfStat(STAT_DUMP_TIME, GetSelfStatTime() - dump_start);
+  AddSelfStat(STAT_BYTES_WRITTEN, byte_count);
+  return byte_count;
+}
+
+void PerfData::UpdatePeakMem() {
+  // Only touched pages of mapped records take memory. The back buffers of
+  // async dump are filled as much as the front ones.
+  int num_copies = this->async_dump != nullptr ? 2 : 1;
+  size_t mem_size =
+      this->sample_arena->used_size +
+      num_copies * (this->vertex_perf_data_count * sizeof(VDS) +
+                    this->edge_perf_data_count * sizeof(EDS)) +
+      (this->vertex_perf_data_index_size + this->edge_perf_data_index_size +
+       this->cct_node_index_size) *
+          sizeof(unsigned long int) +
+      this->cct_node_count * sizeof(CCTN);
+  AddSelfStat(STAT_PEAK_MEM, mem_size);
+}
+
+/** Print a call path from the innermost frame by walking up the CCT */
+static void PrintCCTPath(FILE *fp, CCTN *cct_nodes,
+                         unsigned long int cct_node_id) {
+  while (cct_node_id != CCT_ROOT) {
+    fprintf(fp, "%llx ", cct_nodes[cct_node_id].addr);
+    cct_node_id = cct_nodes[cct_node_id].parent;
   }
+}
+
+/** Print values of metrics separated by spaces */
+static void PrintValues(FILE *fp, perf_data_t *value, int num_metrics) {
+  for (int i = 0; i < num_metrics; i++) {
+    fprintf(fp, " %lf", value[i]);
+  }
+}
 
+void PerfData::DumpTextSection(VDS *vertex_data,
+                               unsigned long int vertex_data_count,
+                               EDS *edge_data,
+                               unsigned long int edge_data_count,
+                               unsigned long int dropped_sample_count) {
   // LOG_INFO("Rank %d : WRITE %d ADDR to %d TXT\n", mpiRank,
   // call_path_addr_log_pointer[i], i);
-  fprintf(this->perf_data_fp, "%lu\n", this->vertex_perf_data_count);
-  for (unsigned long int i = 0; i < this->vertex_perf_data_count; i++) {
-    for (int j = 0; j < this->vertex_perf_data[i].call_path_len; j++) {
-      fprintf(this->perf_data_fp, "%llx ",
-              this->vertex_perf_data[i].call_path[j]);
-    }
-    fprintf(this->perf_data_fp, " | %lf | %d | %d\n",
-            this->vertex_perf_data[i].value, this->vertex_perf_data[i].procs_id,
-            this->vertex_perf_data[i].thread_id);
-    fflush(this->perf_data_fp);
+  // Dropped samples and metric names follow the count, so that old readers
+  // skip them
+  fprintf(this->perf_data_fp, "%lu %lu", vertex_data_count,
+          dropped_sample_count);
+  for (auto &metric_name : this->metric_names) {
+    fprintf(this->perf_data_fp, " %s", metric_name.c_str());
+  }
+  // Then the sampling period as key=value, told apart from metric names by '='
+  if (this->sample_period > 0) {
+    fprintf(this->perf_data_fp, " sample_period=%lf sample_event_rate=%lf",
+            this->sample_period, this->sample_event_rate);
+  }
+  fprintf(this->perf_data_fp, "\n");
+  // Values of all metrics share a field, old readers only read the first one
+  int num_metrics = this->metric_names.size();
+  for (unsigned long int i = 0; i < vertex_data_count; i++) {
+    PrintCCTPath(this->perf_data_fp, this->cct_nodes,
+                 vertex_data[i].cct_node_id);
+    fprintf(this->perf_data_fp, " |");
+    PrintValues(this->perf_data_fp, vertex_data[i].value, num_metrics);
+    fprintf(this->perf_data_fp, " | %d | %d\n", vertex_data[i].procs_id,
+            vertex_data[i].thread_id);
   }
-  this->vertex_perf_data_count =
-      __sync_and_and_fetch(&this->vertex_perf_data_count, 0);
 
-  fprintf(this->perf_data_fp, "%lu\n", this->edge_perf_data_count);
-  for (unsigned long int i = 0; i < this->edge_perf_data_count; i++) {
-    for (int j = 0; j < this->edge_perf_data[i].call_path_len; j++) {
-      fprintf(this->perf_data_fp, "%llx ",
-              this->edge_perf_data[i].call_path[j]);
-    }
+  fprintf(this->perf_data_fp, "%lu\n", edge_data_count);
+  for (unsigned long int i = 0; i < edge_data_count; i++) {
+    PrintCCTPath(this->perf_data_fp, this->cct_nodes, edge_data[i].cct_node_id);
     fprintf(this->perf_data_fp, " | ");
-    for (int j = 0; j < this->edge_perf_data[i].out_call_path_len; j++) {
-      fprintf(this->perf_data_fp, "%llx ",
-              this->edge_perf_data[i].out_call_path[j]);
+    PrintCCTPath(this->perf_data_fp, this->cct_nodes,
+                 edge_data[i].out_cct_node_id);
+    fprintf(this->perf_data_fp, " |");
+    PrintValues(this->perf_data_fp, edge_data[i].value, num_metrics);
+    fprintf(this->perf_data_fp, " | %d | %d | %d | %d\n",
+            edge_data[i].procs_id, edge_data[i].out_procs_id,
+            edge_data[i].thread_id, edge_data[i].out_thread_id);
+  }
+  fflush(this->perf_data_fp);
+}
+
+void PerfData::DumpBinarySection(VDS *vertex_data,
+                                 unsigned long int vertex_data_count,
+                                 EDS *edge_data,
+                                 unsigned long int edge_data_count,
+                                 unsigned long int cct_node_count,
+                                 unsigned long int dropped_sample_count) {
+  uint64_t nv = vertex_data_count;
+  uint64_t ne = edge_data_count;
+  // CCT nodes created since the last section of this file
+  uint64_t first_node = this->cct_dumped_node_count;
+  uint64_t nn = cct_node_count - first_node;
+  uint64_t nm = this->metric_names.size();
+
+  PDH header;
+  memcpy(header.magic, PERF_DATA_MAGIC, PERF_DATA_MAGIC_LEN);
+  header.header_size = sizeof(PDH);
+  header.first_cct_node = first_node;
+  header.num_cct_nodes = nn;
+  header.num_vertex_data = nv;
+  header.num_edge_data = ne;
+  header.num_dropped_samples = dropped_sample_count;
+  header.num_metrics = nm;
+  header.sample_period = this->sample_period;
+  header.sample_event_rate = this->sample_event_rate;
+  header.section_size = sizeof(PDH) + nm * MAX_METRIC_NAME_LEN +
+                        (2 * nn + nv + 2 * ne + nm * (nv + ne)) * 8 +
+                        (2 * nv + 4 * ne) * 4;
+  header.section_size = (header.section_size + 7) / 8 * 8;
+
+  // Build the section in an anonymous mapping and write it at once. It may be
+  // called in a signal handler, where mmap is safe while malloc is not.
+  void *mem = MapMem(header.section_size);
+  if (mem == nullptr) {
+    LOG_ERROR("Failed to map %lu bytes, %s\n",
+              (unsigned long int)header.section_size, "data are lost");
+    return;
+  }
+  char *section = (char *)mem;
+  memcpy(section, &header, sizeof(PDH));
+
+  // Metric names, truncated and null-padded
+  char *metric_names = section + sizeof(PDH);
+  for (uint64_t m = 0; m < nm; m++) {
+    strncpy(metric_names + m * MAX_METRIC_NAME_LEN,
+            this->metric_names[m].c_str(), MAX_METRIC_NAME_LEN - 1);
+  }
+
+  // Columns
+  uint64_t *node_parents =
+      (uint64_t *)(metric_names + nm * MAX_METRIC_NAME_LEN);
+  type::addr_t *node_addrs = (type::addr_t *)(node_parents + nn);
+  uint64_t *v_node_ids = (uint64_t *)(node_addrs + nn);
+  perf_data_t *v_values = (perf_data_t *)(v_node_ids + nv);
+  uint64_t *e_src_node_ids = (uint64_t *)(v_values + nm * nv);
+  uint64_t *e_dest_node_ids = e_src_node_ids + ne;
+  perf_data_t *e_values = (perf_data_t *)(e_dest_node_ids + ne);
+  int32_t *v_procs_ids = (int32_t *)(e_values + nm * ne);
+  int32_t *v_thread_ids = v_procs_ids + nv;
+  int32_t *e_procs_ids = v_thread_ids + nv;
+  int32_t *e_out_procs_ids = e_procs_ids + ne;
+  int32_t *e_thread_ids = e_out_procs_ids + ne;
+  int32_t *e_out_thread_ids = e_thread_ids + ne;
+
+  for (uint64_t i = 0; i < nn; i++) {
+    CCTN *node = &(this->cct_nodes[first_node + i]);
+    node_parents[i] = node->parent;
+    node_addrs[i] = node->addr;
+  }
+  for (uint64_t i = 0; i < nv; i++) {
+    VDS *data = &(vertex_data[i]);
+    v_node_ids[i] = data->cct_node_id;
+    for (uint64_t m = 0; m < nm; m++) {
+      v_values[m * nv + i] = data->value[m];
     }
-    fprintf(this->perf_data_fp, " | %lf | %d | %d | %d | %d\n",
-            this->edge_perf_data[i].value, this->edge_perf_data[i].procs_id,
-            this->edge_perf_data[i].out_procs_id,
-            this->edge_perf_data[i].thread_id,
-            this->edge_perf_data[i].out_thread_id);
-    fflush(this->perf_data_fp);
+    v_procs_ids[i] = data->procs_id;
+    v_thread_ids[i] = data->thread_id;
   }
-  this->edge_perf_data_count =
-      __sync_and_and_fetch(&this->edge_perf_data_count, 0);
+  for (uint64_t i = 0; i < ne; i++) {
+    EDS *data = &(edge_data[i]);
+    e_src_node_ids[i] = data->cct_node_id;
+    e_dest_node_ids[i] = data->out_cct_node_id;
+    for (uint64_t m = 0; m < nm; m++) {
+      e_values[m * ne + i] = data->value[m];
+    }
+    e_procs_ids[i] = data->procs_id;
+    e_out_procs_ids[i] = data->out_procs_id;
+    e_thread_ids[i] = data->thread_id;
+    e_out_thread_ids[i] = data->out_thread_id;
+  }
+
+  if (fwrite(section, 1, header.section_size, this->perf_data_fp) !=
+      header.section_size) {
+    LOG_ERROR("Failed to write %s\n", this->file_name);
+  }
+  fflush(this->perf_data_fp);
+  UnmapMem(mem, header.section_size);
 }
 
 unsigned long int PerfData::GetVertexDataSize() {
@@ -288,37 +1696,110 @@ unsigned long int PerfData::GetEdgeDataSize() {
   return this->edge_perf_data_count;
 }
 
-std::string &PerfData::GetMetricName() { return this->metric_name; }
+void PerfData::SetDumpFormat(type::perf_data_format_t format) {
+  this->dump_format = format;
+}
+
+type::perf_data_format_t PerfData::GetDumpFormat() { return this->dump_format; }
+
+std::string &PerfData::GetMetricName() { return this->metric_names[0]; }
 
 void PerfData::SetMetricName(std::string &metric_name) {
-  this->metric_name = std::string(metric_name);
+  this->metric_names[0] = std::string(metric_name);
+  this->has_metric_names = true;
 }
 
-bool CallPathCmp(type::addr_t *cp_1, int cp_1_len, type::addr_t *cp_2,
-                 int cp_2_len) {
-  if (cp_1_len != cp_2_len) {
-    return false;
-  } else {
-    for (int i = 0; i < cp_1_len; i++) {
-      if (cp_1[i] != cp_2[i]) {
-        return false;
-      }
+void PerfData::SetMetricNames(std::vector<std::string> &metric_names) {
+  if (metric_names.empty() || metric_names.size() > MAX_NUM_METRICS) {
+    LOG_ERROR("Failed to set %lu metrics, at most %d are supported\n",
+              metric_names.size(), MAX_NUM_METRICS);
+    return;
+  }
+  this->metric_names = metric_names;
+  this->has_metric_names = true;
+}
+
+int PerfData::GetNumMetrics() { return this->metric_names.size(); }
+
+std::string &PerfData::GetMetricName(int metric_index) {
+  return this->metric_names[metric_index];
+}
+
+int PerfData::GetMetricIndex(std::string &metric_name) {
+  for (size_t i = 0; i < this->metric_names.size(); i++) {
+    if (this->metric_names[i] == metric_name) {
+      return i;
     }
   }
-  return true;
+  return -1;
+}
+
+void PerfData::SetSamplePeriod(perf_data_t sample_period,
+                               perf_data_t event_rate) {
+  this->sample_period = sample_period;
+  this->sample_event_rate = event_rate;
+}
+
+perf_data_t PerfData::GetSamplePeriod() { return this->sample_period; }
+
+perf_data_t PerfData::GetSampleEventRate() { return this->sample_event_rate; }
+
+perf_data_t PerfData::GetSampleTime() {
+  if (this->sample_period <= 0 || this->sample_event_rate <= 0) {
+    return 0;
+  }
+  return this->sample_period / this->sample_event_rate;
+}
+
+void PerfData::MapMetrics(std::vector<std::string> &metric_names,
+                          int num_metrics, std::vector<int> &metric_map) {
+  metric_map.assign(num_metrics, -1);
+  if (metric_names.empty()) {
+    for (int m = 0; m < num_metrics && m < this->GetNumMetrics(); m++) {
+      metric_map[m] = m;
+    }
+    return;
+  }
+
+  // Metrics follow the first file read, unless set
+  if (!this->has_metric_names && this->vertex_perf_data_count == 0 &&
+      this->edge_perf_data_count == 0) {
+    this->metric_names.clear();
+  }
+  this->has_metric_names = true;
+  for (int m = 0; m < num_metrics; m++) {
+    int metric_index = this->GetMetricIndex(metric_names[m]);
+    if (metric_index < 0 && this->metric_names.size() < MAX_NUM_METRICS) {
+      metric_index = this->metric_names.size();
+      this->metric_names.push_back(metric_names[m]);
+    }
+    if (metric_index < 0) {
+      LOG_ERROR("Failed to read metric %s, at most %d are supported\n",
+                metric_names[m].c_str(), MAX_NUM_METRICS);
+    }
+    metric_map[m] = metric_index;
+  }
 }
 
 int PerfData::QueryVertexData(type::addr_t *call_path, int call_path_len,
                               int procs_id, int thread_id) {
-  for (unsigned long int i = 0; i < this->vertex_perf_data_count; i++) {
-    // call_path
-    if (CallPathCmp(call_path, call_path_len,
-                    this->vertex_perf_data[i].call_path,
-                    this->vertex_perf_data[i].call_path_len) == true &&
+  long int cct_node_id = this->FindCCTPath(call_path, call_path_len);
+  if (cct_node_id < 0) {
+    return -1;
+  }
+
+  unsigned long int mask = this->vertex_perf_data_index_size - 1;
+  unsigned long int slot =
+      VertexDataHash(cct_node_id, procs_id, thread_id) & mask;
+  // Linear probing until an empty slot
+  while (this->vertex_perf_data_index[slot] != 0) {
+    unsigned long int i = this->vertex_perf_data_index[slot] - 1;
+    if (this->vertex_perf_data[i].cct_node_id == (unsigned long)cct_node_id &&
         this->vertex_perf_data[i].thread_id == thread_id &&
         this->vertex_perf_data[i].procs_id == procs_id) {
       return i;
     }
+    slot = (slot + 1) & mask;
   }
 
   return -1;
@@ -328,19 +1809,31 @@ int PerfData::QueryEdgeData(type::addr_t *call_path, int call_path_len,
                             type::addr_t *out_call_path, int out_call_path_len,
                             int procs_id, int out_procs_id, int thread_id,
                             int out_thread_id) {
-  for (unsigned long int i = 0; i < this->edge_perf_data_count; i++) {
-    // call_path
-    if (CallPathCmp(call_path, call_path_len, this->edge_perf_data[i].call_path,
-                    this->edge_perf_data[i].call_path_len) == true &&
-        CallPathCmp(out_call_path, out_call_path_len,
-                    this->edge_perf_data[i].out_call_path,
-                    this->edge_perf_data[i].out_call_path_len) == true &&
+  long int cct_node_id = this->FindCCTPath(call_path, call_path_len);
+  long int out_cct_node_id =
+      this->FindCCTPath(out_call_path, out_call_path_len);
+  if (cct_node_id < 0 || out_cct_node_id < 0) {
+    return -1;
+  }
+
+  unsigned long int mask = this->edge_perf_data_index_size - 1;
+  unsigned long int slot =
+      EdgeDataHash(cct_node_id, out_cct_node_id, procs_id, out_procs_id,
+                   thread_id, out_thread_id) &
+      mask;
+  // Linear probing until an empty slot
+  while (this->edge_perf_data_index[slot] != 0) {
+    unsigned long int i = this->edge_perf_data_index[slot] - 1;
+    if (this->edge_perf_data[i].cct_node_id == (unsigned long)cct_node_id &&
+        this->edge_perf_data[i].out_cct_node_id ==
+            (unsigned long)out_cct_node_id &&
         this->edge_perf_data[i].thread_id == thread_id &&
         this->edge_perf_data[i].procs_id == procs_id &&
         this->edge_perf_data[i].out_thread_id == out_thread_id &&
         this->edge_perf_data[i].out_procs_id == out_procs_id) {
       return i;
     }
+    slot = (slot + 1) & mask;
   }
 
   return -1;
@@ -348,31 +1841,112 @@ int PerfData::QueryEdgeData(type::addr_t *call_path, int call_path_len,
 
 // TODO: Modify current aggregation mode to non-aggregation mode, users can do
 // aggregation with our APIs
+bool PerfData::HandleOverflow(bool *flushed) {
+  if (this->overflow_policy == type::OVERFLOW_FLUSH && !*flushed &&
+      SpinTryLock(&(this->shared_data_lock))) {
+    // Merged buffers are freed for reuse, busy ones are left as is
+    this->MergeThreadBuffers(false);
+    SpinUnlock(&(this->shared_data_lock));
+    *flushed = true;
+    return true;
+  }
+  // Only a merge frees buffers, so halve the sampling rate once per merge
+  if (this->overflow_policy == type::OVERFLOW_DOWNSAMPLE &&
+      __sync_bool_compare_and_swap(&(this->downsampled), 0, 1)) {
+    int rate = this->downsample_rate;
+    if (rate < MAX_DOWNSAMPLE_RATE) {
+      __sync_bool_compare_and_swap(&(this->downsample_rate), rate, 2 * rate);
+    }
+  }
+  __sync_fetch_and_add(&(this->dropped_sample_count), 1);
+  AddSelfStat(STAT_DROPPED_SAMPLES, 1);
+  return false;
+}
+
 void PerfData::RecordVertexData(type::addr_t *call_path, int call_path_len,
                                 int procs_id, int thread_id,
                                 perf_data_t value) {
-  int index =
-      this->QueryVertexData(call_path, call_path_len, procs_id, thread_id);
+  this->RecordVertexData(call_path, call_path_len, procs_id, thread_id, 0,
+                         value);
+}
 
-  if (index >= 0) {
-    this->vertex_perf_data[index].value += value;
-  } else {
-    // Thread-safe, first fetch a index, then record data
-    unsigned long long int x =
-        __sync_fetch_and_add(&this->vertex_perf_data_count, 1);
+void PerfData::RecordVertexData(type::addr_t *call_path, int call_path_len,
+                                int procs_id, int thread_id, int metric_index,
+                                perf_data_t value) {
+  // Stay silent, logging is not async-signal-safe
+  if (metric_index < 0 || metric_index >= (int)this->metric_names.size()) {
+    return;
+  }
+  perf_data_t values[MAX_NUM_METRICS] = {0};
+  values[metric_index] = value;
+  this->RecordVertexData(call_path, call_path_len, procs_id, thread_id, values,
+                         metric_index + 1);
+}
 
-    this->vertex_perf_data[x].call_path_len = call_path_len;
-    for (int i = 0; i < call_path_len; i++) {
-      this->vertex_perf_data[x].call_path[i] = call_path[i];
+void PerfData::RecordVertexData(type::addr_t *call_path, int call_path_len,
+                                int procs_id, int thread_id,
+                                const perf_data_t *values, int num_values) {
+  if (num_values > (int)this->metric_names.size()) {
+    num_values = this->metric_names.size();
+  }
+  perf_data_t value[MAX_NUM_METRICS];
+  for (int i = 0; i < num_values; i++) {
+    value[i] = values[i];
+  }
+  // Keep one of every downsample_rate samples, weighted by the rate
+  int rate = this->downsample_rate;
+  if (rate > 1) {
+    if (++thread_skipped_sample_count < (unsigned long int)rate) {
+      return;
     }
-    this->vertex_perf_data[x].value = value;
-    this->vertex_perf_data[x].thread_id = thread_id;
-    this->vertex_perf_data[x].procs_id = procs_id;
+    thread_skipped_sample_count = 0;
+    for (int i = 0; i < num_values; i++) {
+      value[i] *= rate;
+    }
+  }
+  // Keep the innermost frames that fit in a sample
+  if (call_path_len > MAX_CALL_PATH_DEPTH) {
+    call_path_len = MAX_CALL_PATH_DEPTH;
   }
+  bool merged = false;
+  bool flushed = false;
+  while (true) {
+    TBS *buffer = this->GetThreadBuffer();
+    if (buffer == nullptr) {
+      // The memory cap is reached
+      if (this->HandleOverflow(&flushed)) {
+        continue;
+      }
+      return;
+    }
+
+    // Only Dump contends for this lock. Never wait for it, as Dump may be
+    // interrupted by this sample on the same thread.
+    if (SpinTryLock(&(buffer->lock))) {
+      unsigned long long lookup_start = GetSelfStatTime();
+      bool recorded = AggregateSampleData(
+          buffer->sample_data, &(buffer->sample_data_count),
+          buffer->sample_data_space_size, buffer->sample_data_index,
+          buffer->sample_data_index_size, call_path, call_path_len, procs_id,
+          thread_id, value, num_values);
+      SpinUnlock(&(buffer->lock));
+      AddSelfStat(STAT_LOOKUP_TIME, GetSelfStatTime() - lookup_start);
+      if (recorded) {
+        return;
+      }
+      // The buffer is full, merge it into shared records if no one else is
+      // touching them, and retry. The merge leaves the buffer as is if the
+      // shared records are full and cannot be flushed without waiting.
+      if (!merged && SpinTryLock(&(this->shared_data_lock))) {
+        this->MergeThreadBuffers(false);
+        SpinUnlock(&(this->shared_data_lock));
+        merged = true;
+        continue;
+      }
+    }
 
-  if (this->vertex_perf_data_count >= this->vertex_perf_data_space_size - 5) {
-    // TODO: asynchronous dump
-    this->Dump(this->file_name);
+    // The buffer is being merged or full, switch to another one
+    this->RetireThreadBuffer();
   }
 }
 
@@ -381,37 +1955,62 @@ void PerfData::RecordEdgeData(type::addr_t *call_path, int call_path_len,
                               int out_call_path_len, int procs_id,
                               int out_procs_id, int thread_id,
                               int out_thread_id, perf_data_t value) {
-  // Thread-safe, first fetch a index, then record data
-  unsigned long long int x =
-      __sync_fetch_and_add(&this->edge_perf_data_count, 1);
+  this->RecordEdgeData(call_path, call_path_len, out_call_path,
+                       out_call_path_len, procs_id, out_procs_id, thread_id,
+                       out_thread_id, 0, value);
+}
 
-  this->edge_perf_data[x].call_path_len = call_path_len;
-  for (int i = 0; i < call_path_len; i++) {
-    this->edge_perf_data[x].call_path[i] = call_path[i];
-  }
-  this->edge_perf_data[x].out_call_path_len = out_call_path_len;
-  for (int i = 0; i < out_call_path_len; i++) {
-    this->edge_perf_data[x].out_call_path[i] = out_call_path[i];
+void PerfData::RecordEdgeData(type::addr_t *call_path, int call_path_len,
+                              type::addr_t *out_call_path,
+                              int out_call_path_len, int procs_id,
+                              int out_procs_id, int thread_id,
+                              int out_thread_id, int metric_index,
+                              perf_data_t value) {
+  if (metric_index < 0 || metric_index >= (int)this->metric_names.size()) {
+    LOG_ERROR("Failed to record edge data, no metric %d\n", metric_index);
+    return;
   }
-
-  this->edge_perf_data[x].value = value;
+  // Edge data is recorded out of signal handlers, serialize with Dump
+  SpinLock(&(this->shared_data_lock));
+  unsigned long long int x = this->edge_perf_data_count++;
+
+  this->edge_perf_data[x].cct_node_id =
+      this->InsertCCTPath(call_path, call_path_len);
+  this->edge_perf_data[x].out_cct_node_id =
+      this->InsertCCTPath(out_call_path, out_call_path_len);
+
+  // Slots are reused after dump
+  memset(this->edge_perf_data[x].value, 0,
+         sizeof(this->edge_perf_data[x].value));
+  this->edge_perf_data[x].value[metric_index] = value;
   this->edge_perf_data[x].thread_id = thread_id;
   this->edge_perf_data[x].procs_id = procs_id;
   this->edge_perf_data[x].out_thread_id = out_thread_id;
   this->edge_perf_data[x].out_procs_id = out_procs_id;
 
+  // Edge data is not aggregated, only make it reachable by QueryEdgeData
+  IndexEdgeData(this->edge_perf_data_index, this->edge_perf_data_index_size,
+                this->edge_perf_data, x);
+
   if (this->edge_perf_data_count >= this->edge_perf_data_space_size - 5) {
-    // TODO: asynchronous dump
-    this->Dump(this->file_name);
+    this->FlushSharedData(true);
+  }
+  SpinUnlock(&(this->shared_data_lock));
+}
+
+/** Push a call path from the innermost frame by walking up the CCT */
+static void PushCCTPath(CCTN *cct_nodes, unsigned long int cct_node_id,
+                        std::stack<type::addr_t> &call_path_stack) {
+  while (cct_node_id != CCT_ROOT) {
+    call_path_stack.push(cct_nodes[cct_node_id].addr);
+    cct_node_id = cct_nodes[cct_node_id].parent;
   }
 }
 
 void PerfData::GetVertexDataCallPath(
     unsigned long int data_index, std::stack<type::addr_t> &call_path_stack) {
   VDS *data = &(this->vertex_perf_data[data_index]);
-  for (int i = 0; i < data->call_path_len; i++) {
-    call_path_stack.push(data->call_path[i]);
-  }
+  PushCCTPath(this->cct_nodes, data->cct_node_id, call_path_stack);
   preserve_call_path_tail_so_addr(call_path_stack);
   return;
 }
@@ -430,9 +2029,7 @@ void PerfData::GetVertexDataCallPath(
 void PerfData::GetEdgeDataSrcCallPath(
     unsigned long int data_index, std::stack<type::addr_t> &call_path_stack) {
   EDS *data = &(this->edge_perf_data[data_index]);
-  for (int i = 0; i < data->call_path_len; i++) {
-    call_path_stack.push(data->call_path[i]);
-  }
+  PushCCTPath(this->cct_nodes, data->cct_node_id, call_path_stack);
   // delete_all_so_addr(call_path_stack);
   preserve_call_path_tail_so_addr(call_path_stack);
   return;
@@ -441,22 +2038,209 @@ void PerfData::GetEdgeDataSrcCallPath(
 void PerfData::GetEdgeDataDestCallPath(
     unsigned long int data_index, std::stack<type::addr_t> &call_path_stack) {
   EDS *data = &(this->edge_perf_data[data_index]);
-  for (int i = 0; i < data->out_call_path_len; i++) {
-    call_path_stack.push(data->out_call_path[i]);
-  }
+  PushCCTPath(this->cct_nodes, data->out_cct_node_id, call_path_stack);
   // delete_all_so_addr(call_path_stack);
   preserve_call_path_tail_so_addr(call_path_stack);
   return;
 }
 
+/** Fill a call path from the CCT into the tail of a buffer, from the outermost
+ * frame, filtered as preserve_call_path_tail_so_addr does: invalid addresses
+ * are dropped, and shared object addresses are only kept below the innermost
+ * executable address. The call path is walked from the innermost frame, so
+ * it is written backwards from the end of the buffer. */
+static type::addr_t *FillCCTPath(CCTN *cct_nodes, unsigned long int cct_node_id,
+                                 std::vector<type::addr_t> &buffer,
+                                 int &call_path_len) {
+  int depth = cct_nodes[cct_node_id].depth;
+  if ((int)buffer.size() < depth) {
+    buffer.resize(depth);
+  }
+  int pos = depth;
+  bool exe_addr_exist = false;
+  while (cct_node_id != CCT_ROOT) {
+    type::addr_t addr = cct_nodes[cct_node_id].addr;
+    cct_node_id = cct_nodes[cct_node_id].parent;
+    if (!type::IsValidAddr(addr)) {
+      continue;
+    }
+    if (type::IsTextAddr(addr)) {
+      buffer[--pos] = addr;
+      exe_addr_exist = true;
+    } else if (exe_addr_exist == false) {
+      buffer[--pos] = addr;
+    }
+  }
+  call_path_len = depth - pos;
+  return buffer.data() + pos;
+}
+
+type::addr_t *
+PerfData::GetVertexDataCallPath(unsigned long int data_index,
+                                std::vector<type::addr_t> &buffer,
+                                int &call_path_len) {
+  return FillCCTPath(this->cct_nodes,
+                     this->vertex_perf_data[data_index].cct_node_id, buffer,
+                     call_path_len);
+}
+
+type::addr_t *
+PerfData::GetEdgeDataSrcCallPath(unsigned long int data_index,
+                                 std::vector<type::addr_t> &buffer,
+                                 int &call_path_len) {
+  return FillCCTPath(this->cct_nodes,
+                     this->edge_perf_data[data_index].cct_node_id, buffer,
+                     call_path_len);
+}
+
+type::addr_t *
+PerfData::GetEdgeDataDestCallPath(unsigned long int data_index,
+                                  std::vector<type::addr_t> &buffer,
+                                  int &call_path_len) {
+  return FillCCTPath(this->cct_nodes,
+                     this->edge_perf_data[data_index].out_cct_node_id, buffer,
+                     call_path_len);
+}
+
+VertexDataIterator PerfData::VertexDataBegin() {
+  return VertexDataIterator(this, 0);
+}
+
+VertexDataIterator PerfData::VertexDataEnd() {
+  return VertexDataIterator(this, this->GetVertexDataSize());
+}
+
+VertexDataRange PerfData::GetVertexDataRange() { return VertexDataRange(this); }
+
+VertexDataIterator::VertexDataIterator(PerfData *perf_data,
+                                       unsigned long int data_index)
+    : perf_data(perf_data), data_index(data_index) {
+  this->Load();
+}
+
+void VertexDataIterator::Load() {
+  if (this->data_index < this->perf_data->GetVertexDataSize()) {
+    type::addr_t *call_path = this->perf_data->GetVertexDataCallPath(
+        this->data_index, this->buffer, this->call_path_len);
+    this->call_path_offset = call_path - this->buffer.data();
+  } else {
+    this->call_path_offset = 0;
+    this->call_path_len = 0;
+  }
+}
+
+VertexDataIterator &VertexDataIterator::operator++() {
+  this->data_index++;
+  this->Load();
+  return *this;
+}
+
+VertexDataIterator VertexDataIterator::operator++(int) {
+  VertexDataIterator old = *this;
+  ++(*this);
+  return old;
+}
+
+VertexDataIterator::reference VertexDataIterator::operator*() const {
+  return *this;
+}
+
+VertexDataIterator::pointer VertexDataIterator::operator->() const {
+  return this;
+}
+
+bool VertexDataIterator::operator==(const VertexDataIterator &other) const {
+  return this->data_index == other.data_index &&
+         this->perf_data == other.perf_data;
+}
+
+bool VertexDataIterator::operator!=(const VertexDataIterator &other) const {
+  return !(*this == other);
+}
+
+unsigned long int VertexDataIterator::GetDataIndex() const {
+  return this->data_index;
+}
+
+const type::addr_t *VertexDataIterator::GetCallPath() const {
+  if (this->call_path_len == 0) {
+    return nullptr;
+  }
+  return this->buffer.data() + this->call_path_offset;
+}
+
+int VertexDataIterator::GetCallPathLen() const { return this->call_path_len; }
+
+type::perf_data_t VertexDataIterator::GetValue(int metric_index) const {
+  return this->perf_data->GetVertexDataValue(this->data_index, metric_index);
+}
+
+int VertexDataIterator::GetProcsId() const {
+  return this->perf_data->GetVertexDataProcsId(this->data_index);
+}
+
+int VertexDataIterator::GetThreadId() const {
+  return this->perf_data->GetVertexDataThreadId(this->data_index);
+}
+
+VertexDataRange::VertexDataRange(PerfData *perf_data) : perf_data(perf_data) {}
+
+VertexDataIterator VertexDataRange::begin() const {
+  return this->perf_data->VertexDataBegin();
+}
+
+VertexDataIterator VertexDataRange::end() const {
+  return this->perf_data->VertexDataEnd();
+}
+
+unsigned long int PerfData::GetVertexDataCCTNode(unsigned long int data_index) {
+  return this->vertex_perf_data[data_index].cct_node_id;
+}
+
+unsigned long int
+PerfData::GetEdgeDataSrcCCTNode(unsigned long int data_index) {
+  return this->edge_perf_data[data_index].cct_node_id;
+}
+
+unsigned long int
+PerfData::GetEdgeDataDestCCTNode(unsigned long int data_index) {
+  return this->edge_perf_data[data_index].out_cct_node_id;
+}
+
+unsigned long int PerfData::GetCCTSize() { return this->cct_node_count; }
+
+type::addr_t PerfData::GetCCTNodeAddr(unsigned long int node_id) {
+  return this->cct_nodes[node_id].addr;
+}
+
+unsigned long int PerfData::GetCCTNodeParent(unsigned long int node_id) {
+  return this->cct_nodes[node_id].parent;
+}
+
+int PerfData::GetCCTNodeDepth(unsigned long int node_id) {
+  return this->cct_nodes[node_id].depth;
+}
+
 perf_data_t PerfData::GetVertexDataValue(unsigned long int data_index) {
   VDS *data = &(this->vertex_perf_data[data_index]);
-  return data->value;
+  return data->value[0];
+}
+
+perf_data_t PerfData::GetVertexDataValue(unsigned long int data_index,
+                                         int metric_index) {
+  VDS *data = &(this->vertex_perf_data[data_index]);
+  return data->value[metric_index];
 }
 
 perf_data_t PerfData::GetEdgeDataValue(unsigned long int data_index) {
   EDS *data = &(this->edge_perf_data[data_index]);
-  return data->value;
+  return data->value[0];
+}
+
+perf_data_t PerfData::GetEdgeDataValue(unsigned long int data_index,
+                                       int metric_index) {
+  EDS *data = &(this->edge_perf_data[data_index]);
+  return data->value[metric_index];
 }
 
 int PerfData::GetVertexDataProcsId(unsigned long int data_index) {
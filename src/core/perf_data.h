@@ -7,9 +7,13 @@
 #include <cstdio>
 #include <cstdlib>
 #include <fstream>
+#include <pthread.h>
+#include <semaphore.h>
 #include <stack>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string>
+#include <vector>
 
 #ifndef MAX_CALL_PATH_DEPTH
 #define MAX_CALL_PATH_DEPTH 50
@@ -23,32 +27,187 @@
 #define MAX_LINE_LEN 256
 #endif
 
+#ifndef MAX_THREAD_BUFFER_MEM
+#define MAX_THREAD_BUFFER_MEM 4194304
+#endif
+
+#define PERF_DATA_MAGIC "BGPFDATA"
+#define PERF_DATA_MAGIC_LEN 8
+#define PERF_DATA_VERSION 3
+
+#define MAX_METRIC_NAME_LEN 32
+
+#ifndef MAX_SAMPLE_MEM
+#define MAX_SAMPLE_MEM 1073741824
+#endif
+
+#ifndef MAX_DOWNSAMPLE_RATE
+#define MAX_DOWNSAMPLE_RATE 1048576
+#endif
+
+#ifndef MAX_CCT_MEM
+#define MAX_CCT_MEM 1073741824
+#endif
+
+// Initial memory of each of vertex data, edge data and CCT nodes of a
+// read-only PerfData, which grows on demand
+#ifndef READ_ONLY_INIT_MEM
+#define READ_ONLY_INIT_MEM 1048576
+#endif
+
+#ifndef CCT_INDEX_INIT_SIZE
+#define CCT_INDEX_INIT_SIZE 65536
+#endif
+
+#define CCT_ROOT 0
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
 namespace baguatool::core {
 
 typedef double perf_data_t;
 typedef unsigned long long int addr_t;
 
-// size : 8 * 50 + 4 + 4 + 4 + 4 = 432
+// Node of the calling context tree (CCT). A call path is stored once as a
+// chain of parent-linked nodes, from its innermost frame up to the root.
+// size : 8 + 8 + 4 (+ 4) = 24
+typedef struct CCT_NODE_STRUCT {
+  type::addr_t addr = 0;        // address of the innermost frame
+  unsigned long int parent = 0; // caller node, CCT_ROOT for outermost frame
+  int depth = 0;                // length of the call path
+} CCTN;
+
+// size : 8 + 8 * MAX_NUM_METRICS + 4 + 4 = 64
 typedef struct VERTEX_DATA_STRUCT {
-  type::addr_t call_path[MAX_CALL_PATH_DEPTH] = {0}; //
-  int call_path_len = 0;                             //
-  perf_data_t value = 0;                             //
-  int procs_id = 0;                                  // process id
-  int thread_id = 0;                                 // user-defined thread id
+  unsigned long int cct_node_id = CCT_ROOT; // call path
+  perf_data_t value[MAX_NUM_METRICS] = {0}; // one column per metric
+  int procs_id = 0;                         // process id
+  int thread_id = 0;                        // user-defined thread id
 } VDS;
 
 typedef struct EDGE_DATA_STRUCT {
-  type::addr_t call_path[MAX_CALL_PATH_DEPTH] = {0};     //
-  int call_path_len = 0;                                 //
-  type::addr_t out_call_path[MAX_CALL_PATH_DEPTH] = {0}; //
-  int out_call_path_len = 0;                             //
-  perf_data_t value = 0;                                 //
-  int procs_id = 0;                                      // process id
+  unsigned long int cct_node_id = CCT_ROOT;     // call path
+  unsigned long int out_cct_node_id = CCT_ROOT; // call path of destination
+  perf_data_t value[MAX_NUM_METRICS] = {0};     // one column per metric
+  int procs_id = 0;                             // process id
   int out_procs_id = 0;  // process id of communication process
   int thread_id = 0;     // user-defined thread id
   int out_thread_id = 0; // user-defined thread id of a created thread
 } EDS;
 
+// Raw sample in a thread buffer, its call path is inline because CCT
+// insertion is not async-signal-safe.
+// size : 8 * 50 + 4 (+ 4) + 8 * MAX_NUM_METRICS + 4 + 4 = 464
+typedef struct SAMPLE_DATA_STRUCT {
+  type::addr_t call_path[MAX_CALL_PATH_DEPTH] = {0}; //
+  int call_path_len = 0;                             //
+  perf_data_t value[MAX_NUM_METRICS] = {0};          // one column per metric
+  int procs_id = 0;                                  // process id
+  int thread_id = 0;                                 // user-defined thread id
+} SDS;
+
+// Header of a section of a binary performance data file, a file holds one
+// section per dump. A section carries the CCT nodes created since the last
+// section, so node ids are local to a file and a node always follows its
+// parent. Columns follow the header in this order, 8-byte columns first to
+// keep them aligned:
+//   char         metric name         [num_metrics][MAX_METRIC_NAME_LEN]
+//   uint64_t     CCT node parent     [num_cct_nodes]
+//   type::addr_t CCT node address    [num_cct_nodes]
+//   uint64_t     vertex CCT node id  [num_vertex_data]
+//   perf_data_t  vertex value        [num_metrics][num_vertex_data]
+//   uint64_t     edge src CCT node id, dest CCT node id [num_edge_data] each
+//   perf_data_t  edge value          [num_metrics][num_edge_data]
+//   int32_t      vertex procs_id, thread_id [num_vertex_data] each
+//   int32_t      edge procs_id, out_procs_id, thread_id, out_thread_id
+//                [num_edge_data] each
+// and the section is padded to a multiple of 8 bytes. Version 2 has neither
+// num_metrics nor metric names, and one value column of each type.
+typedef struct PERF_DATA_HEADER_STRUCT {
+  char magic[PERF_DATA_MAGIC_LEN] = {0}; // PERF_DATA_MAGIC, no trailing null
+  uint32_t version = PERF_DATA_VERSION;  //
+  uint32_t header_size = 0;              // sizeof(PDH) of the writer
+  uint64_t section_size = 0;             // header + columns + padding
+  uint64_t first_cct_node = 0;           // id of the first CCT node
+  uint64_t num_cct_nodes = 0;            //
+  uint64_t num_vertex_data = 0;          //
+  uint64_t num_edge_data = 0;            //
+  uint64_t num_dropped_samples = 0;      // dropped since the last section
+  uint64_t num_metrics = 1;              // number of value columns
+  perf_data_t sample_period = 0;         // events between two samples
+  perf_data_t sample_event_rate = 0;     // events per second of the event
+} PDH;
+
+// Size of the header before num_dropped_samples was added, the header only
+// grows at its end and readers skip what they do not know by header_size
+#define PERF_DATA_MIN_HEADER_SIZE 56
+// Size of the header of version 3, which adds num_metrics
+#define PERF_DATA_V3_HEADER_SIZE 72
+// Size of the header with sample_period and sample_event_rate
+#define PERF_DATA_PERIOD_HEADER_SIZE 88
+
+enum thread_buffer_state_t {
+  TBS_FREE = 0,    // not owned, can be claimed by any thread
+  TBS_ACTIVE = 1,  // owned by a thread that records into it
+  TBS_RETIRED = 2, // given up by its owner, waiting for merge
+};
+
+// Private sample buffer of a thread. Header, records and hash index live in
+// one arena chunk, so buffers of different threads never share a cache line.
+typedef struct alignas(CACHE_LINE_SIZE) THREAD_BUFFER_STRUCT {
+  volatile int lock = 0; // held by the owner while recording, by Dump while
+                         // merging
+  volatile int state = TBS_FREE;           // thread_buffer_state_t
+  SDS *sample_data = nullptr;              //
+  unsigned long int sample_data_count = 0; //
+  unsigned long int sample_data_space_size = 0;
+  unsigned long int *sample_data_index = nullptr; // slot -> data index + 1
+  unsigned long int sample_data_index_size = 0;   //
+  size_t mem_size = 0;                            // size of arena chunk
+  struct THREAD_BUFFER_STRUCT *next = nullptr; // lock-free list of buffers
+} TBS;
+
+// Back buffer and writer thread of async dump. The front buffer is handed to
+// the writer by swapping it with the back one, which must be written before
+// the next swap.
+typedef struct ASYNC_DUMP_STRUCT {
+  PerfData *perf_data = nullptr;           // owner
+  VDS *vertex_data = nullptr;              // back buffer of vertex data
+  unsigned long int vertex_data_count = 0; //
+  EDS *edge_data = nullptr;                // back buffer of edge data
+  unsigned long int edge_data_count = 0;   //
+  volatile int pending = 0;                // back buffer is waiting to be
+                                           // written
+  volatile int stop = 0;                   // writer thread should exit
+  sem_t sem;        // posted on swap and stop, sem_post is async-signal-safe
+  pthread_t thread; //
+  unsigned long int cct_node_count = 0; // CCT nodes created before swap
+  unsigned long int dropped_sample_count = 0; // dropped before swap
+  unsigned long int swap_count = 0;     // number of swaps
+  unsigned long int byte_count = 0;     // bytes written to output files
+} ADS;
+
+// Memory of per-thread sample buffers. Address space of the memory cap is
+// reserved at once and committed by the kernel page by page on first touch.
+// Chunks are carved by an atomic bump pointer and never freed, so the arena
+// can be extended in a signal handler.
+typedef struct ARENA_STRUCT {
+  char *base = nullptr;          //
+  size_t size = 0;               // memory cap
+  volatile size_t used_size = 0; //
+} ARENA;
+
+// Files of ReadAll parsed by one reader thread into its own PerfData
+typedef struct READ_SHARD_STRUCT {
+  PerfData *perf_data = nullptr;                        // shard
+  const std::vector<std::string> *file_names = nullptr; //
+  unsigned long int begin = 0; // first file of the shard
+  unsigned long int end = 0;   // one past the last file
+  pthread_t thread;            //
+} RSS;
+
 // class PerfData {
 //  private:
 //   VDS* vertex_perf_data = nullptr;
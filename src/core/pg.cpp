@@ -236,6 +236,62 @@ type::vertex_t ProgramGraph::GetVertexWithCallPath(
 
 } // function GetVertexWithCallPath
 
+type::vertex_t ProgramGraph::GetVertexWithCallPath(
+    type::vertex_t root_vertex, const type::addr_t *call_path,
+    int call_path_len) {
+  // Walk the call path from the outermost frame, the same as popping the stack
+  // in the version above, but iteratively and without copying the call path
+  for (int i = 0; i < call_path_len; i++) {
+    type::addr_t addr = call_path[i];
+
+    /** Read address that already queried **/
+    auto cache_iter = this->call_path_to_vid.find(root_vertex);
+    if (cache_iter != this->call_path_to_vid.end()) {
+      auto vid_iter = cache_iter->second.find(addr);
+      if (vid_iter != cache_iter->second.end()) {
+        root_vertex = vid_iter->second;
+        continue;
+      }
+    }
+
+    /** Step over .dynamic address */
+    if (type::IsDynAddr(addr)) {
+      continue;
+    }
+
+    // Find the CALL vertex of current addr, addr is from calling context
+    type::vertex_t found_vertex = root_vertex;
+    type::vertex_t child_vertex = -1;
+    while (1) {
+      child_vertex = GetChildVertexWithAddr(found_vertex, addr);
+      if (-1 == child_vertex) {
+        break;
+      }
+      found_vertex = child_vertex;
+
+      // If found_vertex is type::FUNC_NODE or type::LOOP_NODE, then continue
+      // searching child_vertex
+      auto found_vertex_type = GetVertexType(found_vertex);
+      if (type::FUNC_NODE != found_vertex_type &&
+          type::LOOP_NODE != found_vertex_type &&
+          type::BB_NODE != found_vertex_type) {
+        break;
+      }
+    }
+
+    if (-1 == child_vertex) {
+      return found_vertex;
+    }
+
+    /** Store address as queried **/
+    this->call_path_to_vid[root_vertex].insert(
+        std::make_pair(addr, found_vertex));
+    root_vertex = found_vertex;
+  }
+
+  return root_vertex;
+} // function GetVertexWithCallPath
+
 // void
 typedef struct CallVertexWithAddrArg {
   type::addr_t addr;             // input
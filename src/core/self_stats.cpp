@@ -0,0 +1,133 @@
+#include "baguatool.h"
+#include "common/tprintf.h"
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// Threads with their own counters, later threads share the last slot
+#ifndef MAX_SELF_STAT_THREADS
+#define MAX_SELF_STAT_THREADS 1024
+#endif
+
+namespace baguatool::core {
+
+typedef struct SELF_STAT_SLOT_STRUCT {
+  long tid = 0;
+  unsigned long long value[NUM_SELF_STATS] = {0};
+} SSS;
+
+// Slots are claimed with an atomic increment and never freed, which is
+// async-signal-safe unlike malloc
+static SSS self_stat_slots[MAX_SELF_STAT_THREADS];
+static int num_self_stat_slots = 0;
+static __thread SSS *thread_self_stat_slot = nullptr;
+
+static const char *self_stat_names[NUM_SELF_STATS] = {
+    "samples",   "dropped_samples", "handler_ns",    "unwind_ns",
+    "lookup_ns", "traced_calls",    "trace_ns",      "dump_ns",
+    "bytes",     "peak_mem"};
+
+unsigned long long GetSelfStatTime() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static unsigned long long self_stat_start_time = GetSelfStatTime();
+
+static int GetNumSelfStatSlots() {
+  int num_slots = num_self_stat_slots;
+  return num_slots < MAX_SELF_STAT_THREADS ? num_slots : MAX_SELF_STAT_THREADS;
+}
+
+static SSS *GetSelfStatSlot() {
+  if (thread_self_stat_slot == nullptr) {
+    int i = __sync_fetch_and_add(&num_self_stat_slots, 1);
+    if (i >= MAX_SELF_STAT_THREADS) {
+      i = MAX_SELF_STAT_THREADS - 1;
+      thread_self_stat_slot = &(self_stat_slots[i]);
+      thread_self_stat_slot->tid = -1;
+    } else {
+      thread_self_stat_slot = &(self_stat_slots[i]);
+      thread_self_stat_slot->tid = syscall(SYS_gettid);
+    }
+  }
+  return thread_self_stat_slot;
+}
+
+void AddSelfStat(SelfStat stat, unsigned long long value) {
+  unsigned long long *counter = &(GetSelfStatSlot()->value[stat]);
+  if (stat != STAT_PEAK_MEM) {
+    __sync_fetch_and_add(counter, value);
+    return;
+  }
+  unsigned long long peak = *counter;
+  while (value > peak && !__sync_bool_compare_and_swap(counter, peak, value)) {
+    peak = *counter;
+  }
+}
+
+unsigned long long GetSelfStat(SelfStat stat) {
+  unsigned long long total = 0;
+  for (int i = 0; i < GetNumSelfStatSlots(); i++) {
+    unsigned long long value = self_stat_slots[i].value[stat];
+    if (stat == STAT_PEAK_MEM) {
+      total = value > total ? value : total;
+    } else {
+      total += value;
+    }
+  }
+  return total;
+}
+
+/** Print the share of the time of num_threads threads over the elapsed time
+ * spent in handlers and tracing
+ */
+static void PrintOverhead(FILE *fp, const unsigned long long *value,
+                          unsigned long long elapsed, int num_threads) {
+  double overhead = value[STAT_HANDLER_TIME] + value[STAT_TRACE_TIME];
+  double thread_time = (double)elapsed * num_threads;
+  fprintf(fp, " %.4f\n", thread_time > 0 ? overhead / thread_time : 0);
+}
+
+void DumpSelfStats(const char *file_name) {
+  FILE *fp = fopen(file_name, "w");
+  if (fp == nullptr) {
+    LOG_ERROR("Failed to open %s\n", file_name);
+    return;
+  }
+  unsigned long long elapsed = GetSelfStatTime() - self_stat_start_time;
+  fprintf(fp, "elapsed_ns %llu\n", elapsed);
+  fprintf(fp, "tid");
+  for (int s = 0; s < NUM_SELF_STATS; s++) {
+    fprintf(fp, " %s", self_stat_names[s]);
+  }
+  fprintf(fp, " overhead\n");
+
+  // tid -1 stands for the threads sharing the last slot
+  unsigned long long total[NUM_SELF_STATS] = {0};
+  for (int i = 0; i < GetNumSelfStatSlots(); i++) {
+    fprintf(fp, "%ld", self_stat_slots[i].tid);
+    for (int s = 0; s < NUM_SELF_STATS; s++) {
+      fprintf(fp, " %llu", self_stat_slots[i].value[s]);
+    }
+    PrintOverhead(fp, self_stat_slots[i].value, elapsed, 1);
+  }
+  fprintf(fp, "total");
+  for (int s = 0; s < NUM_SELF_STATS; s++) {
+    total[s] = GetSelfStat((SelfStat)s);
+    fprintf(fp, " %llu", total[s]);
+  }
+  // Totals sum the time of all threads, including the ones sharing a slot
+  PrintOverhead(fp, total, elapsed, num_self_stat_slots);
+  fclose(fp);
+
+  LOG_INFO("Collector overhead: %llu samples, %llu dropped, %.3f s in "
+           "handlers, %.3f s in tracing, %llu bytes written\n",
+           total[STAT_SAMPLES], total[STAT_DROPPED_SAMPLES],
+           total[STAT_HANDLER_TIME] / 1e9, total[STAT_TRACE_TIME] / 1e9,
+           total[STAT_BYTES_WRITTEN]);
+}
+
+} // namespace baguatool::core